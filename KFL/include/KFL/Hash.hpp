@@ -36,6 +36,11 @@
 #include <KFL/PreDeclare.hpp>
 #include <KFL/CXX17/string_view.hpp>
 
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
 namespace KlayGE
 {
 #define PRIME_NUM 0x9e3779b9
@@ -114,6 +119,52 @@ namespace KlayGE
 		HashRange(seed, first, last);
 		return seed;
 	}
+
+	// 128-bit hash of a stream of bytes, in 2 lanes with different multipliers. For content keys of on-disk caches, where
+	//  size_t hashes collide too often.
+	class ContentHasher final
+	{
+	public:
+		void Update(void const * data, size_t size)
+		{
+			uint8_t const * p = static_cast<uint8_t const *>(data);
+			for (size_t i = 0; i < size; ++ i)
+			{
+				lanes_[0] = (lanes_[0] ^ p[i]) * 0x100000001B3ULL;
+				lanes_[1] = (lanes_[1] ^ p[i]) * 0x9E3779B97F4A7C15ULL;
+				lanes_[1] ^= lanes_[1] >> 29;
+			}
+		}
+		// Strings are terminated, so ("ab", "c") and ("a", "bc") are different keys
+		void Update(char const * str)
+		{
+			this->Update(str, std::strlen(str) + 1);
+		}
+		void Update(uint32_t v)
+		{
+			this->Update(&v, sizeof(v));
+		}
+
+		std::string HexDigest() const
+		{
+			std::ostringstream ss;
+			ss << std::hex << std::setfill('0');
+			for (uint64_t lane : lanes_)
+			{
+				// MurmurHash3's finalizer
+				lane ^= lane >> 33;
+				lane *= 0xFF51AFD7ED558CCDULL;
+				lane ^= lane >> 33;
+				lane *= 0xC4CEB9FE1A85EC53ULL;
+				lane ^= lane >> 33;
+				ss << std::setw(16) << lane;
+			}
+			return ss.str();
+		}
+
+	private:
+		uint64_t lanes_[2] = { 0xCBF29CE484222325ULL, 0x84222325CBF29CE4ULL };
+	};
 }
 
 #endif		// _KFL_HASH_HPP
@@ -422,6 +422,10 @@ namespace KlayGE
 
 		template <typename T>
 		Matrix4_T<T> inverse(Matrix4_T<T> const & rhs) noexcept;
+		// Inverse of an affine transform (last column is 0, 0, 0, 1) from its 3x3 part and translation. Falls back to
+		//  inverse() for projective matrices.
+		template <typename T>
+		Matrix4_T<T> inverse_affine(Matrix4_T<T> const & rhs) noexcept;
 
 		template <typename T>
 		Matrix4_T<T> look_at_lh(Vector_T<T, 3> const & vEye, Vector_T<T, 3> const & vAt) noexcept;
@@ -53,6 +53,8 @@ namespace KlayGE
 	class joiner;
 	class threader;
 	class thread_pool;
+	class task_scheduler;
+	class task_group;
 
 	class half;
 	template <typename T, int N>
@@ -0,0 +1,148 @@
+/**
+ * @file PtrIndexMap.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _KFL_PTRINDEXMAP_HPP
+#define _KFL_PTRINDEXMAP_HPP
+
+#pragma once
+
+#include <KFL/Types.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+namespace KlayGE
+{
+	// Maps pointers to uint32_t indices with open addressing in a flat array. Clear keeps the array, so a map rebuilt every
+	// frame doesn't allocate once it reaches its working size.
+	template <typename T>
+	class PtrIndexMap
+	{
+	public:
+		// Returns the index of key and false. If key isn't in the map, adds it with new_index and returns new_index and true.
+		std::pair<uint32_t, bool> Emplace(T const * key, uint32_t new_index)
+		{
+			BOOST_ASSERT(key != nullptr);
+
+			if ((size_ + 1) * 2 > slots_.size())
+			{
+				this->Rehash(std::max<size_t>(16, slots_.size() * 2));
+			}
+
+			size_t const mask = slots_.size() - 1;
+			for (size_t i = Hash(key) & mask;; i = (i + 1) & mask)
+			{
+				auto& slot = slots_[i];
+				if (slot.first == key)
+				{
+					return std::make_pair(slot.second, false);
+				}
+				if (slot.first == nullptr)
+				{
+					slot = std::make_pair(key, new_index);
+					++ size_;
+					return std::make_pair(new_index, true);
+				}
+			}
+		}
+
+		uint32_t const * Find(T const * key) const
+		{
+			if (size_ > 0)
+			{
+				size_t const mask = slots_.size() - 1;
+				for (size_t i = Hash(key) & mask; slots_[i].first != nullptr; i = (i + 1) & mask)
+				{
+					if (slots_[i].first == key)
+					{
+						return &slots_[i].second;
+					}
+				}
+			}
+			return nullptr;
+		}
+
+		void Clear()
+		{
+			if (size_ > 0)
+			{
+				std::fill(slots_.begin(), slots_.end(), std::make_pair(static_cast<T const *>(nullptr), 0U));
+				size_ = 0;
+			}
+		}
+
+		size_t Size() const noexcept
+		{
+			return size_;
+		}
+		size_t Capacity() const noexcept
+		{
+			return slots_.size();
+		}
+
+	private:
+		static size_t Hash(T const * key) noexcept
+		{
+			// Fibonacci hashing, the high bits are mixed from all bits of the pointer
+			uint64_t const h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key)) * 0x9E3779B97F4A7C15ULL;
+			return static_cast<size_t>(h >> 32);
+		}
+
+		void Rehash(size_t capacity)
+		{
+			auto const old_slots = std::move(slots_);
+			slots_.assign(capacity, std::make_pair(static_cast<T const *>(nullptr), 0U));
+
+			size_t const mask = slots_.size() - 1;
+			for (auto const & old_slot : old_slots)
+			{
+				if (old_slot.first != nullptr)
+				{
+					size_t i = Hash(old_slot.first) & mask;
+					while (slots_[i].first != nullptr)
+					{
+						i = (i + 1) & mask;
+					}
+					slots_[i] = old_slot;
+				}
+			}
+		}
+
+	private:
+		std::vector<std::pair<T const *, uint32_t>> slots_;
+		size_t size_ = 0;
+	};
+}
+
+#endif		// _KFL_PTRINDEXMAP_HPP
@@ -0,0 +1,110 @@
+/**
+ * @file RadixSort.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _KFL_RADIXSORT_HPP
+#define _KFL_RADIXSORT_HPP
+
+#pragma once
+
+#include <KFL/Types.hpp>
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace KlayGE
+{
+	// Maps a float to an uint32_t with the same order
+	inline uint32_t OrderedFloatBits(float v) noexcept
+	{
+		if (v == 0)
+		{
+			// -0 and +0 are equal
+			v = 0;
+		}
+
+		uint32_t bits;
+		std::memcpy(&bits, &v, sizeof(bits));
+		return (bits & 0x80000000U) ? ~bits : (bits | 0x80000000U);
+	}
+
+	// Stable LSD radix sort on the unsigned integer keys returned by key_func, 8 bits per pass. Passes on bytes that are
+	// the same in all keys are skipped. scratch is the temporary buffer, keeping it across calls avoids allocations.
+	template <typename T, typename KeyFunc>
+	void RadixSort(std::vector<T>& items, std::vector<T>& scratch, KeyFunc key_func)
+	{
+		using KeyType = std::decay_t<decltype(key_func(items[0]))>;
+		static_assert(std::is_unsigned<KeyType>::value, "Keys of radix sort must be unsigned integers");
+
+		if (items.size() <= 1)
+		{
+			return;
+		}
+
+		KeyType all_ones = static_cast<KeyType>(~KeyType(0));
+		KeyType any_ones = 0;
+		for (auto const & item : items)
+		{
+			KeyType const key = key_func(item);
+			all_ones &= key;
+			any_ones |= key;
+		}
+		KeyType const varying_bits = all_ones ^ any_ones;
+
+		scratch.resize(items.size());
+		for (uint32_t shift = 0; shift < sizeof(KeyType) * 8; shift += 8)
+		{
+			if (((varying_bits >> shift) & 0xFF) == 0)
+			{
+				continue;
+			}
+
+			uint32_t offsets[256] = {};
+			for (auto const & item : items)
+			{
+				++ offsets[(key_func(item) >> shift) & 0xFF];
+			}
+			uint32_t sum = 0;
+			for (auto& offset : offsets)
+			{
+				uint32_t const count = offset;
+				offset = sum;
+				sum += count;
+			}
+			for (auto const & item : items)
+			{
+				scratch[offsets[(key_func(item) >> shift) & 0xFF] ++] = item;
+			}
+			items.swap(scratch);
+		}
+	}
+}
+
+#endif		// _KFL_RADIXSORT_HPP
@@ -46,6 +46,7 @@ namespace KlayGE
 {
 	class SIMDVectorF4;
 	class SIMDMatrixF4;
+	enum class BoundOverlap : uint32_t;
 
 	namespace SIMDMathLib
 	{
@@ -252,6 +253,14 @@ namespace KlayGE
 		void ObliqueClipping(SIMDMatrixF4& proj, SIMDVectorF4 const & clip_plane);
 
 
+		// Bound
+		///////////////////////////////////////////////////////////////////////////////
+		// Tests AABBs stored as SoA arrays against a frustum, 4 boxes per iteration.
+		// The results are identical to MathLib::intersect_aabb_frustum.
+		void IntersectAABBFrustum(Frustum const & frustum, float const * min_x, float const * min_y, float const * min_z,
+			float const * max_x, float const * max_y, float const * max_z, size_t num, BoundOverlap* results);
+
+
 		// Color
 		///////////////////////////////////////////////////////////////////////////////
 		SIMDVectorF4 NegativeColor(SIMDVectorF4 const & rhs);
@@ -0,0 +1,195 @@
+/**
+ * @file TaskScheduler.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _KFL_TASKSCHEDULER_HPP
+#define _KFL_TASKSCHEDULER_HPP
+
+#pragma once
+
+#include <KFL/Types.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace KlayGE
+{
+	// A work-stealing scheduler for short jobs. Each worker owns a deque, it pushes and pops its own tasks at the back and
+	//  steals from the front of the others. Tasks submitted from non-worker threads go to a shared injection queue.
+	//  Threads waiting for a counter run pending tasks instead of blocking.
+	// Long-lived loops (loading threads, update thread, audio streaming) should stay on thread_pool, a task that never
+	//  returns takes a worker away from everyone else.
+	class task_scheduler final
+	{
+	public:
+		typedef std::function<void()> task_type;
+
+		// num_workers == 0 means one worker per hardware thread, minus the calling thread, but at least one
+		explicit task_scheduler(uint32_t num_workers = 0);
+		~task_scheduler();
+
+		task_scheduler(task_scheduler const & rhs) = delete;
+		task_scheduler& operator=(task_scheduler const & rhs) = delete;
+
+		uint32_t num_workers() const noexcept
+		{
+			return static_cast<uint32_t>(workers_.size());
+		}
+		// Number of threads that can run tasks at the same time, including the waiting one
+		uint32_t concurrency() const noexcept
+		{
+			return this->num_workers() + 1;
+		}
+
+		// If counter is not null, it's increased now and decreased after the task finishes. An exception thrown by the task
+		//  is logged and dropped, use task_group to get it back.
+		void submit(task_type task, std::atomic<uint32_t>* counter = nullptr);
+
+		// Runs pending tasks until the counter reaches 0
+		void wait(std::atomic<uint32_t> const & counter);
+
+		// Calls func(first, last) on sub-ranges of [begin, end) with no more than grain items. Ranges are split in halves,
+		//  so idle workers steal big pieces first. Returns after all sub-ranges are done.
+		template <typename Func>
+		void parallel_for(uint32_t begin, uint32_t end, uint32_t grain, Func const & func);
+
+	private:
+		struct worker_queue;
+
+		bool try_run_one();
+		void worker_loop(uint32_t index);
+
+	private:
+		std::vector<std::unique_ptr<worker_queue>> queues_;	// One per worker, plus the injection queue at the end
+		std::vector<std::thread> workers_;
+
+		std::atomic<uint32_t> num_pending_tasks_{0};
+		std::atomic<uint32_t> num_sleeping_workers_{0};
+		std::atomic<bool> quit_{false};
+		std::mutex sleep_mutex_;
+		std::condition_variable sleep_cond_;
+	};
+
+	// A set of tasks that can be waited on together. The first exception thrown by a task is rethrown by wait().
+	class task_group final
+	{
+	public:
+		explicit task_group(task_scheduler& scheduler)
+			: scheduler_(scheduler)
+		{
+		}
+		~task_group()
+		{
+			scheduler_.wait(counter_);
+		}
+
+		task_group(task_group const & rhs) = delete;
+		task_group& operator=(task_group const & rhs) = delete;
+
+		template <typename Func>
+		void run(Func&& func)
+		{
+			scheduler_.submit([this, func = std::forward<Func>(func)]() mutable
+				{
+					try
+					{
+						func();
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(exception_mutex_);
+						if (!exception_)
+						{
+							exception_ = std::current_exception();
+						}
+					}
+				}, &counter_);
+		}
+
+		void wait()
+		{
+			scheduler_.wait(counter_);
+			if (exception_)
+			{
+				std::exception_ptr e;
+				std::swap(e, exception_);
+				std::rethrow_exception(e);
+			}
+		}
+
+	private:
+		task_scheduler& scheduler_;
+		std::atomic<uint32_t> counter_{0};
+		std::mutex exception_mutex_;
+		std::exception_ptr exception_;
+	};
+
+	template <typename Func>
+	void task_scheduler::parallel_for(uint32_t begin, uint32_t end, uint32_t grain, Func const & func)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		grain = std::max(grain, 1U);
+		if (workers_.empty() || (end - begin <= grain))
+		{
+			func(begin, end);
+			return;
+		}
+
+		// Queued sub-ranges call split, so it's declared before group to outlive the wait in ~task_group when this thread throws
+		std::function<void(uint32_t, uint32_t)> split;
+		task_group group(*this);
+		split = [&group, &split, grain, &func](uint32_t first, uint32_t last)
+		{
+			while (last - first > grain)
+			{
+				uint32_t const mid = first + (last - first) / 2;
+				group.run([&split, mid, last] { split(mid, last); });
+				last = mid;
+			}
+			func(first, last);
+		};
+		split(begin, end);
+		group.wait();
+	}
+}
+
+#endif		// _KFL_TASKSCHEDULER_HPP
@@ -0,0 +1,233 @@
+/**
+ * @file TaskScheduler.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KFL/KFL.hpp>
+#include <KFL/Log.hpp>
+
+#include <ostream>
+
+#include <KFL/TaskScheduler.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	// Number of failed attempts to find a task before a worker goes to sleep
+	uint32_t const SPIN_COUNT = 64;
+
+	thread_local task_scheduler const * tls_scheduler = nullptr;
+	thread_local uint32_t tls_worker_index = 0;
+}
+
+namespace KlayGE
+{
+	struct task_scheduler::worker_queue
+	{
+		struct entry
+		{
+			task_type task;
+			std::atomic<uint32_t>* counter;
+		};
+
+		std::mutex mutex;
+		std::deque<entry> tasks;
+	};
+
+	task_scheduler::task_scheduler(uint32_t num_workers)
+	{
+		if (num_workers == 0)
+		{
+			// The main thread helps only while it waits. At least one worker runs the tasks that are submitted and never waited
+			//  for, such as texture tile and audio decoding, on a single core too.
+			num_workers = std::max(std::thread::hardware_concurrency(), 2U) - 1;
+		}
+
+		for (uint32_t i = 0; i <= num_workers; ++ i)
+		{
+			queues_.push_back(MakeUniquePtr<worker_queue>());
+		}
+
+		workers_.reserve(num_workers);
+		for (uint32_t i = 0; i < num_workers; ++ i)
+		{
+			workers_.emplace_back([this, i] { this->worker_loop(i); });
+		}
+	}
+
+	task_scheduler::~task_scheduler()
+	{
+		quit_ = true;
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+			sleep_cond_.notify_all();
+		}
+		for (auto& worker : workers_)
+		{
+			worker.join();
+		}
+
+		// Tasks left behind still have to run, someone could be waiting on their counters
+		while (this->try_run_one())
+		{
+		}
+	}
+
+	void task_scheduler::submit(task_type task, std::atomic<uint32_t>* counter)
+	{
+		if (counter != nullptr)
+		{
+			counter->fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Counted before the task is visible, so the decrement in try_run_one can't get ahead of it and wrap around.
+		// Pairs with the check in worker_loop. Either the worker sees the new task, or this thread sees the sleeping worker.
+		++ num_pending_tasks_;
+
+		uint32_t const index = (tls_scheduler == this) ? tls_worker_index : static_cast<uint32_t>(queues_.size() - 1);
+		{
+			auto& queue = *queues_[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back({ std::move(task), counter });
+		}
+
+		if (num_sleeping_workers_ > 0)
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+			sleep_cond_.notify_one();
+		}
+	}
+
+	void task_scheduler::wait(std::atomic<uint32_t> const & counter)
+	{
+		while (counter.load(std::memory_order_acquire) != 0)
+		{
+			if (!this->try_run_one())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	bool task_scheduler::try_run_one()
+	{
+		uint32_t const num_queues = static_cast<uint32_t>(queues_.size());
+		uint32_t const injection_index = num_queues - 1;
+		uint32_t const self = (tls_scheduler == this) ? tls_worker_index : injection_index;
+
+		worker_queue::entry task;
+		bool found = false;
+		{
+			// Newest first from a worker's own queue, it's still hot in cache. Oldest first from the injection queue.
+			auto& queue = *queues_[self];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				if (self == injection_index)
+				{
+					task = std::move(queue.tasks.front());
+					queue.tasks.pop_front();
+				}
+				else
+				{
+					task = std::move(queue.tasks.back());
+					queue.tasks.pop_back();
+				}
+				found = true;
+			}
+		}
+		for (uint32_t i = 1; !found && (i < num_queues); ++ i)
+		{
+			// Steals the oldest task, which is usually the biggest piece of a split range
+			auto& queue = *queues_[(self + i) % num_queues];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+				found = true;
+			}
+		}
+
+		if (!found)
+		{
+			return false;
+		}
+
+		-- num_pending_tasks_;
+		try
+		{
+			task.task();
+		}
+		catch (std::exception const & e)
+		{
+			// Letting it out would terminate a worker, or surface in an unrelated wait on this thread
+			LogError() << "Task failed: " << e.what() << std::endl;
+		}
+		catch (...)
+		{
+			LogError() << "Task failed with an unknown exception" << std::endl;
+		}
+		if (task.counter != nullptr)
+		{
+			task.counter->fetch_sub(1, std::memory_order_release);
+		}
+
+		return true;
+	}
+
+	void task_scheduler::worker_loop(uint32_t index)
+	{
+		tls_scheduler = this;
+		tls_worker_index = index;
+
+		uint32_t spin = 0;
+		while (!quit_)
+		{
+			if (this->try_run_one())
+			{
+				spin = 0;
+			}
+			else if (spin < SPIN_COUNT)
+			{
+				++ spin;
+				std::this_thread::yield();
+			}
+			else
+			{
+				std::unique_lock<std::mutex> lock(sleep_mutex_);
+				++ num_sleeping_workers_;
+				sleep_cond_.wait(lock, [this] { return quit_ || (num_pending_tasks_ > 0); });
+				-- num_sleeping_workers_;
+				spin = 0;
+			}
+		}
+	}
+}
@@ -881,6 +881,50 @@ namespace KlayGE
 			}
 		}
 
+		template float4x4 inverse_affine(float4x4 const & rhs) noexcept;
+
+		template <typename T>
+		Matrix4_T<T> inverse_affine(Matrix4_T<T> const & rhs) noexcept
+		{
+			T const * rhs_data = rhs.data();
+			if ((rhs_data[3] != 0) || (rhs_data[7] != 0) || (rhs_data[11] != 0) || (rhs_data[15] != 1))
+			{
+				return inverse(rhs);
+			}
+
+			T const c00(rhs_data[5] * rhs_data[10] - rhs_data[6] * rhs_data[9]);
+			T const c01(rhs_data[6] * rhs_data[8] - rhs_data[4] * rhs_data[10]);
+			T const c02(rhs_data[4] * rhs_data[9] - rhs_data[5] * rhs_data[8]);
+
+			T const det(rhs_data[0] * c00 + rhs_data[1] * c01 + rhs_data[2] * c02);
+			if (equal<T>(det, 0))
+			{
+				return rhs;
+			}
+
+			T const inv_det(T(1) / det);
+
+			T const i00(c00 * inv_det);
+			T const i01((rhs_data[2] * rhs_data[9] - rhs_data[1] * rhs_data[10]) * inv_det);
+			T const i02((rhs_data[1] * rhs_data[6] - rhs_data[2] * rhs_data[5]) * inv_det);
+			T const i10(c01 * inv_det);
+			T const i11((rhs_data[0] * rhs_data[10] - rhs_data[2] * rhs_data[8]) * inv_det);
+			T const i12((rhs_data[2] * rhs_data[4] - rhs_data[0] * rhs_data[6]) * inv_det);
+			T const i20(c02 * inv_det);
+			T const i21((rhs_data[1] * rhs_data[8] - rhs_data[0] * rhs_data[9]) * inv_det);
+			T const i22((rhs_data[0] * rhs_data[5] - rhs_data[1] * rhs_data[4]) * inv_det);
+
+			T const tx(rhs_data[12]);
+			T const ty(rhs_data[13]);
+			T const tz(rhs_data[14]);
+
+			return Matrix4_T<T>(
+				i00, i01, i02, 0,
+				i10, i11, i12, 0,
+				i20, i21, i22, 0,
+				-(tx * i00 + ty * i10 + tz * i20), -(tx * i01 + ty * i11 + tz * i21), -(tx * i02 + ty * i12 + tz * i22), 1);
+		}
+
 		template float4x4 look_at_lh(float3 const & vEye, float3 const & vAt) noexcept;
 
 		template <typename T>
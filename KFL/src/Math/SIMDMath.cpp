@@ -30,6 +30,8 @@
 
 #include <KFL/KFL.hpp>
 #include <KFL/SIMDMath.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Frustum.hpp>
 
 #ifdef SIMD_MATH_SSE
 	#include <emmintrin.h>
@@ -2155,6 +2157,102 @@ namespace KlayGE
 			proj.Col(2, clip_plane * SetVector(c));
 		}
 
+
+		// Bound
+		///////////////////////////////////////////////////////////////////////////////
+		void IntersectAABBFrustum(Frustum const & frustum, float const * min_x, float const * min_y, float const * min_z,
+			float const * max_x, float const * max_y, float const * max_z, size_t num, BoundOverlap* results)
+		{
+			// The corner pair tested against a plane only depends on the signs of the plane normal,
+			// so it is picked once per plane and shared by all boxes.
+			struct PlaneTest
+			{
+				SIMDVectorF4 a, b, c, d;
+				uint32_t v0[3];
+				uint32_t v1[3];
+			};
+			PlaneTest tests[6];
+			for (uint32_t i = 0; i < 6; ++ i)
+			{
+				Plane const & plane = frustum.FrustumPlane(i);
+				auto& test = tests[i];
+				test.a = SetVector(plane.a());
+				test.b = SetVector(plane.b());
+				test.c = SetVector(plane.c());
+				test.d = SetVector(plane.d());
+
+				// Rows 0-2 are min xyz, rows 3-5 are max xyz. v1 is diagonally opposed to v0.
+				test.v0[0] = (plane.a() < 0) ? 0 : 3;
+				test.v0[1] = (plane.b() < 0) ? 1 : 4;
+				test.v0[2] = (plane.c() < 0) ? 2 : 5;
+				test.v1[0] = (plane.a() < 0) ? 3 : 0;
+				test.v1[1] = (plane.b() < 0) ? 4 : 1;
+				test.v1[2] = (plane.c() < 0) ? 5 : 2;
+			}
+
+			float const * const src[] = { min_x, min_y, min_z, max_x, max_y, max_z };
+			for (size_t base = 0; base < num; base += 4)
+			{
+				uint32_t const num_lanes = static_cast<uint32_t>(std::min<size_t>(num - base, 4));
+
+				alignas(16) float lanes[6][4] = {};
+				for (uint32_t row = 0; row < 6; ++ row)
+				{
+					for (uint32_t j = 0; j < num_lanes; ++ j)
+					{
+						lanes[row][j] = src[row][base + j];
+					}
+				}
+
+				SIMDVectorF4 rows[6];
+				for (uint32_t row = 0; row < 6; ++ row)
+				{
+					rows[row] = LoadVector4(lanes[row]);
+				}
+
+				uint32_t outside = 0;
+				uint32_t intersect = 0;
+				for (auto const & test : tests)
+				{
+					// Same evaluation order as MathLib::dot_coord, a * x + b * y + c * z + d
+					SIMDVectorF4 const dist0 = Add(Add(Add(Multiply(test.a, rows[test.v0[0]]), Multiply(test.b, rows[test.v0[1]])),
+						Multiply(test.c, rows[test.v0[2]])), test.d);
+					SIMDVectorF4 const dist1 = Add(Add(Add(Multiply(test.a, rows[test.v1[0]]), Multiply(test.b, rows[test.v1[1]])),
+						Multiply(test.c, rows[test.v1[2]])), test.d);
+
+#if defined(SIMD_MATH_SSE)
+					__m128 const zero = _mm_setzero_ps();
+					outside |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(dist0.Vec(), zero)));
+					intersect |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(dist1.Vec(), zero)));
+#else
+					for (uint32_t j = 0; j < 4; ++ j)
+					{
+						outside |= (dist0.Vec()[j] < 0) ? (1U << j) : 0;
+						intersect |= (dist1.Vec()[j] < 0) ? (1U << j) : 0;
+					}
+#endif
+				}
+
+				for (uint32_t j = 0; j < num_lanes; ++ j)
+				{
+					BoundOverlap bo;
+					if (outside & (1U << j))
+					{
+						bo = BoundOverlap::No;
+					}
+					else if (intersect & (1U << j))
+					{
+						bo = BoundOverlap::Partial;
+					}
+					else
+					{
+						bo = BoundOverlap::Yes;
+					}
+					results[base + j] = bo;
+				}
+			}
+		}
+
 		// Color
 		///////////////////////////////////////////////////////////////////////////////
 		SIMDVectorF4 NegativeColor(SIMDVectorF4 const & rhs)
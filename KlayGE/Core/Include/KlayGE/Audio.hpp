@@ -35,8 +35,14 @@
 
 #include <KlayGE/PreDeclare.hpp>
 #include <KFL/Vector.hpp>
+#include <KFL/Thread.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <vector>
 
 #include <KlayGE/AudioDataSource.hpp>
 
@@ -90,10 +96,43 @@ namespace KlayGE
 		virtual void DoReset() = 0;
 	};
 
+	// Single producer single consumer byte ring. The decoder writes and the device side reads, without locks.
+	class KLAYGE_CORE_API AudioStreamRing final : boost::noncopyable
+	{
+	public:
+		// The capacity is rounded up to a power of 2
+		explicit AudioStreamRing(size_t capacity);
+
+		size_t Capacity() const noexcept
+		{
+			return buffer_.size();
+		}
+		size_t ReadAvailable() const noexcept;
+		size_t WriteAvailable() const noexcept;
+
+		// Both return the number of bytes actually moved
+		size_t Write(void const * data, size_t size);
+		size_t Read(void* data, size_t size);
+		// Drops size bytes without copying them
+		size_t Skip(size_t size);
+
+		// Only when neither side is running
+		void Clear() noexcept;
+
+	private:
+		std::vector<uint8_t> buffer_;
+		size_t mask_;
+
+		std::atomic<size_t> read_pos_{0};
+		std::atomic<size_t> write_pos_{0};
+	};
+
 	class KLAYGE_CORE_API MusicBuffer : public AudioBuffer
 	{
+		friend class AudioStreamingService;
+
 	public:
-		explicit MusicBuffer(AudioDataSourcePtr const & data_source);
+		MusicBuffer(AudioDataSourcePtr const & data_source, uint32_t buffer_seconds);
 		~MusicBuffer() noexcept override;
 
 		void Play(bool loop = false) override;
@@ -107,7 +146,80 @@ namespace KlayGE
 		virtual void DoPlay(bool loop) = 0;
 		virtual void DoStop() = 0;
 
+		// Called on the streaming thread. Moves decoded data from the stream ring to the device, and sets the time until
+		//  it needs to be called again. Returns false when the stream is finished.
+		virtual bool DoUpdateStream(std::chrono::microseconds& next_update) = 0;
+
+		// Decodes ahead until the ring is full, so the device can be primed before playing
+		void PrepareStreaming(bool loop);
+		// Registers to the streaming service. Backends have to be ready for DoUpdateStream from another thread.
+		void StartStreaming();
+		// Unregisters from the streaming service and waits for the pending decode
+		void StopStreaming();
+		void ClearStream();
+
+		// Reads whole blocks of decoded data, a partial block is only returned at the end of the stream
+		size_t ReadStream(void* data, size_t size);
+		size_t SkipStream(size_t size);
+		bool StreamEnded() const noexcept;
+
+		// Bytes of 1 / BUFFERS_PER_SECOND second of data
+		uint32_t StreamChunkSize() const noexcept
+		{
+			return chunk_size_;
+		}
+		uint32_t BytesPerSecond() const noexcept
+		{
+			return chunk_size_ * BUFFERS_PER_SECOND;
+		}
+
 		static uint32_t constexpr BUFFERS_PER_SECOND = 2;
+
+	private:
+		void DecodeAhead();
+
+	private:
+		uint32_t block_align_;
+		uint32_t chunk_size_;
+		AudioStreamRing stream_ring_;
+		std::vector<uint8_t> decode_buff_;
+
+		AudioStreamingService* streaming_service_{nullptr};
+		std::atomic<bool> stream_loop_{false};
+		std::atomic<bool> source_ended_{false};
+		std::atomic<bool> decoding_{false};
+		std::atomic<uint32_t> decode_counter_{0};
+	};
+
+	// One thread streams all the music buffers. It wakes up when a backend reports a processed buffer, or when the
+	//  earliest stream is due, and leaves decoding to the task scheduler so the device side never waits for a decoder.
+	class KLAYGE_CORE_API AudioStreamingService final : boost::noncopyable
+	{
+	public:
+		AudioStreamingService();
+		~AudioStreamingService() noexcept;
+
+		void Register(MusicBuffer& buffer);
+		void Unregister(MusicBuffer& buffer);
+
+		// Wakes up the streaming thread. Backends call it from their buffer end callbacks.
+		void Notify();
+
+		size_t NumStreams() const;
+
+	private:
+		void LoopUpdateStreams();
+		void KickDecode(MusicBuffer& buffer);
+
+	private:
+		std::vector<MusicBuffer*> streams_;
+
+		mutable std::mutex mutex_;
+		std::condition_variable cond_;
+		bool notified_{false};
+		bool quit_{false};
+		bool thread_started_{false};
+		joiner<void> stream_thread_;
 	};
 
 	class KLAYGE_CORE_API AudioEngine : boost::noncopyable
@@ -121,6 +233,11 @@ namespace KlayGE
 
 		virtual std::wstring const & Name() const = 0;
 
+		AudioStreamingService& StreamingService()
+		{
+			return streaming_service_;
+		}
+
 		virtual void AddBuffer(size_t id, AudioBufferPtr const & buffer);
 
 		size_t NumBuffer() const;
@@ -148,6 +265,9 @@ namespace KlayGE
 		virtual void DoResume() = 0;
 
 	protected:
+		// Before the buffers, so it outlives them
+		AudioStreamingService streaming_service_;
+
 		std::map<size_t, AudioBufferPtr> audio_buffs_;
 
 		float sound_vol_{1};
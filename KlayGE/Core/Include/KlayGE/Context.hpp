@@ -56,6 +56,7 @@ namespace KlayGE
 		bool deferred_rendering;
 
 		bool perf_profiler;
+		uint32_t perf_profiler_events_per_thread;
 		bool location_sensor;
 	};
 
@@ -174,6 +175,10 @@ namespace KlayGE
 		{
 			return *gtp_instance_;
 		}
+		task_scheduler& TaskScheduler()
+		{
+			return *task_scheduler_;
+		}
 
 	private:
 		void DestroyAll();
@@ -216,6 +221,7 @@ namespace KlayGE
 #endif
 
 		std::unique_ptr<thread_pool> gtp_instance_;
+		std::unique_ptr<task_scheduler> task_scheduler_;
 	};
 }
 
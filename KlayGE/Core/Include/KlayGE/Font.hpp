@@ -76,6 +76,9 @@ namespace KlayGE
 		Font(std::shared_ptr<FontRenderable> const & fr, uint32_t flags);
 
 		Size_T<float> CalcSize(std::wstring_view text, float font_size);
+		// Puts the glyphs of chars into the distance texture right away, e.g. a localization table's char set during loading.
+		// If there are more chars than the texture holds, the first ones are pushed out again.
+		void PrepareChars(std::wstring_view chars);
 		void RenderText(float x, float y, Color const & clr,
 			std::wstring_view text, float font_size);
 		void RenderText(float x, float y, float z, float xScale, float yScale, Color const & clr,
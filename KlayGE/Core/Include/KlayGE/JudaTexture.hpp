@@ -20,6 +20,9 @@
 #include <KlayGE/RenderStateObject.hpp>
 #include <KlayGE/TexCompressionBC.hpp>
 
+#include <atomic>
+#include <list>
+#include <mutex>
 #include <vector>
 #include <deque>
 #include <unordered_map>
@@ -54,8 +57,16 @@ namespace KlayGE
 
 		static uint32_t const LEVEL_SHIFT = 28;
 
+		static uint32_t const EMPTY_CACHE_INDEX = static_cast<uint32_t>(-1);
+		// A tile being decoded is shown from an ancestor at most this many levels up
+		static uint32_t const MAX_FALLBACK_LEVELS = 4;
+		// Level shift in the indirect texel of a tile with nothing in cache to show, the shader samples 0 for it
+		static uint32_t const NOT_RESIDENT_LEVEL_SHIFT = 255;
+		static uint32_t const MAX_DECODED_BLOCKS = 64;
+
 	public:
 		JudaTexture(uint32_t num_tiles, uint32_t tile_size, ElementFormat format);
+		~JudaTexture();
 
 		uint32_t EncodeTileID(uint32_t level, uint32_t tile_x, uint32_t tile_y) const;
 		void DecodeTileID(uint32_t& level, uint32_t& tile_x, uint32_t& tile_y, uint32_t tile_id) const;
@@ -80,12 +91,23 @@ namespace KlayGE
 
 		void SetParams(RenderEffect const & effect);
 
+		// Tiles not in the cache are decoded on worker threads and show up in a later call. Meanwhile they are
+		// sampled from a coarser ancestor tile if there is one in the cache.
 		void UpdateCache(std::vector<uint32_t> const & tile_ids);
 
 	private:
 		void DecodeATile(std::vector<uint8_t>* data, uint32_t shuff, uint32_t mipmaps);
 		uint32_t DecodeAAttr(uint32_t shuff);
-		uint8_t* RetriveATile(uint32_t data_index);
+		std::shared_ptr<std::vector<uint8_t> const> RetriveATile(uint32_t data_index);
+
+		void DecodeCacheTiles(std::vector<uint32_t> const & tile_ids);
+		void CommitDecodedTiles();
+		uint32_t AllocateCacheTile(uint32_t tile_id);
+		void TouchCacheTile(uint32_t index);
+		void LinkCacheTile(uint32_t index);
+		void UnlinkCacheTile(uint32_t index);
+		void UpdateIndirect(uint32_t tile_id, uint32_t index, uint32_t level_shift);
+		bool UpdateFallback(uint32_t tile_id, uint32_t& fallback_index, uint32_t& fallback_shift);
 
 		uint32_t NumNonEmptySubNodes(QuadTreeNode const& node) const;
 		QuadTreeNode& GetNode(uint32_t shuff);
@@ -164,16 +186,12 @@ namespace KlayGE
 		LZMACodec lzma_dec_;
 		struct DecodedBlockInfo
 		{
-			std::unique_ptr<uint8_t[]> data;
-			uint64_t tick;
-
-			DecodedBlockInfo(std::unique_ptr<uint8_t[]>&& d, uint64_t t)
-				: data(std::move(d)), tick(t)
-			{
-			}
+			std::shared_ptr<std::vector<uint8_t>> data;
+			std::list<uint32_t>::iterator lru_iter;
 		};
 		std::unordered_map<uint32_t, DecodedBlockInfo> decoded_block_cache_;
-		uint64_t decode_tick_;
+		std::list<uint32_t> decoded_block_lru_;	// Most recently used first
+		std::mutex decoded_block_mutex_;
 
 	private:
 		// Cache
@@ -184,15 +202,39 @@ namespace KlayGE
 		uint32_t cache_tile_size_;
 		std::unique_ptr<TexCompression> tex_codec_;
 
-		struct TileInfo
+		uint32_t num_cache_tiles_a_row_;
+		uint32_t num_cache_tiles_a_layer_;
+		uint32_t num_cache_total_tiles_;
+
+		// One per slot in the cache texture, linked in a LRU list
+		struct CacheTile
+		{
+			uint32_t tile_id;
+			uint32_t prev;
+			uint32_t next;
+		};
+		std::vector<CacheTile> cache_tiles_;
+		uint32_t lru_head_;	// Most recently used
+		uint32_t lru_tail_;	// Least recently used, evicted first
+		std::unordered_map<uint32_t, uint32_t> tile_info_map_;	// Tile ID to index in cache_tiles_
+
+		struct PendingTile
+		{
+			bool requested;	// False if it's only decoded as a fallback of other tiles
+			uint32_t fallback_index;
+			uint32_t fallback_shift;
+		};
+		std::unordered_map<uint32_t, PendingTile> pending_tiles_;
+
+		struct DecodedCacheTile
 		{
-			uint32_t x, y, z;
-			uint32_t attr;
-			uint64_t tick;
+			uint32_t tile_id;
+			std::vector<std::vector<uint8_t>> mips;
+			std::vector<uint32_t> row_pitches;
 		};
-		std::unordered_map<uint32_t, TileInfo> tile_info_map_;
-		std::deque<std::pair<uint32_t, uint32_t>> tile_free_list_;
-		uint64_t tile_tick_;
+		std::vector<DecodedCacheTile> decoded_tiles_;
+		std::mutex decoded_tiles_mutex_;
+		std::atomic<uint32_t> decode_counter_{0};
 	};
 }
 
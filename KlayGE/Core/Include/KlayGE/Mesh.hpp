@@ -29,6 +29,7 @@
 
 #include <KlayGE/PreDeclare.hpp>
 #include <KFL/CXX17/string_view.hpp>
+#include <KFL/CXX2a/span.hpp>
 #include <KlayGE/Renderable.hpp>
 #include <KlayGE/RenderLayout.hpp>
 #include <KFL/Math.hpp>
@@ -173,6 +174,7 @@ namespace KlayGE
 		uint32_t NumLods() const;
 
 		void ActiveLod(int32_t lod);
+		void LodScreenSize(uint32_t lod, float size);
 
 		size_t NumMaterials() const
 		{
@@ -294,6 +296,8 @@ namespace KlayGE
 		std::vector<float> bind_scale;
 
 		std::tuple<Quaternion, Quaternion, float> Frame(float frame) const;
+		// hint is the key frame found by the previous call. It's tried first, and updated to the one found.
+		std::tuple<Quaternion, Quaternion, float> Frame(float frame, uint32_t& hint) const;
 	};
 
 	struct KLAYGE_CORE_API AABBKeyFrameSet
@@ -316,6 +320,7 @@ namespace KlayGE
 	public:
 		explicit SkinnedModel(SceneNodePtr const & root_node);
 		SkinnedModel(std::wstring_view name, uint32_t node_attrib);
+		~SkinnedModel() noexcept override;
 
 		bool IsSkinned() const override
 		{
@@ -342,6 +347,7 @@ namespace KlayGE
 		void AssignJoints(ForwardIterator first, ForwardIterator last)
 		{
 			joints_.assign(first, last);
+			joint_parents_.clear();
 			this->UpdateBinds();
 		}
 		void AttachKeyFrameSets(std::shared_ptr<std::vector<KeyFrameSet>> const & kf)
@@ -371,6 +377,11 @@ namespace KlayGE
 
 		float GetFrame() const;
 		void SetFrame(float frame);
+		// Sets the frames of many models at once. The bones of different models are built in parallel.
+		static void SetFrames(std::span<SkinnedModel* const> models, std::span<float const> frames);
+		// Defers SetFrame to the next scene flush, where the frames of all queued models are set by one SetFrames call.
+		void QueueFrame(float frame);
+		static void UpdateQueuedFrames();
 
 		void RebindJoints();
 		void UnbindJoints();
@@ -390,13 +401,25 @@ namespace KlayGE
 		void UpdateBinds();
 		void SetToEffect();
 
+		void UpdateJointHierarchy();
+		void EvaluateBones(float frame);
+		void ComputeBinds();
+
 	protected:
 		std::vector<JointComponentPtr> joints_;
 		std::vector<float4> bind_reals_;
 		std::vector<float4> bind_duals_;
 
+		// Parent joint index of each joint, -1 for roots. Built on demand from the scene nodes the joints bound to.
+		std::vector<int32_t> joint_parents_;
+		// Joint indices sorted so that every parent comes before its children
+		std::vector<uint32_t> joint_eval_order_;
+		std::vector<uint32_t> key_frame_hints_;
+
 		std::shared_ptr<std::vector<KeyFrameSet>> key_frame_sets_;
 		float last_frame_;
+		float queued_frame_ = 0;
+		bool frame_queued_ = false;
 
 		uint32_t num_frames_;
 		uint32_t frame_rate_;
@@ -433,7 +456,21 @@ namespace KlayGE
 		std::function<StaticMeshPtr(std::wstring_view)> CreateMeshFactoryFunc = CreateMeshFactory<StaticMesh>);
 	KLAYGE_CORE_API RenderModelPtr LoadSoftwareModel(std::string_view model_name);
 
-	KLAYGE_CORE_API void SaveModel(RenderModel const & model, std::string_view model_name);
+	// [0, 1] to the signed 16-bit integer that stores a position or a texcoord in the quantized vertex formats, rounded to the
+	// nearest
+	inline int16_t QuantizeToSNorm16(float v)
+	{
+		return static_cast<int16_t>(
+			MathLib::clamp<int32_t>(static_cast<int32_t>(MathLib::round(v * 65535 - 32768)), -32768, 32767));
+	}
+	inline float DequantizeFromSNorm16(int16_t v)
+	{
+		return (v + 32768) / 65535.0f;
+	}
+
+	// With quantize_vertices, 32-bit float positions and texcoords are saved as 16-bit values normalized to the bounding
+	// boxes of their meshes, normals and tangent quaternions as 8-bit values. Those are the formats MeshConverter outputs.
+	KLAYGE_CORE_API void SaveModel(RenderModel const & model, std::string_view model_name, bool quantize_vertices = false);
 
 
 	class KLAYGE_CORE_API RenderableLightSourceProxy : public StaticMesh
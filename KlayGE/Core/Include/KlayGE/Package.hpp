@@ -36,10 +36,32 @@
 #include <KlayGE/PreDeclare.hpp>
 #include <KFL/CXX17/string_view.hpp>
 
+#include <string>
+#include <vector>
+
 struct IInArchive;
 
 namespace KlayGE
 {
+	class MappedFile;
+
+	// An item of the table of contents of a native package, little endian on disk. Items are sorted by path_hash.
+	struct KPakEntry
+	{
+		uint64_t path_hash;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t original_size;
+		uint64_t timestamp;
+		uint32_t name_offset;
+		uint32_t name_length;
+		uint32_t compression;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(KPakEntry) == 56);
+
+	// A package is either a 7z archive, or a native .kpk pack. The native one has a table of contents sorted by path hash,
+	//  and its entries are 4K-aligned, so stored files are read in place from a mapped file.
 	class KLAYGE_CORE_API Package final
 	{
 	public:
@@ -55,7 +77,13 @@ namespace KlayGE
 		}
 
 	private:
+		void Open7z();
+		void OpenKPak();
+
 		uint32_t Find(std::string_view extract_file_path);
+		uint32_t FindKPak(std::string_view extract_file_path) const;
+
+		ResIdentifierPtr ExtractKPak(KPakEntry const & entry, std::string_view res_name);
 
 	private:
 		ResIdentifierPtr archive_is_;
@@ -64,7 +92,15 @@ namespace KlayGE
 		std::string password_;
 
 		uint32_t num_items_;
+
+		std::vector<KPakEntry> kpak_entries_;
+		std::string kpak_names_;
+		std::shared_ptr<MappedFile> kpak_mapped_file_;
 	};
+
+	// Packs all files under src_dir into a native package. Each file is LZMA compressed if that makes it notably smaller,
+	//  otherwise it's stored as is.
+	KLAYGE_CORE_API void SavePackage(std::string_view package_name, std::string_view src_dir, bool compress = true);
 }
 
 #endif		// KLAYGE_CORE_PACKAGE_HPP
@@ -35,8 +35,10 @@
 
 #include <KlayGE/PreDeclare.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/AABBox.hpp>
 #include <KlayGE/SceneNode.hpp>
 
+#include <array>
 #include <mutex>
 #include <random>
 #include <vector>
@@ -55,6 +57,55 @@ namespace KlayGE
 		float init_life;
 	};
 
+	// A range of particles in structure-of-arrays layout
+	struct ParticleBatch
+	{
+		float* pos_x;
+		float* pos_y;
+		float* pos_z;
+		float* vel_x;
+		float* vel_y;
+		float* vel_z;
+		float* life;
+		float* spin;
+		float* size;
+		float* alpha;
+		float* init_life;
+
+		uint32_t num;
+
+		Particle Get(uint32_t i) const
+		{
+			BOOST_ASSERT(i < num);
+
+			Particle par;
+			par.pos = float3(pos_x[i], pos_y[i], pos_z[i]);
+			par.vel = float3(vel_x[i], vel_y[i], vel_z[i]);
+			par.life = life[i];
+			par.spin = spin[i];
+			par.size = size[i];
+			par.alpha = alpha[i];
+			par.init_life = init_life[i];
+			return par;
+		}
+		void Set(uint32_t i, Particle const & par) const
+		{
+			BOOST_ASSERT(i < num);
+
+			pos_x[i] = par.pos.x();
+			pos_y[i] = par.pos.y();
+			pos_z[i] = par.pos.z();
+			vel_x[i] = par.vel.x();
+			vel_y[i] = par.vel.y();
+			vel_z[i] = par.vel.z();
+			life[i] = par.life;
+			spin[i] = par.spin;
+			size[i] = par.size;
+			alpha[i] = par.alpha;
+			init_life[i] = par.init_life;
+		}
+	};
+
 	class KLAYGE_CORE_API ParticleEmitter
 	{
 	public:
@@ -212,6 +263,14 @@ namespace KlayGE
 		virtual ParticleUpdaterPtr Clone() = 0;
 
 		virtual void Update(Particle& par, float elapse_time) = 0;
+		// The default one calls Update on each particle.
+		virtual void Update(ParticleBatch const & particles, float elapse_time);
+		// Batches of one frame are updated on several threads at the same time only if all updaters return true here.
+		// Per-particle updates aren't assumed to be thread safe, so it's false by default.
+		virtual bool ConcurrentBatches() const
+		{
+			return false;
+		}
 		virtual void SnapParams() = 0;
 
 	protected:
@@ -289,20 +348,12 @@ namespace KlayGE
 
 		uint32_t NumParticles() const
 		{
-			return static_cast<uint32_t>(particles_.size());
+			return max_num_particles_;
 		}
 		uint32_t NumActiveParticles() const;
 		uint32_t GetActiveParticleIndex(uint32_t i) const;
-		Particle const & GetParticle(uint32_t i) const
-		{
-			BOOST_ASSERT(i < particles_.size());
-			return particles_[i];
-		}
-		Particle& GetParticle(uint32_t i)
-		{
-			BOOST_ASSERT(i < particles_.size());
-			return particles_[i];
-		}
+		Particle const & GetParticle(uint32_t i) const;
+		Particle& GetParticle(uint32_t i);
 		void ClearParticles();
 
 		void ParticleAlphaFromTex(std::string const & tex_name);
@@ -332,6 +383,11 @@ namespace KlayGE
 		void UpdateParticlesNoLock(float elapsed_time);
 		void UpdateParticleBufferNoLock();
 
+		ParticleBatch MakeBatch(uint32_t first, uint32_t num);
+		void CopyParticle(uint32_t dst, uint32_t src);
+		void GatherParticles() const;
+		void ScatterParticles();
+
 	private:
 		SceneNodePtr root_node_;
 		RenderablePtr render_particles_;
@@ -339,8 +395,36 @@ namespace KlayGE
 		std::vector<ParticleEmitterPtr> emitters_;
 		std::vector<ParticleUpdaterPtr> updaters_;
 
-		std::vector<Particle> particles_;
+		enum ParticleStream
+		{
+			PS_PosX,
+			PS_PosY,
+			PS_PosZ,
+			PS_VelX,
+			PS_VelY,
+			PS_VelZ,
+			PS_Life,
+			PS_Spin,
+			PS_Size,
+			PS_Alpha,
+			PS_InitLife,
+
+			PS_NumStreams
+		};
+
+		// Particles in structure-of-arrays layout. The alive ones are packed in [0, num_alive_particles_).
+		uint32_t max_num_particles_;
+		uint32_t num_alive_particles_;
+		std::array<std::vector<float>, PS_NumStreams> particle_streams_;
+		// Array-of-structures copy for GetParticle. It's gathered from the streams when first asked for after an update,
+		// and scattered back before the next update if it's handed out for writing. Both happen under
+		// actived_particles_mutex_, the same as the update.
+		mutable std::vector<Particle> particles_;
+		mutable bool particles_gathered_;
+		bool particles_written_;
 		std::vector<std::pair<uint32_t, float>> actived_particles_;
+		std::vector<std::pair<uint32_t, float>> actived_particles_scratch_;
+		std::vector<AABBox> batch_bounds_;
 		mutable std::mutex actived_particles_mutex_;
 
 		float gravity_;
@@ -417,7 +501,13 @@ namespace KlayGE
 			return opacity_over_life_;
 		}
 
+		using ParticleUpdater::Update;
 		void Update(Particle& par, float elapse_time) override;
+		void Update(ParticleBatch const & particles, float elapse_time) override;
+		bool ConcurrentBatches() const override
+		{
+			return true;
+		}
 		void SnapParams() override;
 
 	private:
@@ -430,6 +520,12 @@ namespace KlayGE
 		std::vector<float2> this_frame_size_over_life_;
 		std::vector<float2> this_frame_mass_over_life_;
 		std::vector<float2> this_frame_opacity_over_life_;
+
+		// Curves of this frame baked into lookup tables for batch updates
+		static uint32_t constexpr LUT_SIZE = 256;
+		std::array<float, LUT_SIZE> size_lut_;
+		std::array<float, LUT_SIZE> mass_lut_;
+		std::array<float, LUT_SIZE> opacity_lut_;
 	};
 }
 
@@ -36,9 +36,12 @@
 #include <KlayGE/PreDeclare.hpp>
 #include <KFL/Timer.hpp>
 
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <string>
 #include <tuple>
+#include <vector>
 
 namespace KlayGE
 {
@@ -46,6 +49,7 @@ namespace KlayGE
 	{
 	public:
 		PerfRange();
+		explicit PerfRange(std::string const & name);
 
 		void Begin();
 		void End();
@@ -57,6 +61,7 @@ namespace KlayGE
 		bool Dirty() const;
 
 	private:
+		std::string name_;
 		Timer cpu_timer_;
 		QueryPtr gpu_timer_query_;
 
@@ -82,13 +87,80 @@ namespace KlayGE
 
 		void ExportToCSV(std::string const & file_name) const;
 
+		// Timeline events. They are recorded into a ring buffer of the calling thread without locking. The ring holds the
+		// last ContextCfg::perf_profiler_events_per_thread events. Names must stay valid until the profiler is destroyed,
+		// string literals are the usual choice.
+		void ThreadName(std::string const & name);
+		void BeginZone(char const * name);
+		void EndZone();
+		void FrameMarker();
+		void Counter(char const * name, int64_t value);
+
+		// Exports the timeline of all threads in Chrome trace event format, for chrome://tracing or Perfetto.
+		// Rings of threads that have exited are freed after they are exported.
+		void ExportToChromeTrace(std::string const & file_name);
+
+	private:
+		enum PerfEventType : uint32_t
+		{
+			PET_BeginZone,
+			PET_EndZone,
+			PET_Frame,
+			PET_Counter
+		};
+
+		struct PerfEvent
+		{
+			double timestamp;
+			char const * name;
+			int64_t value;
+			PerfEventType type;
+		};
+
+		struct ThreadEvents
+		{
+			uint32_t thread_id;
+			std::string name;
+			std::vector<PerfEvent> events;
+			std::atomic<uint64_t> write_index;
+			std::shared_ptr<std::atomic<bool>> exited;
+		};
+
+		ThreadEvents* CurrThreadEvents();
+		void RecordEvent(PerfEventType type, char const * name, int64_t value);
+
 	private:
 		static std::unique_ptr<PerfProfiler> perf_profiler_instance_;
 
 		std::vector<std::tuple<int, std::string, PerfRangePtr,
 			std::vector<std::tuple<uint32_t, double, double>>>> perf_ranges_;
 		uint32_t frame_id_;
+
+		bool enabled_;
+		uint32_t events_per_thread_;
+		uint32_t generation_;
+		Timer timeline_timer_;
+		mutable std::mutex thread_events_mutex_;
+		std::vector<std::unique_ptr<ThreadEvents>> thread_events_;
+		uint32_t next_thread_id_;
+	};
+
+	// Records a zone on the calling thread for the lifetime of the object
+	class KLAYGE_CORE_API PerfZone final : boost::noncopyable
+	{
+	public:
+		explicit PerfZone(char const * name);
+		~PerfZone();
+
+	private:
+		bool active_;
 	};
 }
 
+#ifndef KLAYGE_SHIP
+	#define KLAYGE_PERF_ZONE(name) KlayGE::PerfZone KFL_JOIN(perf_zone_, __LINE__)(name)
+#else
+	#define KLAYGE_PERF_ZONE(name)
+#endif
+
 #endif			// _KLAYGE_PERFPROFILER_HPP
@@ -301,6 +301,7 @@ namespace KlayGE
 	typedef std::shared_ptr<LightShaftPostProcess> LightShaftPostProcessPtr;
 	class TransientBuffer;
 	typedef std::shared_ptr<TransientBuffer> TransientBufferPtr;
+	class ConstantBufferRing;
 	class Fence;
 	typedef std::shared_ptr<Fence> FencePtr;
 	class Imposter;
@@ -347,6 +348,8 @@ namespace KlayGE
 	typedef std::shared_ptr<AudioBuffer> AudioBufferPtr;
 	class SoundBuffer;
 	class MusicBuffer;
+	class AudioStreamRing;
+	class AudioStreamingService;
 	class AudioDataSource;
 	typedef std::shared_ptr<AudioDataSource> AudioDataSourcePtr;
 	class AudioFactory;
@@ -651,7 +651,8 @@ namespace KlayGE
 	public:
 #if KLAYGE_IS_DEV_PLATFORM
 		void Load(RenderEffect& effect, XMLNode const& node, uint32_t tech_index);
-		void CompileShaders(RenderEffect& effect, uint32_t tech_index);
+		// Compiles either the hull shader stages only, or all the other stages
+		void CompileShaders(RenderEffect& effect, uint32_t tech_index, bool hull_stages);
 #endif
 		void CreateHwShaders(RenderEffect& effect, uint32_t tech_index);
 
@@ -724,6 +725,15 @@ namespace KlayGE
 		{
 			return has_tessellation_;
 		}
+		// True if the vertex shader reads the model matrices of klayge_instance, so many scene nodes can be drawn in one
+		//  instanced call. Set by the "auto_instancing" annotation, the last one wins in inherited techniques.
+		bool AutoInstancing() const
+		{
+			return auto_instancing_;
+		}
+
+	private:
+		void UpdateAutoInstancing();
 
 	private:
 		std::string name_;
@@ -739,6 +749,7 @@ namespace KlayGE
 		bool is_validate_;
 		bool has_discard_;
 		bool has_tessellation_;
+		bool auto_instancing_ = false;
 	};
 
 	class KLAYGE_CORE_API RenderPass final : boost::noncopyable
@@ -747,7 +758,7 @@ namespace KlayGE
 #if KLAYGE_IS_DEV_PLATFORM
 		void Load(RenderEffect& effect, XMLNode const& node, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
 		void Load(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
-		void CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index);
+		void CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, bool hull_stages);
 #endif
 		void CreateHwShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index);
 
@@ -818,7 +829,7 @@ namespace KlayGE
 	class KLAYGE_CORE_API RenderEffectConstantBuffer final : boost::noncopyable
 	{
 	public:
-		explicit RenderEffectConstantBuffer(RenderEffect const& effect) : effect_(&effect), dirty_(true)
+		explicit RenderEffectConstantBuffer(RenderEffect const& effect) : effect_(&effect)
 		{
 		}
 
@@ -887,13 +898,31 @@ namespace KlayGE
 			return r2t.t;
 		}
 
+		// Marks the whole buffer as modified, or clears the modified range
 		void Dirty(bool dirty)
 		{
-			dirty_ = dirty;
+			dirty_begin_ = dirty ? 0 : 0xFFFFFFFFU;
+			dirty_end_ = dirty ? 0xFFFFFFFFU : 0;
 		}
 		bool Dirty() const
 		{
-			return dirty_;
+			return dirty_begin_ < dirty_end_;
+		}
+		// Marks [offset, offset + size) as modified. Update() uploads the range covering all modified bytes only, if the device
+		//  supports partial constant buffer updates.
+		void DirtyRange(uint32_t offset, uint32_t size)
+		{
+			dirty_begin_ = std::min(dirty_begin_, offset);
+			dirty_end_ = std::max(dirty_end_, offset + size);
+		}
+
+		// In upload ring mode, the data is copied into the render engine's ConstantBufferRing on every update, and on the
+		//  first bind of each frame. HWBuff() is the ring, bound at HWBuffOffset(). Good for per-draw data that changes
+		//  between draws. Ignored if the device can't bind constant buffers by offset.
+		void UploadRing(bool ring);
+		bool UploadRing() const
+		{
+			return upload_ring_;
 		}
 
 		void Update();
@@ -901,6 +930,10 @@ namespace KlayGE
 		{
 			return hw_buff_;
 		}
+		uint32_t HWBuffOffset() const
+		{
+			return hw_buff_offset_;
+		}
 		void BindHWBuff(GraphicsBufferPtr const & buff);
 
 	private:
@@ -914,7 +947,13 @@ namespace KlayGE
 
 		GraphicsBufferPtr hw_buff_;
 		std::vector<uint8_t> buff_;
-		bool dirty_;
+		// Modified range in bytes, empty if begin >= end
+		uint32_t dirty_begin_ = 0;
+		uint32_t dirty_end_ = 0xFFFFFFFFU;
+
+		bool upload_ring_ = false;
+		uint32_t hw_buff_offset_ = 0;
+		uint32_t ring_frame_id_ = 0;
 	};
 
 	class KLAYGE_CORE_API RenderEffectParameter final : boost::noncopyable
@@ -411,8 +411,38 @@ namespace KlayGE
 
 		PredefinedCameraCBuffer const& PredefinedCameraCBufferInstance() const;
 
+		class KLAYGE_CORE_API PredefinedInstanceCBuffer
+		{
+		public:
+			static constexpr uint32_t max_num_instances = 64;
+
+		public:
+			PredefinedInstanceCBuffer();
+
+			RenderEffectConstantBuffer* CBuffer() const
+			{
+				return predefined_cbuffer_;
+			}
+
+			uint32_t& NumInstances(RenderEffectConstantBuffer& cbuff) const;
+			float4x4& Model(RenderEffectConstantBuffer& cbuff, uint32_t index) const;
+			float4x4& PrevModel(RenderEffectConstantBuffer& cbuff, uint32_t index) const;
+
+		private:
+			RenderEffectPtr effect_;
+			RenderEffectConstantBuffer* predefined_cbuffer_;
+
+			uint32_t num_instances_offset_;
+			uint32_t models_offset_;
+			uint32_t prev_models_offset_;
+		};
+
+		PredefinedInstanceCBuffer const& PredefinedInstanceCBufferInstance() const;
+
 		Mipmapper const& MipmapperInstance() const;
 
+		ConstantBufferRing& ConstantBufferRingInstance();
+
 	protected:
 		void Destroy();
 		uint32_t NumRealizedCameraInstances() const;
@@ -542,8 +572,11 @@ namespace KlayGE
 		mutable std::unique_ptr<PredefinedMeshCBuffer> predefined_mesh_cb_;
 		mutable std::unique_ptr<PredefinedModelCBuffer> predefined_model_cb_;
 		mutable std::unique_ptr<PredefinedCameraCBuffer> predefined_camera_cb_;
+		mutable std::unique_ptr<PredefinedInstanceCBuffer> predefined_instance_cb_;
 
 		mutable std::unique_ptr<Mipmapper> mipmapper_;
+
+		std::unique_ptr<ConstantBufferRing> cbuffer_ring_;
 	};
 }
 
@@ -170,6 +170,10 @@ namespace KlayGE
 		{
 			return active_lod_;
 		}
+		// With automatic LOD, a LOD is used when the bounding sphere covers less than its screen size, as a fraction of
+		//  the viewport height. The default screen size of LOD n is 0.5^n.
+		void LodScreenSize(uint32_t lod, float size);
+		float LodScreenSize(uint32_t lod) const;
 		virtual RenderLayout& GetRenderLayout() const;
 		virtual RenderLayout& GetRenderLayout(uint32_t lod) const;
 		virtual std::wstring const & Name() const;
@@ -280,7 +284,11 @@ namespace KlayGE
 		virtual void UpdateInstanceStream();
 		virtual void UpdateBoundBox();
 
-		float CalcLod(float3 const & eye_pos, float fov_scale) const;
+		// Draws instances_ with one instanced call per batch of PredefinedInstanceCBuffer::max_num_instances nodes. Only
+		//  for techniques with AutoInstancing(), others draw the nodes one by one.
+		void RenderInstancesInBatches(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout& layout);
+
+		int32_t SelectLod(float3 const & eye_pos, float proj_scale_y) const;
 
 		// For deferred only
 		void BindDeferredEffect(RenderEffectPtr const & deferred_effect);
@@ -302,6 +310,7 @@ namespace KlayGE
 		std::vector<RenderLayoutPtr> rls_;
 
 		int32_t active_lod_ = 0;
+		std::vector<float> lod_screen_sizes_;
 
 		// For select mode
 
@@ -356,7 +365,9 @@ namespace KlayGE
 		RenderEffectConstantBufferPtr mesh_cbuffer_;
 		RenderEffectConstantBufferPtr model_cbuffer_;
 		RenderEffectConstantBufferPtr camera_cbuffer_;
+		RenderEffectConstantBufferPtr instance_cbuffer_;
 		uint32_t visible_in_cameras_ = 0;
+		uint32_t num_batched_instances_ = 0;
 	};
 
 	// TODO: Consider merging this with Renderable
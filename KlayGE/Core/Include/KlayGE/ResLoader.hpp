@@ -34,8 +34,12 @@
 #pragma once
 
 #include <KlayGE/PreDeclare.hpp>
+#include <atomic>
 #include <istream>
+#include <limits>
+#include <list>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <KFL/ResIdentifier.hpp>
@@ -65,11 +69,19 @@ namespace KlayGE
 
 		virtual bool HasSubThreadStage() const = 0;
 
+		// Descs that Match must have the same Hash
+		virtual uint64_t Hash() const = 0;
 		virtual bool Match(ResLoadingDesc const & rhs) const = 0;
 		virtual void CopyDataFrom(ResLoadingDesc const & rhs) = 0;
 		virtual std::shared_ptr<void> CloneResourceFrom(std::shared_ptr<void> const & resource) = 0;
 
 		virtual std::shared_ptr<void> Resource() const = 0;
+
+		// Approximate memory footprint of the loaded resource in bytes. Resources with size 0 don't count in the cache budget.
+		virtual uint64_t ResourceSize() const
+		{
+			return 0;
+		}
 	};
 
 	class KLAYGE_CORE_API ResLoader final : boost::noncopyable
@@ -101,8 +113,12 @@ namespace KlayGE
 		std::string AbsPath(std::string_view path);
 
 		std::shared_ptr<void> SyncQuery(ResLoadingDescPtr const & res_desc);
-		std::shared_ptr<void> ASyncQuery(ResLoadingDescPtr const & res_desc);
+		// Requests with larger priority are picked up by the loading threads first. A queued request of a state-less
+		// resource is dropped if nobody holds the returned resource any more when a loading thread reaches it.
+		std::shared_ptr<void> ASyncQuery(ResLoadingDescPtr const & res_desc, float priority = 0);
 		void Unload(std::shared_ptr<void> const & res);
+		// Changes the priority of a resource that hasn't been picked up by a loading thread yet, e.g. by camera distance.
+		void Prioritize(std::shared_ptr<void> const & res, float priority);
 
 		template <typename T>
 		std::shared_ptr<T> SyncQueryT(ResLoadingDescPtr const & res_desc)
@@ -111,9 +127,15 @@ namespace KlayGE
 		}
 
 		template <typename T>
-		std::shared_ptr<T> ASyncQueryT(ResLoadingDescPtr const & res_desc)
+		std::shared_ptr<T> ASyncQueryT(ResLoadingDescPtr const & res_desc, float priority = 0)
+		{
+			return std::static_pointer_cast<T>(this->ASyncQuery(res_desc, priority));
+		}
+
+		template <typename T>
+		void Prioritize(std::shared_ptr<T> const & res, float priority)
 		{
-			return std::static_pointer_cast<T>(this->ASyncQuery(res_desc));
+			this->Prioritize(std::static_pointer_cast<void>(res), priority);
 		}
 
 		template <typename T>
@@ -129,6 +151,24 @@ namespace KlayGE
 			return static_cast<uint32_t>(loading_res_.size());
 		}
 
+		uint32_t NumLoadingThreads() const
+		{
+			return static_cast<uint32_t>(loading_threads_.size());
+		}
+		void NumLoadingThreads(uint32_t num);
+
+		// Loaded state-less resources nobody references any more are kept in the cache, and released in least recently used
+		// order while the total size of the cached resources is over budget. Unlimited by default.
+		uint64_t CacheBudget() const
+		{
+			return cache_budget_;
+		}
+		void CacheBudget(uint64_t budget);
+		uint64_t CacheSize() const
+		{
+			return loaded_res_size_;
+		}
+
 	private:
 		std::string RealPath(std::string_view path);
 		std::string RealPath(std::string_view path,
@@ -136,11 +176,13 @@ namespace KlayGE
 		void DecomposePackageName(std::string_view path,
 			std::string& package_path, std::string& password, std::string& path_in_package);
 
-		void AddLoadedResource(ResLoadingDescPtr const & res_desc, std::shared_ptr<void> const & res);
-		std::shared_ptr<void> FindMatchLoadedResource(ResLoadingDescPtr const & res_desc);
+		void AddLoadedResource(ResLoadingDescPtr const & res_desc, uint64_t hash, std::shared_ptr<void> const & res,
+			long num_internal_refs);
+		std::shared_ptr<void> FindMatchLoadedResource(ResLoadingDescPtr const & res_desc, uint64_t hash);
 		void RemoveUnrefResources();
+		void SweepLoadedResourcesNoLock(size_t max_visits);
 
-		void LoadingThreadFunc();
+		void LoadingThreadFunc(uint32_t thread_index);
 
 #if defined(KLAYGE_PLATFORM_ANDROID)
 		AAsset* LocateFileAndroid(std::string_view name);
@@ -151,8 +193,6 @@ namespace KlayGE
 #endif
 
 	private:
-		static std::unique_ptr<ResLoader> res_loader_instance_;
-
 		enum LoadingStatus
 		{
 			LS_Loading,
@@ -160,6 +200,50 @@ namespace KlayGE
 			LS_CanBeRemoved
 		};
 
+		struct LoadedResource
+		{
+			ResLoadingDescPtr res_desc;
+			uint64_t hash;
+			std::weak_ptr<void> res;
+			long num_internal_refs;
+			uint64_t size;
+		};
+
+		struct LoadingResource
+		{
+			ResLoadingDescPtr res_desc;
+			uint64_t hash;
+			std::shared_ptr<volatile LoadingStatus> status;
+			long num_internal_refs;
+		};
+
+		struct LoadingResQueueItem
+		{
+			ResLoadingDescPtr res_desc;
+			uint64_t hash;
+			std::shared_ptr<volatile LoadingStatus> status;
+
+			// Matched by owner in Prioritize. For state-less resources, if the use count drops to num_internal_refs, the
+			// caller has released the resource and the request can be cancelled. Otherwise num_internal_refs is -1.
+			std::weak_ptr<void> res;
+			long num_internal_refs;
+
+			float priority;
+			uint64_t seq;
+
+			bool operator<(LoadingResQueueItem const & rhs) const
+			{
+				// Larger priority first, then FIFO
+				return (priority < rhs.priority) || ((priority == rhs.priority) && (seq > rhs.seq));
+			}
+		};
+
+		std::list<LoadedResource>::iterator RemoveLoadedResourceNoLock(std::list<LoadedResource>::iterator iter);
+		bool CancelUnreferencedLoading(LoadingResQueueItem const & item);
+
+	private:
+		static std::unique_ptr<ResLoader> res_loader_instance_;
+
 		std::string exe_path_;
 		std::string local_path_;
 		std::vector<std::tuple<uint64_t, uint32_t, std::string, PackagePtr>> paths_;
@@ -167,16 +251,22 @@ namespace KlayGE
 
 		std::mutex loaded_mutex_;
 		std::mutex loading_mutex_;
-		std::vector<std::pair<ResLoadingDescPtr, std::weak_ptr<void>>> loaded_res_;
-		std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_;
+		std::list<LoadedResource> loaded_res_;	// Most recently used first
+		std::unordered_multimap<uint64_t, std::list<LoadedResource>::iterator> loaded_res_index_;
+		uint64_t loaded_res_size_ = 0;
+		uint64_t cache_budget_ = std::numeric_limits<uint64_t>::max();
+		std::unordered_multimap<uint64_t, LoadingResource> loading_res_;
 
-		bool non_empty_loading_res_queue_ = false;
 		std::condition_variable loading_res_queue_cv_;
 		std::mutex loading_res_queue_mutex_;
-		std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_queue_;
+		std::vector<LoadingResQueueItem> loading_res_queue_;	// A max-heap
+		uint64_t loading_res_queue_seq_ = 0;
+
+		std::vector<joiner<void>> loading_threads_;
+		uint32_t num_active_loading_threads_ = 0;
+		bool quit_ = false;
 
-		std::unique_ptr<joiner<void>> loading_thread_;
-		volatile bool quit_{false};
+		std::atomic<uint64_t> bytes_opened_{0};
 	};
 }
 
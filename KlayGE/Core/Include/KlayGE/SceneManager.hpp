@@ -26,8 +26,11 @@
 #include <KlayGE/SceneNode.hpp>
 #include <KlayGE/Renderable.hpp>
 #include <KFL/Frustum.hpp>
+#include <KFL/PtrIndexMap.hpp>
 #include <KFL/Thread.hpp>
 
+#include <array>
+#include <atomic>
 #include <vector>
 #include <unordered_map>
 
@@ -102,6 +105,11 @@ namespace KlayGE
 			return nodes_updated_;
 		}
 
+		// Called by nodes under the scene root. A changed transform dirties the node's subtree, a changed bound only the
+		//  node. Both are resolved in the next Update(), together with the bounds of the ancestors.
+		void MarkNodeDirty(SceneNode const & node, bool transform_changed);
+		void MarkHierarchyDirty();
+
 	protected:
 		void Flush(uint32_t urt);
 
@@ -117,6 +125,25 @@ namespace KlayGE
 		std::vector<Frustum const*> camera_frustums_;
 		std::vector<float4x4> camera_view_projs_;
 		std::vector<LightSourcePtr> frame_lights_;
+
+		// scene_root_ flattened in traversal order. Parents come before their children, and a subtree is a contiguous
+		//  range ending at hierarchy_subtree_ends_. World transforms are kept here contiguously and published to the nodes.
+		// Declared before scene_root_, so they outlive the nodes notifying them on destruction.
+		std::vector<SceneNode*> hierarchy_nodes_;
+		std::vector<uint32_t> hierarchy_parents_;
+		std::vector<uint32_t> hierarchy_subtree_ends_;
+		std::vector<float4x4> hierarchy_xforms_;
+		// Node indices grouped by depth, a level only depends on the one above
+		std::vector<uint32_t> hierarchy_levels_;
+		std::vector<uint32_t> hierarchy_level_offsets_;
+		// Moveable nodes may have renderables with changing bounds, their bounds are refreshed every frame
+		std::vector<uint32_t> hierarchy_moveables_;
+		std::vector<uint8_t> hierarchy_dirties_;
+		// Nodes moved in the last frame, their previous transforms need to catch up
+		std::vector<uint32_t> hierarchy_moved_;
+		std::atomic<bool> hierarchy_any_dirty_{false};
+		std::atomic<bool> hierarchy_changed_{true};
+
 		SceneNode scene_root_;
 		SceneNode overlay_root_;
 
@@ -129,13 +156,36 @@ namespace KlayGE
 		std::vector<SceneNode*> all_scene_nodes_;
 		std::vector<SceneNode*> all_overlay_nodes_;
 
+		// World space bounds of all_scene_nodes_ in SoA layout (min xyz, max xyz), and the per-node results of
+		// ClipScene's parallel pass, indexed by node * num_cameras + camera
+		std::array<std::vector<float>, 6> node_bounds_ws_;
+		std::vector<uint8_t> node_area_visibles_;
+		std::vector<BoundOverlap> node_local_visibles_;
+
 	private:
 		void FlushScene();
 
+		void RebuildHierarchy();
+		void UpdateHierarchy();
+
 	private:
 		uint32_t urt_;
 
-		std::vector<std::pair<RenderTechnique const *, std::vector<Renderable*>>> render_queue_;
+		struct RenderTechniqueBucket
+		{
+			RenderTechnique const * tech;
+			uint32_t num_items;
+			uint32_t rank;
+		};
+
+		// Renderables queued in this frame with their bucket indices. Buckets are in the order techniques are first added.
+		std::vector<std::pair<Renderable*, uint32_t>> render_queue_;
+		std::vector<RenderTechniqueBucket> render_buckets_;
+		PtrIndexMap<RenderTechnique> render_bucket_indices_;
+		std::vector<uint32_t> render_bucket_order_;
+		// Sort keys of render_queue_, and the scratch buffer of the radix sort. Reused across frames.
+		std::vector<std::pair<uint64_t, Renderable*>> render_sort_items_;
+		std::vector<std::pair<uint64_t, Renderable*>> render_sort_scratch_;
 
 		uint32_t num_objects_rendered_;
 		uint32_t num_renderables_rendered_;
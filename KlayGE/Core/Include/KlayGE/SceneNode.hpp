@@ -44,6 +44,8 @@ namespace KlayGE
 {
 	class KLAYGE_CORE_API SceneNode final : boost::noncopyable, public std::enable_shared_from_this<SceneNode>
 	{
+		friend class SceneManager;
+
 	public:
 		enum SOAttrib
 		{
@@ -78,7 +80,26 @@ namespace KlayGE
 		void RemoveChild(SceneNode* node);
 		void ClearChildren();
 
-		void Traverse(std::function<bool(SceneNode&)> const & callback);
+		// Pre-order, children of a node are skipped if the callback returns false. Iterative, deep hierarchies don't
+		//  recurse.
+		template <typename Func>
+		void Traverse(Func const & callback)
+		{
+			std::vector<SceneNode*> stack(1, this);
+			while (!stack.empty())
+			{
+				SceneNode* node = stack.back();
+				stack.pop_back();
+
+				if (callback(*node))
+				{
+					for (auto iter = node->children_.rbegin(); iter != node->children_.rend(); ++ iter)
+					{
+						stack.push_back(iter->get());
+					}
+				}
+			}
+		}
 
 		uint32_t NumComponents() const;
 		template <typename T>
@@ -150,7 +171,9 @@ namespace KlayGE
 		float4x4 const& PrevTransformToWorld() const;
 		AABBox const& PosBoundOS() const;
 		AABBox const& PosBoundWS() const;
+		// Updates the world transforms of this node only. Nodes under the scene root are updated by SceneManager.
 		void UpdateTransforms();
+		// Recomputes the bounds of the whole subtree
 		void UpdatePosBoundSubtree();
 		bool Updated() const;
 		void FillVisibleMark(BoundOverlap vm);
@@ -200,6 +223,11 @@ namespace KlayGE
 		void Parent(SceneNode* so);
 		void EmitSceneChanged();
 
+		void UpdatePosBound();
+		void MarkTransformDirty();
+		void MarkPosBoundDirty();
+		void NotifySceneManager(bool transform_changed);
+
 	protected:
 		std::wstring name_;
 
@@ -220,6 +248,8 @@ namespace KlayGE
 		std::unique_ptr<AABBox> pos_aabb_os_;
 		std::unique_ptr<AABBox> pos_aabb_ws_;
 		bool pos_aabb_dirty_ = true;
+		// Index in SceneManager's flattened hierarchy, set when the node is under the scene root
+		uint32_t hierarchy_index_ = ~0U;
 		std::array<BoundOverlap, RenderEngine::PredefinedCameraCBuffer::max_num_cameras> visible_marks_;
 
 		UpdateEvent sub_thread_update_event_;
@@ -66,6 +66,15 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) = 0;
 		virtual void DecodeBlock(void* output, void const * input) = 0;
 
+		// Encodes num_blocks blocks. The input blocks are tightly packed, each one is BlockWidth * BlockHeight decoded texels.
+		// The default loops over EncodeBlock, and no built-in codec overrides it yet. It's the hook for codecs that can
+		// process several blocks at once, e.g. with SIMD.
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method);
+
+		// Creates a new codec of the same type, used by each worker of the parallel EncodeMem.
+		// Returns nullptr if the codec can't be used from multiple threads, and EncodeMem will run serially.
+		virtual std::unique_ptr<TexCompression> Clone() const;
+
 		virtual void EncodeMem(uint32_t width, uint32_t height, 
 			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
 			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
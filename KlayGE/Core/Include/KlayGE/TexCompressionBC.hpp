@@ -34,6 +34,7 @@
 #pragma once
 
 #include <cstring>
+#include <random>
 
 #include <KlayGE/TexCompression.hpp>
 
@@ -88,6 +89,8 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		void EncodeBC1Internal(BC1Block& bc1, ARGBColor32 const * argb, bool alpha, TexCompressionMethod method) const;
 
 	private:
@@ -106,6 +109,8 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 	private:
 		TexCompressionBC1 bc1_codec_;
 	};
@@ -117,6 +122,8 @@ namespace KlayGE
 
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
+
+		virtual std::unique_ptr<TexCompression> Clone() const override;
 	};
 
 	class KLAYGE_CORE_API TexCompressionBC3 final : public TexCompression
@@ -127,6 +134,8 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 	private:
 		TexCompressionBC1 bc1_codec_;
 		TexCompressionBC4 bc4_codec_;
@@ -140,6 +149,8 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 	private:
 		TexCompressionBC4 bc4_codec_;
 	};
@@ -152,6 +163,8 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		void DecodeBC6Internal(void* output, void const * input, bool signed_fmt);
 
 	private:
@@ -213,6 +226,8 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 	private:
 		TexCompressionBC6U bc6u_codec_;
 	};
@@ -278,6 +293,8 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 	private:
 		void PackBC7UniformBlock(void* output, ARGBColor32 const & pixel);
 		void PackBC7Block(int mode, CompressParams& params, void* output);
@@ -316,6 +333,9 @@ namespace KlayGE
 		int rotate_mode_;
 		int index_mode_;
 
+		// Reseeded from the texels of every block, so the result doesn't depend on the order the blocks are encoded
+		mutable std::mt19937 rng_;
+
 		static ModeInfo const mode_info_[];
 	};
 
@@ -80,6 +80,17 @@ namespace KlayGE
 		Linear,
 	};
 
+	// Filters of the CPU resampler. Box, Kaiser and Lanczos3 widen with the shrink ratio, so they don't alias when
+	//  reducing by more than 2x. Linear is plain bilinear interpolation, the same as TextureFilter::Linear.
+	enum class ResampleFilter
+	{
+		Point,
+		Box,
+		Linear,
+		Kaiser,
+		Lanczos3
+	};
+
 	// Abstract class representing a Texture resource.
 	// @remarks
 	// The actual concrete subclass which will exist for a texture
@@ -390,6 +401,13 @@ namespace KlayGE
 		void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch, ElementFormat src_format,
 		uint32_t src_width, uint32_t src_height, uint32_t src_depth,
 		TextureFilter filter);
+	// Separable resize on the CPU. Bands of rows are filtered in parallel on the task scheduler. Resizing between the
+	//  same plain UNorm8/UNorm16/half/float formats filters the stored channels directly, other formats go through ABGR32F.
+	KLAYGE_CORE_API void ResizeTexture(void* dst_data, uint32_t dst_row_pitch, uint32_t dst_slice_pitch, ElementFormat dst_format,
+		uint32_t dst_width, uint32_t dst_height, uint32_t dst_depth,
+		void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch, ElementFormat src_format,
+		uint32_t src_width, uint32_t src_height, uint32_t src_depth,
+		ResampleFilter filter);
 
 	// return the lookat and up vector in cubemap view
 	//////////////////////////////////////////////////////////////////////////////////
@@ -35,8 +35,10 @@
 
 #include <KlayGE/PreDeclare.hpp>
 
+#include <array>
+#include <deque>
+#include <memory>
 #include <vector>
-#include <list>
 
 namespace KlayGE
 {
@@ -55,19 +57,107 @@ namespace KlayGE
 		}
 	};
 
+	// Sub-allocates a ring linearly. Space is not freed one by one, but reclaimed in the order of the frames that used it.
+	//  An allocation never wraps around the end of the ring.
+	class KLAYGE_CORE_API FrameRingSubAllocator final : boost::noncopyable
+	{
+	public:
+		explicit FrameRingSubAllocator(uint32_t capacity);
+
+		uint32_t Capacity() const
+		{
+			return capacity_;
+		}
+
+		// Returns false if there is no enough space
+		bool Alloc(uint32_t size_in_byte, SubAlloc& alloc);
+		// Marks the allocations so far as used by frame frame_id
+		void EndFrame(uint32_t frame_id);
+		// Reclaims the space of frames up to last_frame_id
+		void RetireFrames(uint32_t last_frame_id);
+		// Enlarges the ring. The old range [0, old capacity) is kept until the frames ended so far are retired.
+		void Grow(uint32_t capacity);
+
+	private:
+		struct FrameMark
+		{
+			uint32_t frame_id;
+			uint64_t end;
+		};
+
+		uint32_t capacity_;
+		// Positions grow monotonically, offsets are positions modulo capacity_
+		uint64_t head_;
+		uint64_t tail_;
+		std::deque<FrameMark> frames_;
+	};
+
+	// Two-level segregated fit sub-allocator. Alloc and Free are constant time, and the book keeping lives in arrays that
+	//  are reused, so there is no heap allocation per sub alloc.
+	class KLAYGE_CORE_API TlsfSubAllocator final : boost::noncopyable
+	{
+		static uint32_t constexpr GRANULARITY = 4;
+		static uint32_t constexpr SL_BITS = 4;
+		static uint32_t constexpr SL_COUNT = 1U << SL_BITS;
+		static uint32_t constexpr FL_COUNT = 32;
+		static uint32_t constexpr INVALID_BLOCK = 0xFFFFFFFFU;
+
+		struct Block
+		{
+			uint32_t offset;
+			uint32_t size;
+			uint32_t prev_phys;
+			uint32_t next_phys;
+			uint32_t prev_free;
+			uint32_t next_free;
+			bool free;
+		};
+
+	public:
+		explicit TlsfSubAllocator(uint32_t capacity);
+
+		uint32_t Capacity() const
+		{
+			return capacity_;
+		}
+
+		// Returns false if there is no enough space. Sizes are rounded up to GRANULARITY internally, alloc.length_ is
+		//  still the requested size.
+		bool Alloc(uint32_t size_in_byte, SubAlloc& alloc);
+		void Free(SubAlloc const & alloc);
+		// Adds [old capacity, capacity) as free space
+		void Grow(uint32_t capacity);
+
+	private:
+		static void Mapping(uint32_t size, uint32_t& fl, uint32_t& sl);
+
+		uint32_t NewBlock();
+		void InsertFreeBlock(uint32_t index);
+		void RemoveFreeBlock(uint32_t index);
+
+	private:
+		uint32_t capacity_;
+
+		std::vector<Block> blocks_;
+		std::vector<uint32_t> unused_blocks_;
+		uint32_t last_phys_block_;
+
+		uint32_t fl_bitmap_;
+		std::array<uint32_t, FL_COUNT> sl_bitmaps_;
+		std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> free_heads_;
+
+		// Used block at each GRANULARITY aligned offset
+		std::vector<uint32_t> used_block_at_;
+	};
+
 	class KLAYGE_CORE_API TransientBuffer final : boost::noncopyable
 	{
 		// Frames that have ended
 		struct RetiredFrame
 		{
-			// Sub allocs that are unuseful and will be freed at the end of the frame
-			std::list<SubAlloc> pending_frees_;
 			uint32_t frame_id;
-
-			explicit RetiredFrame(uint32_t id)
-				: frame_id(id)
-			{
-			}
+			// Index after the last pending free of this frame
+			uint32_t pending_frees_end;
 		};
 
 	public:
@@ -77,8 +167,16 @@ namespace KlayGE
 			BF_Index
 		};
 
+		enum AllocPolicy
+		{
+			// Every sub alloc lives for one frame only. Dealloc is optional, space comes back after the GPU is done with the frame.
+			AP_FrameRing,
+			// Sub allocs live until they are Dealloc'ed.
+			AP_General
+		};
+
 	public:
-		TransientBuffer(uint32_t size_in_byte, BindFlag bind_flag);
+		TransientBuffer(uint32_t size_in_byte, BindFlag bind_flag, AllocPolicy policy = AP_FrameRing);
 
 		// Allocate a sub space from transient buffer
 		SubAlloc Alloc(uint32_t size_in_byte, void const * data);
@@ -95,22 +193,56 @@ namespace KlayGE
 
 	private:
 		GraphicsBufferPtr DoCreateBuffer(BindFlag bind_flag, uint32_t size_in_byte);
-		// Free the sub alloc and return the space allocated back to transient buffer.
-		void DoFree(SubAlloc const & alloc);
 
 	private:
 		bool use_no_overwrite_;
 		uint32_t num_pre_frames_;
 
 		GraphicsBufferPtr buffer_;
-		std::list<SubAlloc> free_list_;
-		std::list<RetiredFrame> retired_frames_;
 		BindFlag bind_flag_;
+		AllocPolicy policy_;
+
+		std::unique_ptr<FrameRingSubAllocator> ring_allocator_;
+		std::unique_ptr<TlsfSubAllocator> tlsf_allocator_;
+		// Sub allocs of AP_General waiting for their frames to be retired, oldest first
+		std::vector<SubAlloc> pending_frees_;
+		std::deque<RetiredFrame> retired_frames_;
 
 		std::vector<uint8_t> simulate_buffer_;
 		uint32_t valid_min_;
 		uint32_t valid_max_;
 	};
+
+	// Shared constant buffer for per-draw data. Every upload gets a new range, which is bound by offset, so updating a
+	//  constant buffer between draws neither waits for the GPU nor overwrites data in flight. Space comes back a few frames
+	//  later. Used only if RenderDeviceCaps::cbuffer_offset_binding_support is set.
+	class KLAYGE_CORE_API ConstantBufferRing final : boost::noncopyable
+	{
+	public:
+		// Offsets and sizes of the bound ranges are multiples of ALIGNMENT. It's 256 bytes on D3D12, and 16 constants on D3D11.1.
+		static uint32_t constexpr ALIGNMENT = 256;
+
+		explicit ConstantBufferRing(uint32_t size_in_byte);
+
+		static uint32_t AlignedSize(uint32_t size_in_byte)
+		{
+			return (size_in_byte + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+		}
+
+		// Copies data into the ring. Returns the buffer it lives in, which changes when the ring grows.
+		GraphicsBufferPtr const & Upload(void const * data, uint32_t size_in_byte, uint32_t& offset);
+
+	private:
+		void CreateBuffer(uint32_t size_in_byte);
+
+	private:
+		bool use_no_overwrite_;
+		uint32_t num_pre_frames_;
+		uint32_t frame_id_;
+
+		GraphicsBufferPtr buffer_;
+		std::unique_ptr<FrameRingSubAllocator> allocator_;
+	};
 }
 
 #endif
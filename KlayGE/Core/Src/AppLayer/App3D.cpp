@@ -40,6 +40,7 @@
 #include <KlayGE/UI.hpp>
 #include <KlayGE/SceneManager.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 
 #include <boost/assert.hpp>
 
@@ -518,6 +519,10 @@ namespace KlayGE
 	void App3DFramework::Run()
 #endif
 	{
+#ifndef KLAYGE_SHIP
+		PerfProfiler::Instance().ThreadName("Main");
+#endif
+
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 
 #if defined KLAYGE_PLATFORM_WINDOWS_DESKTOP
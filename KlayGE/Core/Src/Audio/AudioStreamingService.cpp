@@ -0,0 +1,235 @@
+/**
+ * @file AudioStreamingService.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/TaskScheduler.hpp>
+#include <KlayGE/Context.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <KlayGE/Audio.hpp>
+
+namespace
+{
+	// Don't spin if a backend asks to be updated right away
+	std::chrono::microseconds constexpr MIN_UPDATE_INTERVAL(1000);
+	// Upper bound of the sleep, in case a backend misses a wake up
+	std::chrono::microseconds constexpr MAX_UPDATE_INTERVAL(1000000);
+}
+
+namespace KlayGE
+{
+	AudioStreamRing::AudioStreamRing(size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+		buffer_.resize(size);
+		mask_ = size - 1;
+	}
+
+	size_t AudioStreamRing::ReadAvailable() const noexcept
+	{
+		return write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_acquire);
+	}
+
+	size_t AudioStreamRing::WriteAvailable() const noexcept
+	{
+		return buffer_.size() - this->ReadAvailable();
+	}
+
+	size_t AudioStreamRing::Write(void const * data, size_t size)
+	{
+		size_t const write_pos = write_pos_.load(std::memory_order_relaxed);
+		size_t const read_pos = read_pos_.load(std::memory_order_acquire);
+		size = std::min(size, buffer_.size() - (write_pos - read_pos));
+
+		size_t const offset = write_pos & mask_;
+		size_t const first = std::min(size, buffer_.size() - offset);
+		uint8_t const * src = static_cast<uint8_t const *>(data);
+		std::memcpy(&buffer_[offset], src, first);
+		std::memcpy(&buffer_[0], src + first, size - first);
+
+		write_pos_.store(write_pos + size, std::memory_order_release);
+		return size;
+	}
+
+	size_t AudioStreamRing::Read(void* data, size_t size)
+	{
+		size_t const read_pos = read_pos_.load(std::memory_order_relaxed);
+		size_t const write_pos = write_pos_.load(std::memory_order_acquire);
+		size = std::min(size, write_pos - read_pos);
+
+		size_t const offset = read_pos & mask_;
+		size_t const first = std::min(size, buffer_.size() - offset);
+		uint8_t* dst = static_cast<uint8_t*>(data);
+		std::memcpy(dst, &buffer_[offset], first);
+		std::memcpy(dst + first, &buffer_[0], size - first);
+
+		read_pos_.store(read_pos + size, std::memory_order_release);
+		return size;
+	}
+
+	size_t AudioStreamRing::Skip(size_t size)
+	{
+		size_t const read_pos = read_pos_.load(std::memory_order_relaxed);
+		size_t const write_pos = write_pos_.load(std::memory_order_acquire);
+		size = std::min(size, write_pos - read_pos);
+
+		read_pos_.store(read_pos + size, std::memory_order_release);
+		return size;
+	}
+
+	void AudioStreamRing::Clear() noexcept
+	{
+		read_pos_.store(0, std::memory_order_relaxed);
+		write_pos_.store(0, std::memory_order_release);
+	}
+
+
+	AudioStreamingService::AudioStreamingService() = default;
+
+	AudioStreamingService::~AudioStreamingService() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			quit_ = true;
+		}
+		cond_.notify_one();
+
+		if (thread_started_)
+		{
+			stream_thread_();
+		}
+	}
+
+	void AudioStreamingService::Register(MusicBuffer& buffer)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			if (std::find(streams_.begin(), streams_.end(), &buffer) == streams_.end())
+			{
+				streams_.push_back(&buffer);
+			}
+
+			if (!thread_started_)
+			{
+				stream_thread_ = Context::Instance().ThreadPool()([this] { this->LoopUpdateStreams(); });
+				thread_started_ = true;
+			}
+
+			notified_ = true;
+		}
+		cond_.notify_one();
+	}
+
+	void AudioStreamingService::Unregister(MusicBuffer& buffer)
+	{
+		// The streaming thread holds the lock while updating, so the buffer is not touched after this
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto iter = std::find(streams_.begin(), streams_.end(), &buffer);
+		if (iter != streams_.end())
+		{
+			streams_.erase(iter);
+		}
+	}
+
+	void AudioStreamingService::Notify()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			notified_ = true;
+		}
+		cond_.notify_one();
+	}
+
+	size_t AudioStreamingService::NumStreams() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return streams_.size();
+	}
+
+	void AudioStreamingService::LoopUpdateStreams()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (!quit_)
+		{
+			notified_ = false;
+
+			auto const now = std::chrono::steady_clock::now();
+			auto next_wake = now + MAX_UPDATE_INTERVAL;
+			for (auto iter = streams_.begin(); iter != streams_.end();)
+			{
+				MusicBuffer& buffer = **iter;
+
+				std::chrono::microseconds next_update = MAX_UPDATE_INTERVAL;
+				if (buffer.DoUpdateStream(next_update))
+				{
+					this->KickDecode(buffer);
+					next_wake = std::min(next_wake, now + std::max(next_update, MIN_UPDATE_INTERVAL));
+					++ iter;
+				}
+				else
+				{
+					iter = streams_.erase(iter);
+				}
+			}
+
+			if (streams_.empty())
+			{
+				cond_.wait(lock, [this] { return quit_ || notified_; });
+			}
+			else
+			{
+				cond_.wait_until(lock, next_wake, [this] { return quit_ || notified_; });
+			}
+		}
+	}
+
+	void AudioStreamingService::KickDecode(MusicBuffer& buffer)
+	{
+		// One decode task per stream at a time, so the ring has a single producer
+		if (!buffer.source_ended_ && !buffer.decoding_ && (buffer.stream_ring_.WriteAvailable() >= buffer.chunk_size_))
+		{
+			buffer.decoding_ = true;
+			Context::Instance().TaskScheduler().submit([this, &buffer]
+				{
+					buffer.DecodeAhead();
+					buffer.decoding_ = false;
+					this->Notify();
+				}, &buffer.decode_counter_);
+		}
+	}
+}
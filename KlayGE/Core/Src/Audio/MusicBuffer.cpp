@@ -29,18 +29,57 @@
  */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/ErrorHandling.hpp>
+#include <KFL/TaskScheduler.hpp>
 #include <KlayGE/AudioDataSource.hpp>
+#include <KlayGE/AudioFactory.hpp>
+#include <KlayGE/Context.hpp>
+
+#include <algorithm>
+
+#include <boost/assert.hpp>
 
 #include <KlayGE/Audio.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t BlockAlign(AudioFormat format)
+	{
+		switch (format)
+		{
+		case AF_Mono8:
+			return 1;
+
+		case AF_Mono16:
+		case AF_Stereo8:
+			return 2;
+
+		case AF_Stereo16:
+			return 4;
+
+		default:
+			KFL_UNREACHABLE("Invalid audio format");
+		}
+	}
+}
+
 namespace KlayGE
 {
-	MusicBuffer::MusicBuffer(AudioDataSourcePtr const & data_source)
-		: AudioBuffer(data_source)
+	MusicBuffer::MusicBuffer(AudioDataSourcePtr const & data_source, uint32_t buffer_seconds)
+		: AudioBuffer(data_source),
+			block_align_(BlockAlign(format_)),
+			chunk_size_((freq_ / BUFFERS_PER_SECOND) * block_align_),
+			stream_ring_(static_cast<size_t>(chunk_size_) * BUFFERS_PER_SECOND * std::max(buffer_seconds, 1U)),
+			decode_buff_(chunk_size_)
 	{
 	}
 
-	MusicBuffer::~MusicBuffer() noexcept = default;
+	MusicBuffer::~MusicBuffer() noexcept
+	{
+		BOOST_ASSERT_MSG(streaming_service_ == nullptr, "The derived class must stop streaming in its destructor");
+	}
 
 	bool MusicBuffer::IsSound() const
 	{
@@ -51,6 +90,7 @@ namespace KlayGE
 	{
 		this->Stop();
 
+		this->ClearStream();
 		this->DoReset();
 	}
 
@@ -62,10 +102,101 @@ namespace KlayGE
 
 	void MusicBuffer::Stop()
 	{
-		if (this->IsPlaying())
+		if (this->IsPlaying() || (streaming_service_ != nullptr))
 		{
 			this->DoStop();
 			data_source_->Reset();
+			this->ClearStream();
+		}
+	}
+
+	void MusicBuffer::PrepareStreaming(bool loop)
+	{
+		BOOST_ASSERT(streaming_service_ == nullptr);
+
+		stream_loop_ = loop;
+		if (this->StreamEnded())
+		{
+			// Played to the end last time, start over
+			data_source_->Reset();
+			this->ClearStream();
+		}
+
+		this->DecodeAhead();
+	}
+
+	void MusicBuffer::StartStreaming()
+	{
+		BOOST_ASSERT(streaming_service_ == nullptr);
+
+		streaming_service_ = &Context::Instance().AudioFactoryInstance().AudioEngineInstance().StreamingService();
+		streaming_service_->Register(*this);
+	}
+
+	void MusicBuffer::StopStreaming()
+	{
+		if (streaming_service_ != nullptr)
+		{
+			streaming_service_->Unregister(*this);
+			streaming_service_ = nullptr;
+		}
+		Context::Instance().TaskScheduler().wait(decode_counter_);
+	}
+
+	void MusicBuffer::ClearStream()
+	{
+		BOOST_ASSERT(streaming_service_ == nullptr);
+
+		stream_ring_.Clear();
+		source_ended_ = false;
+	}
+
+	size_t MusicBuffer::ReadStream(void* data, size_t size)
+	{
+		// The end flag goes first. It's set after the last write.
+		bool const ended = source_ended_;
+		size_t const available = stream_ring_.ReadAvailable();
+		if (!ended || (available > size))
+		{
+			size = std::min(size, available) / block_align_ * block_align_;
+		}
+		return stream_ring_.Read(data, size);
+	}
+
+	size_t MusicBuffer::SkipStream(size_t size)
+	{
+		return stream_ring_.Skip(size);
+	}
+
+	bool MusicBuffer::StreamEnded() const noexcept
+	{
+		return source_ended_ && (stream_ring_.ReadAvailable() == 0);
+	}
+
+	void MusicBuffer::DecodeAhead()
+	{
+		bool just_reset = false;
+		while (!source_ended_ && (stream_ring_.WriteAvailable() >= chunk_size_))
+		{
+			size_t const read_size = data_source_->Read(decode_buff_.data(), chunk_size_);
+			if (read_size == 0)
+			{
+				// Stops looping if the source is empty right after the reset
+				if (stream_loop_ && !just_reset)
+				{
+					data_source_->Reset();
+					just_reset = true;
+				}
+				else
+				{
+					source_ended_ = true;
+				}
+			}
+			else
+			{
+				stream_ring_.Write(decode_buff_.data(), read_size);
+				just_reset = false;
+			}
 		}
 	}
 }
@@ -39,6 +39,7 @@
 #include <KlayGE/PerfProfiler.hpp>
 #include <KlayGE/UI.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/TaskScheduler.hpp>
 
 #include <fstream>
 #include <mutex>
@@ -126,6 +127,7 @@ namespace KlayGE
 #endif
 
 		gtp_instance_ = MakeUniquePtr<thread_pool>(1, 16);
+		task_scheduler_ = MakeUniquePtr<task_scheduler>();
 	}
 
 	Context::~Context()
@@ -154,6 +156,7 @@ namespace KlayGE
 
 		app_ = nullptr;
 
+		task_scheduler_.reset();
 		gtp_instance_.reset();
 	}
 
@@ -332,6 +335,7 @@ namespace KlayGE
 		std::vector<std::pair<std::string, std::string>> graphics_options;
 		bool debug_context = false;
 		bool perf_profiler = false;
+		uint32_t perf_profiler_events_per_thread = 65536;
 		bool location_sensor = false;
 
 		std::string rf_name;
@@ -397,6 +401,12 @@ namespace KlayGE
 			if (perf_profiler_node)
 			{
 				perf_profiler = perf_profiler_node->Attrib("enabled")->ValueInt() ? true : false;
+
+				XMLAttributePtr events_attr = perf_profiler_node->Attrib("events_per_thread");
+				if (events_attr)
+				{
+					perf_profiler_events_per_thread = events_attr->ValueUInt();
+				}
 			}
 
 			XMLNodePtr location_sensor_node = context_node->FirstNode("location_sensor");
@@ -729,6 +739,7 @@ namespace KlayGE
 
 		cfg_.deferred_rendering = false;
 		cfg_.perf_profiler = perf_profiler;
+		cfg_.perf_profiler_events_per_thread = perf_profiler_events_per_thread;
 		cfg_.location_sensor = location_sensor;
 	}
 
@@ -770,6 +781,7 @@ namespace KlayGE
 
 			XMLNodePtr perf_profiler_node = cfg_doc.AllocNode(XNT_Element, "perf_profiler");
 			perf_profiler_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.perf_profiler));
+			perf_profiler_node->AppendAttrib(cfg_doc.AllocAttribUInt("events_per_thread", cfg_.perf_profiler_events_per_thread));
 			context_node->AppendNode(perf_profiler_node);
 
 			XMLNodePtr location_sensor_node = cfg_doc.AllocNode(XNT_Element, "location_sensor");
@@ -29,11 +29,14 @@
 */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/ErrorHandling.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/Query.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <iomanip>
 #include <mutex>
 
 #include <KlayGE/PerfProfiler.hpp>
@@ -41,6 +44,48 @@
 namespace
 {
 	std::mutex singleton_mutex;
+
+	// Each profiler instance gets a new generation, so a thread never uses the buffer from a destroyed one
+	std::atomic<uint32_t> profiler_generation(0);
+	thread_local uint32_t tls_generation = 0;
+	thread_local void* tls_thread_events = nullptr;
+
+	// Flags the ring of the thread as exited when the thread ends, so the profiler can free it
+	struct ThreadExitMarker
+	{
+		~ThreadExitMarker()
+		{
+			if (exited)
+			{
+				exited->store(true, std::memory_order_release);
+			}
+		}
+
+		std::shared_ptr<std::atomic<bool>> exited;
+	};
+	thread_local ThreadExitMarker tls_exit_marker;
+
+	void WriteJsonString(std::ostream& os, char const * str)
+	{
+		os << '"';
+		for (; *str != '\0'; ++ str)
+		{
+			char const ch = *str;
+			if ((ch == '"') || (ch == '\\'))
+			{
+				os << '\\' << ch;
+			}
+			else if (static_cast<unsigned char>(ch) < 0x20)
+			{
+				os << ' ';
+			}
+			else
+			{
+				os << ch;
+			}
+		}
+		os << '"';
+	}
 }
 
 namespace KlayGE
@@ -48,7 +93,12 @@ namespace KlayGE
 	std::unique_ptr<PerfProfiler> PerfProfiler::perf_profiler_instance_;
 
 	PerfRange::PerfRange()
-		: cpu_time_(0), gpu_time_(0), dirty_(false)
+		: PerfRange(std::string())
+	{
+	}
+
+	PerfRange::PerfRange(std::string const & name)
+		: name_(name), cpu_time_(0), gpu_time_(0), dirty_(false)
 	{
 		if (Context::Instance().Config().perf_profiler)
 		{
@@ -62,6 +112,10 @@ namespace KlayGE
 		if (Context::Instance().Config().perf_profiler)
 		{
 			dirty_ = true;
+			if (!name_.empty())
+			{
+				PerfProfiler::Instance().BeginZone(name_.c_str());
+			}
 			cpu_timer_.restart();
 			if (gpu_timer_query_)
 			{
@@ -79,6 +133,10 @@ namespace KlayGE
 			{
 				gpu_timer_query_->End();
 			}
+			if (!name_.empty())
+			{
+				PerfProfiler::Instance().EndZone();
+			}
 		}
 	}
 
@@ -111,8 +169,16 @@ namespace KlayGE
 
 
 	PerfProfiler::PerfProfiler()
-		: frame_id_(0)
+		: frame_id_(0),
+			enabled_(Context::Instance().Config().perf_profiler), events_per_thread_(256),
+			generation_(++ profiler_generation), next_thread_id_(0)
 	{
+		// Rounded up to a power of 2 so the ring index is a mask
+		uint32_t const events_per_thread = Context::Instance().Config().perf_profiler_events_per_thread;
+		while ((events_per_thread_ < events_per_thread) && (events_per_thread_ < (1UL << 24)))
+		{
+			events_per_thread_ <<= 1;
+		}
 	}
 
 	PerfProfiler& PerfProfiler::Instance()
@@ -144,7 +210,7 @@ namespace KlayGE
 
 	PerfRangePtr PerfProfiler::CreatePerfRange(int category, std::string const & name)
 	{
-		PerfRangePtr range = MakeSharedPtr<PerfRange>();
+		PerfRangePtr range = MakeSharedPtr<PerfRange>(name);
 		typedef std::remove_reference<decltype(std::get<3>(perf_ranges_[0]))>::type PerfDataType;
 		perf_ranges_.push_back(std::make_tuple(category, name, range, PerfDataType()));
 		return range;
@@ -152,7 +218,7 @@ namespace KlayGE
 
 	void PerfProfiler::CollectData()
 	{
-		if (Context::Instance().Config().perf_profiler)
+		if (enabled_)
 		{
 			for (auto& range : perf_ranges_)
 			{
@@ -164,13 +230,14 @@ namespace KlayGE
 				}
 			}
 
+			this->FrameMarker();
 			++ frame_id_;
 		}
 	}
 
 	void PerfProfiler::ExportToCSV(std::string const & file_name) const
 	{
-		if (Context::Instance().Config().perf_profiler)
+		if (enabled_)
 		{
 			std::ofstream ofs(file_name.c_str());
 			ofs << "Frame" << ',' << "Category" << ',' << "Name" << ','
@@ -193,4 +260,190 @@ namespace KlayGE
 			ofs << std::endl;
 		}
 	}
+
+	void PerfProfiler::ThreadName(std::string const & name)
+	{
+		if (enabled_)
+		{
+			ThreadEvents* thread_events = this->CurrThreadEvents();
+
+			std::lock_guard<std::mutex> lock(thread_events_mutex_);
+			thread_events->name = name;
+		}
+	}
+
+	void PerfProfiler::BeginZone(char const * name)
+	{
+		this->RecordEvent(PET_BeginZone, name, 0);
+	}
+
+	void PerfProfiler::EndZone()
+	{
+		this->RecordEvent(PET_EndZone, nullptr, 0);
+	}
+
+	void PerfProfiler::FrameMarker()
+	{
+		this->RecordEvent(PET_Frame, "Frame", frame_id_);
+	}
+
+	void PerfProfiler::Counter(char const * name, int64_t value)
+	{
+		this->RecordEvent(PET_Counter, name, value);
+	}
+
+	void PerfProfiler::ExportToChromeTrace(std::string const & file_name)
+	{
+		if (enabled_)
+		{
+			std::ofstream ofs(file_name.c_str());
+			ofs << std::fixed << std::setprecision(3);
+			ofs << "{\"traceEvents\":[";
+
+			bool first = true;
+			auto begin_event = [&ofs, &first](char const * name, char const * phase, uint32_t thread_id)
+			{
+				ofs << (first ? "\n" : ",\n");
+				first = false;
+
+				ofs << "{\"name\":";
+				WriteJsonString(ofs, name);
+				ofs << ",\"ph\":\"" << phase << "\",\"pid\":0,\"tid\":" << thread_id;
+			};
+
+			std::lock_guard<std::mutex> lock(thread_events_mutex_);
+			for (auto iter = thread_events_.begin(); iter != thread_events_.end();)
+			{
+				auto const & thread_events = *iter;
+
+				// Read before the events, so everything an exited thread recorded is exported before its ring is freed
+				bool const exited = thread_events->exited->load(std::memory_order_acquire);
+
+				uint32_t const tid = thread_events->thread_id;
+				if (!thread_events->name.empty())
+				{
+					begin_event("thread_name", "M", tid);
+					ofs << ",\"args\":{\"name\":";
+					WriteJsonString(ofs, thread_events->name.c_str());
+					ofs << "}}";
+				}
+
+				// Only the last events.size() events are kept. An event could be overwritten while it is being exported.
+				// Once the ring wraps, ends whose begins are overwritten are dropped. Zones still open at the end, including
+				// ones not ended yet, are closed at the last timestamp, so every B has its E.
+				uint64_t const capacity = thread_events->events.size();
+				uint64_t const end = thread_events->write_index.load(std::memory_order_acquire);
+				uint64_t const begin = (end > capacity) ? end - capacity : 0;
+				uint32_t zone_depth = 0;
+				double last_ts = 0;
+				for (uint64_t i = begin; i < end; ++ i)
+				{
+					PerfEvent const & event = thread_events->events[i & (capacity - 1)];
+					double const ts = event.timestamp * 1e6;
+					last_ts = std::max(last_ts, ts);
+					switch (event.type)
+					{
+					case PET_BeginZone:
+						begin_event(event.name, "B", tid);
+						ofs << ",\"ts\":" << ts << "}";
+						++ zone_depth;
+						break;
+
+					case PET_EndZone:
+						if (zone_depth > 0)
+						{
+							begin_event("", "E", tid);
+							ofs << ",\"ts\":" << ts << "}";
+							-- zone_depth;
+						}
+						break;
+
+					case PET_Frame:
+						begin_event(event.name, "i", tid);
+						ofs << ",\"ts\":" << ts << ",\"s\":\"g\",\"args\":{\"frame\":" << event.value << "}}";
+						break;
+
+					case PET_Counter:
+						begin_event(event.name, "C", tid);
+						ofs << ",\"ts\":" << ts << ",\"args\":{\"value\":" << event.value << "}}";
+						break;
+
+					default:
+						KFL_UNREACHABLE("Invalid perf event type");
+					}
+				}
+				for (; zone_depth > 0; -- zone_depth)
+				{
+					begin_event("", "E", tid);
+					ofs << ",\"ts\":" << last_ts << "}";
+				}
+
+				if (exited)
+				{
+					iter = thread_events_.erase(iter);
+				}
+				else
+				{
+					++ iter;
+				}
+			}
+
+			ofs << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+		}
+	}
+
+	PerfProfiler::ThreadEvents* PerfProfiler::CurrThreadEvents()
+	{
+		if (tls_generation != generation_)
+		{
+			auto thread_events = MakeUniquePtr<ThreadEvents>();
+			thread_events->events.resize(events_per_thread_);
+			thread_events->write_index = 0;
+			thread_events->exited = MakeSharedPtr<std::atomic<bool>>(false);
+			tls_exit_marker.exited = thread_events->exited;
+
+			std::lock_guard<std::mutex> lock(thread_events_mutex_);
+			thread_events->thread_id = next_thread_id_;
+			++ next_thread_id_;
+			tls_thread_events = thread_events.get();
+			tls_generation = generation_;
+			thread_events_.push_back(std::move(thread_events));
+		}
+		return static_cast<ThreadEvents*>(tls_thread_events);
+	}
+
+	void PerfProfiler::RecordEvent(PerfEventType type, char const * name, int64_t value)
+	{
+		if (enabled_)
+		{
+			ThreadEvents* thread_events = this->CurrThreadEvents();
+
+			// Single writer per buffer, the release store publishes the event to ExportToChromeTrace
+			uint64_t const index = thread_events->write_index.load(std::memory_order_relaxed);
+			PerfEvent& event = thread_events->events[index & (events_per_thread_ - 1)];
+			event.timestamp = timeline_timer_.elapsed();
+			event.name = name;
+			event.value = value;
+			event.type = type;
+			thread_events->write_index.store(index + 1, std::memory_order_release);
+		}
+	}
+
+
+	PerfZone::PerfZone(char const * name)
+		: active_(Context::Instance().Config().perf_profiler)
+	{
+		if (active_)
+		{
+			PerfProfiler::Instance().BeginZone(name);
+		}
+	}
+
+	PerfZone::~PerfZone()
+	{
+		if (active_)
+		{
+			PerfProfiler::Instance().EndZone();
+		}
+	}
 }
@@ -32,6 +32,7 @@
 #include <KFL/Hash.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/Package.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 #include <KFL/CXX17/filesystem.hpp>
 
 #if defined KLAYGE_PLATFORM_LINUX
@@ -73,6 +74,13 @@ namespace
 {
 	std::mutex singleton_mutex;
 
+	// The number of references to res held inside ResLoader, assuming the caller holds exactly one. -1 means they can't be
+	// tracked, and the resource is never released or cancelled by ResLoader.
+	long NumInternalRefs(KlayGE::ResLoadingDesc const & res_desc, std::shared_ptr<void> const & res)
+	{
+		return (res && res_desc.StateLess()) ? res.use_count() - 1 : -1;
+	}
+
 #ifdef KLAYGE_PLATFORM_ANDROID
 	class AAssetStreamBuf : public KlayGE::MemInputStreamBuf
 	{
@@ -203,21 +211,22 @@ namespace KlayGE
 #endif
 #endif
 
-		loading_thread_ = MakeUniquePtr<joiner<void>>(Context::Instance().ThreadPool()(
-			[this] { this->LoadingThreadFunc(); }));
+		uint32_t const num_hw_threads = std::thread::hardware_concurrency();
+		this->NumLoadingThreads(std::clamp(num_hw_threads / 2, 1U, 4U));
 	}
 
 	ResLoader::~ResLoader()
 	{
-		quit_ = true;
-
 		{
-			std::unique_lock<std::mutex> lock(loading_res_queue_mutex_, std::try_to_lock);
-			non_empty_loading_res_queue_ = true;
-			loading_res_queue_cv_.notify_one();
+			std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+			quit_ = true;
 		}
+		loading_res_queue_cv_.notify_all();
 
-		(*loading_thread_)();
+		for (auto& thread : loading_threads_)
+		{
+			thread();
+		}
 	}
 
 	ResLoader& ResLoader::Instance()
@@ -248,6 +257,35 @@ namespace KlayGE
 		// TODO
 	}
 
+	void ResLoader::NumLoadingThreads(uint32_t num)
+	{
+		num = std::max(num, 1U);
+
+		uint32_t const old_num = static_cast<uint32_t>(loading_threads_.size());
+		{
+			std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+			num_active_loading_threads_ = num;
+		}
+
+		if (num > old_num)
+		{
+			for (uint32_t i = old_num; i < num; ++ i)
+			{
+				loading_threads_.emplace_back(Context::Instance().ThreadPool()(
+					[this, i] { this->LoadingThreadFunc(i); }));
+			}
+		}
+		else if (num < old_num)
+		{
+			loading_res_queue_cv_.notify_all();
+			for (uint32_t i = num; i < old_num; ++ i)
+			{
+				loading_threads_[i]();
+			}
+			loading_threads_.resize(num);
+		}
+	}
+
 	std::string ResLoader::AbsPath(std::string_view path)
 	{
 		std::string path_str(path);
@@ -345,22 +383,35 @@ namespace KlayGE
 		password = "";
 		path_in_package = "";
 
+		// 7z archives, or native packages
+		std::string_view const pkt_exts[] = { ".7z", ".kpk" };
+
 		size_t start_offset = 0;
 		for (;;)
 		{
-			auto const pkt_offset = path.find(".7z", start_offset);
+			auto pkt_offset = std::string_view::npos;
+			size_t pkt_end = 0;
+			for (auto const & ext : pkt_exts)
+			{
+				auto const offset = path.find(ext, start_offset);
+				if (offset < pkt_offset)
+				{
+					pkt_offset = offset;
+					pkt_end = offset + ext.size();
+				}
+			}
 			if (pkt_offset != std::string_view::npos)
 			{
-				package_path = std::string(path.substr(0, pkt_offset + 3));
+				package_path = std::string(path.substr(0, pkt_end));
 				std::filesystem::path pkt_path(package_path);
 				std::error_code ec;
 				if (std::filesystem::exists(pkt_path, ec)
 					&& (std::filesystem::is_regular_file(pkt_path) || std::filesystem::is_symlink(pkt_path)))
 				{
-					auto const next_slash_offset = path.find('/', pkt_offset + 3);
-					if ((path.size() > pkt_offset + 3) && (path[pkt_offset + 3] == '|'))
+					auto const next_slash_offset = path.find('/', pkt_end);
+					if ((path.size() > pkt_end) && (path[pkt_end] == '|'))
 					{
-						auto const password_start_offset = pkt_offset + 4;
+						auto const password_start_offset = pkt_end + 1;
 						if (next_slash_offset != std::string_view::npos)
 						{
 							password = std::string(path.substr(password_start_offset, next_slash_offset - password_start_offset));
@@ -378,7 +429,7 @@ namespace KlayGE
 				}
 				else
 				{
-					start_offset = pkt_offset + 3;
+					start_offset = pkt_end;
 				}
 			}
 			else
@@ -623,6 +674,13 @@ namespace KlayGE
 					if (std::filesystem::exists(res_path, ec))
 					{
 						uint64_t const timestamp = std::filesystem::last_write_time(res_path).time_since_epoch().count();
+#ifndef KLAYGE_SHIP
+						uint64_t const file_size = std::filesystem::file_size(res_path, ec);
+						if (!ec)
+						{
+							PerfProfiler::Instance().Counter("Bytes opened", static_cast<int64_t>(bytes_opened_ += file_size));
+						}
+#endif
 						return MakeSharedPtr<ResIdentifier>(
 							name, timestamp, MakeSharedPtr<std::ifstream>(res_name.c_str(), std::ios_base::binary));
 					}
@@ -678,9 +736,9 @@ namespace KlayGE
 
 	std::shared_ptr<void> ResLoader::SyncQuery(ResLoadingDescPtr const & res_desc)
 	{
-		this->RemoveUnrefResources();
+		uint64_t const hash = res_desc->Hash();
 
-		std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc);
+		std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc, hash);
 		std::shared_ptr<void> res;
 		if (loaded_res)
 		{
@@ -693,23 +751,27 @@ namespace KlayGE
 				res = res_desc->CloneResourceFrom(loaded_res);
 				if (res != loaded_res)
 				{
-					this->AddLoadedResource(res_desc, res);
+					this->AddLoadedResource(res_desc, hash, res, -1);
 				}
 			}
 		}
 		else
 		{
 			std::shared_ptr<volatile LoadingStatus> async_is_done;
+			long num_internal_refs = -1;
 			bool found = false;
 			{
 				std::lock_guard<std::mutex> lock(loading_mutex_);
 
-				for (auto const & lrq : loading_res_)
+				auto const range = loading_res_.equal_range(hash);
+				for (auto iter = range.first; iter != range.second; ++ iter)
 				{
-					if (lrq.first->Match(*res_desc))
+					auto const & lr = iter->second;
+					if (lr.res_desc->Match(*res_desc))
 					{
-						res_desc->CopyDataFrom(*lrq.first);
-						async_is_done = lrq.second;
+						res_desc->CopyDataFrom(*lr.res_desc);
+						async_is_done = lr.status;
+						num_internal_refs = lr.num_internal_refs;
 						found = true;
 						break;
 					}
@@ -732,17 +794,21 @@ namespace KlayGE
 
 			res_desc->MainThreadStage();
 			res = res_desc->Resource();
-			this->AddLoadedResource(res_desc, res);
+			if (!found)
+			{
+				num_internal_refs = NumInternalRefs(*res_desc, res);
+			}
+			this->AddLoadedResource(res_desc, hash, res, num_internal_refs);
 		}
 
 		return res;
 	}
 
-	std::shared_ptr<void> ResLoader::ASyncQuery(ResLoadingDescPtr const & res_desc)
+	std::shared_ptr<void> ResLoader::ASyncQuery(ResLoadingDescPtr const & res_desc, float priority)
 	{
-		this->RemoveUnrefResources();
+		uint64_t const hash = res_desc->Hash();
 
-		std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc);
+		std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc, hash);
 		std::shared_ptr<void> res;
 		if (loaded_res)
 		{
@@ -755,7 +821,7 @@ namespace KlayGE
 				res = res_desc->CloneResourceFrom(loaded_res);
 				if (res != loaded_res)
 				{
-					this->AddLoadedResource(res_desc, res);
+					this->AddLoadedResource(res_desc, hash, res, -1);
 				}
 			}
 		}
@@ -766,26 +832,36 @@ namespace KlayGE
 			{
 				std::lock_guard<std::mutex> lock(loading_mutex_);
 
-				for (auto const & lrq : loading_res_)
+				auto const range = loading_res_.equal_range(hash);
+				for (auto iter = range.first; iter != range.second; ++ iter)
 				{
-					if (lrq.first->Match(*res_desc))
+					auto const & lr = iter->second;
+					if (lr.res_desc->Match(*res_desc))
 					{
-						res_desc->CopyDataFrom(*lrq.first);
-						async_is_done = lrq.second;
+						res_desc->CopyDataFrom(*lr.res_desc);
+						async_is_done = lr.status;
+						res = res_desc->Resource();
 						found = true;
 						break;
 					}
 				}
+
+				if (found && !res_desc->StateLess())
+				{
+					loading_res_.emplace(hash, LoadingResource{ res_desc, hash, async_is_done, -1 });
+				}
 			}
 
 			if (found)
 			{
-				res = res_desc->Resource();
+				std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
 
-				if (!res_desc->StateLess())
+				auto iter = std::find_if(loading_res_queue_.begin(), loading_res_queue_.end(),
+					[&async_is_done](LoadingResQueueItem const & item) { return item.status == async_is_done; });
+				if ((iter != loading_res_queue_.end()) && (iter->priority < priority))
 				{
-					std::lock_guard<std::mutex> lock(loading_mutex_);
-					loading_res_.emplace_back(res_desc, async_is_done);
+					iter->priority = priority;
+					std::make_heap(loading_res_queue_.begin(), loading_res_queue_.end());
 				}
 			}
 			else
@@ -795,23 +871,34 @@ namespace KlayGE
 					res = res_desc->CreateResource();
 
 					async_is_done = MakeSharedPtr<LoadingStatus>(LS_Loading);
+					long const num_internal_refs = NumInternalRefs(*res_desc, res);
+
+					LoadingResQueueItem item;
+					item.res_desc = res_desc;
+					item.hash = hash;
+					item.status = async_is_done;
+					item.res = res;
+					item.num_internal_refs = num_internal_refs;
+					item.priority = priority;
 
 					{
 						std::lock_guard<std::mutex> lock(loading_mutex_);
-						loading_res_.emplace_back(res_desc, async_is_done);
+						loading_res_.emplace(hash, LoadingResource{ res_desc, hash, async_is_done, num_internal_refs });
 					}
 					{
-						std::unique_lock<std::mutex> lock(loading_res_queue_mutex_, std::try_to_lock);
-						loading_res_queue_.emplace_back(res_desc, async_is_done);
-						non_empty_loading_res_queue_ = true;
-						loading_res_queue_cv_.notify_one();
+						std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+						item.seq = loading_res_queue_seq_;
+						++ loading_res_queue_seq_;
+						loading_res_queue_.push_back(std::move(item));
+						std::push_heap(loading_res_queue_.begin(), loading_res_queue_.end());
 					}
+					loading_res_queue_cv_.notify_one();
 				}
 				else
 				{
 					res_desc->MainThreadStage();
 					res = res_desc->Resource();
-					this->AddLoadedResource(res_desc, res);
+					this->AddLoadedResource(res_desc, hash, res, NumInternalRefs(*res_desc, res));
 				}
 			}
 		}
@@ -824,83 +911,179 @@ namespace KlayGE
 
 		for (auto iter = loaded_res_.begin(); iter != loaded_res_.end(); ++ iter)
 		{
-			if (res == iter->second.lock())
+			if (res == iter->res.lock())
 			{
-				loaded_res_.erase(iter);
+				this->RemoveLoadedResourceNoLock(iter);
 				break;
 			}
 		}
 	}
 
-	void ResLoader::AddLoadedResource(ResLoadingDescPtr const & res_desc, std::shared_ptr<void> const & res)
+	void ResLoader::Prioritize(std::shared_ptr<void> const & res, float priority)
 	{
-		std::lock_guard<std::mutex> lock(loaded_mutex_);
+		if (!res)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
 
-		bool found = false;
-		for (auto& c_desc : loaded_res_)
+		// Compares the owners of the weak pointers, so no user descriptor is called under the queue lock
+		bool changed = false;
+		for (auto& item : loading_res_queue_)
 		{
-			if (c_desc.first == res_desc)
+			if (item.priority != priority)
 			{
-				c_desc.second = std::weak_ptr<void>(res);
-				found = true;
-				break;
+				if (!item.res.owner_before(res) && !res.owner_before(item.res))
+				{
+					item.priority = priority;
+					changed = true;
+				}
 			}
 		}
-		if (!found)
+		if (changed)
 		{
-			loaded_res_.emplace_back(res_desc, std::weak_ptr<void>(res));
+			std::make_heap(loading_res_queue_.begin(), loading_res_queue_.end());
 		}
 	}
 
-	std::shared_ptr<void> ResLoader::FindMatchLoadedResource(ResLoadingDescPtr const & res_desc)
+	void ResLoader::CacheBudget(uint64_t budget)
+	{
+		std::lock_guard<std::mutex> lock(loaded_mutex_);
+		cache_budget_ = budget;
+	}
+
+	void ResLoader::AddLoadedResource(ResLoadingDescPtr const & res_desc, uint64_t hash, std::shared_ptr<void> const & res,
+		long num_internal_refs)
+	{
+		uint64_t const size = (num_internal_refs >= 0) ? res_desc->ResourceSize() : 0;
+
+		std::lock_guard<std::mutex> lock(loaded_mutex_);
+
+		auto const range = loaded_res_index_.equal_range(hash);
+		auto const index_iter = std::find_if(range.first, range.second,
+			[&res_desc](std::pair<uint64_t const, std::list<LoadedResource>::iterator> const & index)
+			{
+				return index.second->res_desc == res_desc;
+			});
+		if (index_iter != range.second)
+		{
+			auto const iter = index_iter->second;
+			loaded_res_size_ -= iter->size;
+			iter->res = res;
+			iter->num_internal_refs = num_internal_refs;
+			iter->size = size;
+			loaded_res_size_ += size;
+			loaded_res_.splice(loaded_res_.begin(), loaded_res_, iter);
+		}
+		else
+		{
+			loaded_res_.push_front(LoadedResource{ res_desc, hash, res, num_internal_refs, size });
+			loaded_res_index_.emplace(hash, loaded_res_.begin());
+			loaded_res_size_ += size;
+		}
+
+		// Loading many resources between two Update() calls could otherwise grow the cache far past the budget.
+		// Only a few of the least recently used are visited here, Update() still does the full sweep.
+		if (loaded_res_size_ > cache_budget_)
+		{
+			this->SweepLoadedResourcesNoLock(16);
+		}
+	}
+
+	std::shared_ptr<void> ResLoader::FindMatchLoadedResource(ResLoadingDescPtr const & res_desc, uint64_t hash)
 	{
 		std::lock_guard<std::mutex> lock(loaded_mutex_);
 
 		std::shared_ptr<void> loaded_res;
-		for (auto const & lr : loaded_res_)
+		auto range = loaded_res_index_.equal_range(hash);
+		for (auto index_iter = range.first; index_iter != range.second;)
 		{
-			if (lr.first->Match(*res_desc))
+			auto const iter = index_iter->second;
+			if (iter->res_desc->Match(*res_desc))
 			{
-				loaded_res = lr.second.lock();
-				break;
+				loaded_res = iter->res.lock();
+				if (loaded_res)
+				{
+					loaded_res_.splice(loaded_res_.begin(), loaded_res_, iter);
+					break;
+				}
+				else
+				{
+					loaded_res_size_ -= iter->size;
+					loaded_res_.erase(iter);
+					index_iter = loaded_res_index_.erase(index_iter);
+				}
+			}
+			else
+			{
+				++ index_iter;
 			}
 		}
 		return loaded_res;
 	}
 
+	std::list<ResLoader::LoadedResource>::iterator ResLoader::RemoveLoadedResourceNoLock(
+		std::list<LoadedResource>::iterator iter)
+	{
+		auto const range = loaded_res_index_.equal_range(iter->hash);
+		for (auto index_iter = range.first; index_iter != range.second; ++ index_iter)
+		{
+			if (index_iter->second == iter)
+			{
+				loaded_res_index_.erase(index_iter);
+				break;
+			}
+		}
+
+		loaded_res_size_ -= iter->size;
+		return loaded_res_.erase(iter);
+	}
+
 	void ResLoader::RemoveUnrefResources()
 	{
 		std::lock_guard<std::mutex> lock(loaded_mutex_);
+		this->SweepLoadedResourcesNoLock(loaded_res_.size());
+	}
 
-		for (auto iter = loaded_res_.begin(); iter != loaded_res_.end();)
+	void ResLoader::SweepLoadedResourcesNoLock(size_t max_visits)
+	{
+		// Walks up to max_visits entries from the least recently used. Expired resources are always removed.
+		// Unreferenced ones are evicted only while the cache is over budget.
+		auto iter = loaded_res_.end();
+		for (size_t i = 0; (i < max_visits) && (iter != loaded_res_.begin()); ++ i)
 		{
-			if (iter->second.lock())
-			{
-				++ iter;
-			}
-			else
+			-- iter;
+
+			long const use_count = iter->res.use_count();
+			bool const unreferenced = (iter->size > 0) && (use_count <= iter->num_internal_refs);
+			if ((use_count == 0) || ((loaded_res_size_ > cache_budget_) && unreferenced))
 			{
-				iter = loaded_res_.erase(iter);
+				iter = this->RemoveLoadedResourceNoLock(iter);
 			}
 		}
 	}
 
 	void ResLoader::Update()
 	{
-		std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> tmp_loading_res;
+		std::vector<LoadingResource> tmp_loading_res;
 		{
 			std::lock_guard<std::mutex> lock(loading_mutex_);
-			tmp_loading_res = loading_res_;
+			tmp_loading_res.reserve(loading_res_.size());
+			for (auto const & lr : loading_res_)
+			{
+				tmp_loading_res.push_back(lr.second);
+			}
 		}
 
-		for (auto& lrq : tmp_loading_res)
+		for (auto& lr : tmp_loading_res)
 		{
-			if (LS_Complete == *lrq.second)
+			if (LS_Complete == *lr.status)
 			{
-				ResLoadingDescPtr const & res_desc = lrq.first;
+				ResLoadingDescPtr const & res_desc = lr.res_desc;
 
 				std::shared_ptr<void> res;
-				std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc);
+				std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc, lr.hash);
 				if (loaded_res)
 				{
 					if (!res_desc->StateLess())
@@ -908,7 +1091,7 @@ namespace KlayGE
 						res = res_desc->CloneResourceFrom(loaded_res);
 						if (res != loaded_res)
 						{
-							this->AddLoadedResource(res_desc, res);
+							this->AddLoadedResource(res_desc, lr.hash, res, -1);
 						}
 					}
 				}
@@ -916,15 +1099,15 @@ namespace KlayGE
 				{
 					res_desc->MainThreadStage();
 					res = res_desc->Resource();
-					this->AddLoadedResource(res_desc, res);
+					this->AddLoadedResource(res_desc, lr.hash, res, lr.num_internal_refs);
 				}
 			}
 		}
-		for (auto& lrq : tmp_loading_res)
+		for (auto& lr : tmp_loading_res)
 		{
-			if (LS_Complete == *lrq.second)
+			if (LS_Complete == *lr.status)
 			{
-				*lrq.second = LS_CanBeRemoved;
+				*lr.status = LS_CanBeRemoved;
 			}
 		}
 
@@ -932,7 +1115,7 @@ namespace KlayGE
 			std::lock_guard<std::mutex> lock(loading_mutex_);
 			for (auto iter = loading_res_.begin(); iter != loading_res_.end();)
 			{
-				if (LS_CanBeRemoved == *(iter->second))
+				if (LS_CanBeRemoved == *(iter->second.status))
 				{
 					iter = loading_res_.erase(iter);
 				}
@@ -942,32 +1125,72 @@ namespace KlayGE
 				}
 			}
 		}
+
+		tmp_loading_res.clear();
+		this->RemoveUnrefResources();
 	}
 
-	void ResLoader::LoadingThreadFunc()
+	bool ResLoader::CancelUnreferencedLoading(LoadingResQueueItem const & item)
 	{
-		while (!quit_)
+		if (item.num_internal_refs >= 0)
 		{
-			std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_queue_copy;
+			// Hold loading_mutex_, so that ASyncQuery can't hand out the resource again while checking
+			std::lock_guard<std::mutex> lock(loading_mutex_);
 
+			if (item.res.use_count() <= item.num_internal_refs)
 			{
-				std::unique_lock<std::mutex> lock(loading_res_queue_mutex_);
-				loading_res_queue_cv_.wait(lock, [this] { return non_empty_loading_res_queue_; });
+				*item.status = LS_CanBeRemoved;
 
-				loading_res_queue_copy.swap(loading_res_queue_);
-				non_empty_loading_res_queue_ = false;
+				auto const range = loading_res_.equal_range(item.hash);
+				for (auto iter = range.first; iter != range.second;)
+				{
+					if (iter->second.status == item.status)
+					{
+						iter = loading_res_.erase(iter);
+					}
+					else
+					{
+						++ iter;
+					}
+				}
+				return true;
 			}
+		}
+
+		return false;
+	}
 
-			for (auto& res_pair : loading_res_queue_copy)
+	void ResLoader::LoadingThreadFunc(uint32_t thread_index)
+	{
+#ifndef KLAYGE_SHIP
+		PerfProfiler::Instance().ThreadName("ResLoader " + std::to_string(thread_index));
+#endif
+
+		for (;;)
+		{
+			LoadingResQueueItem item;
 			{
-				if (LS_Loading == *res_pair.second)
+				std::unique_lock<std::mutex> lock(loading_res_queue_mutex_);
+				loading_res_queue_cv_.wait(lock, [this, thread_index]
+					{
+						return quit_ || (thread_index >= num_active_loading_threads_) || !loading_res_queue_.empty();
+					});
+				if (quit_ || (thread_index >= num_active_loading_threads_))
 				{
-					res_pair.first->SubThreadStage();
-					*res_pair.second = LS_Complete;
+					break;
 				}
+
+				std::pop_heap(loading_res_queue_.begin(), loading_res_queue_.end());
+				item = std::move(loading_res_queue_.back());
+				loading_res_queue_.pop_back();
 			}
 
-			Sleep(10);
+			if ((LS_Loading == *item.status) && !this->CancelUnreferencedLoading(item))
+			{
+				KLAYGE_PERF_ZONE("ResLoader::SubThreadStage");
+				item.res_desc->SubThreadStage();
+				*item.status = LS_Complete;
+			}
 		}
 	}
 
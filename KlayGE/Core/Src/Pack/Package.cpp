@@ -31,16 +31,28 @@
 #include <KlayGE/KlayGE.hpp>
 #define INITGUID
 #include <KFL/com_ptr.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KFL/CXX2a/span.hpp>
+#include <KFL/CustomizedStreamBuf.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KFL/MappedFile.hpp>
 #include <KFL/ResIdentifier.hpp>
 #include <KFL/StringUtil.hpp>
+#include <KFL/TaskScheduler.hpp>
 #include <KFL/Util.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/LZMACodec.hpp>
 
 #include <CPP/Common/MyWindows.h>
 
 #include <KFL/DllLoader.hpp>
 
 #include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
 #include <sstream>
 #include <string>
 
@@ -140,6 +152,52 @@ namespace
 		DllLoader dll_loader_;
 		CreateObjectFunc createObjectFunc_;
 	};
+
+	uint32_t const KPAK_VERSION = 1;
+
+	// fourcc, version, number of entries, reserved, offset and size of the name table. The table of contents follows.
+	uint32_t const KPAK_HEADER_SIZE = 32;
+
+	// Data of each entry starts at a page boundary, so a stored file can be used in place from a mapped package
+	uint64_t const KPAK_ENTRY_ALIGNMENT = 4096;
+
+	enum KPakCompression : uint32_t
+	{
+		KPC_None = 0,
+		KPC_LZMA
+	};
+
+	// An LZMA entry starts with the 5-byte properties of the encoder
+	uint64_t const KPAK_LZMA_PROPS_SIZE = 5;
+
+	// LZMA doesn't get much above 7000:1 even on runs of one byte. A larger original size is a corrupted table of contents, and
+	//  isn't allocated.
+	uint64_t const KPAK_MAX_LZMA_RATIO = 16384;
+
+	// FNV-1a on the lower case path. Lookups are case insensitive, the same as in 7z packages.
+	uint64_t KPakPathHash(std::string_view path)
+	{
+		uint64_t hash = 0xCBF29CE484222325ULL;
+		for (char ch : path)
+		{
+			hash = (hash ^ static_cast<uint8_t>(std::tolower(static_cast<unsigned char>(ch)))) * 0x100000001B3ULL;
+		}
+		return hash;
+	}
+
+	// Keeps the owner of the memory, a mapped package or a decoded buffer, alive with the stream
+	class SharedMemInputStreamBuf : public MemInputStreamBuf
+	{
+	public:
+		SharedMemInputStreamBuf(void const * p, std::streamsize num_bytes, std::shared_ptr<void const> const & owner)
+			: MemInputStreamBuf(p, num_bytes),
+				owner_(owner)
+		{
+		}
+
+	private:
+		std::shared_ptr<void const> owner_;
+	};
 }
 
 namespace KlayGE
@@ -150,15 +208,33 @@ namespace KlayGE
 	}
 
 	Package::Package(ResIdentifierPtr const & archive_is, std::string_view password)
-		: archive_is_(archive_is), password_(password)
+		: archive_is_(archive_is), password_(password), num_items_(0)
 	{
 		BOOST_ASSERT(archive_is);
 
+		uint32_t fourcc = 0;
+		archive_is_->read(&fourcc, sizeof(fourcc));
+		fourcc = LE2Native(fourcc);
+		archive_is_->clear();
+		archive_is_->seekg(0, std::ios_base::beg);
+
+		if (fourcc == MakeFourCC<'K', 'P', 'A', 'K'>::value)
+		{
+			this->OpenKPak();
+		}
+		else
+		{
+			this->Open7z();
+		}
+	}
+
+	void Package::Open7z()
+	{
 		com_ptr<IInArchive> archive;
 		TIFHR(SevenZipLoader::Instance().CreateObject(&CLSID_CFormat7z, &IID_IInArchive, archive.put_void()));
 
-		com_ptr<IInStream> file(new InStream(archive_is), false);
-		com_ptr<IArchiveOpenCallback> ocb(new ArchiveOpenCallback(password), false);
+		com_ptr<IInStream> file(new InStream(archive_is_), false);
+		com_ptr<IArchiveOpenCallback> ocb(new ArchiveOpenCallback(password_), false);
 		TIFHR(archive->Open(file.get(), 0, ocb.get()));
 
 		TIFHR(archive->GetNumberOfItems(&num_items_));
@@ -166,14 +242,128 @@ namespace KlayGE
 		archive_ = std::shared_ptr<IInArchive>(archive.detach(), std::mem_fn(&IInArchive::Release));
 	}
 
+	// Native packages have no encryption, the password is ignored
+	void Package::OpenKPak()
+	{
+		// Every size and offset in the header and the table of contents is checked against the package size before it's used
+		archive_is_->seekg(0, std::ios_base::end);
+		int64_t const package_size_signed = archive_is_->tellg();
+		archive_is_->seekg(0, std::ios_base::beg);
+		if (!*archive_is_ || (package_size_signed < KPAK_HEADER_SIZE))
+		{
+			TMSG("Corrupted package");
+		}
+		uint64_t const package_size = static_cast<uint64_t>(package_size_signed);
+
+		uint32_t header[4];
+		archive_is_->read(header, sizeof(header));
+		uint32_t const ver = LE2Native(header[1]);
+		if (ver != KPAK_VERSION)
+		{
+			TMSG("Unsupported package version");
+		}
+		uint32_t const num_entries = LE2Native(header[2]);
+
+		uint64_t names_offset;
+		archive_is_->read(&names_offset, sizeof(names_offset));
+		names_offset = LE2Native(names_offset);
+		uint64_t names_size;
+		archive_is_->read(&names_size, sizeof(names_size));
+		names_size = LE2Native(names_size);
+		if (!*archive_is_ || (num_entries > (package_size - KPAK_HEADER_SIZE) / sizeof(KPakEntry)) || (names_offset > package_size) ||
+			(names_size > package_size - names_offset))
+		{
+			TMSG("Corrupted package");
+		}
+
+		kpak_entries_.resize(num_entries);
+		archive_is_->read(kpak_entries_.data(), kpak_entries_.size() * sizeof(kpak_entries_[0]));
+		if (!*archive_is_)
+		{
+			TMSG("Corrupted package");
+		}
+		uint64_t data_end = 0;
+		for (auto& entry : kpak_entries_)
+		{
+			entry.path_hash = LE2Native(entry.path_hash);
+			entry.offset = LE2Native(entry.offset);
+			entry.size = LE2Native(entry.size);
+			entry.original_size = LE2Native(entry.original_size);
+			entry.timestamp = LE2Native(entry.timestamp);
+			entry.name_offset = LE2Native(entry.name_offset);
+			entry.name_length = LE2Native(entry.name_length);
+			entry.compression = LE2Native(entry.compression);
+
+			if ((entry.offset > package_size) || (entry.size > package_size - entry.offset) ||
+				(static_cast<uint64_t>(entry.name_offset) + entry.name_length > names_size))
+			{
+				TMSG("Corrupted package");
+			}
+			switch (entry.compression)
+			{
+			case KPC_None:
+				if (entry.original_size != entry.size)
+				{
+					TMSG("Corrupted package");
+				}
+				break;
+
+			case KPC_LZMA:
+				if ((entry.size < KPAK_LZMA_PROPS_SIZE) || (entry.original_size / KPAK_MAX_LZMA_RATIO > entry.size) ||
+					(entry.original_size > std::numeric_limits<size_t>::max()))
+				{
+					TMSG("Corrupted package");
+				}
+				break;
+
+			default:
+				TMSG("Unsupported package compression");
+			}
+
+			data_end = std::max(data_end, entry.offset + entry.size);
+		}
+		if (!std::is_sorted(kpak_entries_.begin(), kpak_entries_.end(), [](KPakEntry const & lhs, KPakEntry const & rhs)
+				{
+					return lhs.path_hash < rhs.path_hash;
+				}))
+		{
+			TMSG("Corrupted package");
+		}
+
+		kpak_names_.resize(static_cast<size_t>(names_size));
+		archive_is_->seekg(static_cast<int64_t>(names_offset), std::ios_base::beg);
+		archive_is_->read(kpak_names_.data(), kpak_names_.size());
+		if (!*archive_is_)
+		{
+			TMSG("Corrupted package");
+		}
+
+		// If the package isn't a file on the file system, entries are read through the stream
+		kpak_mapped_file_ = MakeSharedPtr<MappedFile>();
+		if (!kpak_mapped_file_->Map(archive_is_->ResName()) || (kpak_mapped_file_->Size() < data_end))
+		{
+			kpak_mapped_file_.reset();
+		}
+	}
+
 	bool Package::Locate(std::string_view extract_file_path)
 	{
-		uint32_t real_index = this->Find(extract_file_path);
+		uint32_t real_index = archive_ ? this->Find(extract_file_path) : this->FindKPak(extract_file_path);
 		return (real_index != 0xFFFFFFFF);
 	}
 
 	ResIdentifierPtr Package::Extract(std::string_view extract_file_path, std::string_view res_name)
 	{
+		if (!archive_)
+		{
+			uint32_t const index = this->FindKPak(extract_file_path);
+			if (index != 0xFFFFFFFF)
+			{
+				return this->ExtractKPak(kpak_entries_[index], res_name);
+			}
+			return ResIdentifierPtr();
+		}
+
 		uint32_t real_index = this->Find(extract_file_path);
 		if (real_index != 0xFFFFFFFF)
 		{
@@ -248,4 +438,236 @@ namespace KlayGE
 
 		return real_index;
 	}
+
+	uint32_t Package::FindKPak(std::string_view extract_file_path) const
+	{
+		uint64_t const path_hash = KPakPathHash(extract_file_path);
+		auto iter = std::lower_bound(kpak_entries_.begin(), kpak_entries_.end(), path_hash,
+			[](KPakEntry const & entry, uint64_t hash)
+			{
+				return entry.path_hash < hash;
+			});
+		for (; (iter != kpak_entries_.end()) && (iter->path_hash == path_hash); ++ iter)
+		{
+			std::string_view const file_path(kpak_names_.data() + iter->name_offset, iter->name_length);
+			if (!StringUtil::CaseInsensitiveLexicographicalCompare(extract_file_path, file_path) &&
+				!StringUtil::CaseInsensitiveLexicographicalCompare(file_path, extract_file_path))
+			{
+				return static_cast<uint32_t>(iter - kpak_entries_.begin());
+			}
+		}
+
+		return 0xFFFFFFFF;
+	}
+
+	ResIdentifierPtr Package::ExtractKPak(KPakEntry const & entry, std::string_view res_name)
+	{
+		uint64_t const timestamp = (entry.timestamp != 0) ? entry.timestamp : archive_is_->Timestamp();
+
+		std::shared_ptr<void const> owner;
+		std::span<uint8_t const> stored;
+		if (kpak_mapped_file_)
+		{
+			owner = kpak_mapped_file_;
+			stored = MakeSpan(kpak_mapped_file_->Data() + entry.offset, static_cast<size_t>(entry.size));
+		}
+		else
+		{
+			auto stored_data = MakeSharedPtr<std::vector<uint8_t>>(static_cast<size_t>(entry.size));
+			archive_is_->clear();
+			archive_is_->seekg(static_cast<int64_t>(entry.offset), std::ios_base::beg);
+			archive_is_->read(stored_data->data(), stored_data->size());
+			if (!*archive_is_ || (static_cast<uint64_t>(archive_is_->gcount()) != entry.size))
+			{
+				TMSG("Corrupted package");
+			}
+			owner = stored_data;
+			stored = MakeSpan(*stored_data);
+		}
+
+		std::span<uint8_t const> decoded;
+		switch (entry.compression)
+		{
+		case KPC_None:
+			decoded = stored;
+			break;
+
+		case KPC_LZMA:
+			{
+				auto decoded_data = MakeSharedPtr<std::vector<uint8_t>>(static_cast<size_t>(entry.original_size));
+				LZMACodec lzma;
+				lzma.Decode(decoded_data->data(), stored, entry.original_size);
+				owner = decoded_data;
+				decoded = MakeSpan(*decoded_data);
+			}
+			break;
+
+		default:
+			TMSG("Unsupported package compression");
+		}
+
+		auto buff = MakeSharedPtr<SharedMemInputStreamBuf>(decoded.data(), static_cast<std::streamsize>(decoded.size()), owner);
+		return MakeSharedPtr<ResIdentifier>(res_name, timestamp, MakeSharedPtr<std::istream>(buff.get()), buff);
+	}
+
+	void SavePackage(std::string_view package_name, std::string_view src_dir, bool compress)
+	{
+		std::filesystem::path const src_path(src_dir.begin(), src_dir.end());
+		std::filesystem::path const package_path(package_name.begin(), package_name.end());
+
+		std::vector<std::filesystem::path> files;
+		std::vector<std::string> names;
+		std::filesystem::recursive_directory_iterator end_itr;
+		for (std::filesystem::recursive_directory_iterator i(src_path); i != end_itr; ++ i)
+		{
+			std::error_code ec;
+			if (std::filesystem::is_regular_file(i->status()) && !std::filesystem::equivalent(i->path(), package_path, ec))
+			{
+				files.push_back(i->path());
+				names.push_back(i->path().lexically_relative(src_path).generic_string());
+			}
+		}
+
+		uint32_t const num_entries = static_cast<uint32_t>(files.size());
+		std::vector<KPakEntry> entries(num_entries);
+		std::vector<std::vector<uint8_t>> compressed_data(num_entries);
+		Context::Instance().TaskScheduler().parallel_for(0, num_entries, 1,
+			[&files, &names, &entries, &compressed_data, compress](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; ++ i)
+				{
+					auto& entry = entries[i];
+					std::memset(&entry, 0, sizeof(entry));
+					entry.path_hash = KPakPathHash(names[i]);
+					entry.original_size = std::filesystem::file_size(files[i]);
+					entry.timestamp = std::filesystem::last_write_time(files[i]).time_since_epoch().count();
+					entry.compression = KPC_None;
+					entry.size = entry.original_size;
+
+					if (compress && (entry.original_size > 0))
+					{
+						std::vector<uint8_t> content(static_cast<size_t>(entry.original_size));
+						std::ifstream ifs(files[i].string().c_str(), std::ios_base::binary);
+						ifs.read(reinterpret_cast<char*>(content.data()), static_cast<std::streamsize>(content.size()));
+						if (static_cast<uint64_t>(ifs.gcount()) != entry.original_size)
+						{
+							TMSG("Could not read " + names[i]);
+						}
+
+						// Compressed only if it saves at least 1/8, a stored file is read in place without decoding
+						LZMACodec lzma;
+						lzma.Encode(compressed_data[i], MakeSpan(content));
+						if (compressed_data[i].size() < entry.original_size - entry.original_size / 8)
+						{
+							entry.compression = KPC_LZMA;
+							entry.size = compressed_data[i].size();
+						}
+						else
+						{
+							std::vector<uint8_t>().swap(compressed_data[i]);
+						}
+					}
+				}
+			});
+
+		std::vector<uint32_t> order(num_entries);
+		std::iota(order.begin(), order.end(), 0U);
+		std::sort(order.begin(), order.end(), [&entries, &names](uint32_t lhs, uint32_t rhs)
+			{
+				if (entries[lhs].path_hash != entries[rhs].path_hash)
+				{
+					return entries[lhs].path_hash < entries[rhs].path_hash;
+				}
+				return names[lhs] < names[rhs];
+			});
+
+		std::string name_table;
+		for (uint32_t i : order)
+		{
+			entries[i].name_offset = static_cast<uint32_t>(name_table.size());
+			entries[i].name_length = static_cast<uint32_t>(names[i].size());
+			name_table += names[i];
+		}
+
+		uint64_t const names_offset = KPAK_HEADER_SIZE + num_entries * sizeof(KPakEntry);
+		uint64_t offset = names_offset + name_table.size();
+		for (uint32_t i : order)
+		{
+			offset = (offset + KPAK_ENTRY_ALIGNMENT - 1) & ~(KPAK_ENTRY_ALIGNMENT - 1);
+			entries[i].offset = offset;
+			offset += entries[i].size;
+		}
+
+		std::ofstream ofs(package_path.string().c_str(), std::ios_base::binary);
+		if (!ofs)
+		{
+			TMSG("Could not create " + package_path.string());
+		}
+		uint32_t header[4];
+		header[0] = Native2LE(MakeFourCC<'K', 'P', 'A', 'K'>::value);
+		header[1] = Native2LE(KPAK_VERSION);
+		header[2] = Native2LE(num_entries);
+		header[3] = 0;
+		ofs.write(reinterpret_cast<char*>(header), sizeof(header));
+
+		uint64_t const le_names_offset = Native2LE(names_offset);
+		ofs.write(reinterpret_cast<char const *>(&le_names_offset), sizeof(le_names_offset));
+		uint64_t const le_names_size = Native2LE(static_cast<uint64_t>(name_table.size()));
+		ofs.write(reinterpret_cast<char const *>(&le_names_size), sizeof(le_names_size));
+
+		for (uint32_t i : order)
+		{
+			auto const & entry = entries[i];
+
+			KPakEntry le_entry;
+			le_entry.path_hash = Native2LE(entry.path_hash);
+			le_entry.offset = Native2LE(entry.offset);
+			le_entry.size = Native2LE(entry.size);
+			le_entry.original_size = Native2LE(entry.original_size);
+			le_entry.timestamp = Native2LE(entry.timestamp);
+			le_entry.name_offset = Native2LE(entry.name_offset);
+			le_entry.name_length = Native2LE(entry.name_length);
+			le_entry.compression = Native2LE(entry.compression);
+			le_entry.reserved = 0;
+			ofs.write(reinterpret_cast<char*>(&le_entry), sizeof(le_entry));
+		}
+
+		ofs.write(name_table.data(), static_cast<std::streamsize>(name_table.size()));
+
+		std::vector<char> buff(KPAK_ENTRY_ALIGNMENT);
+		for (uint32_t i : order)
+		{
+			auto const & entry = entries[i];
+
+			std::fill(buff.begin(), buff.end(), 0);
+			ofs.write(buff.data(), static_cast<std::streamsize>(entry.offset - static_cast<uint64_t>(ofs.tellp())));
+
+			if (entry.compression == KPC_LZMA)
+			{
+				ofs.write(reinterpret_cast<char const *>(compressed_data[i].data()), static_cast<std::streamsize>(entry.size));
+			}
+			else
+			{
+				std::ifstream ifs(files[i].string().c_str(), std::ios_base::binary);
+				for (uint64_t copied = 0; copied < entry.size;)
+				{
+					auto const n = static_cast<std::streamsize>(std::min<uint64_t>(entry.size - copied, buff.size()));
+					ifs.read(buff.data(), n);
+					if (ifs.gcount() != n)
+					{
+						// The file shrank after its size was taken
+						TMSG("Could not read " + names[i]);
+					}
+					ofs.write(buff.data(), n);
+					copied += n;
+				}
+			}
+		}
+
+		ofs.flush();
+		if (!ofs)
+		{
+			TMSG("Could not write " + package_path.string());
+		}
+	}
 }
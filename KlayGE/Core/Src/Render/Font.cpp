@@ -48,6 +48,7 @@
 #include <KlayGE/LZMACodec.hpp>
 #include <KlayGE/TransientBuffer.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/TaskScheduler.hpp>
 #include <KlayGE/App3D.hpp>
 #include <KlayGE/Window.hpp>
 
@@ -72,9 +73,10 @@ namespace KlayGE
 	public:
 		explicit FontRenderable(std::shared_ptr<KFont> const & kfl)
 				: Renderable(L"Font"),
+					lru_head_(INVALID_CHAR_INDEX), lru_tail_(INVALID_CHAR_INDEX),
+					last_layout_trim_frame_(0),
 					three_dim_(false),
-					kfont_loader_(kfl),
-					tick_(0)
+					kfont_loader_(kfl)
 		{
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 
@@ -96,9 +98,8 @@ namespace KlayGE
 			RenderDeviceCaps const & caps = renderEngine.DeviceCaps();
 			uint32_t size = std::min<uint32_t>(2048U, std::min<uint32_t>(caps.max_texture_width, caps.max_texture_height)) / kfont_char_size * kfont_char_size;
 			dist_texture_ = rf.MakeTexture2D(size, size, 1, 1, EF_R8, 1, 0, EAH_GPU_Read);
-			a_char_data_.resize(kfont_char_size * kfont_char_size);
-
-			char_free_list_.emplace_back(0, size * size / kfont_char_size / kfont_char_size);
+			dist_data_.resize(size * size);
+			char_infos_.reserve((size / kfont_char_size) * (size / kfont_char_size));
 
 			effect_ = SyncLoadRenderEffect("Font.fxml");
 			*(effect_->ParameterByName("distance_tex")) = dist_texture_;
@@ -135,6 +136,8 @@ namespace KlayGE
 
 		void OnRenderBegin() override
 		{
+			this->FlushPendingChars();
+
 			if (!three_dim_)
 			{
 				RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
@@ -156,6 +159,24 @@ namespace KlayGE
 		{
 			pos_aabb_ = AABBox(float3(0, 0, 0), float3(0, 0, 0));
 
+			// Layouts not drawn for a while are dropped
+			uint32_t const frame = Context::Instance().AppInstance().TotalNumFrames();
+			if (frame - last_layout_trim_frame_ >= LAYOUT_KEEP_FRAMES)
+			{
+				for (auto iter = text_layouts_.begin(); iter != text_layouts_.end();)
+				{
+					if (frame - iter->second.last_used_frame >= LAYOUT_KEEP_FRAMES)
+					{
+						iter = text_layouts_.erase(iter);
+					}
+					else
+					{
+						++ iter;
+					}
+				}
+				last_layout_trim_frame_ = frame;
+			}
+
 			tb_vb_sub_allocs_.clear();
 			tb_ib_sub_allocs_.clear();
 
@@ -202,6 +223,12 @@ namespace KlayGE
 			this->OnRenderEnd();
 		}
 
+		void PrepareChars(std::wstring_view chars)
+		{
+			this->UpdateTexture(chars);
+			this->FlushPendingChars();
+		}
+
 		Size_T<float> CalcSize(std::wstring_view text, float font_size)
 		{
 			this->UpdateTexture(text);
@@ -254,16 +281,100 @@ namespace KlayGE
 		}
 
 	private:
+		struct TextLayoutParams;
+		struct TextLayout;
+
 		void AddText(Rect const & rc, float sz,
 			float xScale, float yScale, Color const & clr, std::wstring_view text, float font_size, uint32_t align)
 		{
-			this->UpdateTexture(text);
+			BOOST_ASSERT(align != 0);
+
+			TextLayoutParams params{};
+			params.rc_width = rc.Width();
+			params.rc_height = rc.Height();
+			params.x_scale = xScale;
+			params.y_scale = yScale;
+			params.font_size = font_size;
+			params.clr = clr.ABGR();
+			params.align = align;
+
+			this->AddLayout(this->FindLayout(text, params), float3(rc.left(), rc.top(), sz));
+		}
+
+		void AddText(float sx, float sy, float sz,
+			float xScale, float yScale, Color const & clr, std::wstring_view text, float font_size)
+		{
+			TextLayoutParams params{};
+			params.x_scale = xScale;
+			params.y_scale = yScale;
+			params.font_size = font_size;
+			params.clr = clr.ABGR();
+			params.align = 0;
+
+			this->AddLayout(this->FindLayout(text, params), float3(sx, sy, sz));
+		}
 
+		// Returns the cached layout of the text, rebuilds it if the text or parameters changed, or any of its chars in the
+		//  distance texture was replaced since it was built. Layouts are built at the origin, so the same text drawn at
+		//  another position is a hit.
+		TextLayout const & FindLayout(std::wstring_view text, TextLayoutParams const & params)
+		{
+			uint32_t param_words[sizeof(params) / sizeof(uint32_t)];
+			std::memcpy(param_words, &params, sizeof(params));
+			size_t seed = HashRange(text.begin(), text.end());
+			HashRange(seed, std::begin(param_words), std::end(param_words));
+
+			TextLayout& layout = text_layouts_[seed];
+			bool valid = layout.built && (layout.text == text) && (0 == std::memcmp(&layout.params, &params, sizeof(params)));
+			for (size_t i = 0; valid && (i < layout.char_indices.size()); ++ i)
+			{
+				valid = (char_infos_[layout.char_indices[i]].generation == layout.char_generations[i]);
+			}
+			if (valid)
+			{
+				for (uint32_t const index : layout.char_indices)
+				{
+					this->TouchChar(index);
+				}
+			}
+			else
+			{
+				this->UpdateTexture(text);
+
+				layout.text = std::wstring(text);
+				layout.params = params;
+				if (params.align != 0)
+				{
+					this->BuildRectLayout(layout);
+				}
+				else
+				{
+					this->BuildLayout(layout);
+				}
+				layout.built = true;
+			}
+
+			layout.last_used_frame = Context::Instance().AppInstance().TotalNumFrames();
+			return layout;
+		}
+
+		void BuildRectLayout(TextLayout& layout)
+		{
 			KFont const & kl = *kfont_loader_;
 			auto const & cim = char_info_map_;
+			TextLayoutParams const & params = layout.params;
 
-			std::vector<FontVert> vertices;
-			std::vector<uint16_t> indices;
+			Rect const rc(0, 0, params.rc_width, params.rc_height);
+			float const sz = 0;
+			float const xScale = params.x_scale;
+			float const yScale = params.y_scale;
+			float const font_size = params.font_size;
+			uint32_t const align = params.align;
+
+			layout.vertices.clear();
+			layout.indices.clear();
+			layout.char_indices.clear();
+			layout.char_generations.clear();
 
 			float const h = font_size * yScale;
 			float const rel_size = font_size / kl.CharSize();
@@ -272,7 +383,7 @@ namespace KlayGE
 
 			std::vector<std::pair<float, std::wstring>> lines(1, std::make_pair(0.0f, L""));
 
-			for (auto const & ch : text)
+			for (auto const & ch : layout.text)
 			{
 				if (ch != L'\n')
 				{
@@ -330,16 +441,12 @@ namespace KlayGE
 				}
 			}
 
-			uint32_t const index_per_char = restart_ ? 5 : 6;
-
-			uint32_t const clr32 = clr.ABGR();
+			uint32_t const clr32 = params.clr;
+			layout.vertices.reserve((layout.text.size() - (lines.size() - 1)) * 4);
 			for (size_t i = 0; i < sx.size(); ++ i)
 			{
-				size_t const maxSize = lines[i].second.length();
 				float x = sx[i], y = sy[i];
 
-				vertices.reserve(maxSize * 4);
-
 				for (auto const & ch : lines[i].second)
 				{
 					std::pair<int32_t, uint32_t> const & offset_adv = kl.CharIndexAdvance(ch);
@@ -353,24 +460,26 @@ namespace KlayGE
 						float height = ci.height * rel_size_y;
 
 						auto cmiter = cim.find(ch);
-						Rect const & texRect(cmiter->second.rc);
+						Rect const & texRect(char_infos_[cmiter->second].rc);
 
 						Rect pos_rc(x + left, y + top, x + left + width, y + top + height);
 						Rect intersect_rc = pos_rc & rc;
 						if ((intersect_rc.Width() > 0) && (intersect_rc.Height() > 0))
 						{
-							vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.top(), sz),
+							layout.vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.top(), sz),
 													clr32,
 													float2(texRect.left(), texRect.top())));
-							vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.top(), sz),
+							layout.vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.top(), sz),
 													clr32,
 													float2(texRect.right(), texRect.top())));
-							vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.bottom(), sz),
+							layout.vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.bottom(), sz),
 													clr32,
 													float2(texRect.right(), texRect.bottom())));
-							vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.bottom(), sz),
+							layout.vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.bottom(), sz),
 													clr32,
 													float2(texRect.left(), texRect.bottom())));
+							layout.char_indices.push_back(cmiter->second);
+							layout.char_generations.push_back(char_infos_[cmiter->second].generation);
 						}
 					}
 
@@ -378,62 +487,47 @@ namespace KlayGE
 					y += (offset_adv.second >> 16) * rel_size_y;
 				}
 
-				tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
-
-				uint16_t last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(FontVert));
-				uint32_t const num_chars = static_cast<uint32_t>(vertices.size() / 4);
-				indices.reserve(num_chars * index_per_char);
-				for (uint32_t c = 0; c < num_chars; ++ c)
+				AABBox const line_aabb(float3(sx[i], sy[i], sz), float3(sx[i] + lines[i].first, sy[i] + h, sz + 0.1f));
+				if (0 == i)
 				{
-					indices.push_back(last_index + 0);
-					indices.push_back(last_index + 1);
-					if (restart_)
-					{
-						indices.push_back(last_index + 3);
-						indices.push_back(last_index + 2);
-						indices.push_back(0xFFFF);
-					}
-					else
-					{
-						indices.push_back(last_index + 2);
-						indices.push_back(last_index + 2);
-						indices.push_back(last_index + 3);
-						indices.push_back(last_index + 0);
-					}
-					last_index += 4;
+					layout.aabb = line_aabb;
+				}
+				else
+				{
+					layout.aabb |= line_aabb;
 				}
-				BOOST_ASSERT(last_index + 3 <= 0xFFFF);
-				tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
-
-				pos_aabb_ |= AABBox(float3(sx[i], sy[i], sz), float3(sx[i] + lines[i].first, sy[i] + h, sz + 0.1f));
 			}
+
+			this->BuildLayoutIndices(layout);
 		}
 
-		void AddText(float sx, float sy, float sz,
-			float xScale, float yScale, Color const & clr, std::wstring_view text, float font_size)
+		void BuildLayout(TextLayout& layout)
 		{
-			this->UpdateTexture(text);
-
 			KFont const & kl = *kfont_loader_;
 			auto const & cim = char_info_map_;
-
-			std::vector<FontVert> vertices;
-			std::vector<uint16_t> indices;
-
-			uint32_t const clr32 = clr.ABGR();
-			float const h = font_size * yScale;
-			float const rel_size = font_size / kl.CharSize();
-			float const rel_size_x = rel_size * xScale;
-			float const rel_size_y = rel_size * yScale;
-			size_t const maxSize = text.length() - std::count(text.begin(), text.end(), L'\n');
+			TextLayoutParams const & params = layout.params;
+
+			float const sx = 0;
+			float const sy = 0;
+			float const sz = 0;
+
+			layout.vertices.clear();
+			layout.indices.clear();
+			layout.char_indices.clear();
+			layout.char_generations.clear();
+
+			uint32_t const clr32 = params.clr;
+			float const h = params.font_size * params.y_scale;
+			float const rel_size = params.font_size / kl.CharSize();
+			float const rel_size_x = rel_size * params.x_scale;
+			float const rel_size_y = rel_size * params.y_scale;
+			size_t const maxSize = layout.text.length() - std::count(layout.text.begin(), layout.text.end(), L'\n');
 			float x = sx, y = sy;
 			float maxx = sx, maxy = sy;
 
-			uint32_t const index_per_char = restart_ ? 5 : 6;
-
-			vertices.reserve(maxSize * 4);
+			layout.vertices.reserve(maxSize * 4);
 
-			for (auto const & ch : text)
+			for (auto const & ch : layout.text)
 			{
 				if (ch != L'\n')
 				{
@@ -450,21 +544,23 @@ namespace KlayGE
 						auto cmiter = cim.find(ch);
 						if (cmiter != cim.end())
 						{
-							Rect const & texRect(cmiter->second.rc);
+							Rect const & texRect(char_infos_[cmiter->second].rc);
 							Rect pos_rc(x + left, y + top, x + left + width, y + top + height);
 
-							vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.top(), sz),
+							layout.vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.top(), sz),
 												clr32,
 												float2(texRect.left(), texRect.top())));
-							vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.top(), sz),
+							layout.vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.top(), sz),
 												clr32,
 												float2(texRect.right(), texRect.top())));
-							vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.bottom(), sz),
+							layout.vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.bottom(), sz),
 												clr32,
 												float2(texRect.right(), texRect.bottom())));
-							vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.bottom(), sz),
+							layout.vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.bottom(), sz),
 												clr32,
 												float2(texRect.left(), texRect.bottom())));
+							layout.char_indices.push_back(cmiter->second);
+							layout.char_generations.push_back(char_infos_[cmiter->second].generation);
 						}
 					}
 
@@ -488,44 +584,76 @@ namespace KlayGE
 				}
 			}
 
-			tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
+			layout.aabb = AABBox(float3(sx, sy, sz), float3(maxx, maxy, sz + 0.1f));
+
+			this->BuildLayoutIndices(layout);
+		}
+
+		// Indices are relative to the first vertex of the layout, AddLayout offsets them
+		void BuildLayoutIndices(TextLayout& layout)
+		{
+			uint32_t const index_per_char = restart_ ? 5 : 6;
+			uint32_t const num_chars = static_cast<uint32_t>(layout.vertices.size() / 4);
+			BOOST_ASSERT(num_chars * 4 <= 0xFFFF);
 
-			uint16_t last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(FontVert));
-			uint32_t const num_chars = static_cast<uint32_t>(vertices.size() / 4);
-			indices.reserve(num_chars * index_per_char);
+			layout.indices.reserve(num_chars * index_per_char);
+			uint16_t last_index = 0;
 			for (uint32_t c = 0; c < num_chars; ++ c)
 			{
-				indices.push_back(last_index + 0);
-				indices.push_back(last_index + 1);
+				layout.indices.push_back(last_index + 0);
+				layout.indices.push_back(last_index + 1);
 				if (restart_)
 				{
-					indices.push_back(last_index + 3);
-					indices.push_back(last_index + 2);
-					indices.push_back(0xFFFF);
+					layout.indices.push_back(last_index + 3);
+					layout.indices.push_back(last_index + 2);
+					layout.indices.push_back(0xFFFF);
 				}
 				else
 				{
-					indices.push_back(last_index + 2);
-					indices.push_back(last_index + 2);
-					indices.push_back(last_index + 3);
-					indices.push_back(last_index + 0);
+					layout.indices.push_back(last_index + 2);
+					layout.indices.push_back(last_index + 2);
+					layout.indices.push_back(last_index + 3);
+					layout.indices.push_back(last_index + 0);
 				}
 				last_index += 4;
 			}
-			tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
+		}
+
+		void AddLayout(TextLayout const & layout, float3 const & offset)
+		{
+			if (!layout.vertices.empty())
+			{
+				layout_vertices_.resize(layout.vertices.size());
+				for (size_t i = 0; i < layout.vertices.size(); ++ i)
+				{
+					layout_vertices_[i] = layout.vertices[i];
+					layout_vertices_[i].pos += offset;
+				}
+				tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(layout_vertices_.size() * sizeof(layout_vertices_[0])),
+					layout_vertices_.data()));
 
-			pos_aabb_ |= AABBox(float3(sx, sy, sz), float3(maxx, maxy, sz + 0.1f));
+				uint16_t const base_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(FontVert));
+				BOOST_ASSERT(base_index + layout.vertices.size() - 1 <= 0xFFFF);
+				layout_indices_.resize(layout.indices.size());
+				for (size_t i = 0; i < layout.indices.size(); ++ i)
+				{
+					uint16_t const index = layout.indices[i];
+					layout_indices_[i] = (0xFFFF == index) ? index : static_cast<uint16_t>(base_index + index);
+				}
+				tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(layout_indices_.size() * sizeof(layout_indices_[0])),
+					layout_indices_.data()));
+			}
+
+			pos_aabb_ |= AABBox(layout.aabb.Min() + offset, layout.aabb.Max() + offset);
 		}
 
 		// ʹLRU㷨
 		/////////////////////////////////////////////////////////////////////////////////
 		void UpdateTexture(std::wstring_view text)
 		{
-			++ tick_;
-
 			uint32_t const tex_size = dist_texture_->Width(0);
 
-			KFont& kl = *kfont_loader_;
+			KFont const & kl = *kfont_loader_;
 			auto& cim = char_info_map_;
 
 			uint32_t const kfont_char_size = kl.CharSize();
@@ -541,123 +669,217 @@ namespace KlayGE
 					auto cmiter = cim.find(ch);
 					if (cmiter != cim.end())
 					{
-						// ҵ
-
-						cmiter->second.tick = tick_;
+						this->TouchChar(cmiter->second);
 					}
 					else
 					{
-						// ҲԵ
+						uint32_t index;
+						if (char_infos_.size() < num_total_chars)
+						{
+							index = static_cast<uint32_t>(char_infos_.size());
+							char_infos_.emplace_back();
+						}
+						else
+						{
+							index = lru_tail_;
+							cim.erase(char_infos_[index].ch);
+							this->UnlinkChar(index);
+
+							// Cached layouts using the replaced char are rebuilt
+							++ char_infos_[index].generation;
+						}
+						this->LinkChar(index);
+						cim.emplace(ch, index);
 
 						KFont::font_info const & ci = kl.CharInfo(offset);
 
-						uint32_t width = ci.width;
-						uint32_t height = ci.height;
+						uint32_t const x = index % num_chars_a_row * kfont_char_size;
+						uint32_t const y = index / num_chars_a_row * kfont_char_size;
 
-						int2 char_pos;
-						CharInfo charInfo;
-						if (cim.size() < num_total_chars)
-						{
-							// пռ
+						CharInfo& char_info = char_infos_[index];
+						char_info.ch = ch;
+						char_info.rc.left() = static_cast<float>(x) / tex_size;
+						char_info.rc.top() = static_cast<float>(y) / tex_size;
+						char_info.rc.right() = char_info.rc.left() + static_cast<float>(ci.width) / tex_size;
+						char_info.rc.bottom() = char_info.rc.top() + static_cast<float>(ci.height) / tex_size;
 
-							uint32_t const s = char_free_list_.front().first;
-						
-							char_pos.y() = s / num_chars_a_row;
-							char_pos.x() = s - char_pos.y() * num_chars_a_row;
+						// The distance data is decoded and uploaded with the other new chars before rendering
+						pending_chars_.emplace_back(index, ch);
+					}
+				}
+			}
+		}
 
-							char_pos.x() *= kfont_char_size;
-							char_pos.y() *= kfont_char_size;
+		// Decodes the distance data of all new chars in parallel into dist_data_, and uploads the region covering them
+		//  in one texture update. If the slots are scattered, only runs of adjacent slots are uploaded.
+		void FlushPendingChars()
+		{
+			if (pending_chars_.empty())
+			{
+				return;
+			}
 
-							charInfo.rc.left() = static_cast<float>(char_pos.x()) / tex_size;
-							charInfo.rc.top() = static_cast<float>(char_pos.y()) / tex_size;
+			uint32_t const tex_size = dist_texture_->Width(0);
 
-							++ char_free_list_.front().first;
-							if (char_free_list_.front().first == char_free_list_.front().second)
-							{
-								char_free_list_.pop_front();
-							}
-						}
-						else
+			KFont const & kl = *kfont_loader_;
+
+			uint32_t const kfont_char_size = kl.CharSize();
+			uint32_t const num_chars_a_row = tex_size / kfont_char_size;
+
+			// A slot can be reused within a frame. Only the last char put in it is still valid.
+			std::stable_sort(pending_chars_.begin(), pending_chars_.end(),
+				[](std::pair<uint32_t, wchar_t> const & lhs, std::pair<uint32_t, wchar_t> const & rhs)
+				{
+					return lhs.first < rhs.first;
+				});
+
+			std::vector<std::pair<uint32_t, std::vector<uint8_t>>> lzma_data;
+			uint32_t min_x = num_chars_a_row;
+			uint32_t min_y = num_chars_a_row;
+			uint32_t max_x = 0;
+			uint32_t max_y = 0;
+			for (size_t i = 0; i < pending_chars_.size(); ++ i)
+			{
+				uint32_t const index = pending_chars_[i].first;
+				if (((i + 1 < pending_chars_.size()) && (pending_chars_[i + 1].first == index))
+					|| (char_infos_[index].ch != pending_chars_[i].second))
+				{
+					continue;
+				}
+
+				// The font file is shared, so the compressed data is read on this thread
+				int32_t const offset = kl.CharIndex(pending_chars_[i].second);
+				uint32_t size;
+				kl.GetLZMADistanceData(nullptr, size, offset);
+				std::vector<uint8_t> data(size);
+				kl.GetLZMADistanceData(data.data(), size, offset);
+				lzma_data.emplace_back(index, std::move(data));
+
+				uint32_t const x = index % num_chars_a_row;
+				uint32_t const y = index / num_chars_a_row;
+				min_x = std::min(min_x, x);
+				min_y = std::min(min_y, y);
+				max_x = std::max(max_x, x);
+				max_y = std::max(max_y, y);
+			}
+			pending_chars_.clear();
+
+			Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(lzma_data.size()), 8,
+				[this, &lzma_data, tex_size, kfont_char_size, num_chars_a_row](uint32_t first, uint32_t last)
+				{
+					LZMACodec lzma_dec;
+					std::vector<uint8_t> decoded(kfont_char_size * kfont_char_size);
+					for (uint32_t i = first; i < last; ++ i)
+					{
+						lzma_dec.Decode(decoded.data(), MakeSpan(lzma_data[i].second), decoded.size());
+
+						uint32_t const index = lzma_data[i].first;
+						uint32_t const x = index % num_chars_a_row * kfont_char_size;
+						uint32_t const y = index / num_chars_a_row * kfont_char_size;
+						for (uint32_t row = 0; row < kfont_char_size; ++ row)
 						{
-							// ҵʹʱûʹõ
-
-							uint64_t min_tick = cim.begin()->second.tick;
-							auto min_chiter = cim.begin();
-							for (auto chiter = cim.begin(); chiter != cim.end(); ++ chiter)
-							{
-								if (chiter->second.tick < min_tick)
-								{
-									min_tick = chiter->second.tick;
-									min_chiter = chiter;
-								}
-							}
-
-							char_pos.x() = static_cast<int32_t>(min_chiter->second.rc.left() * tex_size);
-							char_pos.y() = static_cast<int32_t>(min_chiter->second.rc.top() * tex_size);
-							charInfo.rc.left() = min_chiter->second.rc.left();
-							charInfo.rc.top() = min_chiter->second.rc.top();
-
-							for (auto chiter = cim.begin(); chiter != cim.end(); ++ chiter)
-							{
-								if (chiter->second.tick == min_tick)
-								{
-									uint32_t const x = static_cast<int32_t>(chiter->second.rc.left() * tex_size);
-									uint32_t const y = static_cast<int32_t>(chiter->second.rc.top() * tex_size);
-									uint32_t const id = y * num_chars_a_row + x;
-									auto freeiter = char_free_list_.begin();
-									while ((freeiter != char_free_list_.end()) && (freeiter->second <= id))
-									{
-										++ freeiter;
-									}
-									char_free_list_.emplace(freeiter, id, id + 1);
-
-									cim.erase(chiter);
-									break;
-								}
-							}
-							for (auto freeiter = char_free_list_.begin(); freeiter != char_free_list_.end();)
-							{
-								auto nextiter = freeiter;
-								++ nextiter;
-
-								if (nextiter != char_free_list_.end())
-								{
-									if (freeiter->second == nextiter->first)
-									{
-										freeiter->second = nextiter->second;
-										char_free_list_.erase(nextiter);
-									}
-									else
-									{
-										++ freeiter;
-									}
-								}
-								else
-								{
-									break;
-								}
-							}
+							std::memcpy(&dist_data_[(y + row) * tex_size + x], &decoded[row * kfont_char_size], kfont_char_size);
 						}
+					}
+				});
 
-						charInfo.rc.right()		= charInfo.rc.left() + static_cast<float>(width) / tex_size;
-						charInfo.rc.bottom()	= charInfo.rc.top() + static_cast<float>(height) / tex_size;
-						charInfo.tick			= tick_;
+			if (!lzma_data.empty())
+			{
+				uint32_t const num_rect_slots = (max_x - min_x + 1) * (max_y - min_y + 1);
+				if (num_rect_slots <= lzma_data.size() * 2)
+				{
+					uint32_t const x = min_x * kfont_char_size;
+					uint32_t const y = min_y * kfont_char_size;
+					dist_texture_->UpdateSubresource2D(0, 0, x, y,
+						(max_x - min_x + 1) * kfont_char_size, (max_y - min_y + 1) * kfont_char_size,
+						&dist_data_[y * tex_size + x], tex_size);
+				}
+				else
+				{
+					// LRU evictions scatter the slots, the rect would be mostly chars that didn't change.
+					//  lzma_data is sorted by slot, so a run is consecutive entries in the same row.
+					for (size_t i = 0; i < lzma_data.size();)
+					{
+						uint32_t const first_index = lzma_data[i].first;
+						size_t end = i + 1;
+						while ((end < lzma_data.size()) && (lzma_data[end].first == first_index + (end - i))
+							&& (lzma_data[end].first % num_chars_a_row != 0))
+						{
+							++ end;
+						}
 
-						kl.GetDistanceData(&a_char_data_[0], kfont_char_size, offset);
-						dist_texture_->UpdateSubresource2D(0, 0, char_pos.x(), char_pos.y(), kfont_char_size, kfont_char_size,
-							&a_char_data_[0], kfont_char_size);
+						uint32_t const x = first_index % num_chars_a_row * kfont_char_size;
+						uint32_t const y = first_index / num_chars_a_row * kfont_char_size;
+						dist_texture_->UpdateSubresource2D(0, 0, x, y,
+							static_cast<uint32_t>(end - i) * kfont_char_size, kfont_char_size,
+							&dist_data_[y * tex_size + x], tex_size);
 
-						cim.emplace(ch, charInfo);
+						i = end;
 					}
 				}
 			}
 		}
 
+		void TouchChar(uint32_t index)
+		{
+			if (index != lru_head_)
+			{
+				this->UnlinkChar(index);
+				this->LinkChar(index);
+			}
+		}
+
+		void LinkChar(uint32_t index)
+		{
+			CharInfo& char_info = char_infos_[index];
+			char_info.prev = INVALID_CHAR_INDEX;
+			char_info.next = lru_head_;
+			if (lru_head_ != INVALID_CHAR_INDEX)
+			{
+				char_infos_[lru_head_].prev = index;
+			}
+			else
+			{
+				lru_tail_ = index;
+			}
+			lru_head_ = index;
+		}
+
+		void UnlinkChar(uint32_t index)
+		{
+			CharInfo& char_info = char_infos_[index];
+			if (char_info.prev != INVALID_CHAR_INDEX)
+			{
+				char_infos_[char_info.prev].next = char_info.next;
+			}
+			else
+			{
+				lru_head_ = char_info.next;
+			}
+			if (char_info.next != INVALID_CHAR_INDEX)
+			{
+				char_infos_[char_info.next].prev = char_info.prev;
+			}
+			else
+			{
+				lru_tail_ = char_info.prev;
+			}
+			char_info.prev = INVALID_CHAR_INDEX;
+			char_info.next = INVALID_CHAR_INDEX;
+		}
+
 	private:
+		static uint32_t constexpr INVALID_CHAR_INDEX = ~0U;
+		static uint32_t constexpr LAYOUT_KEEP_FRAMES = 60;
+
+		// One per slot in the distance texture, linked in a LRU list
 		struct CharInfo
 		{
 			Rect rc;
-			uint64_t tick;
+			wchar_t ch;
+			uint32_t prev;
+			uint32_t next;
+			uint32_t generation;	// Increased when the slot gets another char
 		};
 
 #ifdef KLAYGE_HAS_STRUCT_PACK
@@ -682,10 +904,43 @@ namespace KlayGE
 	#pragma pack(pop)
 #endif
 
+		// All members are 32-bit, so they are compared and hashed as raw words. The position isn't part of them.
+		struct TextLayoutParams
+		{
+			float rc_width, rc_height;
+			float x_scale, y_scale;
+			float font_size;
+			uint32_t clr;
+			uint32_t align;	// 0 if the text starts at the origin, otherwise it's aligned in the rect
+		};
+
+		// Vertices of a text relative to its position, kept across frames while the same text is drawn with the same
+		//  parameters
+		struct TextLayout
+		{
+			std::wstring text;
+			TextLayoutParams params;
+			std::vector<FontVert> vertices;
+			std::vector<uint16_t> indices;
+			std::vector<uint32_t> char_indices;	// In char_infos_, kept in use while the layout is drawn
+			std::vector<uint32_t> char_generations;	// Of the slots in char_indices when the layout was built
+			AABBox aabb;
+			bool built{false};
+			uint32_t last_used_frame;
+		};
+
 		bool restart_;
 
-		std::unordered_map<wchar_t, CharInfo> char_info_map_;
-		std::list<std::pair<uint32_t, uint32_t>> char_free_list_;
+		std::vector<CharInfo> char_infos_;
+		uint32_t lru_head_;	// Most recently used
+		uint32_t lru_tail_;	// Least recently used, reused first
+		std::unordered_map<wchar_t, uint32_t> char_info_map_;	// Char to index in char_infos_
+		std::vector<std::pair<uint32_t, wchar_t>> pending_chars_;
+
+		std::unordered_map<size_t, TextLayout> text_layouts_;
+		uint32_t last_layout_trim_frame_;
+		std::vector<FontVert> layout_vertices_;
+		std::vector<uint16_t> layout_indices_;
 
 		bool three_dim_;
 
@@ -695,15 +950,13 @@ namespace KlayGE
 		std::vector<SubAlloc> tb_ib_sub_allocs_;
 
 		TexturePtr		dist_texture_;
-		std::vector<uint8_t> a_char_data_;
+		std::vector<uint8_t> dist_data_;	// CPU copy of dist_texture_
 
 		RenderEffectParameter* half_width_height_ep_;
 		RenderEffectParameter* dpi_scale_ep_;
 		RenderEffectParameter* mvp_ep_;
 
 		std::shared_ptr<KFont> kfont_loader_;
-
-		uint64_t tick_;
 	};
 }
 
@@ -774,6 +1027,15 @@ namespace
 			return true;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashRange(seed, font_desc_.res_name.begin(), font_desc_.res_name.end());
+			HashCombine(seed, font_desc_.flag);
+			return seed;
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -856,6 +1118,14 @@ namespace KlayGE
 		}
 	}
 
+	void Font::PrepareChars(std::wstring_view chars)
+	{
+		if (!chars.empty())
+		{
+			font_renderable_->PrepareChars(chars);
+		}
+	}
+
 	// ָλû
 	/////////////////////////////////////////////////////////////////////////////////
 	void Font::RenderText(float sx, float sy, Color const & clr,
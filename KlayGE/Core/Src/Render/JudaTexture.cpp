@@ -14,6 +14,7 @@
 
 #include <KFL/CXX2a/format.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KFL/TaskScheduler.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderEngine.hpp>
@@ -120,7 +121,8 @@ namespace KlayGE
 		: root_(MakeSharedPtr<QuadTreeNode>()),
 			num_tiles_(num_tiles), tile_size_(tile_size), format_(format),
 			texel_size_(NumFormatBytes(format)),
-			decode_tick_(0), tile_tick_(0)
+			num_cache_tiles_a_row_(0), num_cache_tiles_a_layer_(0), num_cache_total_tiles_(0),
+			lru_head_(EMPTY_CACHE_INDEX), lru_tail_(EMPTY_CACHE_INDEX)
 	{
 		BOOST_ASSERT(num_tiles_ <= MAX_NUM_TILES);
 		BOOST_ASSERT(tile_size_ <= MAX_TILE_SIZE);
@@ -181,6 +183,15 @@ namespace KlayGE
 		}
 	}
 
+	JudaTexture::~JudaTexture()
+	{
+		// Decoding tasks still in flight refer to this
+		if (decode_counter_ != 0)
+		{
+			Context::Instance().TaskScheduler().wait(decode_counter_);
+		}
+	}
+
 	uint32_t JudaTexture::EncodeTileID(uint32_t level, uint32_t tile_x, uint32_t tile_y) const
 	{
 		BOOST_ASSERT(level <= MAX_TREE_LEVEL);
@@ -418,46 +429,52 @@ namespace KlayGE
 
 		uint32_t const full_tile_bytes = cache_tile_size_ * cache_tile_size_ * texel_size_;
 
-		for (size_t i = 0; i < shuffs.size(); ++ i)
-		{
-			uint32_t shuff = shuffs[i].first;
-			uint32_t const index = shuffs[i].second;
-
-			uint32_t scale = tile_size_ / cache_tile_size_;
-			if (scale != 1)
+		// Tiles are independent. Sorted by shuff, neighboring sub-ranges share most of the ancestor blocks.
+		Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(shuffs.size()), 1,
+			[this, &data, &shuffs, full_tile_bytes, mipmaps](uint32_t first, uint32_t last)
 			{
-				uint32_t level = this->ShuffLevel(shuff);
-				while (scale > 1)
+				for (uint32_t i = first; i < last; ++ i)
 				{
-					scale /= 2;
-					-- level;
-				}
+					uint32_t shuff = shuffs[i].first;
+					uint32_t const index = shuffs[i].second;
 
-				shuff = this->ShuffLevel(shuff, level);
-			}
+					uint32_t scale = tile_size_ / cache_tile_size_;
+					if (scale != 1)
+					{
+						uint32_t level = this->ShuffLevel(shuff);
+						while (scale > 1)
+						{
+							scale /= 2;
+							-- level;
+						}
 
-			uint32_t s = full_tile_bytes;
-			for (size_t j = 0; j < mipmaps; ++ j)
-			{
-				data[index * mipmaps + j].resize(s);
-				s /= 4;
-			}
+						shuff = this->ShuffLevel(shuff, level);
+					}
 
-			this->DecodeATile(&data[index * mipmaps], shuff, mipmaps);
-		}
+					uint32_t s = full_tile_bytes;
+					for (size_t j = 0; j < mipmaps; ++ j)
+					{
+						data[index * mipmaps + j].resize(s);
+						s /= 4;
+					}
+
+					this->DecodeATile(&data[index * mipmaps], shuff, mipmaps);
+				}
+			});
 	}
 
 	void JudaTexture::DecodeATile(std::vector<uint8_t>* data, uint32_t shuff, uint32_t mipmaps)
 	{
-		++ decode_tick_;
-
 		uint32_t const full_tile_bytes = cache_tile_size_ * cache_tile_size_ * texel_size_;
 		uint32_t target_level = this->ShuffLevel(shuff);
 
+		// Blocks are shared with other decoding threads, holding them keeps them alive
+		auto const root_block = this->RetriveATile(root_->data_index);
+
 		QuadTreeNode* node = root_.get();
 		if (0 == target_level)
 		{
-			std::memcpy(&data[0][0], this->RetriveATile(root_->data_index), full_tile_bytes);
+			std::memcpy(&data[0][0], root_block->data(), full_tile_bytes);
 		}
 		else
 		{
@@ -510,7 +527,7 @@ namespace KlayGE
 						uint8_t const * src;
 						if (1 == ll_b)
 						{
-							src = this->RetriveATile(root_->data_index);
+							src = root_block->data();
 						}
 						else
 						{
@@ -532,9 +549,10 @@ namespace KlayGE
 				
 						if (node && (node->data_index != EMPTY_DATA_INDEX))
 						{
+							auto const node_block = this->RetriveATile(node->data_index);
 							uint32_t start_x = (start_sub_tile_x >> shift) * used_w * 2;
 							uint32_t start_y = (start_sub_tile_y >> shift) * used_h * 2;
-							uint8_t const * start_src = this->RetriveATile(node->data_index) + (start_y * tile_size_ + start_x) * texel_size_;
+							uint8_t const * start_src = node_block->data() + (start_y * tile_size_ + start_x) * texel_size_;
 							uint8_t* dst = &temp[0];
 							for (size_t y = 0; y < used_h * 2; ++ y)
 							{
@@ -611,71 +629,63 @@ namespace KlayGE
 		return ret_attr;
 	}
 
-	uint8_t* JudaTexture::RetriveATile(uint32_t data_index)
+	std::shared_ptr<std::vector<uint8_t> const> JudaTexture::RetriveATile(uint32_t data_index)
 	{
 		if (data_blocks_.empty())
 		{
-			auto iter = decoded_block_cache_.find(data_index);
-			if (iter != decoded_block_cache_.end())
-			{
-				iter->second.tick = decode_tick_;
-			}
-			else
+			std::vector<uint8_t> comed_data;
 			{
-				if (decoded_block_cache_.size() >= 64)
-				{
-					auto min_iter = decoded_block_cache_.begin();
-					uint64_t min_tick = min_iter->second.tick;
-					for (auto dbiter = decoded_block_cache_.begin();
-						dbiter != decoded_block_cache_.end(); ++ dbiter)
-					{
-						if (dbiter->second.tick < min_tick)
-						{
-							min_tick = dbiter->second.tick;
-							min_iter = dbiter;
-						}
-					}
+				std::lock_guard<std::mutex> lock(decoded_block_mutex_);
 
-					for (auto dbiter = decoded_block_cache_.begin();
-						dbiter != decoded_block_cache_.end();)
-					{
-						if (dbiter->second.tick == min_tick)
-						{
-							dbiter = decoded_block_cache_.erase(dbiter);
-						}
-						else
-						{
-							++ dbiter;
-						}
-					}
+				auto iter = decoded_block_cache_.find(data_index);
+				if (iter != decoded_block_cache_.end())
+				{
+					decoded_block_lru_.splice(decoded_block_lru_.begin(), decoded_block_lru_, iter->second.lru_iter);
+					return iter->second.data;
 				}
 
-				uint32_t const full_tile_bytes = tile_size_ * tile_size_ * texel_size_;
-				auto data = MakeUniquePtr<uint8_t[]>(full_tile_bytes);
+				// Only reading the file needs the lock, decompressions run in parallel
 				if (data_index != EMPTY_DATA_INDEX)
 				{
 					uint64_t offsets[2];
 					input_file_->seekg(data_blocks_offset_ + data_index * sizeof(uint64_t), std::ios_base::beg);
 					input_file_->read(offsets, sizeof(offsets));
-					uint32_t const comed_len = static_cast<uint32_t>(offsets[1] - offsets[0]);
-					auto comed_data = MakeUniquePtr<uint8_t[]>(comed_len);
+					comed_data.resize(static_cast<size_t>(offsets[1] - offsets[0]));
 					input_file_->seekg(offsets[0], std::ios_base::beg);
-					input_file_->read(comed_data.get(), comed_len);
-					lzma_dec_.Decode(data.get(), MakeSpan(comed_data.get(), comed_len), full_tile_bytes);
-				}
-				else
-				{
-					memset(data.get(), 0, full_tile_bytes);
+					input_file_->read(comed_data.data(), comed_data.size());
 				}
+			}
+
+			uint32_t const full_tile_bytes = tile_size_ * tile_size_ * texel_size_;
+			auto data = MakeSharedPtr<std::vector<uint8_t>>(full_tile_bytes);
+			if (data_index != EMPTY_DATA_INDEX)
+			{
+				lzma_dec_.Decode(data->data(), MakeSpan(comed_data), full_tile_bytes);
+			}
 
-				iter = decoded_block_cache_.emplace(data_index, DecodedBlockInfo(std::move(data), decode_tick_)).first;
+			std::lock_guard<std::mutex> lock(decoded_block_mutex_);
+
+			auto iter = decoded_block_cache_.find(data_index);
+			if (iter != decoded_block_cache_.end())
+			{
+				// Another thread decoded it in the meantime
+				return iter->second.data;
 			}
 
-			return iter->second.data.get();
+			if (decoded_block_cache_.size() >= MAX_DECODED_BLOCKS)
+			{
+				decoded_block_cache_.erase(decoded_block_lru_.back());
+				decoded_block_lru_.pop_back();
+			}
+			decoded_block_lru_.push_front(data_index);
+			decoded_block_cache_.emplace(data_index, DecodedBlockInfo{data, decoded_block_lru_.begin()});
+
+			return data;
 		}
 		else
 		{
-			return &data_blocks_[data_index][0];
+			// Data blocks live as long as the texture, no ownership is needed
+			return std::shared_ptr<std::vector<uint8_t> const>(std::shared_ptr<void>(), &data_blocks_[data_index]);
 		}
 	}
 
@@ -1203,9 +1213,27 @@ namespace KlayGE
 				}
 			}
 
-			tex_indirect_ = rf.MakeTexture2D(num_tiles_, num_tiles_, 1, 1, EF_ABGR8, 1, 0, EAH_GPU_Read);
+			{
+				std::vector<uint8_t> indirect_data(num_tiles_ * num_tiles_ * 4, 0);
+				for (size_t i = 3; i < indirect_data.size(); i += 4)
+				{
+					indirect_data[i] = static_cast<uint8_t>(NOT_RESIDENT_LEVEL_SHIFT);
+				}
+
+				ElementInitData init_data;
+				init_data.data = indirect_data.data();
+				init_data.row_pitch = num_tiles_ * 4;
+				init_data.slice_pitch = init_data.row_pitch * num_tiles_;
+				tex_indirect_ = rf.MakeTexture2D(num_tiles_, num_tiles_, 1, 1, EF_ABGR8, 1, 0, EAH_GPU_Read, MakeSpan<1>(init_data));
+			}
 
-			tile_free_list_.emplace_back(0, pages);
+			uint32_t const tex_width = tex_cache_ ? tex_cache_->Width(0) : tex_cache_array_[0]->Width(0);
+			uint32_t const tex_height = tex_cache_ ? tex_cache_->Height(0) : tex_cache_array_[0]->Height(0);
+			uint32_t const tex_layer = tex_cache_ ? tex_cache_->ArraySize() : static_cast<uint32_t>(tex_cache_array_.size());
+			num_cache_tiles_a_row_ = tex_width / tile_with_border_size;
+			num_cache_tiles_a_layer_ = num_cache_tiles_a_row_ * tex_height / tile_with_border_size;
+			num_cache_total_tiles_ = std::min(num_cache_tiles_a_layer_ * tex_layer, pages);
+			cache_tiles_.reserve(num_cache_total_tiles_);
 		}
 	}
 
@@ -1252,1313 +1280,1439 @@ namespace KlayGE
 	{
 		BOOST_ASSERT(tex_cache_ || !tex_cache_array_.empty());
 
-		++ tile_tick_;
+		this->CommitDecodedTiles();
 
-		uint32_t const tex_width = tex_cache_ ? tex_cache_->Width(0) : tex_cache_array_[0]->Width(0);
-		uint32_t const tex_height = tex_cache_ ? tex_cache_->Height(0) : tex_cache_array_[0]->Height(0);
-		uint32_t const tex_layer = tex_cache_ ? tex_cache_->ArraySize() : static_cast<uint32_t>(tex_cache_array_.size());
-		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
-
-		uint32_t const num_cache_tiles_a_row = tex_width / tile_with_border_size;
-		uint32_t const num_cache_tiles_a_layer = num_cache_tiles_a_row * tex_height / tile_with_border_size;
-		uint32_t const num_cache_total_tiles = num_cache_tiles_a_layer * tex_layer;
-
-		std::unordered_map<uint32_t, uint32_t> neighbor_id_map;
-		std::vector<uint32_t> all_neighbor_ids;
-		std::vector<uint32_t> neighbor_ids;
-		std::vector<uint32_t> tile_attrs;
-		std::vector<bool> in_same_image;
-		auto& tim = tile_info_map_;
-		for (size_t i = 0; i < tile_ids.size(); ++ i)
+		std::vector<uint32_t> new_tile_ids;
+		std::vector<uint32_t> new_fallback_ids;
+		for (uint32_t const tile_id : tile_ids)
 		{
-			auto tmiter = tim.find(tile_ids[i]);
-			if (tmiter != tim.end())
+			auto iter = tile_info_map_.find(tile_id);
+			if (iter != tile_info_map_.end())
 			{
 				// Exists in cache
 
-				tmiter->second.tick = tile_tick_;
+				this->TouchCacheTile(iter->second);
+				continue;
 			}
-			else
+
+			auto pending_iter = pending_tiles_.find(tile_id);
+			if (pending_iter == pending_tiles_.end())
 			{
-				uint32_t level, tile_x, tile_y;
-				this->DecodeTileID(level, tile_x, tile_y, tile_ids[i]);
+				pending_iter = pending_tiles_.emplace(tile_id, PendingTile{ true, EMPTY_CACHE_INDEX, 0 }).first;
+				new_tile_ids.push_back(tile_id);
+			}
+			PendingTile& pending = pending_iter->second;
+			pending.requested = true;
 
-				std::array<uint32_t, 9> new_tile_id_with_neighbors;
-				new_tile_id_with_neighbors.fill(0xFFFFFFFF);
-				new_tile_id_with_neighbors[0] = tile_ids[i];
+			// Until it's decoded, the closest ancestor in cache is shown instead
 
-				std::array<bool, 9> new_in_same_image;
-				new_in_same_image.fill(false);
-				new_in_same_image[0] = true;
+			uint32_t level, tile_x, tile_y;
+			this->DecodeTileID(level, tile_x, tile_y, tile_id);
+			uint32_t const max_shift = std::min(level, MAX_FALLBACK_LEVELS);
+			bool const has_fallback = this->UpdateFallback(tile_id, pending.fallback_index, pending.fallback_shift);
+			if (!has_fallback && (max_shift > 0))
+			{
+				// One coarse tile covers many requested ones, so they share a single decoding
+				uint32_t const fallback_id = this->EncodeTileID(level - max_shift, tile_x >> max_shift, tile_y >> max_shift);
+				if (pending_tiles_.emplace(fallback_id, PendingTile{ false, EMPTY_CACHE_INDEX, 0 }).second)
+				{
+					new_fallback_ids.push_back(fallback_id);
+				}
+			}
+		}
 
-				uint32_t attr = this->DecodeAAttr(this->Pos2Shuff(level, tile_x, tile_y));
-				tile_attrs.push_back(attr);
-				if (attr != 0xFFFFFFFF)
+		// Fallbacks are submitted first, they are needed before the tiles themselves
+		auto& scheduler = Context::Instance().TaskScheduler();
+		if (!new_fallback_ids.empty())
+		{
+			scheduler.submit([this, ids = std::move(new_fallback_ids)]
+				{
+					this->DecodeCacheTiles(ids);
+				}, &decode_counter_);
+		}
+		if (!new_tile_ids.empty())
+		{
+			scheduler.submit([this, ids = std::move(new_tile_ids)]
 				{
-					std::array<int32_t, 9> new_tile_id_x;
-					std::array<int32_t, 9> new_tile_id_y;
+					this->DecodeCacheTiles(ids);
+				}, &decode_counter_);
+		}
+	}
 
-					int32_t left = tile_x - 1;
-					int32_t right = tile_x + 1;
-					int32_t up = tile_y - 1;
-					int32_t down = tile_y + 1;
+	void JudaTexture::CommitDecodedTiles()
+	{
+		std::vector<DecodedCacheTile> decoded_tiles;
+		{
+			std::lock_guard<std::mutex> lock(decoded_tiles_mutex_);
+			decoded_tiles.swap(decoded_tiles_);
+		}
 
-					ImageEntry const & entry = image_entries_[attr];
-					if (TAM_Wrap == (entry.addr_u_v & 0xF))
-					{
-						left = entry.x + (left - entry.x + entry.w) % entry.w;
-						right = entry.x + (right - entry.x + entry.w) % entry.w;
-					}
-					if (TAM_Wrap == ((entry.addr_u_v >> 4) & 0xF))
-					{
-						up = entry.y + (up - entry.y + entry.h) % entry.h;
-						down = entry.y + (down - entry.y + entry.h) % entry.h;
-					}
+		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
+		for (auto const & decoded : decoded_tiles)
+		{
+			auto pending_iter = pending_tiles_.find(decoded.tile_id);
+			BOOST_ASSERT(pending_iter != pending_tiles_.end());
+			bool const requested = pending_iter->second.requested;
+			pending_tiles_.erase(pending_iter);
+
+			uint32_t const index = this->AllocateCacheTile(decoded.tile_id);
+			uint32_t const z = index / num_cache_tiles_a_layer_;
+			uint32_t const y = (index - z * num_cache_tiles_a_layer_) / num_cache_tiles_a_row_;
+			uint32_t const x = index - z * num_cache_tiles_a_layer_ - y * num_cache_tiles_a_row_;
+
+			TexturePtr const & target_tex = tex_cache_ ? tex_cache_ : tex_cache_array_[z];
+			uint32_t const target_array_index = tex_cache_ ? z : 0;
+			uint32_t mip_tile_with_border_size = tile_with_border_size;
+			for (uint32_t l = 0; l < decoded.mips.size(); ++ l)
+			{
+				target_tex->UpdateSubresource2D(target_array_index, l,
+					x * mip_tile_with_border_size, y * mip_tile_with_border_size,
+					mip_tile_with_border_size, mip_tile_with_border_size,
+					decoded.mips[l].data(), decoded.row_pitches[l]);
 
-					new_tile_id_x[1] = left;
-					new_tile_id_y[1] = up;
-					new_tile_id_x[2] = tile_x;
-					new_tile_id_y[2] = up;
-					new_tile_id_x[3] = right;
-					new_tile_id_y[3] = up;
-
-					new_tile_id_x[4] = left;
-					new_tile_id_y[4] = tile_y;
-					new_tile_id_x[5] = right;
-					new_tile_id_y[5] = tile_y;
-
-					new_tile_id_x[6] = left;
-					new_tile_id_y[6] = down;
-					new_tile_id_x[7] = tile_x;
-					new_tile_id_y[7] = down;
-					new_tile_id_x[8] = right;
-					new_tile_id_y[8] = down;
-
-					for (int j = 1; j < 9; ++ j)
-					{
-						if ((new_tile_id_x[j] >= 0) && (new_tile_id_y[j] >= 0)
-							&& (new_tile_id_x[j] < static_cast<int32_t>(num_tiles_) - 1)
-							&& (new_tile_id_y[j] < static_cast<int32_t>(num_tiles_) - 1))
-						{
-							new_tile_id_with_neighbors[j] = this->EncodeTileID(level, new_tile_id_x[j], new_tile_id_y[j]);
-							if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
-							{
-								if (attr == this->DecodeAAttr(this->Pos2Shuff(level, new_tile_id_x[j], new_tile_id_y[j])))
-								{
-									new_in_same_image[j] = true;
-								}
-							}
-						}
-						else
-						{
-							new_tile_id_with_neighbors[j] = 0xFFFFFFFF;
-						}
-					}
-				}
+				mip_tile_with_border_size /= 2;
+			}
+
+			if (requested)
+			{
+				this->UpdateIndirect(decoded.tile_id, index, 0);
+			}
+		}
+	}
+
+	uint32_t JudaTexture::AllocateCacheTile(uint32_t tile_id)
+	{
+		uint32_t index;
+		if (cache_tiles_.size() < num_cache_total_tiles_)
+		{
+			// Still has space in cache
+
+			index = static_cast<uint32_t>(cache_tiles_.size());
+			cache_tiles_.push_back({ tile_id, EMPTY_CACHE_INDEX, EMPTY_CACHE_INDEX });
+		}
+		else
+		{
+			// Reuses the tile that is not used for the longest time
+
+			index = lru_tail_;
+			tile_info_map_.erase(cache_tiles_[index].tile_id);
+			this->UnlinkCacheTile(index);
+			cache_tiles_[index].tile_id = tile_id;
 
-				for (size_t j = 0; j < new_tile_id_with_neighbors.size(); ++ j)
+			this->LinkCacheTile(index);
+			tile_info_map_.emplace(tile_id, index);
+
+			// Pending tiles showing the evicted tile move to another ancestor in cache, which can be the new tile. Without
+			//  one, they aren't resident until UpdateCache finds them one again.
+			for (auto& pending : pending_tiles_)
+			{
+				if (pending.second.fallback_index == index)
 				{
-					if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
+					if (!this->UpdateFallback(pending.first, pending.second.fallback_index, pending.second.fallback_shift))
 					{
-						if (neighbor_id_map.find(new_tile_id_with_neighbors[j]) == neighbor_id_map.end())
-						{
-							neighbor_id_map.emplace(new_tile_id_with_neighbors[j], static_cast<uint32_t>(neighbor_ids.size()));
-							neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
-						}
+						pending.second.fallback_index = EMPTY_CACHE_INDEX;
+						pending.second.fallback_shift = 0;
+						this->UpdateIndirect(pending.first, 0, NOT_RESIDENT_LEVEL_SHIFT);
 					}
-					all_neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
-					in_same_image.push_back(new_in_same_image[j]);
 				}
 			}
+
+			return index;
 		}
 
-		uint32_t mipmaps = tex_cache_->NumMipMaps();
-		std::vector<std::vector<uint8_t>> neighbor_data;
-		this->DecodeTiles(neighbor_data, neighbor_ids, mipmaps);
+		this->LinkCacheTile(index);
+		tile_info_map_.emplace(tile_id, index);
+		return index;
+	}
 
-		TileInfo tile_info;
-		tile_info.tick = tile_tick_;
-		for (size_t i = 0; i < all_neighbor_ids.size(); i += 9)
+	void JudaTexture::TouchCacheTile(uint32_t index)
+	{
+		if (index != lru_head_)
 		{
-			tile_info.attr = tile_attrs[i / 9];
-			uint8_t border_clr[4];
-			TexAddressingMode addr_u, addr_v;
-			if (tile_info.attr != 0xFFFFFFFF)
-			{
-				ImageEntry const & entry = image_entries_[tile_info.attr];
-				addr_u = static_cast<TexAddressingMode>(entry.addr_u_v & 0xF);
-				addr_v = static_cast<TexAddressingMode>((entry.addr_u_v >> 4) & 0xF);
-				texel_op_.from_float4(border_clr, &entry.border_clr.r());
-			}
-			else
-			{
-				addr_u = TAM_Clamp;
-				addr_v = TAM_Clamp;
-				border_clr[0] = border_clr[1] = border_clr[2] = border_clr[3] = 0;
-			}
+			this->UnlinkCacheTile(index);
+			this->LinkCacheTile(index);
+		}
+	}
 
-			if (tile_info_map_.size() < num_cache_total_tiles)
-			{
-				// Still has space in cache
+	void JudaTexture::LinkCacheTile(uint32_t index)
+	{
+		CacheTile& tile = cache_tiles_[index];
+		tile.prev = EMPTY_CACHE_INDEX;
+		tile.next = lru_head_;
+		if (lru_head_ != EMPTY_CACHE_INDEX)
+		{
+			cache_tiles_[lru_head_].prev = index;
+		}
+		else
+		{
+			lru_tail_ = index;
+		}
+		lru_head_ = index;
+	}
+
+	void JudaTexture::UnlinkCacheTile(uint32_t index)
+	{
+		CacheTile& tile = cache_tiles_[index];
+		if (tile.prev != EMPTY_CACHE_INDEX)
+		{
+			cache_tiles_[tile.prev].next = tile.next;
+		}
+		else
+		{
+			lru_head_ = tile.next;
+		}
+		if (tile.next != EMPTY_CACHE_INDEX)
+		{
+			cache_tiles_[tile.next].prev = tile.prev;
+		}
+		else
+		{
+			lru_tail_ = tile.prev;
+		}
+		tile.prev = EMPTY_CACHE_INDEX;
+		tile.next = EMPTY_CACHE_INDEX;
+	}
+
+	void JudaTexture::UpdateIndirect(uint32_t tile_id, uint32_t index, uint32_t level_shift)
+	{
+		uint32_t const z = index / num_cache_tiles_a_layer_;
+		uint32_t const y = (index - z * num_cache_tiles_a_layer_) / num_cache_tiles_a_row_;
+		uint32_t const x = index - z * num_cache_tiles_a_layer_ - y * num_cache_tiles_a_row_;
 
-				uint32_t const s = tile_free_list_.front().first;
-				tile_info.z = s / num_cache_tiles_a_layer;
-				tile_info.y = (s - tile_info.z * num_cache_tiles_a_layer) / num_cache_tiles_a_row;
-				tile_info.x = s - tile_info.z * num_cache_tiles_a_layer - tile_info.y * num_cache_tiles_a_row;
+		// Alpha is the number of levels up of the cached tile, the shader picks the right part of it
+		uint8_t const a_tile_indirect[] =
+		{
+			static_cast<uint8_t>(x),
+			static_cast<uint8_t>(y),
+			static_cast<uint8_t>(z),
+			static_cast<uint8_t>(level_shift)
+		};
+		uint32_t level, tile_x, tile_y;
+		this->DecodeTileID(level, tile_x, tile_y, tile_id);
+		tex_indirect_->UpdateSubresource2D(0, 0, tile_x, tile_y, 1, 1, a_tile_indirect, sizeof(a_tile_indirect));
+	}
 
-				++ tile_free_list_.front().first;
-				if (tile_free_list_.front().first == tile_free_list_.front().second)
+	bool JudaTexture::UpdateFallback(uint32_t tile_id, uint32_t& fallback_index, uint32_t& fallback_shift)
+	{
+		uint32_t level, tile_x, tile_y;
+		this->DecodeTileID(level, tile_x, tile_y, tile_id);
+		uint32_t const max_shift = std::min(level, MAX_FALLBACK_LEVELS);
+		for (uint32_t shift = 1; shift <= max_shift; ++ shift)
+		{
+			auto fallback_iter = tile_info_map_.find(this->EncodeTileID(level - shift, tile_x >> shift, tile_y >> shift));
+			if (fallback_iter != tile_info_map_.end())
+			{
+				this->TouchCacheTile(fallback_iter->second);
+				if ((fallback_index != fallback_iter->second) || (fallback_shift != shift))
 				{
-					tile_free_list_.pop_front();
+					fallback_index = fallback_iter->second;
+					fallback_shift = shift;
+					this->UpdateIndirect(tile_id, fallback_iter->second, shift);
 				}
+				return true;
 			}
-			else
+		}
+		return false;
+	}
+
+	void JudaTexture::DecodeCacheTiles(std::vector<uint32_t> const & tile_ids)
+	{
+		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
+		ElementFormat const cache_format = tex_cache_ ? tex_cache_->Format() : tex_cache_array_[0]->Format();
+		uint32_t const mipmaps = tex_cache_ ? tex_cache_->NumMipMaps() : tex_cache_array_[0]->NumMipMaps();
+
+		// Neighbors shared by several tiles are decoded only once
+		std::unordered_map<uint32_t, uint32_t> neighbor_id_map;
+		std::vector<uint32_t> all_neighbor_ids;
+		std::vector<uint32_t> neighbor_ids;
+		std::vector<uint32_t> tile_attrs;
+		std::vector<bool> in_same_image;
+		for (size_t i = 0; i < tile_ids.size(); ++ i)
+		{
+			uint32_t level, tile_x, tile_y;
+			this->DecodeTileID(level, tile_x, tile_y, tile_ids[i]);
+
+			std::array<uint32_t, 9> new_tile_id_with_neighbors;
+			new_tile_id_with_neighbors.fill(0xFFFFFFFF);
+			new_tile_id_with_neighbors[0] = tile_ids[i];
+
+			std::array<bool, 9> new_in_same_image;
+			new_in_same_image.fill(false);
+			new_in_same_image[0] = true;
+
+			uint32_t attr = this->DecodeAAttr(this->Pos2Shuff(level, tile_x, tile_y));
+			tile_attrs.push_back(attr);
+			if (attr != 0xFFFFFFFF)
 			{
-				// Find tiles that are not used for the longest time
+				std::array<int32_t, 9> new_tile_id_x;
+				std::array<int32_t, 9> new_tile_id_y;
+
+				int32_t left = tile_x - 1;
+				int32_t right = tile_x + 1;
+				int32_t up = tile_y - 1;
+				int32_t down = tile_y + 1;
 
-				uint64_t min_tick = tim.begin()->second.tick;
-				auto min_tileiter = tim.begin();
-				for (auto tileiter = tim.begin(); tileiter != tim.end(); ++ tileiter)
+				ImageEntry const & entry = image_entries_[attr];
+				if (TAM_Wrap == (entry.addr_u_v & 0xF))
 				{
-					if (tileiter->second.tick < min_tick)
-					{
-						min_tick = tileiter->second.tick;
-						min_tileiter = tileiter;
-					}
+					left = entry.x + (left - entry.x + entry.w) % entry.w;
+					right = entry.x + (right - entry.x + entry.w) % entry.w;
+				}
+				if (TAM_Wrap == ((entry.addr_u_v >> 4) & 0xF))
+				{
+					up = entry.y + (up - entry.y + entry.h) % entry.h;
+					down = entry.y + (down - entry.y + entry.h) % entry.h;
 				}
 
-				tile_info.x = min_tileiter->second.x;
-				tile_info.y = min_tileiter->second.y;
-				tile_info.z = min_tileiter->second.z;
-
-				for (auto tileiter = tim.begin(); tileiter != tim.end();)
+				new_tile_id_x[1] = left;
+				new_tile_id_y[1] = up;
+				new_tile_id_x[2] = tile_x;
+				new_tile_id_y[2] = up;
+				new_tile_id_x[3] = right;
+				new_tile_id_y[3] = up;
+
+				new_tile_id_x[4] = left;
+				new_tile_id_y[4] = tile_y;
+				new_tile_id_x[5] = right;
+				new_tile_id_y[5] = tile_y;
+
+				new_tile_id_x[6] = left;
+				new_tile_id_y[6] = down;
+				new_tile_id_x[7] = tile_x;
+				new_tile_id_y[7] = down;
+				new_tile_id_x[8] = right;
+				new_tile_id_y[8] = down;
+
+				for (int j = 1; j < 9; ++ j)
 				{
-					if (tileiter->second.tick == min_tick)
+					if ((new_tile_id_x[j] >= 0) && (new_tile_id_y[j] >= 0)
+						&& (new_tile_id_x[j] < static_cast<int32_t>(num_tiles_) - 1)
+						&& (new_tile_id_y[j] < static_cast<int32_t>(num_tiles_) - 1))
 					{
-						uint32_t const id = tileiter->second.z * num_cache_tiles_a_layer + tileiter->second.y * num_cache_tiles_a_row + tileiter->second.x;
-						auto freeiter = tile_free_list_.begin();
-						while ((freeiter != tile_free_list_.end()) && (freeiter->second <= id))
+						new_tile_id_with_neighbors[j] = this->EncodeTileID(level, new_tile_id_x[j], new_tile_id_y[j]);
+						if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
 						{
-							++ freeiter;
+							if (attr == this->DecodeAAttr(this->Pos2Shuff(level, new_tile_id_x[j], new_tile_id_y[j])))
+							{
+								new_in_same_image[j] = true;
+							}
 						}
-						tile_free_list_.emplace(freeiter, id, id + 1);
-
-						tileiter = tim.erase(tileiter);
 					}
 					else
 					{
-						 ++ tileiter;
+						new_tile_id_with_neighbors[j] = 0xFFFFFFFF;
 					}
 				}
-				for (auto freeiter = tile_free_list_.begin(); freeiter != tile_free_list_.end() - 1;)
-				{
-					auto nextiter = freeiter;
-					++ nextiter;
+			}
 
-					if (freeiter->second == nextiter->first)
-					{
-						freeiter->second = nextiter->second;
-						freeiter = tile_free_list_.erase(nextiter);
-						-- freeiter;
-					}
-					else
+			for (size_t j = 0; j < new_tile_id_with_neighbors.size(); ++ j)
+			{
+				if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
+				{
+					if (neighbor_id_map.find(new_tile_id_with_neighbors[j]) == neighbor_id_map.end())
 					{
-						++ freeiter;
+						neighbor_id_map.emplace(new_tile_id_with_neighbors[j], static_cast<uint32_t>(neighbor_ids.size()));
+						neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
 					}
 				}
+				all_neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
+				in_same_image.push_back(new_in_same_image[j]);
 			}
+		}
 
-			std::array<uint32_t, 9> index_with_neighbors = { { 0 } };
-			for (size_t j = 0; j < index_with_neighbors.size(); ++ j)
-			{
-				if (all_neighbor_ids[i + j] != 0xFFFFFFFF)
-				{
-					BOOST_ASSERT(neighbor_id_map.find(all_neighbor_ids[i + j]) != neighbor_id_map.end());
+		std::vector<std::vector<uint8_t>> neighbor_data;
+		this->DecodeTiles(neighbor_data, neighbor_ids, mipmaps);
 
-					index_with_neighbors[j] = neighbor_id_map[all_neighbor_ids[i + j]];
-				}
-				else
+		Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(tile_ids.size()), 1,
+			[&](uint32_t first, uint32_t last)
+			{
+				// Codecs carry state, so every sub-range has its own
+				std::unique_ptr<TexCompression> tex_codec;
+				if (tex_codec_)
 				{
-					index_with_neighbors[j] = 0xFFFFFFFF;
+					tex_codec = tex_codec_->Clone();
 				}
-			}
-			BOOST_ASSERT(index_with_neighbors[0] != 0xFFFFFFFF);
 
-			uint32_t mip_tile_size = cache_tile_size_;
-			uint32_t mip_tile_with_border_size = tile_with_border_size;
-			uint32_t mip_border_size = cache_tile_border_size_;
-			for (uint32_t l = 0; l < mipmaps; ++ l)
-			{
-#if defined(KLAYGE_COMPILER_MSVC)
-				std::array<uint8_t const *, 9> neighbor_data_ptr{};
-#else
-				std::array<uint8_t const *, 9> neighbor_data_ptr;
-#endif
-				for (uint32_t j = 0; j < neighbor_data_ptr.size(); ++ j)
+				for (uint32_t t = first; t < last; ++ t)
 				{
-					if (index_with_neighbors[j] != 0xFFFFFFFF)
+					size_t const i = t * 9;
+					uint32_t const attr = tile_attrs[t];
+					uint8_t border_clr[4];
+					TexAddressingMode addr_u, addr_v;
+					if (attr != 0xFFFFFFFF)
 					{
-						neighbor_data_ptr[j] = &neighbor_data[index_with_neighbors[j] * mipmaps + l][0];
+						ImageEntry const & entry = image_entries_[attr];
+						addr_u = static_cast<TexAddressingMode>(entry.addr_u_v & 0xF);
+						addr_v = static_cast<TexAddressingMode>((entry.addr_u_v >> 4) & 0xF);
+						texel_op_.from_float4(border_clr, &entry.border_clr.r());
 					}
 					else
 					{
-						neighbor_data_ptr[j] = nullptr;
+						addr_u = TAM_Clamp;
+						addr_v = TAM_Clamp;
+						border_clr[0] = border_clr[1] = border_clr[2] = border_clr[3] = 0;
 					}
-				}
 
-				auto tex_a_tile_data = MakeUniquePtr<uint8_t[]>(mip_tile_with_border_size * mip_tile_with_border_size * texel_size_);
-				{
-					uint8_t* data_with_border = &tex_a_tile_data[0];
-					uint32_t const data_pitch = mip_tile_with_border_size * texel_size_;
-				
-					for (uint32_t y = 0; y < mip_tile_size; ++ y)
+					std::array<uint32_t, 9> index_with_neighbors = { { 0 } };
+					for (size_t j = 0; j < index_with_neighbors.size(); ++ j)
 					{
-						texel_op_.copy_array(data_with_border + (y + mip_border_size) * data_pitch + mip_border_size * texel_size_,
-							neighbor_data_ptr[0] + y * mip_tile_size * texel_size_, mip_tile_size);
-					}
+						if (all_neighbor_ids[i + j] != 0xFFFFFFFF)
+						{
+							BOOST_ASSERT(neighbor_id_map.find(all_neighbor_ids[i + j]) != neighbor_id_map.end());
 
-					if ((neighbor_data_ptr[1] != nullptr) && in_same_image[i + 1])
-					{
-						for (uint32_t y = 0; y < mip_border_size; ++ y)
+							index_with_neighbors[j] = neighbor_id_map.find(all_neighbor_ids[i + j])->second;
+						}
+						else
 						{
-							texel_op_.copy_array(data_with_border + y * data_pitch,
-								neighbor_data_ptr[1] + ((y + mip_tile_size - mip_border_size) * mip_tile_size + (mip_tile_size - mip_border_size)) * texel_size_,
-								mip_border_size);
+							index_with_neighbors[j] = 0xFFFFFFFF;
 						}
 					}
-					else
+					BOOST_ASSERT(index_with_neighbors[0] != 0xFFFFFFFF);
+
+					DecodedCacheTile decoded;
+					decoded.tile_id = tile_ids[t];
+					decoded.mips.resize(mipmaps);
+					decoded.row_pitches.resize(mipmaps);
+
+					uint32_t mip_tile_size = cache_tile_size_;
+					uint32_t mip_tile_with_border_size = tile_with_border_size;
+					uint32_t mip_border_size = cache_tile_border_size_;
+					for (uint32_t l = 0; l < mipmaps; ++ l)
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+#if defined(KLAYGE_COMPILER_MSVC)
+						std::array<uint8_t const *, 9> neighbor_data_ptr{};
+#else
+						std::array<uint8_t const *, 9> neighbor_data_ptr;
+#endif
+						for (uint32_t j = 0; j < neighbor_data_ptr.size(); ++ j)
 						{
-							auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
-							auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
-							switch (addr_u)
+							if (index_with_neighbors[j] != 0xFFFFFFFF)
 							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_border_size - 1 - x;
-									}
-								}
-								break;
+								neighbor_data_ptr[j] = &neighbor_data[index_with_neighbors[j] * mipmaps + l][0];
+							}
+							else
+							{
+								neighbor_data_ptr[j] = nullptr;
+							}
+						}
+
+						std::vector<uint8_t> tex_a_tile_data(mip_tile_with_border_size * mip_tile_with_border_size * texel_size_);
+						{
+							uint8_t* data_with_border = &tex_a_tile_data[0];
+							uint32_t const data_pitch = mip_tile_with_border_size * texel_size_;
+						
+							for (uint32_t y = 0; y < mip_tile_size; ++ y)
+							{
+								texel_op_.copy_array(data_with_border + (y + mip_border_size) * data_pitch + mip_border_size * texel_size_,
+									neighbor_data_ptr[0] + y * mip_tile_size * texel_size_, mip_tile_size);
+							}
 
-							case TAM_Clamp:
+							if ((neighbor_data_ptr[1] != nullptr) && in_same_image[i + 1])
+							{
 								for (uint32_t y = 0; y < mip_border_size; ++ y)
 								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = 0;
+									texel_op_.copy_array(data_with_border + y * data_pitch,
+										neighbor_data_ptr[1] + ((y + mip_tile_size - mip_border_size) * mip_tile_size + (mip_tile_size - mip_border_size)) * texel_size_,
+										mip_border_size);
+								}
+							}
+							else
+							{
+								if (attr != 0xFFFFFFFF)
+								{
+									auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
+									auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
+									switch (addr_u)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_border_size - 1 - x;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = 0;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+									switch (addr_v)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = mip_border_size - 1 - y;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = 0;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
+											}
+											else
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+											}
+										}
+									}
+								}
+								else
+								{
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0]);
+										}
 									}
 								}
-								break;
-
-							case TAM_Border:
+							}
+							if ((neighbor_data_ptr[2] != nullptr) && in_same_image[i + 2])
+							{
 								for (uint32_t y = 0; y < mip_border_size; ++ y)
 								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = -1;
+									texel_op_.copy_array(data_with_border + y * data_pitch + mip_border_size * texel_size_,
+										neighbor_data_ptr[2] + ((y + mip_tile_size - mip_border_size) * mip_tile_size) * texel_size_, mip_tile_size);
+								}
+							}
+							else
+							{
+								if (attr != 0xFFFFFFFF)
+								{
+									auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_tile_size * mip_border_size);
+									auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_tile_size * mip_border_size);
+									switch (addr_u)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_x[y * mip_tile_size + x] = x;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_x[y * mip_tile_size + x] = x;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_x[y * mip_tile_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+									switch (addr_v)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_y[y * mip_tile_size + x] = mip_border_size - 1 - y;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_y[y * mip_tile_size + x] = 0;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_y[y * mip_tile_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_tile_size; ++ x)
+										{
+											if ((border_coords_x[y * mip_tile_size + x] >= 0) && (border_coords_y[y * mip_tile_size + x] >= 0))
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0] + border_coords_y[y * mip_tile_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_tile_size + x]);
+											}
+											else
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+											}
+										}
+									}
+								}
+								else
+								{
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										texel_op_.copy_array(data_with_border + y * data_pitch + mip_border_size * texel_size_,
+											neighbor_data_ptr[0], mip_tile_size);
 									}
 								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
 							}
-							switch (addr_v)
+							if ((neighbor_data_ptr[3] != nullptr) && in_same_image[i + 3])
 							{
-							case TAM_Mirror:
 								for (uint32_t y = 0; y < mip_border_size; ++ y)
 								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = mip_border_size - 1 - y;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = 0;
-									}
-								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
-							}
-
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
-									}
-									else
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
-									}
-								}
-							}
-						}
-						else
-						{
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0]);
-								}
-							}
-						}
-					}
-					if ((neighbor_data_ptr[2] != nullptr) && in_same_image[i + 2])
-					{
-						for (uint32_t y = 0; y < mip_border_size; ++ y)
-						{
-							texel_op_.copy_array(data_with_border + y * data_pitch + mip_border_size * texel_size_,
-								neighbor_data_ptr[2] + ((y + mip_tile_size - mip_border_size) * mip_tile_size) * texel_size_, mip_tile_size);
-						}
-					}
-					else
-					{
-						if (tile_info.attr != 0xFFFFFFFF)
-						{
-							auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_tile_size * mip_border_size);
-							auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_tile_size * mip_border_size);
-							switch (addr_u)
-							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_x[y * mip_tile_size + x] = x;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_x[y * mip_tile_size + x] = x;
-									}
-								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_x[y * mip_tile_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
-							}
-							switch (addr_v)
-							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_y[y * mip_tile_size + x] = mip_border_size - 1 - y;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_y[y * mip_tile_size + x] = 0;
-									}
+									texel_op_.copy_array(data_with_border + y * data_pitch + (mip_border_size + mip_tile_size) * texel_size_,
+										neighbor_data_ptr[3] + (y + mip_tile_size - mip_border_size) * mip_tile_size * texel_size_, mip_border_size);
 								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_y[y * mip_tile_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
 							}
-
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
+							else
 							{
-								for (uint32_t x = 0; x < mip_tile_size; ++ x)
-								{
-									if ((border_coords_x[y * mip_tile_size + x] >= 0) && (border_coords_y[y * mip_tile_size + x] >= 0))
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0] + border_coords_y[y * mip_tile_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_tile_size + x]);
-									}
-									else
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+								if (attr != 0xFFFFFFFF)
+								{
+									auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
+									auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
+									switch (addr_u)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_tile_size - 1 - x;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_tile_size - 1;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+									switch (addr_v)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = mip_border_size - 1 - y;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = 0;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
+											}
+											else
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+											}
+										}
+									}
+								}
+								else
+								{
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											texel_op_.copy(data_with_border + y * data_pitch + (x + mip_border_size + mip_tile_size) * texel_size_,
+												neighbor_data_ptr[0] + (mip_tile_size - 1) * texel_size_);
+										}
 									}
 								}
 							}
-						}
-						else
-						{
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								texel_op_.copy_array(data_with_border + y * data_pitch + mip_border_size * texel_size_,
-									neighbor_data_ptr[0], mip_tile_size);
-							}
-						}
-					}
-					if ((neighbor_data_ptr[3] != nullptr) && in_same_image[i + 3])
-					{
-						for (uint32_t y = 0; y < mip_border_size; ++ y)
-						{
-							texel_op_.copy_array(data_with_border + y * data_pitch + (mip_border_size + mip_tile_size) * texel_size_,
-								neighbor_data_ptr[3] + (y + mip_tile_size - mip_border_size) * mip_tile_size * texel_size_, mip_border_size);
-						}
-					}
-					else
-					{
-						if (tile_info.attr != 0xFFFFFFFF)
-						{
-							auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
-							auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
-							switch (addr_u)
-							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_tile_size - 1 - x;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_tile_size - 1;
-									}
-								}
-								break;
 
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
-							}
-							switch (addr_v)
+							if ((neighbor_data_ptr[4] != nullptr) && in_same_image[i + 4])
 							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = mip_border_size - 1 - y;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = 0;
-									}
-								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
-							}
-
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
-									}
-									else
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
-									}
-								}
-							}
-						}
-						else
-						{
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									texel_op_.copy(data_with_border + y * data_pitch + (x + mip_border_size + mip_tile_size) * texel_size_,
-										neighbor_data_ptr[0] + (mip_tile_size - 1) * texel_size_);
-								}
-							}
-						}
-					}
-
-					if ((neighbor_data_ptr[4] != nullptr) && in_same_image[i + 4])
-					{
-						for (uint32_t y = 0; y < mip_tile_size; ++ y)
-						{
-							texel_op_.copy_array(data_with_border + (y + mip_border_size) * data_pitch,
-								neighbor_data_ptr[4] + (y * mip_tile_size + (mip_tile_size - mip_border_size)) * texel_size_, mip_border_size);
-						}
-					}
-					else
-					{
-						if (tile_info.attr != 0xFFFFFFFF)
-						{
-							auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_tile_size);
-							auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_tile_size);
-							switch (addr_u)
-							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_border_size - 1 - x;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
 								for (uint32_t y = 0; y < mip_tile_size; ++ y)
 								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = 0;
-									}
+									texel_op_.copy_array(data_with_border + (y + mip_border_size) * data_pitch,
+										neighbor_data_ptr[4] + (y * mip_tile_size + (mip_tile_size - mip_border_size)) * texel_size_, mip_border_size);
 								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
 							}
-							switch (addr_v)
+							else
 							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = y;
+								if (attr != 0xFFFFFFFF)
+								{
+									auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_tile_size);
+									auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_tile_size);
+									switch (addr_u)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_border_size - 1 - x;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = 0;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+									switch (addr_v)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = y;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = y;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+
+									for (uint32_t y = 0; y < mip_tile_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
+											}
+											else
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+											}
+										}
+									}
+								}
+								else
+								{
+									for (uint32_t y = 0; y < mip_tile_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											texel_op_.copy(data_with_border + (y + mip_border_size) * data_pitch + x * texel_size_,
+												neighbor_data_ptr[0] + y * mip_tile_size * texel_size_);
+										}
 									}
 								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = y;
-									}
-								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
-							}
-
-							for (uint32_t y = 0; y < mip_tile_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
-									}
-									else
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
-									}
-								}
-							}
-						}
-						else
-						{
-							for (uint32_t y = 0; y < mip_tile_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									texel_op_.copy(data_with_border + (y + mip_border_size) * data_pitch + x * texel_size_,
-										neighbor_data_ptr[0] + y * mip_tile_size * texel_size_);
-								}
 							}
-						}
-					}
-					if ((neighbor_data_ptr[5] != nullptr) && in_same_image[i + 5])
-					{
-						for (uint32_t y = 0; y < mip_tile_size; ++ y)
-						{
-							texel_op_.copy_array(data_with_border + (y + mip_border_size) * data_pitch + (mip_border_size + mip_tile_size) * texel_size_,
-								neighbor_data_ptr[5] + y * mip_tile_size * texel_size_, mip_border_size);
-						}
-					}
-					else
-					{
-						if (tile_info.attr != 0xFFFFFFFF)
-						{
-							auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_tile_size);
-							auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_tile_size);
-							switch (addr_u)
-							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_tile_size - 1 - x;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_tile_size - 1;
-									}
-								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
-							}
-							switch (addr_v)
+							if ((neighbor_data_ptr[5] != nullptr) && in_same_image[i + 5])
 							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = y;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_tile_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = y;
-									}
-								}
-								break;
-
-							case TAM_Border:
 								for (uint32_t y = 0; y < mip_tile_size; ++ y)
 								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = -1;
-									}
+									texel_op_.copy_array(data_with_border + (y + mip_border_size) * data_pitch + (mip_border_size + mip_tile_size) * texel_size_,
+										neighbor_data_ptr[5] + y * mip_tile_size * texel_size_, mip_border_size);
 								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
 							}
-
-							for (uint32_t y = 0; y < mip_tile_size; ++ y)
+							else
 							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
-									}
-									else
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+								if (attr != 0xFFFFFFFF)
+								{
+									auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_tile_size);
+									auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_tile_size);
+									switch (addr_u)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_tile_size - 1 - x;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_tile_size - 1;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+									switch (addr_v)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = y;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = y;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_tile_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+
+									for (uint32_t y = 0; y < mip_tile_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
+											}
+											else
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+											}
+										}
+									}
+								}
+								else
+								{
+									for (uint32_t y = 0; y < mip_tile_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											texel_op_.copy(data_with_border + (y + mip_border_size) * data_pitch + (x + mip_border_size + mip_tile_size) * texel_size_,
+												neighbor_data_ptr[0] + (y * mip_tile_size + mip_tile_size - 1) * texel_size_);
+										}
 									}
 								}
 							}
-						}
-						else
-						{
-							for (uint32_t y = 0; y < mip_tile_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									texel_op_.copy(data_with_border + (y + mip_border_size) * data_pitch + (x + mip_border_size + mip_tile_size) * texel_size_,
-										neighbor_data_ptr[0] + (y * mip_tile_size + mip_tile_size - 1) * texel_size_);
-								}
-							}
-						}
-					}
 
-					if ((neighbor_data_ptr[6] != nullptr) && in_same_image[i + 6])
-					{
-						for (uint32_t y = 0; y < mip_border_size; ++ y)
-						{
-							texel_op_.copy_array(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch,
-								neighbor_data_ptr[6] + (y * mip_tile_size + (mip_tile_size - mip_border_size)) * texel_size_, mip_border_size);
-						}
-					}
-					else
-					{
-						if (tile_info.attr != 0xFFFFFFFF)
-						{
-							auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
-							auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
-							switch (addr_u)
+							if ((neighbor_data_ptr[6] != nullptr) && in_same_image[i + 6])
 							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_border_size - 1 - x;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = 0;
-									}
-								}
-								break;
-
-							case TAM_Border:
 								for (uint32_t y = 0; y < mip_border_size; ++ y)
 								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = -1;
-									}
+									texel_op_.copy_array(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch,
+										neighbor_data_ptr[6] + (y * mip_tile_size + (mip_tile_size - mip_border_size)) * texel_size_, mip_border_size);
 								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
 							}
-							switch (addr_v)
+							else
 							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = mip_tile_size - 1 - y;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = mip_tile_size - 1;
+								if (attr != 0xFFFFFFFF)
+								{
+									auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
+									auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
+									switch (addr_u)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_border_size - 1 - x;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = 0;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+									switch (addr_v)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = mip_tile_size - 1 - y;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = mip_tile_size - 1;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
+											}
+											else
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+											}
+										}
+									}
+								}
+								else
+								{
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											texel_op_.copy(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + x * texel_size_,
+												neighbor_data_ptr[0] + (mip_tile_size - 1) * mip_tile_size * texel_size_);
+										}
 									}
 								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
 							}
-
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
+							if ((neighbor_data_ptr[7] != nullptr) && in_same_image[i + 7])
 							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
+								for (uint32_t y = 0; y < mip_border_size; ++ y)
 								{
-									if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
-									}
-									else
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
-									}
+									texel_op_.copy_array(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + mip_border_size * texel_size_,
+										neighbor_data_ptr[7] + y * mip_tile_size * texel_size_, mip_tile_size);
 								}
 							}
-						}
-						else
-						{
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
+							else
 							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									texel_op_.copy(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + x * texel_size_,
-										neighbor_data_ptr[0] + (mip_tile_size - 1) * mip_tile_size * texel_size_);
-								}
-							}
-						}
-					}
-					if ((neighbor_data_ptr[7] != nullptr) && in_same_image[i + 7])
-					{
-						for (uint32_t y = 0; y < mip_border_size; ++ y)
-						{
-							texel_op_.copy_array(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + mip_border_size * texel_size_,
-								neighbor_data_ptr[7] + y * mip_tile_size * texel_size_, mip_tile_size);
-						}
-					}
-					else
-					{
-						if (tile_info.attr != 0xFFFFFFFF)
-						{
-							auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_tile_size * mip_border_size);
-							auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_tile_size * mip_border_size);
-							switch (addr_u)
+								if (attr != 0xFFFFFFFF)
+								{
+									auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_tile_size * mip_border_size);
+									auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_tile_size * mip_border_size);
+									switch (addr_u)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_x[y * mip_tile_size + x] = x;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_x[y * mip_tile_size + x] = x;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_x[y * mip_tile_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+									switch (addr_v)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_y[y * mip_tile_size + x] = mip_tile_size - 1 - y;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_y[y * mip_tile_size + x] = mip_tile_size - 1;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_size; ++ x)
+											{
+												border_coords_y[y * mip_tile_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_tile_size; ++ x)
+										{
+											if ((border_coords_x[y * mip_tile_size + x] >= 0) && (border_coords_y[y * mip_tile_size + x] >= 0))
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0] + border_coords_y[y * mip_tile_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_tile_size + x]);
+											}
+											else
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+											}
+										}
+									}
+								}
+								else
+								{
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										texel_op_.copy_array(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + mip_border_size * texel_size_,
+											neighbor_data_ptr[0] + (mip_tile_size - 1) * mip_tile_size * texel_size_, mip_tile_size);
+									}
+								}
+							}			
+							if ((neighbor_data_ptr[8] != nullptr) && in_same_image[i + 8])
 							{
-							case TAM_Mirror:
 								for (uint32_t y = 0; y < mip_border_size; ++ y)
 								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_x[y * mip_tile_size + x] = x;
-									}
+									texel_op_.copy_array(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + (mip_border_size + mip_tile_size) * texel_size_,
+										neighbor_data_ptr[8] + y * mip_tile_size * texel_size_, mip_border_size);
 								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_x[y * mip_tile_size + x] = x;
-									}
-								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_x[y * mip_tile_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
 							}
-							switch (addr_v)
+							else
 							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_y[y * mip_tile_size + x] = mip_tile_size - 1 - y;
+								if (attr != 0xFFFFFFFF)
+								{
+									auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
+									auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
+									switch (addr_u)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_tile_size - 1 - x;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = mip_tile_size - 1;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_x[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+									switch (addr_v)
+									{
+									case TAM_Mirror:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = mip_tile_size - 1 - y;
+											}
+										}
+										break;
+
+									case TAM_Clamp:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = mip_tile_size - 1;
+											}
+										}
+										break;
+
+									case TAM_Border:
+										for (uint32_t y = 0; y < mip_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_border_size; ++ x)
+											{
+												border_coords_y[y * mip_border_size + x] = -1;
+											}
+										}
+										break;
+
+									default:
+										KFL_UNREACHABLE("Invalid texture addressing mode");
+									}
+
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
+													neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
+											}
+											else
+											{
+												texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
+											}
+										}
+									}
+								}
+								else
+								{
+									for (uint32_t y = 0; y < mip_border_size; ++ y)
+									{
+										for (uint32_t x = 0; x < mip_border_size; ++ x)
+										{
+											texel_op_.copy(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + (x + mip_border_size + mip_tile_size) * texel_size_,
+												neighbor_data_ptr[0] + (mip_tile_size - 1) * mip_tile_size * texel_size_);
+										}
 									}
 								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_y[y * mip_tile_size + x] = mip_tile_size - 1;
-									}
-								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_size; ++ x)
-									{
-										border_coords_y[y * mip_tile_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
-							}
-
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_tile_size; ++ x)
-								{
-									if ((border_coords_x[y * mip_tile_size + x] >= 0) && (border_coords_y[y * mip_tile_size + x] >= 0))
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0] + border_coords_y[y * mip_tile_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_tile_size + x]);
-									}
-									else
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
-									}
-								}
-							}
-						}
-						else
-						{
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								texel_op_.copy_array(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + mip_border_size * texel_size_,
-									neighbor_data_ptr[0] + (mip_tile_size - 1) * mip_tile_size * texel_size_, mip_tile_size);
 							}
 						}
-					}			
-					if ((neighbor_data_ptr[8] != nullptr) && in_same_image[i + 8])
-					{
-						for (uint32_t y = 0; y < mip_border_size; ++ y)
-						{
-							texel_op_.copy_array(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + (mip_border_size + mip_tile_size) * texel_size_,
-								neighbor_data_ptr[8] + y * mip_tile_size * texel_size_, mip_border_size);
-						}
-					}
-					else
-					{
-						if (tile_info.attr != 0xFFFFFFFF)
-						{
-							auto border_coords_x = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
-							auto border_coords_y = MakeUniquePtr<int32_t[]>(mip_border_size * mip_border_size);
-							switch (addr_u)
-							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_tile_size - 1 - x;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = mip_tile_size - 1;
-									}
-								}
-								break;
 
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_x[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
-							}
-							switch (addr_v)
+						if (IsCompressedFormat(cache_format))
+						{
+							uint32_t const block_width = BlockWidth(cache_format);
+							uint32_t const block_height = BlockHeight(cache_format);
+							uint32_t const block_bytes = BlockBytes(cache_format);
+							uint32_t const bc_row_pitch = (mip_tile_with_border_size + block_width - 1) / block_width * block_bytes;
+							uint32_t const bc_slice_pitch = (mip_tile_with_border_size + block_height - 1) / block_height * bc_row_pitch;
+							std::vector<uint8_t> bc(bc_slice_pitch);
 							{
-							case TAM_Mirror:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = mip_tile_size - 1 - y;
-									}
-								}
-								break;
-
-							case TAM_Clamp:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = mip_tile_size - 1;
-									}
-								}
-								break;
-
-							case TAM_Border:
-								for (uint32_t y = 0; y < mip_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_border_size; ++ x)
-									{
-										border_coords_y[y * mip_border_size + x] = -1;
-									}
-								}
-								break;
-
-							default:
-								KFL_UNREACHABLE("Invalid texture addressing mode");
+								uint8_t const * data_with_border = &tex_a_tile_data[0];
+								uint32_t const data_row_pitch = mip_tile_with_border_size * texel_size_;
+								uint32_t const data_slice_pitch = mip_tile_with_border_size
+									* mip_tile_with_border_size * texel_size_;
+
+								uint32_t const * p_argb;
+								uint32_t row_pitch;
+								uint32_t slice_pitch;
+								std::vector<uint32_t> argb_data;
+								switch (format_)
+								{
+								case EF_R8:
+									{
+										argb_data.resize(mip_tile_with_border_size * mip_tile_with_border_size, 0);
+										for (uint32_t y = 0; y < mip_tile_with_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_with_border_size; ++ x)
+											{
+												argb_data[y * mip_tile_with_border_size + x] = data_with_border[y * data_row_pitch + x] << 16;
+											}
+										}
+										p_argb = &argb_data[0];
+										row_pitch = mip_tile_with_border_size * 4;
+										slice_pitch = mip_tile_with_border_size * row_pitch;
+									}
+									break;
+
+								case EF_GR8:
+									{
+										argb_data.resize(mip_tile_with_border_size * mip_tile_with_border_size, 0);
+										for (uint32_t y = 0; y < mip_tile_with_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_with_border_size; ++ x)
+											{
+												argb_data[y * mip_tile_with_border_size + x] = (data_with_border[y * data_row_pitch + x * 2 + 0] << 16)
+													| (data_with_border[y * data_row_pitch + x * 2 + 1] << 8);
+											}
+										}
+										p_argb = &argb_data[0];
+										row_pitch = mip_tile_with_border_size * 4;
+										slice_pitch = mip_tile_with_border_size * row_pitch;
+									}
+									break;
+
+								case EF_ABGR8:
+									{
+										argb_data.resize(mip_tile_with_border_size * mip_tile_with_border_size, 0);
+										for (uint32_t y = 0; y < mip_tile_with_border_size; ++ y)
+										{
+											for (uint32_t x = 0; x < mip_tile_with_border_size; ++ x)
+											{
+												argb_data[y * mip_tile_with_border_size + x] = (data_with_border[y * data_row_pitch + x * 4 + 0] << 16)
+													| (data_with_border[y * data_row_pitch + x * 4 + 1] << 8)
+													| (data_with_border[y * data_row_pitch + x * 4 + 2] << 0)
+													| (data_with_border[y * data_row_pitch + x * 4 + 3] << 24);
+											}
+										}
+										p_argb = &argb_data[0];
+										row_pitch = mip_tile_with_border_size * 4;
+										slice_pitch = mip_tile_with_border_size * row_pitch;
+									}
+									break;
+
+								case EF_ARGB8:
+									p_argb = reinterpret_cast<uint32_t const *>(data_with_border);
+									row_pitch = data_row_pitch;
+									slice_pitch = data_slice_pitch;
+									break;
+
+								default:
+									KFL_UNREACHABLE("Not supported element format");
+								}
+
+								tex_codec->EncodeMem(mip_tile_with_border_size, mip_tile_with_border_size,
+									&bc[0], bc_row_pitch, bc_slice_pitch, p_argb, row_pitch, slice_pitch, TCM_Quality);
 							}
 
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									if ((border_coords_x[y * mip_border_size + x] >= 0) && (border_coords_y[y * mip_border_size + x] >= 0))
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_,
-											neighbor_data_ptr[0] + border_coords_y[y * mip_border_size + x] * mip_tile_with_border_size + border_coords_x[y * mip_border_size + x]);
-									}
-									else
-									{
-										texel_op_.copy(data_with_border + y * data_pitch + x * texel_size_, border_clr);
-									}
-								}
-							}
+							decoded.mips[l] = std::move(bc);
+							decoded.row_pitches[l] = bc_row_pitch;
 						}
 						else
 						{
-							for (uint32_t y = 0; y < mip_border_size; ++ y)
-							{
-								for (uint32_t x = 0; x < mip_border_size; ++ x)
-								{
-									texel_op_.copy(data_with_border + (y + mip_border_size + mip_tile_size) * data_pitch + (x + mip_border_size + mip_tile_size) * texel_size_,
-										neighbor_data_ptr[0] + (mip_tile_size - 1) * mip_tile_size * texel_size_);
-								}
-							}
-						}
-					}
-				}
-
-				ElementFormat format;
-				if (tex_cache_)
-				{
-					format = tex_cache_->Format();
-				}
-				else
-				{
-					format = tex_cache_array_[tile_info.z]->Format();
-				}
-
-				TexturePtr target_tex;
-				uint32_t target_array_index;
-				if (tex_cache_)
-				{
-					target_tex = tex_cache_;
-					target_array_index = tile_info.z;
-				}
-				else
-				{
-					target_tex = tex_cache_array_[tile_info.z];
-					target_array_index = 0;
-				}
-
-				if (IsCompressedFormat(format))
-				{
-					uint32_t const block_width = BlockWidth(format);
-					uint32_t const block_height = BlockHeight(format);
-					uint32_t const block_bytes = BlockBytes(format);
-					uint32_t const bc_row_pitch = (mip_tile_with_border_size + block_width - 1) / block_width * block_bytes;
-					uint32_t const bc_slice_pitch = (mip_tile_with_border_size + block_height - 1) / block_height * bc_row_pitch;
-					auto bc = MakeUniquePtr<uint8_t[]>(bc_slice_pitch);
-					{
-						uint8_t const * data_with_border = &tex_a_tile_data[0];
-						uint32_t const data_row_pitch = mip_tile_with_border_size * texel_size_;
-						uint32_t const data_slice_pitch = mip_tile_with_border_size
-							* mip_tile_with_border_size * texel_size_;
-
-						uint32_t const * p_argb;
-						uint32_t row_pitch;
-						uint32_t slice_pitch;
-						std::vector<uint32_t> argb_data;
-						switch (format_)
-						{
-						case EF_R8:
-							{
-								argb_data.resize(mip_tile_with_border_size * mip_tile_with_border_size, 0);
-								for (uint32_t y = 0; y < mip_tile_with_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_with_border_size; ++ x)
-									{
-										argb_data[y * mip_tile_with_border_size + x] = data_with_border[y * data_row_pitch + x] << 16;
-									}
-								}
-								p_argb = &argb_data[0];
-								row_pitch = mip_tile_with_border_size * 4;
-								slice_pitch = mip_tile_with_border_size * row_pitch;
-							}
-							break;
-
-						case EF_GR8:
-							{
-								argb_data.resize(mip_tile_with_border_size * mip_tile_with_border_size, 0);
-								for (uint32_t y = 0; y < mip_tile_with_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_with_border_size; ++ x)
-									{
-										argb_data[y * mip_tile_with_border_size + x] = (data_with_border[y * data_row_pitch + x * 2 + 0] << 16)
-											| (data_with_border[y * data_row_pitch + x * 2 + 1] << 8);
-									}
-								}
-								p_argb = &argb_data[0];
-								row_pitch = mip_tile_with_border_size * 4;
-								slice_pitch = mip_tile_with_border_size * row_pitch;
-							}
-							break;
-
-						case EF_ABGR8:
-							{
-								argb_data.resize(mip_tile_with_border_size * mip_tile_with_border_size, 0);
-								for (uint32_t y = 0; y < mip_tile_with_border_size; ++ y)
-								{
-									for (uint32_t x = 0; x < mip_tile_with_border_size; ++ x)
-									{
-										argb_data[y * mip_tile_with_border_size + x] = (data_with_border[y * data_row_pitch + x * 4 + 0] << 16)
-											| (data_with_border[y * data_row_pitch + x * 4 + 1] << 8)
-											| (data_with_border[y * data_row_pitch + x * 4 + 2] << 0)
-											| (data_with_border[y * data_row_pitch + x * 4 + 3] << 24);
-									}
-								}
-								p_argb = &argb_data[0];
-								row_pitch = mip_tile_with_border_size * 4;
-								slice_pitch = mip_tile_with_border_size * row_pitch;
-							}
-							break;
-
-						case EF_ARGB8:
-							p_argb = reinterpret_cast<uint32_t const *>(data_with_border);
-							row_pitch = data_row_pitch;
-							slice_pitch = data_slice_pitch;
-							break;
-
-						default:
-							KFL_UNREACHABLE("Not supported element format");
+							decoded.mips[l] = std::move(tex_a_tile_data);
+							decoded.row_pitches[l] = mip_tile_with_border_size * texel_size_;
 						}
 
-						tex_codec_->EncodeMem(mip_tile_with_border_size, mip_tile_with_border_size,
-							&bc[0], bc_row_pitch, bc_slice_pitch, p_argb, row_pitch, slice_pitch, TCM_Quality);
+						mip_tile_size /= 2;
+						mip_tile_with_border_size /= 2;
+						mip_border_size /= 2;
 					}
 
-					target_tex->UpdateSubresource2D(target_array_index, l,
-						tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size,
-						mip_tile_with_border_size, mip_tile_with_border_size,
-						&bc[0], bc_row_pitch);
+					std::lock_guard<std::mutex> lock(decoded_tiles_mutex_);
+					decoded_tiles_.push_back(std::move(decoded));
 				}
-				else
-				{
-					target_tex->UpdateSubresource2D(target_array_index, l,
-						tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size,
-						mip_tile_with_border_size, mip_tile_with_border_size,
-						&tex_a_tile_data[0], mip_tile_with_border_size * texel_size_);
-				}
-
-				mip_tile_size /= 2;
-				mip_tile_with_border_size /= 2;
-				mip_border_size /= 2;
-			}
-
-			uint8_t const a_tile_indirect[] =
-			{
-				static_cast<uint8_t>(tile_info.x),
-				static_cast<uint8_t>(tile_info.y),
-				static_cast<uint8_t>(tile_info.z),
-				0
-			};
-			uint32_t level, tile_x, tile_y;
-			this->DecodeTileID(level, tile_x, tile_y, all_neighbor_ids[i]);
-			tex_indirect_->UpdateSubresource2D(0, 0, tile_x, tile_y, 1, 1, a_tile_indirect, sizeof(a_tile_indirect));
-
-			tim.emplace(all_neighbor_ids[i], tile_info);
-		}
+			});
 	}
 }
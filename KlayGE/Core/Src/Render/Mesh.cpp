@@ -32,6 +32,9 @@
 #include <KlayGE/App3D.hpp>
 #include <KlayGE/Camera.hpp>
 #include <KFL/XMLDom.hpp>
+#include <KFL/CustomizedStreamBuf.hpp>
+#include <KFL/MappedFile.hpp>
+#include <KFL/TaskScheduler.hpp>
 #include <KlayGE/LZMACodec.hpp>
 #include <KlayGE/Light.hpp>
 #include <KlayGE/RenderMaterial.hpp>
@@ -44,6 +47,9 @@
 #include <fstream>
 #include <sstream>
 #include <cstring>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 
 #include <KlayGE/Mesh.hpp>
 
@@ -51,7 +57,31 @@ namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const MODEL_BIN_VERSION = 19;
+	uint32_t const MODEL_BIN_VERSION = 21;
+
+	// Since version 20, a model_bin is a table of chunks. The chunk data are 16-byte aligned and can be used in place
+	// if they are not compressed. Since version 21, each LOD stores its screen size.
+	uint32_t const MODEL_BIN_CHUNK_ALIGNMENT = 16;
+
+	enum ModelBinChunkCompression : uint32_t
+	{
+		MBCC_None = 0,
+		MBCC_LZMA
+	};
+
+	struct ModelBinChunkDesc
+	{
+		uint32_t type;
+		uint32_t compression;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t original_size;
+	};
+	static_assert(sizeof(ModelBinChunkDesc) == 32);
+
+	uint32_t const MODEL_BIN_CHUNK_META = MakeFourCC<'M', 'E', 'T', 'A'>::value;
+	uint32_t const MODEL_BIN_CHUNK_VERTICES = MakeFourCC<'V', 'E', 'R', 'T'>::value;
+	uint32_t const MODEL_BIN_CHUNK_INDICES = MakeFourCC<'I', 'N', 'D', 'X'>::value;
 
 	class RenderModelLoadingDesc : public ResLoadingDesc
 	{
@@ -136,6 +166,15 @@ namespace
 			return true;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashRange(seed, model_desc_.res_name.begin(), model_desc_.res_name.end());
+			HashCombine(seed, model_desc_.access_hint);
+			return seed;
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			KFL_UNUSED(rhs);
@@ -341,6 +380,136 @@ namespace
 		ModelDesc model_desc_;
 		std::mutex main_thread_stage_mutex_;
 	};
+
+	uint32_t QuantizeToUNorm8x4(float4 const & v)
+	{
+		uint32_t ret = 0;
+		for (uint32_t i = 0; i < 4; ++ i)
+		{
+			ret |= MathLib::clamp(static_cast<uint32_t>((v[i] * 0.5f + 0.5f) * 255 + 0.5f), 0U, 255U) << (i * 8);
+		}
+		return ret;
+	}
+
+	// Float streams are converted to the compact formats. Each LOD of a mesh is normalized with the bounding boxes of
+	// the mesh, which are what the mesh shaders decode with.
+	void QuantizeVertexStreams(std::vector<VertexElement>& merged_ves, std::vector<std::vector<uint8_t>>& merged_buffs,
+		std::vector<uint32_t> const & mesh_lods, std::vector<AABBox> const & pos_bbs, std::vector<AABBox> const & tc_bbs,
+		std::vector<uint32_t> const & mesh_num_vertices, std::vector<uint32_t> const & mesh_base_vertices)
+	{
+		for (size_t i = 0; i < merged_ves.size(); ++ i)
+		{
+			auto& ve = merged_ves[i];
+			auto const & src = merged_buffs[i];
+
+			ElementFormat new_format;
+			switch (ve.usage)
+			{
+			case VEU_Position:
+				new_format = ((ve.format == EF_BGR32F) || (ve.format == EF_ABGR32F)) ? EF_SIGNED_ABGR16 : ve.format;
+				break;
+
+			case VEU_TextureCoord:
+				new_format = (ve.format == EF_GR32F) ? EF_SIGNED_GR16 : ve.format;
+				break;
+
+			case VEU_Normal:
+				new_format = ((ve.format == EF_BGR32F) || (ve.format == EF_ABGR32F)) ? EF_ABGR8 : ve.format;
+				break;
+
+			case VEU_Tangent:
+				new_format = (ve.format == EF_ABGR32F) ? EF_ABGR8 : ve.format;
+				break;
+
+			default:
+				new_format = ve.format;
+				break;
+			}
+			if (new_format == ve.format)
+			{
+				continue;
+			}
+
+			uint32_t const num_elems = NumComponents(ve.format);
+			uint32_t const num_vertices = static_cast<uint32_t>(src.size() / ve.element_size());
+			float const * src_f = reinterpret_cast<float const *>(src.data());
+			std::vector<uint8_t> dst(num_vertices * NumFormatBytes(new_format));
+
+			uint32_t mesh_lod_index = 0;
+			for (size_t mesh_index = 0; mesh_index < mesh_lods.size(); ++ mesh_index)
+			{
+				float3 const pos_center = pos_bbs[mesh_index].Center();
+				float3 pos_extent = pos_bbs[mesh_index].HalfSize();
+				float3 const tc_center = tc_bbs[mesh_index].Center();
+				float3 tc_extent = tc_bbs[mesh_index].HalfSize();
+				for (uint32_t j = 0; j < 3; ++ j)
+				{
+					// A flat axis decodes to the center whatever is stored
+					if (pos_extent[j] == 0)
+					{
+						pos_extent[j] = 1;
+					}
+					if (tc_extent[j] == 0)
+					{
+						tc_extent[j] = 1;
+					}
+				}
+
+				for (uint32_t lod = 0; lod < mesh_lods[mesh_index]; ++ lod, ++ mesh_lod_index)
+				{
+					uint32_t const first = mesh_base_vertices[mesh_lod_index];
+					uint32_t const last = std::min(first + mesh_num_vertices[mesh_lod_index], num_vertices);
+					for (uint32_t v = first; v < last; ++ v)
+					{
+						float const * s = &src_f[v * num_elems];
+						switch (ve.usage)
+						{
+						case VEU_Position:
+							{
+								float3 const pos = (float3(s[0], s[1], s[2]) - pos_center) / pos_extent * 0.5f + 0.5f;
+								int16_t* d = reinterpret_cast<int16_t*>(&dst[v * 8]);
+								d[0] = QuantizeToSNorm16(pos.x());
+								d[1] = QuantizeToSNorm16(pos.y());
+								d[2] = QuantizeToSNorm16(pos.z());
+								d[3] = 32767;
+							}
+							break;
+
+						case VEU_TextureCoord:
+							{
+								float3 const tc = (float3(s[0], s[1], 0) - tc_center) / tc_extent * 0.5f + 0.5f;
+								int16_t* d = reinterpret_cast<int16_t*>(&dst[v * 4]);
+								d[0] = QuantizeToSNorm16(tc.x());
+								d[1] = QuantizeToSNorm16(tc.y());
+							}
+							break;
+
+						case VEU_Normal:
+							{
+								float3 const normal = MathLib::normalize(float3(s[0], s[1], s[2]));
+								uint32_t const compact = QuantizeToUNorm8x4(float4(normal.x(), normal.y(), normal.z(), -1));
+								std::memcpy(&dst[v * 4], &compact, sizeof(compact));
+							}
+							break;
+
+						default:
+							{
+								uint32_t const compact = QuantizeToUNorm8x4(float4(s[0], s[1], s[2], s[3]));
+								std::memcpy(&dst[v * 4], &compact, sizeof(compact));
+							}
+							break;
+						}
+					}
+				}
+			}
+
+			ve.format = new_format;
+			merged_buffs[i].swap(dst);
+		}
+	}
+
+	std::mutex queued_skinned_models_mutex;
+	std::vector<KlayGE::SkinnedModel*> queued_skinned_models;
 }
 
 namespace KlayGE
@@ -396,6 +565,14 @@ namespace KlayGE
 			});
 	}
 
+	void RenderModel::LodScreenSize(uint32_t lod, float size)
+	{
+		this->ForEachMesh([lod, size](Renderable& mesh)
+			{
+				mesh.LodScreenSize(lod, size);
+			});
+	}
+
 	bool RenderModel::HWResourceReady() const
 	{
 		bool ready = hw_res_ready_;
@@ -476,6 +653,7 @@ namespace KlayGE
 					mesh.NumIndices(lod, src_mesh.NumIndices(lod));
 					mesh.StartVertexLocation(lod, src_mesh.StartVertexLocation(lod));
 					mesh.StartIndexLocation(lod, src_mesh.StartIndexLocation(lod));
+					mesh.LodScreenSize(lod, src_mesh.LodScreenSize(lod));
 				}
 			}
 
@@ -626,6 +804,12 @@ namespace KlayGE
 
 
 	std::tuple<Quaternion, Quaternion, float> KeyFrameSet::Frame(float frame) const
+	{
+		uint32_t hint = 0;
+		return this->Frame(frame, hint);
+	}
+
+	std::tuple<Quaternion, Quaternion, float> KeyFrameSet::Frame(float frame, uint32_t& hint) const
 	{
 		std::tuple<Quaternion, Quaternion, float> ret;
 		if (frame_id.size() == 1)
@@ -636,8 +820,25 @@ namespace KlayGE
 		{
 			frame = std::fmod(frame, static_cast<float>(frame_id.back() + 1));
 
-			auto iter = std::upper_bound(frame_id.begin(), frame_id.end(), frame);
-			int index = static_cast<int>(iter - frame_id.begin());
+			// Animations usually move forward less than a key frame per update, so the key frame found last time
+			// and the next one are tried before the binary search.
+			uint32_t const num_key_frames = static_cast<uint32_t>(frame_id.size());
+			bool found = false;
+			for (uint32_t i = std::max(hint, 1U); (i <= hint + 1) && (i <= num_key_frames); ++ i)
+			{
+				if ((frame_id[i - 1] <= frame) && ((i == num_key_frames) || (frame < frame_id[i])))
+				{
+					hint = i;
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+			{
+				auto iter = std::upper_bound(frame_id.begin(), frame_id.end(), frame);
+				hint = static_cast<uint32_t>(iter - frame_id.begin());
+			}
+			int index = static_cast<int>(hint);
 
 			int index0 = index - 1;
 			int index1 = index % frame_id.size();
@@ -722,34 +923,90 @@ namespace KlayGE
 	{
 	}
 
+	SkinnedModel::~SkinnedModel() noexcept
+	{
+		std::lock_guard<std::mutex> lock(queued_skinned_models_mutex);
+		if (frame_queued_)
+		{
+			queued_skinned_models.erase(std::find(queued_skinned_models.begin(), queued_skinned_models.end(), this));
+		}
+	}
+
 	void SkinnedModel::BuildBones(float frame)
 	{
+		this->EvaluateBones(frame);
+		this->SetToEffect();
+	}
+
+	void SkinnedModel::UpdateJointHierarchy()
+	{
+		std::unordered_map<JointComponent const *, int32_t> joint_indices;
 		for (size_t i = 0; i < joints_.size(); ++ i)
 		{
-			auto& joint = *joints_[i];
-			KeyFrameSet const & kf = (*key_frame_sets_)[i];
-
-			std::tuple<Quaternion, Quaternion, float> key_dq = kf.Frame(frame);
+			joint_indices.emplace(joints_[i].get(), static_cast<int32_t>(i));
+		}
 
-			bool is_root = false;
-			auto* parent_node = joint.BoundSceneNode()->Parent();
+		joint_parents_.assign(joints_.size(), -1);
+		for (size_t i = 0; i < joints_.size(); ++ i)
+		{
+			auto* node = joints_[i]->BoundSceneNode();
+			auto* parent_node = node ? node->Parent() : nullptr;
 			if (parent_node)
 			{
-				auto* parent_joint = parent_node->FirstComponentOfType<JointComponent>();
-				if (parent_joint == nullptr)
+				auto iter = joint_indices.find(parent_node->FirstComponentOfType<JointComponent>());
+				if (iter != joint_indices.end())
 				{
-					is_root = true;
+					joint_parents_[i] = iter->second;
 				}
 			}
+		}
+
+		std::vector<uint32_t> depths(joints_.size(), 0);
+		for (size_t i = 0; i < joints_.size(); ++ i)
+		{
+			for (int32_t parent = joint_parents_[i]; parent >= 0; parent = joint_parents_[parent])
+			{
+				++ depths[i];
+				BOOST_ASSERT(depths[i] <= joints_.size());
+			}
+		}
+
+		joint_eval_order_.resize(joints_.size());
+		for (uint32_t i = 0; i < joint_eval_order_.size(); ++ i)
+		{
+			joint_eval_order_[i] = i;
+		}
+		std::stable_sort(joint_eval_order_.begin(), joint_eval_order_.end(),
+			[&depths](uint32_t lhs, uint32_t rhs)
+			{
+				return depths[lhs] < depths[rhs];
+			});
+
+		key_frame_hints_.assign(joints_.size(), 0);
+	}
+
+	void SkinnedModel::EvaluateBones(float frame)
+	{
+		if (joint_parents_.size() != joints_.size())
+		{
+			this->UpdateJointHierarchy();
+		}
 
-			if (is_root)
+		for (uint32_t const i : joint_eval_order_)
+		{
+			auto& joint = *joints_[i];
+			KeyFrameSet const & kf = (*key_frame_sets_)[i];
+
+			std::tuple<Quaternion, Quaternion, float> key_dq = kf.Frame(frame, key_frame_hints_[i]);
+
+			int32_t const parent_index = joint_parents_[i];
+			if (parent_index < 0)
 			{
 				joint.BindParams(std::get<0>(key_dq), std::get<1>(key_dq), std::get<2>(key_dq));
 			}
 			else
 			{
-				auto const& parent = *parent_node->FirstComponentOfType<JointComponent>();
-
+				auto const& parent = *joints_[parent_index];
 				if (MathLib::dot(std::get<0>(key_dq), parent.BindReal()) < 0)
 				{
 					std::get<0>(key_dq) = -std::get<0>(key_dq);
@@ -795,10 +1052,16 @@ namespace KlayGE
 			}
 		}
 
-		this->UpdateBinds();
+		this->ComputeBinds();
 	}
 
 	void SkinnedModel::UpdateBinds()
+	{
+		this->ComputeBinds();
+		this->SetToEffect();
+	}
+
+	void SkinnedModel::ComputeBinds()
 	{
 		bind_reals_.resize(joints_.size());
 		bind_duals_.resize(joints_.size());
@@ -861,8 +1124,6 @@ namespace KlayGE
 			bind_reals_[i] = float4(bind_real.x(), bind_real.y(), bind_real.z(), bind_real.w()) * bind_scale;
 			bind_duals_[i] = float4(bind_dual.x(), bind_dual.y(), bind_dual.z(), bind_dual.w());
 		}
-
-		this->SetToEffect();
 	}
 
 	float SkinnedModel::GetFrame() const
@@ -880,6 +1141,68 @@ namespace KlayGE
 		}
 	}
 
+	void SkinnedModel::SetFrames(std::span<SkinnedModel* const> models, std::span<float const> frames)
+	{
+		BOOST_ASSERT(models.size() == frames.size());
+
+		std::vector<SkinnedModel*> dirty_models;
+		for (size_t i = 0; i < static_cast<size_t>(models.size()); ++ i)
+		{
+			if (models[i]->last_frame_ != frames[i])
+			{
+				models[i]->last_frame_ = frames[i];
+				dirty_models.push_back(models[i]);
+			}
+		}
+
+		// Only the bones are built in parallel, effects can be shared by models so they are updated on this thread.
+		uint32_t const MIN_MODELS_PER_TASK = 8;
+		Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(dirty_models.size()), MIN_MODELS_PER_TASK,
+			[&dirty_models](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; ++ i)
+				{
+					auto* model = dirty_models[i];
+					model->EvaluateBones(model->last_frame_);
+				}
+			});
+
+		for (auto* model : dirty_models)
+		{
+			model->SetToEffect();
+		}
+	}
+
+	void SkinnedModel::QueueFrame(float frame)
+	{
+		std::lock_guard<std::mutex> lock(queued_skinned_models_mutex);
+		queued_frame_ = frame;
+		if (!frame_queued_)
+		{
+			frame_queued_ = true;
+			queued_skinned_models.push_back(this);
+		}
+	}
+
+	void SkinnedModel::UpdateQueuedFrames()
+	{
+		std::lock_guard<std::mutex> lock(queued_skinned_models_mutex);
+		if (queued_skinned_models.empty())
+		{
+			return;
+		}
+
+		std::vector<float> frames(queued_skinned_models.size());
+		for (size_t i = 0; i < queued_skinned_models.size(); ++ i)
+		{
+			frames[i] = queued_skinned_models[i]->queued_frame_;
+			queued_skinned_models[i]->frame_queued_ = false;
+		}
+
+		SetFrames(queued_skinned_models, frames);
+		queued_skinned_models.clear();
+	}
+
 	void SkinnedModel::RebindJoints()
 	{
 		this->BuildBones(last_frame_);
@@ -1135,8 +1458,8 @@ namespace KlayGE
 		std::vector<RenderMaterialPtr> mtls;
 		std::vector<VertexElement> merged_ves;
 		char all_is_index_16_bit;
-		std::vector<std::vector<uint8_t>> merged_buff;
-		std::vector<uint8_t> merged_indices;
+		std::vector<std::span<uint8_t const>> merged_buff;
+		std::span<uint8_t const> merged_indices;
 		std::vector<std::string> mesh_names;
 		std::vector<int32_t> mtl_ids;
 		std::vector<uint32_t> mesh_lods;
@@ -1146,6 +1469,7 @@ namespace KlayGE
 		std::vector<uint32_t> mesh_base_vertices;
 		std::vector<uint32_t> mesh_num_indices;
 		std::vector<uint32_t> mesh_start_indices;
+		std::vector<float> mesh_lod_screen_sizes;
 		std::vector<NodeInfo> nodes;
 		std::vector<JointComponentPtr> joints;
 		std::shared_ptr<std::vector<Animation>> animations;
@@ -1154,30 +1478,131 @@ namespace KlayGE
 		uint32_t frame_rate = 0;
 		std::vector<std::shared_ptr<AABBKeyFrameSet>> frame_pos_bbs;
 
-		ResIdentifierPtr runtime_file = ResLoader::Instance().Open(runtime_name);
+		// Map the file if it's on the file system. Otherwise, e.g. it's in a package, read the whole file into memory.
+		MappedFile mapped_file;
+		std::vector<uint8_t> file_content;
+		std::span<uint8_t const> file_data;
+		if (mapped_file.Map(ResLoader::Instance().Locate(runtime_name)))
+		{
+			file_data = MakeSpan(mapped_file.Data(), static_cast<size_t>(mapped_file.Size()));
+		}
+		else
+		{
+			ResIdentifierPtr runtime_file = ResLoader::Instance().Open(runtime_name);
+			runtime_file->seekg(0, std::ios_base::end);
+			file_content.resize(static_cast<size_t>(runtime_file->tellg()));
+			runtime_file->seekg(0, std::ios_base::beg);
+			runtime_file->read(file_content.data(), file_content.size());
+			file_data = MakeSpan(file_content);
+		}
+
+		uint64_t const file_size = static_cast<uint64_t>(file_data.size());
+		if (file_size < 16)
+		{
+			TMSG("Truncated model_bin " + runtime_name);
+		}
 
 		uint32_t fourcc;
-		runtime_file->read(&fourcc, sizeof(fourcc));
+		std::memcpy(&fourcc, &file_data[0], sizeof(fourcc));
 		fourcc = LE2Native(fourcc);
 		BOOST_ASSERT((fourcc == MakeFourCC<'K', 'L', 'M', ' '>::value));
 
 		uint32_t ver;
-		runtime_file->read(&ver, sizeof(ver));
+		std::memcpy(&ver, &file_data[4], sizeof(ver));
 		ver = LE2Native(ver);
 		BOOST_ASSERT(MODEL_BIN_VERSION == ver);
 
-		std::shared_ptr<std::stringstream> ss = MakeSharedPtr<std::stringstream>();
+		uint32_t num_chunks;
+		std::memcpy(&num_chunks, &file_data[8], sizeof(num_chunks));
+		num_chunks = LE2Native(num_chunks);
+		if (num_chunks > (file_size - 16) / sizeof(ModelBinChunkDesc))
+		{
+			TMSG("Truncated model_bin " + runtime_name);
+		}
+
+		std::vector<ModelBinChunkDesc> chunk_descs(num_chunks);
+		std::memcpy(chunk_descs.data(), &file_data[16], chunk_descs.size() * sizeof(chunk_descs[0]));
+
+		// Uncompressed chunks are used in place, compressed ones are decoded in parallel
+		std::vector<std::vector<uint8_t>> decoded_chunks(num_chunks);
+		std::vector<uint32_t> compressed_chunks;
+		std::span<uint8_t const> meta_chunk;
+		for (uint32_t i = 0; i < num_chunks; ++ i)
+		{
+			auto& desc = chunk_descs[i];
+			desc.type = LE2Native(desc.type);
+			desc.compression = LE2Native(desc.compression);
+			desc.offset = LE2Native(desc.offset);
+			desc.size = LE2Native(desc.size);
+			desc.original_size = LE2Native(desc.original_size);
+
+			// A truncated or corrupted file must not make the chunks point outside of it
+			if ((desc.offset > file_size) || (desc.size > file_size - desc.offset))
+			{
+				TMSG("Truncated model_bin " + runtime_name);
+			}
+			if ((desc.compression != MBCC_None) && (desc.compression != MBCC_LZMA))
+			{
+				TMSG("Unknown chunk compression in model_bin " + runtime_name);
+			}
+			if ((desc.compression == MBCC_None) && (desc.original_size != desc.size))
+			{
+				TMSG("Corrupted model_bin " + runtime_name);
+			}
+
+			std::span<uint8_t const> chunk;
+			if (desc.compression == MBCC_LZMA)
+			{
+				decoded_chunks[i].resize(static_cast<size_t>(desc.original_size));
+				compressed_chunks.push_back(i);
+				chunk = MakeSpan(decoded_chunks[i]);
+			}
+			else
+			{
+				BOOST_ASSERT(desc.compression == MBCC_None);
+				chunk = file_data.subspan(static_cast<size_t>(desc.offset), static_cast<size_t>(desc.size));
+			}
+
+			switch (desc.type)
+			{
+			case MODEL_BIN_CHUNK_META:
+				meta_chunk = chunk;
+				break;
+
+			case MODEL_BIN_CHUNK_VERTICES:
+				merged_buff.push_back(chunk);
+				break;
 
-		uint64_t original_len, len;
-		runtime_file->read(&original_len, sizeof(original_len));
-		original_len = LE2Native(original_len);
-		runtime_file->read(&len, sizeof(len));
-		len = LE2Native(len);
+			case MODEL_BIN_CHUNK_INDICES:
+				merged_indices = chunk;
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		{
+			auto decode_chunk = [&chunk_descs, &decoded_chunks, file_data](uint32_t index)
+			{
+				auto const & desc = chunk_descs[index];
+				LZMACodec lzma;
+				lzma.Decode(decoded_chunks[index].data(),
+					file_data.subspan(static_cast<size_t>(desc.offset), static_cast<size_t>(desc.size)), desc.original_size);
+			};
 
-		LZMACodec lzma;
-		lzma.Decode(*ss, runtime_file, len, original_len);
+			Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(compressed_chunks.size()), 1,
+				[&decode_chunk, &compressed_chunks](uint32_t first, uint32_t last)
+				{
+					for (uint32_t i = first; i < last; ++ i)
+					{
+						decode_chunk(compressed_chunks[i]);
+					}
+				});
+		}
 
-		ResIdentifierPtr decoded = MakeSharedPtr<ResIdentifier>(runtime_file->ResName(), runtime_file->Timestamp(), ss);
+		auto meta_buff = MakeSharedPtr<MemInputStreamBuf>(meta_chunk.data(), static_cast<std::streamsize>(meta_chunk.size()));
+		ResIdentifierPtr decoded = MakeSharedPtr<ResIdentifier>(runtime_name, 0, MakeSharedPtr<std::istream>(meta_buff.get()), meta_buff);
 
 		uint32_t num_mtls;
 		decoded->read(&num_mtls, sizeof(num_mtls));
@@ -1322,14 +1747,16 @@ namespace KlayGE
 
 		int const index_elem_size = all_is_index_16_bit ? 2 : 4;
 
-		merged_buff.resize(merged_ves.size());
+		// The vertex and index streams are in their own chunks
+		BOOST_ASSERT(merged_buff.size() == merged_ves.size());
 		for (size_t i = 0; i < merged_buff.size(); ++ i)
 		{
-			merged_buff[i].resize(all_num_vertices * merged_ves[i].element_size());
-			decoded->read(&merged_buff[i][0], merged_buff[i].size() * sizeof(merged_buff[i][0]));
+			BOOST_ASSERT(static_cast<size_t>(merged_buff[i].size()) == all_num_vertices * merged_ves[i].element_size());
 		}
-		merged_indices.resize(all_num_indices * index_elem_size);
-		decoded->read(&merged_indices[0], merged_indices.size() * sizeof(merged_indices[0]));
+		BOOST_ASSERT(static_cast<size_t>(merged_indices.size()) == static_cast<size_t>(all_num_indices * index_elem_size));
+		KFL_UNUSED(all_num_vertices);
+		KFL_UNUSED(all_num_indices);
+		KFL_UNUSED(index_elem_size);
 
 		mesh_names.resize(num_meshes);
 		mtl_ids.resize(num_meshes);
@@ -1340,6 +1767,7 @@ namespace KlayGE
 		mesh_base_vertices.clear();
 		mesh_num_indices.clear();
 		mesh_start_indices.clear();
+		mesh_lod_screen_sizes.clear();
 		for (uint32_t mesh_index = 0; mesh_index < num_meshes; ++ mesh_index)
 		{
 			mesh_names[mesh_index] = ReadShortString(*decoded);
@@ -1384,6 +1812,9 @@ namespace KlayGE
 				mesh_num_indices.push_back(LE2Native(tmp));
 				decoded->read(&tmp, sizeof(tmp));
 				mesh_start_indices.push_back(LE2Native(tmp));
+				float screen_size;
+				decoded->read(&screen_size, sizeof(screen_size));
+				mesh_lod_screen_sizes.push_back(LE2Native(screen_size));
 			}
 		}
 
@@ -1651,6 +2082,7 @@ namespace KlayGE
 				mesh->NumIndices(lod, mesh_num_indices[mesh_lod_index]);
 				mesh->StartVertexLocation(lod, mesh_base_vertices[mesh_lod_index]);
 				mesh->StartIndexLocation(lod, mesh_start_indices[mesh_lod_index]);
+				mesh->LodScreenSize(lod, mesh_lod_screen_sizes[mesh_lod_index]);
 			}
 		}
 
@@ -1777,9 +2209,8 @@ namespace KlayGE
 		std::vector<AABBox> const & pos_bbs, std::vector<AABBox> const & tc_bbs,
 		std::vector<uint32_t> const & mesh_num_vertices, std::vector<uint32_t> const & mesh_base_vertices,
 		std::vector<uint32_t> const & mesh_num_indices, std::vector<uint32_t> const & mesh_start_indices,
-		std::vector<VertexElement> const & merged_ves,
-		std::vector<std::vector<uint8_t>> const & merged_vertices, std::vector<uint8_t> const & merged_indices,
-		char is_index_16_bit, std::ostream& os)
+		std::vector<float> const & mesh_lod_screen_sizes,
+		std::vector<VertexElement> const & merged_ves, char is_index_16_bit, std::ostream& os)
 	{
 		uint32_t num_merged_ves = Native2LE(static_cast<uint32_t>(merged_ves.size()));
 		os.write(reinterpret_cast<char*>(&num_merged_ves), sizeof(num_merged_ves));
@@ -1797,12 +2228,6 @@ namespace KlayGE
 		os.write(reinterpret_cast<char*>(&num_indices), sizeof(num_indices));
 		os.write(&is_index_16_bit, sizeof(is_index_16_bit));
 
-		for (size_t i = 0; i < merged_vertices.size(); ++ i)
-		{
-			os.write(reinterpret_cast<char const *>(&merged_vertices[i][0]), merged_vertices[i].size() * sizeof(merged_vertices[i][0]));
-		}
-		os.write(reinterpret_cast<char const *>(&merged_indices[0]), merged_indices.size() * sizeof(merged_indices[0]));
-
 		uint32_t mesh_lod_index = 0;
 		for (uint32_t mesh_index = 0; mesh_index < mesh_names.size(); ++ mesh_index)
 		{
@@ -1844,6 +2269,8 @@ namespace KlayGE
 				os.write(reinterpret_cast<char*>(&ni), sizeof(ni));
 				uint32_t si = Native2LE(mesh_start_indices[mesh_lod_index]);
 				os.write(reinterpret_cast<char*>(&si), sizeof(si));
+				float screen_size = Native2LE(mesh_lod_screen_sizes[mesh_lod_index]);
+				os.write(reinterpret_cast<char*>(&screen_size), sizeof(screen_size));
 			}
 		}
 	}
@@ -2060,6 +2487,7 @@ namespace KlayGE
 		std::vector<AABBox> const & pos_bbs, std::vector<AABBox> const & tc_bbs,
 		std::vector<uint32_t> const & mesh_num_vertices, std::vector<uint32_t> const & mesh_base_vertices,
 		std::vector<uint32_t> const & mesh_num_indices, std::vector<uint32_t> const & mesh_base_indices,
+		std::vector<float> const & mesh_lod_screen_sizes,
 		std::vector<SceneNode const *> const & nodes, std::vector<Renderable const *> const & renderables,
 		std::vector<JointComponent const*> const & joints, std::shared_ptr<std::vector<Animation>> const & animations,
 		std::shared_ptr<std::vector<KeyFrameSet>> const & kfs, uint32_t num_frames, uint32_t frame_rate,
@@ -2095,8 +2523,8 @@ namespace KlayGE
 		if (!mesh_names.empty())
 		{
 			WriteMeshesChunk(mesh_names, mtl_ids, mesh_lods, pos_bbs, tc_bbs,
-				mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices,
-				merged_ves, merged_buffs, merged_indices, all_is_index_16_bit, ss);
+				mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices, mesh_lod_screen_sizes,
+				merged_ves, all_is_index_16_bit, ss);
 		}
 
 		if (!nodes.empty())
@@ -2118,6 +2546,46 @@ namespace KlayGE
 			WriteAnimationsChunk(*animations, ss);
 		}
 
+		// The metadata are small and parsed field by field, so they are compressed. The vertex and index streams are
+		// stored as is, to be handed to buffer creation directly from a mapped file.
+		auto const & ss_str = ss.str();
+		std::vector<std::tuple<uint32_t, ModelBinChunkCompression, std::span<uint8_t const>>> chunks;
+		chunks.emplace_back(MODEL_BIN_CHUNK_META, MBCC_LZMA,
+			MakeSpan(reinterpret_cast<uint8_t const *>(ss_str.data()), ss_str.size()));
+		if (!mesh_names.empty())
+		{
+			for (auto const & buff : merged_buffs)
+			{
+				chunks.emplace_back(MODEL_BIN_CHUNK_VERTICES, MBCC_None, MakeSpan(buff));
+			}
+			chunks.emplace_back(MODEL_BIN_CHUNK_INDICES, MBCC_None, MakeSpan(merged_indices));
+		}
+
+		std::vector<ModelBinChunkDesc> chunk_descs(chunks.size());
+		std::vector<std::vector<uint8_t>> compressed_chunks(chunks.size());
+		uint64_t offset = 16 + chunk_descs.size() * sizeof(chunk_descs[0]);
+		for (size_t i = 0; i < chunks.size(); ++ i)
+		{
+			auto& desc = chunk_descs[i];
+			desc.type = std::get<0>(chunks[i]);
+			desc.compression = std::get<1>(chunks[i]);
+			desc.original_size = std::get<2>(chunks[i]).size();
+			if (desc.compression == MBCC_LZMA)
+			{
+				LZMACodec lzma;
+				lzma.Encode(compressed_chunks[i], std::get<2>(chunks[i]));
+				desc.size = compressed_chunks[i].size();
+			}
+			else
+			{
+				desc.size = desc.original_size;
+			}
+
+			offset = (offset + MODEL_BIN_CHUNK_ALIGNMENT - 1) & ~static_cast<uint64_t>(MODEL_BIN_CHUNK_ALIGNMENT - 1);
+			desc.offset = offset;
+			offset += desc.size;
+		}
+
 		std::ofstream ofs(jit_name.c_str(), std::ios_base::binary);
 		BOOST_ASSERT(ofs);
 		uint32_t fourcc = Native2LE(MakeFourCC<'K', 'L', 'M', ' '>::value);
@@ -2126,23 +2594,36 @@ namespace KlayGE
 		uint32_t ver = Native2LE(MODEL_BIN_VERSION);
 		ofs.write(reinterpret_cast<char*>(&ver), sizeof(ver));
 
-		auto const & ss_str = ss.str();
-		uint64_t original_len = Native2LE(static_cast<uint64_t>(ss_str.size()));
-		ofs.write(reinterpret_cast<char*>(&original_len), sizeof(original_len));
+		uint32_t num_chunks = Native2LE(static_cast<uint32_t>(chunk_descs.size()));
+		ofs.write(reinterpret_cast<char*>(&num_chunks), sizeof(num_chunks));
+
+		uint32_t reserved = 0;
+		ofs.write(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+
+		for (auto const & desc : chunk_descs)
+		{
+			ModelBinChunkDesc le_desc;
+			le_desc.type = Native2LE(desc.type);
+			le_desc.compression = Native2LE(desc.compression);
+			le_desc.offset = Native2LE(desc.offset);
+			le_desc.size = Native2LE(desc.size);
+			le_desc.original_size = Native2LE(desc.original_size);
+			ofs.write(reinterpret_cast<char*>(&le_desc), sizeof(le_desc));
+		}
 
-		std::ofstream::pos_type p = ofs.tellp();
-		uint64_t len = 0;
-		ofs.write(reinterpret_cast<char*>(&len), sizeof(len));
+		for (size_t i = 0; i < chunks.size(); ++ i)
+		{
+			auto const & desc = chunk_descs[i];
 
-		LZMACodec lzma;
-		len = lzma.Encode(ofs, MakeSpan(reinterpret_cast<uint8_t const *>(ss_str.c_str()), ss_str.size()));
+			char const padding[MODEL_BIN_CHUNK_ALIGNMENT] = {};
+			ofs.write(padding, static_cast<std::streamsize>(desc.offset - static_cast<uint64_t>(ofs.tellp())));
 
-		ofs.seekp(p, std::ios_base::beg);
-		len = Native2LE(len);
-		ofs.write(reinterpret_cast<char*>(&len), sizeof(len));
+			std::span<uint8_t const> data = (desc.compression == MBCC_LZMA) ? std::span<uint8_t const>(compressed_chunks[i]) : std::get<2>(chunks[i]);
+			ofs.write(reinterpret_cast<char const *>(data.data()), static_cast<std::streamsize>(data.size()));
+		}
 	}
 
-	void SaveModel(RenderModel const & model, std::string_view model_name)
+	void SaveModel(RenderModel const & model, std::string_view model_name, bool quantize_vertices)
 	{
 		std::filesystem::path output_path(model_name.begin(), model_name.end());
 		auto const output_ext = output_path.extension().string();
@@ -2175,6 +2656,7 @@ namespace KlayGE
 		std::vector<uint32_t> mesh_base_vertices;
 		std::vector<uint32_t> mesh_num_indices;
 		std::vector<uint32_t> mesh_base_indices;
+		std::vector<float> mesh_lod_screen_sizes;
 		if (!mesh_names.empty())
 		{
 			{
@@ -2260,6 +2742,7 @@ namespace KlayGE
 					mesh_base_vertices.push_back(mesh.StartVertexLocation(lod));
 					mesh_num_indices.push_back(mesh.NumIndices(lod));
 					mesh_base_indices.push_back(mesh.StartIndexLocation(lod));
+					mesh_lod_screen_sizes.push_back(mesh.LodScreenSize(lod));
 				}
 			}
 
@@ -2312,9 +2795,14 @@ namespace KlayGE
 			}
 		}
 
+		if (quantize_vertices && !mesh_names.empty())
+		{
+			QuantizeVertexStreams(merged_ves, merged_buffs, mesh_lods, pos_bbs, tc_bbs, mesh_num_vertices, mesh_base_vertices);
+		}
+
 		SaveModel(output_path.string(), mtls, merged_ves, all_is_index_16_bit, merged_buffs, merged_indices,
 			mesh_names, mtl_ids, mesh_lods, pos_bbs, tc_bbs,
-			mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices,
+			mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices, mesh_lod_screen_sizes,
 			nodes, renderables,
 			joints, animations, kfs, num_frame, frame_rate, frame_pos_bbs);
 
@@ -45,6 +45,8 @@
 #include <KFL/XMLDom.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/RadixSort.hpp>
+#include <KFL/TaskScheduler.hpp>
 
 #include <fstream>
 #include <string>
@@ -56,6 +58,63 @@ namespace
 	using namespace KlayGE;
 
 	uint32_t const NUM_PARTICLES = 4096;
+	uint32_t const PARTICLES_PER_BATCH = 2048;
+
+	// Calls func(batch_index, first, num) on batches of PARTICLES_PER_BATCH particles in [0, num_particles), in parallel
+	// on the task scheduler.
+	template <typename Func>
+	void ForEachParticleBatch(uint32_t num_particles, Func const & func)
+	{
+		uint32_t const num_batches = (num_particles + PARTICLES_PER_BATCH - 1) / PARTICLES_PER_BATCH;
+		Context::Instance().TaskScheduler().parallel_for(0, num_batches, 1,
+			[num_particles, &func](uint32_t first_batch, uint32_t last_batch)
+			{
+				for (uint32_t batch = first_batch; batch < last_batch; ++ batch)
+				{
+					uint32_t const first = batch * PARTICLES_PER_BATCH;
+					func(batch, first, std::min(PARTICLES_PER_BATCH, num_particles - first));
+				}
+			});
+	}
+
+	float EvalPolyline(std::vector<float2> const & polyline, float pos)
+	{
+		float ret = polyline.back().y();
+		for (auto iter = std::next(polyline.begin()); iter != polyline.end(); ++ iter)
+		{
+			if (iter->x() >= pos)
+			{
+				float2 const & prev = *std::prev(iter);
+				float const s = (pos - prev.x()) / (iter->x() - prev.x());
+				ret = MathLib::lerp(prev.y(), iter->y(), s);
+				break;
+			}
+		}
+		return ret;
+	}
+
+	template <size_t N>
+	void BakePolyline(std::array<float, N>& lut, std::vector<float2> const & polyline)
+	{
+		if (polyline.empty())
+		{
+			lut.fill(0);
+			return;
+		}
+
+		for (size_t i = 0; i < N; ++ i)
+		{
+			lut[i] = EvalPolyline(polyline, static_cast<float>(i) / (N - 1));
+		}
+	}
+
+	template <size_t N>
+	float LookupPolyline(std::array<float, N> const & lut, float pos)
+	{
+		float const t = MathLib::clamp(pos, 0.0f, 1.0f) * (N - 1);
+		uint32_t const index = std::min(static_cast<uint32_t>(t), static_cast<uint32_t>(N - 2));
+		return MathLib::lerp(lut[index], lut[index + 1], t - index);
+	}
 
 	class ParticleSystemLoadingDesc : public ResLoadingDesc
 	{
@@ -341,6 +400,14 @@ namespace
 			return true;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashRange(seed, ps_desc_.res_name.begin(), ps_desc_.res_name.end());
+			return seed;
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -592,6 +659,16 @@ namespace KlayGE
 
 	ParticleUpdater::~ParticleUpdater() noexcept = default;
 
+	void ParticleUpdater::Update(ParticleBatch const & particles, float elapse_time)
+	{
+		for (uint32_t i = 0; i < particles.num; ++ i)
+		{
+			Particle par = particles.Get(i);
+			this->Update(par, elapse_time);
+			particles.Set(i, par);
+		}
+	}
+
 	void ParticleUpdater::DoClone(ParticleUpdaterPtr const & rhs)
 	{
 		rhs->ps_ = ps_;
@@ -600,10 +677,14 @@ namespace KlayGE
 
 	ParticleSystem::ParticleSystem(uint32_t max_num_particles, bool sort_particles)
 		: root_node_(MakeSharedPtr<SceneNode>(L"ParticleSystemRootNode", SceneNode::SOA_Moveable | SceneNode::SOA_NotCastShadow)),
-			particles_(max_num_particles),
+			max_num_particles_(max_num_particles),
 			gravity_(0.5f), force_(0, 0, 0), media_density_(0.0f),
 			sort_particles_(sort_particles)
 	{
+		for (auto& stream : particle_streams_)
+		{
+			stream.resize(max_num_particles_);
+		}
 		this->ClearParticles();
 
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
@@ -751,105 +832,236 @@ namespace KlayGE
 		return actived_particles_[i].first;
 	}
 
+	Particle const & ParticleSystem::GetParticle(uint32_t i) const
+	{
+		BOOST_ASSERT(i < max_num_particles_);
+
+		// Readers on different threads gather at most once, and not while an update rewrites the streams
+		std::lock_guard<std::mutex> lock(actived_particles_mutex_);
+		if (!particles_gathered_)
+		{
+			this->GatherParticles();
+		}
+		return particles_[i];
+	}
+
+	Particle& ParticleSystem::GetParticle(uint32_t i)
+	{
+		BOOST_ASSERT(i < max_num_particles_);
+
+		std::lock_guard<std::mutex> lock(actived_particles_mutex_);
+		if (!particles_gathered_)
+		{
+			this->GatherParticles();
+		}
+		particles_written_ = true;
+		return particles_[i];
+	}
+
 	void ParticleSystem::ClearParticles()
 	{
-		for (auto& particle : particles_)
+		std::lock_guard<std::mutex> lock(actived_particles_mutex_);
+		num_alive_particles_ = 0;
+		particles_gathered_ = false;
+		particles_written_ = false;
+	}
+
+	void ParticleSystem::GatherParticles() const
+	{
+		particles_.resize(max_num_particles_);
+		for (uint32_t i = 0; i < num_alive_particles_; ++ i)
 		{
-			particle.life = 0;
+			Particle& par = particles_[i];
+			par.pos = float3(particle_streams_[PS_PosX][i], particle_streams_[PS_PosY][i], particle_streams_[PS_PosZ][i]);
+			par.vel = float3(particle_streams_[PS_VelX][i], particle_streams_[PS_VelY][i], particle_streams_[PS_VelZ][i]);
+			par.life = particle_streams_[PS_Life][i];
+			par.spin = particle_streams_[PS_Spin][i];
+			par.size = particle_streams_[PS_Size][i];
+			par.alpha = particle_streams_[PS_Alpha][i];
+			par.init_life = particle_streams_[PS_InitLife][i];
 		}
+		// Particles after the alive ones are dead
+		std::fill(particles_.begin() + num_alive_particles_, particles_.end(), Particle{});
+
+		particles_gathered_ = true;
 	}
 
-	void ParticleSystem::UpdateParticlesNoLock(float elapsed_time)
+	void ParticleSystem::ScatterParticles()
 	{
-		auto emitter_iter = emitters_.begin();
-		uint32_t new_particle = (*emitter_iter)->Update(elapsed_time);
+		BOOST_ASSERT(particles_gathered_);
 
-		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
-		auto const& camera = *re.DefaultFrameBuffer()->Viewport()->Camera();
-		float4x4 const& view_mat = camera.ViewMatrix();
+		// Particles killed or revived through GetParticle leave or join the alive ones, which stay packed in their order
+		ParticleBatch const batch = this->MakeBatch(0, max_num_particles_);
+		uint32_t num_alive = 0;
+		for (uint32_t i = 0; i < max_num_particles_; ++ i)
+		{
+			if (particles_[i].life > 0)
+			{
+				batch.Set(num_alive, particles_[i]);
+				++ num_alive;
+			}
+		}
+		num_alive_particles_ = num_alive;
 
-		actived_particles_.clear();
+		particles_written_ = false;
+	}
 
-		float3 min_bb(+1e10f, +1e10f, +1e10f);
-		float3 max_bb(-1e10f, -1e10f, -1e10f);
+	ParticleBatch ParticleSystem::MakeBatch(uint32_t first, uint32_t num)
+	{
+		BOOST_ASSERT(first + num <= max_num_particles_);
+
+		ParticleBatch batch;
+		batch.pos_x = &particle_streams_[PS_PosX][first];
+		batch.pos_y = &particle_streams_[PS_PosY][first];
+		batch.pos_z = &particle_streams_[PS_PosZ][first];
+		batch.vel_x = &particle_streams_[PS_VelX][first];
+		batch.vel_y = &particle_streams_[PS_VelY][first];
+		batch.vel_z = &particle_streams_[PS_VelZ][first];
+		batch.life = &particle_streams_[PS_Life][first];
+		batch.spin = &particle_streams_[PS_Spin][first];
+		batch.size = &particle_streams_[PS_Size][first];
+		batch.alpha = &particle_streams_[PS_Alpha][first];
+		batch.init_life = &particle_streams_[PS_InitLife][first];
+		batch.num = num;
+		return batch;
+	}
 
-		for (auto const & updater : updaters_)
+	void ParticleSystem::CopyParticle(uint32_t dst, uint32_t src)
+	{
+		for (auto& stream : particle_streams_)
 		{
-			updater->SnapParams();
+			stream[dst] = stream[src];
 		}
+	}
 
-		for (uint32_t i = 0; i < particles_.size(); ++ i)
+	void ParticleSystem::UpdateParticlesNoLock(float elapsed_time)
+	{
+		if (particles_written_)
+		{
+			this->ScatterParticles();
+		}
+		particles_gathered_ = false;
+
+		bool concurrent_batches = true;
+		for (auto const & updater : updaters_)
 		{
-			Particle& particle = particles_[i];
+			updater->SnapParams();
+			concurrent_batches &= updater->ConcurrentBatches();
+		}
 
-			if (particle.life > 0)
+		auto update_batch = [this, elapsed_time](uint32_t batch_index, uint32_t first, uint32_t num)
 			{
+				KFL_UNUSED(batch_index);
+
+				ParticleBatch const batch = this->MakeBatch(first, num);
 				for (auto const & updater : updaters_)
 				{
-					updater->Update(particle, elapsed_time);
+					updater->Update(batch, elapsed_time);
 				}
-			}
-			else
+			};
+		if (concurrent_batches)
+		{
+			ForEachParticleBatch(num_alive_particles_, update_batch);
+		}
+		else if (num_alive_particles_ > 0)
+		{
+			update_batch(0, 0, num_alive_particles_);
+		}
+
+		// Keeps alive particles packed at the front, in their original order
+		float const * life = particle_streams_[PS_Life].data();
+		uint32_t num_alive = 0;
+		for (uint32_t i = 0; i < num_alive_particles_; ++ i)
+		{
+			if (life[i] > 0)
 			{
-				if (new_particle > 0)
+				if (num_alive != i)
 				{
-					(*emitter_iter)->Emit(particle);
-					for (auto const & updater : updaters_)
-					{
-						updater->Update(particle, 0);
-					}
-					-- new_particle;
+					this->CopyParticle(num_alive, i);
 				}
-				else
+				++ num_alive;
+			}
+		}
+
+		uint32_t const first_new = num_alive;
+		for (auto const & emitter : emitters_)
+		{
+			uint32_t const num_new = std::min(emitter->Update(elapsed_time), max_num_particles_ - num_alive);
+			if (num_new > 0)
+			{
+				ParticleBatch const batch = this->MakeBatch(num_alive, num_new);
+				for (uint32_t i = 0; i < num_new; ++ i)
 				{
-					if (emitter_iter != emitters_.end())
-					{
-						++ emitter_iter;
-						if (emitter_iter != emitters_.end())
-						{
-							new_particle = (*emitter_iter)->Update(elapsed_time);
-						}
-					}
+					Particle par{};
+					emitter->Emit(par);
+					batch.Set(i, par);
 				}
+				num_alive += num_new;
+			}
+		}
+		if (num_alive > first_new)
+		{
+			ParticleBatch const batch = this->MakeBatch(first_new, num_alive - first_new);
+			for (auto const & updater : updaters_)
+			{
+				updater->Update(batch, 0);
 			}
+		}
+		num_alive_particles_ = num_alive;
 
-			if (particle.life > 0)
+		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		auto const& camera = *re.DefaultFrameBuffer()->Viewport()->Camera();
+		float4x4 const& view_mat = camera.ViewMatrix();
+		float4 const z_row = view_mat.Col(2);
+		float4 const w_row = view_mat.Col(3);
+
+		actived_particles_.resize(num_alive_particles_);
+		batch_bounds_.resize((num_alive_particles_ + PARTICLES_PER_BATCH - 1) / PARTICLES_PER_BATCH);
+		ForEachParticleBatch(num_alive_particles_, [this, &z_row, &w_row](uint32_t batch_index, uint32_t first, uint32_t num)
 			{
-				float3 const & pos = particle.pos;
+				ParticleBatch const batch = this->MakeBatch(first, num);
 
-				float depth_es;
-				if (sort_particles_)
+				float3 min_bb(+1e10f, +1e10f, +1e10f);
+				float3 max_bb(-1e10f, -1e10f, -1e10f);
+				for (uint32_t i = 0; i < num; ++ i)
 				{
-					float4 const pos4(pos.x(), pos.y(), pos.z(), 1);
-					float4 const z_row = view_mat.Col(2);
-					float4 const w_row = view_mat.Col(3);
+					float3 const pos(batch.pos_x[i], batch.pos_y[i], batch.pos_z[i]);
 
-					depth_es = MathLib::dot(pos4, z_row) / MathLib::dot(pos4, w_row);
-				}
-				else
-				{
-					depth_es = 0;
-				}
+					float depth_es;
+					if (sort_particles_)
+					{
+						float4 const pos4(pos.x(), pos.y(), pos.z(), 1);
+						depth_es = MathLib::dot(pos4, z_row) / MathLib::dot(pos4, w_row);
+					}
+					else
+					{
+						depth_es = 0;
+					}
 
-				actived_particles_.emplace_back(i, depth_es);
+					actived_particles_[first + i] = std::make_pair(first + i, depth_es);
 
-				min_bb = MathLib::minimize(min_bb, pos);
-				max_bb = MathLib::maximize(min_bb, pos);
-			}
-		}
+					min_bb = MathLib::minimize(min_bb, pos);
+					max_bb = MathLib::maximize(max_bb, pos);
+				}
+
+				batch_bounds_[batch_index] = AABBox(min_bb, max_bb);
+			});
 
 		if (!actived_particles_.empty())
 		{
 			if (sort_particles_)
 			{
-				std::sort(actived_particles_.begin(), actived_particles_.end(),
-					[](std::pair<uint32_t, float> const & lhs, std::pair<uint32_t, float> const & rhs)
-					{
-						return lhs.second > rhs.second;
-					});
+				// Back to front
+				RadixSort(actived_particles_, actived_particles_scratch_,
+					[](std::pair<uint32_t, float> const & particle) { return ~OrderedFloatBits(particle.second); });
 			}
 
-			checked_cast<RenderParticles&>(*render_particles_).PosBound(AABBox(min_bb, max_bb));
+			AABBox pos_bound = batch_bounds_[0];
+			for (size_t i = 1; i < batch_bounds_.size(); ++ i)
+			{
+				pos_bound |= batch_bounds_[i];
+			}
+			checked_cast<RenderParticles&>(*render_particles_).PosBound(pos_bound);
 		}
 	}
 
@@ -902,15 +1114,16 @@ namespace KlayGE
 			{
 				GraphicsBuffer::Mapper mapper(*instance_gb, BA_Write_Only);
 				ParticleInstance* instance_data = mapper.Pointer<ParticleInstance>();
+				ParticleBatch const batch = this->MakeBatch(0, num_alive_particles_);
 				for (uint32_t i = 0; i < num_active_particles; ++ i, ++ instance_data)
 				{
-					Particle const & par = particles_[actived_particles_[i].first];
-					instance_data->pos = par.pos;
-					instance_data->life = par.life;
-					instance_data->spin = par.spin;
-					instance_data->size = par.size;
-					instance_data->life_factor = (par.init_life - par.life) / par.init_life;
-					instance_data->alpha = par.alpha;
+					uint32_t const index = actived_particles_[i].first;
+					instance_data->pos = float3(batch.pos_x[index], batch.pos_y[index], batch.pos_z[index]);
+					instance_data->life = batch.life[index];
+					instance_data->spin = batch.spin[index];
+					instance_data->size = batch.size[index];
+					instance_data->life_factor = (batch.init_life[index] - batch.life[index]) / batch.init_life[index];
+					instance_data->alpha = batch.alpha[index];
 				}
 			}
 		}
@@ -1170,41 +1383,9 @@ namespace KlayGE
 
 		float pos = (par.init_life - par.life) / par.init_life;
 
-		float cur_size = this_frame_size_over_life_.back().y();
-		for (auto iter = std::next(this_frame_size_over_life_.begin()); iter != this_frame_size_over_life_.end(); ++ iter)
-		{
-			if (iter->x() >= pos)
-			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_size = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
-			}
-		}
-
-		float cur_mass = this_frame_mass_over_life_.back().y();
-		for (auto iter = std::next(this_frame_mass_over_life_.begin()); iter != this_frame_mass_over_life_.end(); ++ iter)
-		{
-			if (iter->x() >= pos)
-			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_mass = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
-			}
-		}
-
-		float cur_alpha = this_frame_opacity_over_life_.back().y();
-		for (auto iter = std::next(this_frame_opacity_over_life_.begin()); iter != this_frame_opacity_over_life_.end(); ++ iter)
-		{
-			if (iter->x() >= pos)
-			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_alpha = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
-			}
-		}
+		float cur_size = EvalPolyline(this_frame_size_over_life_, pos);
+		float cur_mass = EvalPolyline(this_frame_mass_over_life_, pos);
+		float cur_alpha = EvalPolyline(this_frame_opacity_over_life_, pos);
 
 		ParticleSystemPtr ps = ps_.lock();
 		float buoyancy = 4.0f / 3 * PI * MathLib::cube(cur_size) * ps->MediaDensity() * ps->Gravity();
@@ -1217,6 +1398,41 @@ namespace KlayGE
 		par.alpha = cur_alpha;
 	}
 
+	void PolylineParticleUpdater::Update(ParticleBatch const & particles, float elapse_time)
+	{
+		BOOST_ASSERT(!this_frame_size_over_life_.empty());
+		BOOST_ASSERT(!this_frame_mass_over_life_.empty());
+		BOOST_ASSERT(!this_frame_opacity_over_life_.empty());
+
+		ParticleSystemPtr ps = ps_.lock();
+		float const gravity = ps->Gravity();
+		float const buoyancy_factor = 4.0f / 3 * PI * ps->MediaDensity() * gravity;
+		float3 const force = ps->Force();
+
+		// Branch-free loop over the streams, the curves are read from the LUTs baked in SnapParams
+		for (uint32_t i = 0; i < particles.num; ++ i)
+		{
+			float const pos = (particles.init_life[i] - particles.life[i]) / particles.init_life[i];
+
+			float const cur_size = LookupPolyline(size_lut_, pos);
+			float const cur_mass = LookupPolyline(mass_lut_, pos);
+			float const cur_alpha = LookupPolyline(opacity_lut_, pos);
+
+			float const buoyancy = buoyancy_factor * MathLib::cube(cur_size);
+			float const inv_mass = 1 / cur_mass;
+			particles.vel_x[i] += force.x() * inv_mass * elapse_time;
+			particles.vel_y[i] += ((force.y() + buoyancy) * inv_mass - gravity) * elapse_time;
+			particles.vel_z[i] += force.z() * inv_mass * elapse_time;
+			particles.pos_x[i] += particles.vel_x[i] * elapse_time;
+			particles.pos_y[i] += particles.vel_y[i] * elapse_time;
+			particles.pos_z[i] += particles.vel_z[i] * elapse_time;
+			particles.life[i] -= elapse_time;
+			particles.spin[i] += 0.001f;
+			particles.size[i] = cur_size;
+			particles.alpha[i] = cur_alpha;
+		}
+	}
+
 	void PolylineParticleUpdater::SnapParams()
 	{
 		std::lock_guard<std::mutex> lock(update_mutex_);
@@ -1224,5 +1440,9 @@ namespace KlayGE
 		this_frame_size_over_life_ = size_over_life_;
 		this_frame_mass_over_life_ = mass_over_life_;
 		this_frame_opacity_over_life_ = opacity_over_life_;
+
+		BakePolyline(size_lut_, this_frame_size_over_life_);
+		BakePolyline(mass_lut_, this_frame_mass_over_life_);
+		BakePolyline(opacity_lut_, this_frame_opacity_over_life_);
 	}
 }
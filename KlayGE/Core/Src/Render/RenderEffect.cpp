@@ -58,8 +58,11 @@
 #include <KlayGE/RenderView.hpp>
 #include <KlayGE/ShaderObject.hpp>
 #include <KlayGE/Texture.hpp>
+#include <KlayGE/TransientBuffer.hpp>
+#include <KlayGE/App3D.hpp>
 #include <KFL/XMLDom.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/TaskScheduler.hpp>
 #include <KFL/CXX17/filesystem.hpp>
 
 #include <fstream>
@@ -558,7 +561,7 @@ namespace
 				if (val_in_cbuff != value)
 				{
 					val_in_cbuff = value;
-					cbuff->Dirty(true);
+					cbuff->DirtyRange(cbuff_desc.offset, static_cast<uint32_t>(sizeof(T)));
 				}
 			}
 			else
@@ -1854,7 +1857,7 @@ namespace
 					dst += cbuff_desc.stride;
 				}
 
-				this->CBuffer()->Dirty(true);
+				this->CBuffer()->DirtyRange(cbuff_desc.offset, size_ * cbuff_desc.stride);
 			}
 			else
 			{
@@ -1984,7 +1987,7 @@ namespace
 					dst += cbuff_desc.stride;
 				}
 
-				this->CBuffer()->Dirty(true);
+				this->CBuffer()->DirtyRange(cbuff_desc.offset, size_ * cbuff_desc.stride);
 			}
 			else
 			{
@@ -3267,7 +3270,7 @@ namespace
 					++dst;
 				}
 
-				this->CBuffer()->Dirty(true);
+				this->CBuffer()->DirtyRange(cbuff_desc.offset, size_ * static_cast<uint32_t>(sizeof(float4x4)));
 			}
 			else
 			{
@@ -4179,6 +4182,17 @@ namespace KlayGE
 			return true;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			for (auto const & name : effect_desc_.res_name)
+			{
+				HashRange(seed, name.begin(), name.end());
+			}
+			return seed;
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -5102,11 +5116,19 @@ namespace KlayGE
 	{
 		if (need_compile_)
 		{
-			uint32_t tech_index = 0;
-			for (auto const& tech : techniques_)
+			// Each shader stage object is compiled only by the pass that owns it, but other passes can share it through
+			//  tech_pass_type. A domain shader reads the tessellation parameters of the hull shader in its pass, which could
+			//  be owned by another pass, so all hull shaders are compiled before any other stage.
+			for (bool const hull_stages : {true, false})
 			{
-				tech->CompileShaders(effect, tech_index);
-				++tech_index;
+				Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(techniques_.size()), 1,
+					[this, &effect, hull_stages](uint32_t begin, uint32_t end)
+					{
+						for (uint32_t tech_index = begin; tech_index < end; ++tech_index)
+						{
+							techniques_[tech_index]->CompileShaders(effect, tech_index, hull_stages);
+						}
+					});
 			}
 
 			std::ofstream ofs(kfx_name_.c_str(), std::ios_base::binary | std::ios_base::out);
@@ -5921,6 +5943,8 @@ namespace KlayGE
 			{
 				annotations_ = parent_tech->annotations_;
 			}
+
+			this->UpdateAutoInstancing();
 		}
 
 		{
@@ -6045,14 +6069,16 @@ namespace KlayGE
 		}
 	}
 
-	void RenderTechnique::CompileShaders(RenderEffect& effect, uint32_t tech_index)
+	void RenderTechnique::CompileShaders(RenderEffect& effect, uint32_t tech_index, bool hull_stages)
 	{
-		uint32_t pass_index = 0;
-		for (auto& pass : passes_)
-		{
-			pass->CompileShaders(effect, tech_index, pass_index);
-			++pass_index;
-		}
+		Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(passes_.size()), 1,
+			[this, &effect, tech_index, hull_stages](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t pass_index = begin; pass_index < end; ++pass_index)
+				{
+					passes_[pass_index]->CompileShaders(effect, tech_index, pass_index, hull_stages);
+				}
+			});
 	}
 #endif
 
@@ -6100,6 +6126,7 @@ namespace KlayGE
 				annotation->StreamIn(effect, res);
 			}
 		}
+		this->UpdateAutoInstancing();
 
 		uint8_t num_macro;
 		res.read(&num_macro, sizeof(num_macro));
@@ -6186,6 +6213,21 @@ namespace KlayGE
 	}
 #endif
 
+	void RenderTechnique::UpdateAutoInstancing()
+	{
+		auto_instancing_ = false;
+		if (annotations_)
+		{
+			for (auto const & annotation : *annotations_)
+			{
+				if ((annotation->Type() == REDT_bool) && (annotation->Name() == "auto_instancing"))
+				{
+					annotation->Value(auto_instancing_);
+				}
+			}
+		}
+	}
+
 	bool RenderTechnique::HWResourceReady(RenderEffect const& effect) const
 	{
 		bool hw_res_ready = true;
@@ -6752,15 +6794,20 @@ namespace KlayGE
 		}
 	}
 
-	void RenderPass::CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index)
+	void RenderPass::CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, bool hull_stages)
 	{
 		auto const & shader_obj = this->GetShaderObject(effect);
 		for (uint32_t stage_index = 0; stage_index < NumShaderStages; ++stage_index)
 		{
+			ShaderStage const stage = static_cast<ShaderStage>(stage_index);
+			if ((stage == ShaderStage::Hull) != hull_stages)
+			{
+				continue;
+			}
+
 			ShaderDesc const& sd = effect.GetShaderDesc(shader_desc_ids_[stage_index]);
 			if (!sd.func_name.empty())
 			{
-				ShaderStage const stage = static_cast<ShaderStage>(stage_index);
 				if (sd.tech_pass_type == (tech_index << 16) + (pass_index << 8) + stage_index)
 				{
 					auto const & tech = *effect.TechniqueByIndex(tech_index);
@@ -7091,6 +7138,7 @@ namespace KlayGE
 			dst_cbuffer.param_indices_ = MakeSharedPtr<std::vector<uint32_t>>(param_indices_->size());
 		}
 		dst_cbuffer.buff_ = buff_;
+		dst_cbuffer.upload_ring_ = upload_ring_;
 		dst_cbuffer.Resize(static_cast<uint32_t>(buff_.size()));
 
 		this->RebindParameters(dst_cbuffer, dst_effect);
@@ -7142,7 +7190,7 @@ namespace KlayGE
 	void RenderEffectConstantBuffer::Resize(uint32_t size)
 	{
 		buff_.resize(size);
-		if (size > 0)
+		if ((size > 0) && !upload_ring_)
 		{
 			if (!hw_buff_ || (size > hw_buff_->Size()))
 			{
@@ -7151,22 +7199,67 @@ namespace KlayGE
 			}
 		}
 
-		dirty_ = true;
+		this->Dirty(true);
+	}
+
+	void RenderEffectConstantBuffer::UploadRing(bool ring)
+	{
+		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		ring &= re.DeviceCaps().cbuffer_offset_binding_support;
+		if (upload_ring_ != ring)
+		{
+			upload_ring_ = ring;
+			hw_buff_.reset();
+			hw_buff_offset_ = 0;
+			this->Resize(static_cast<uint32_t>(buff_.size()));
+		}
 	}
 
 	void RenderEffectConstantBuffer::Update()
 	{
-		if (dirty_)
+		if (buff_.empty())
 		{
-			hw_buff_->UpdateSubresource(0, static_cast<uint32_t>(buff_.size()), &buff_[0]);
+			return;
+		}
+
+		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		uint32_t const size = static_cast<uint32_t>(buff_.size());
+		if (upload_ring_)
+		{
+			// Ranges in the ring are reclaimed a few frames later, so upload again in every frame
+			uint32_t const frame_id = Context::Instance().AppInstance().TotalNumFrames();
+			if (this->Dirty() || !hw_buff_ || (ring_frame_id_ != frame_id))
+			{
+				hw_buff_ = re.ConstantBufferRingInstance().Upload(buff_.data(), size, hw_buff_offset_);
+				ring_frame_id_ = frame_id;
+				this->Dirty(false);
+			}
+		}
+		else if (this->Dirty())
+		{
+			uint32_t begin = 0;
+			uint32_t end = size;
+			if (re.DeviceCaps().partial_cbuffer_update_support)
+			{
+				// Ranges of partial updates are in 16-byte constants
+				begin = dirty_begin_ & ~15U;
+				end = std::min(dirty_end_, size);
+				end = std::min((end + 15) & ~15U, size);
+			}
+			if (begin < end)
+			{
+				hw_buff_->UpdateSubresource(begin, end - begin, &buff_[begin]);
+			}
 
-			dirty_ = false;
+			this->Dirty(false);
 		}
 	}
 
 	void RenderEffectConstantBuffer::BindHWBuff(GraphicsBufferPtr const & buff)
 	{
+		upload_ring_ = false;
 		hw_buff_ = buff;
+		hw_buff_offset_ = 0;
 		buff_.resize(buff->Size());
 	}
 
@@ -58,6 +58,7 @@
 #include <KlayGE/App3D.hpp>
 #include <KlayGE/Window.hpp>
 #include <KlayGE/PerfProfiler.hpp>
+#include <KlayGE/TransientBuffer.hpp>
 
 #include <mutex>
 #include <string>
@@ -71,6 +72,7 @@ namespace
 	std::mutex mesh_cb_instance_mutex;
 	std::mutex model_cb_instance_mutex;
 	std::mutex camera_cb_instance_mutex;
+	std::mutex instance_cb_instance_mutex;
 	std::mutex mipmapper_instance_mutex;
 }
 
@@ -1419,8 +1421,10 @@ namespace KlayGE
 		predefined_mesh_cb_.reset();
 		predefined_model_cb_.reset();
 		predefined_camera_cb_.reset();
+		predefined_instance_cb_.reset();
 
 		mipmapper_.reset();
+		cbuffer_ring_.reset();
 
 		cur_frame_buffer_.reset();
 		screen_frame_buffer_.reset();
@@ -1557,6 +1561,19 @@ namespace KlayGE
 		return *predefined_camera_cb_;
 	}
 
+	RenderEngine::PredefinedInstanceCBuffer const& RenderEngine::PredefinedInstanceCBufferInstance() const
+	{
+		if (!predefined_instance_cb_)
+		{
+			std::lock_guard<std::mutex> lock(instance_cb_instance_mutex);
+			if (!predefined_instance_cb_)
+			{
+				predefined_instance_cb_ = MakeUniquePtr<PredefinedInstanceCBuffer>();
+			}
+		}
+		return *predefined_instance_cb_;
+	}
+
 	Mipmapper const& RenderEngine::MipmapperInstance() const
 	{
 		if (!mipmapper_)
@@ -1570,6 +1587,16 @@ namespace KlayGE
 		return *mipmapper_;
 	}
 
+	ConstantBufferRing& RenderEngine::ConstantBufferRingInstance()
+	{
+		// Only used in binding shaders, which happens in the render thread
+		if (!cbuffer_ring_)
+		{
+			cbuffer_ring_ = MakeUniquePtr<ConstantBufferRing>(1024 * 1024);
+		}
+		return *cbuffer_ring_;
+	}
+
 
 	RenderEngine::PredefinedMaterialCBuffer::PredefinedMaterialCBuffer()
 	{
@@ -1772,4 +1799,34 @@ namespace KlayGE
 	{
 		return *(cbuff.template VariableInBuff<float4x4>(prev_mvps_offset_) + index);
 	}
+
+
+	RenderEngine::PredefinedInstanceCBuffer::PredefinedInstanceCBuffer()
+	{
+		effect_ = SyncLoadRenderEffect("PredefinedCBuffers.fxml");
+		predefined_cbuffer_ = effect_->CBufferByName("klayge_instance");
+
+		num_instances_offset_ = effect_->ParameterByName("num_model_instances")->CBufferOffset();
+		models_offset_ = effect_->ParameterByName("instance_models")->CBufferOffset();
+		prev_models_offset_ = effect_->ParameterByName("prev_instance_models")->CBufferOffset();
+
+		this->NumInstances(*predefined_cbuffer_) = 0;
+	}
+
+	uint32_t& RenderEngine::PredefinedInstanceCBuffer::NumInstances(RenderEffectConstantBuffer& cbuff) const
+	{
+		return *cbuff.template VariableInBuff<uint32_t>(num_instances_offset_);
+	}
+
+	float4x4& RenderEngine::PredefinedInstanceCBuffer::Model(RenderEffectConstantBuffer& cbuff, uint32_t index) const
+	{
+		BOOST_ASSERT(index < max_num_instances);
+		return *(cbuff.template VariableInBuff<float4x4>(models_offset_) + index);
+	}
+
+	float4x4& RenderEngine::PredefinedInstanceCBuffer::PrevModel(RenderEffectConstantBuffer& cbuff, uint32_t index) const
+	{
+		BOOST_ASSERT(index < max_num_instances);
+		return *(cbuff.template VariableInBuff<float4x4>(prev_models_offset_) + index);
+	}
 }
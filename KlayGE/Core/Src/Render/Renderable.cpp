@@ -32,6 +32,8 @@
 #include <KlayGE/RenderMaterial.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
 
+#include <cmath>
+
 #include <KlayGE/Renderable.hpp>
 
 namespace KlayGE
@@ -65,6 +67,8 @@ namespace KlayGE
 			auto const& camera_cb = re.PredefinedCameraCBufferInstance();
 			auto* camera_cbuff = camera_cb.CBuffer();
 			camera_cbuffer_ = camera_cbuff->Clone(camera_cbuff->OwnerEffect());
+			// Rewritten for each camera and pass, so it goes to the upload ring if possible
+			camera_cbuffer_->UploadRing(true);
 		}
 	}
 
@@ -95,6 +99,24 @@ namespace KlayGE
 		}
 	}
 
+	void Renderable::LodScreenSize(uint32_t lod, float size)
+	{
+		if (lod >= lod_screen_sizes_.size())
+		{
+			lod_screen_sizes_.resize(lod + 1, -1.0f);
+		}
+		lod_screen_sizes_[lod] = size;
+	}
+
+	float Renderable::LodScreenSize(uint32_t lod) const
+	{
+		if ((lod < lod_screen_sizes_.size()) && (lod_screen_sizes_[lod] >= 0))
+		{
+			return lod_screen_sizes_[lod];
+		}
+		return std::ldexp(1.0f, -static_cast<int>(lod));
+	}
+
 	RenderLayout& Renderable::GetRenderLayout() const
 	{
 		return this->GetRenderLayout(active_lod_);
@@ -197,6 +219,28 @@ namespace KlayGE
 			}
 		}
 
+		{
+			uint32_t const instance_cbuff_index = effect_->FindCBuffer("klayge_instance");
+			if ((instance_cbuff_index != static_cast<uint32_t>(-1)) && (effect_->CBufferByIndex(instance_cbuff_index)->Size() > 0))
+			{
+				if (num_batched_instances_ > 0)
+				{
+					effect_->BindCBufferByIndex(instance_cbuff_index, instance_cbuffer_);
+				}
+				else
+				{
+					// The instances of another renderable could be still bound
+					auto& instance_cbuffer = *effect_->CBufferByIndex(instance_cbuff_index);
+					uint32_t& num_instances = re.PredefinedInstanceCBufferInstance().NumInstances(instance_cbuffer);
+					if (num_instances != 0)
+					{
+						num_instances = 0;
+						instance_cbuffer.Dirty(true);
+					}
+				}
+			}
+		}
+
 		if (select_mode_on_)
 		{
 			*select_mode_object_id_param_ = select_mode_object_id_;
@@ -268,14 +312,13 @@ namespace KlayGE
 		if (active_lod_ < 0)
 		{
 			auto const& camera = *re.CurFrameBuffer()->Viewport()->Camera();
-			lod = MathLib::clamp(static_cast<int32_t>(this->CalcLod(camera.EyePos(), camera.ProjMatrix()(0, 0)) + 0.5f),
-				0, static_cast<int32_t>(this->NumLods() - 1));
+			lod = this->SelectLod(camera.EyePos(), camera.ProjMatrix()(1, 1));
 		}
 		else
 		{
 			lod = active_lod_;
 		}
-		RenderLayout const & layout = this->GetRenderLayout(lod);
+		RenderLayout& layout = this->GetRenderLayout(lod);
 		GraphicsBufferPtr const & inst_stream = layout.InstanceStream();
 		RenderTechnique const & tech = *this->GetRenderTechnique();
 		auto const & effect = *this->GetRenderEffect();
@@ -296,6 +339,10 @@ namespace KlayGE
 				re.Render(effect, tech, layout);
 				this->OnRenderEnd();
 			}
+			else if ((instances_.size() > 1) && tech.AutoInstancing() && instances_[0]->InstanceFormat().empty())
+			{
+				this->RenderInstancesInBatches(effect, tech, layout);
+			}
 			else
 			{
 				for (auto const * node : instances_)
@@ -321,6 +368,62 @@ namespace KlayGE
 		}
 	}
 
+	void Renderable::RenderInstancesInBatches(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout& layout)
+	{
+		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		auto const& picb = re.PredefinedInstanceCBufferInstance();
+
+		if (!instance_cbuffer_ || (&instance_cbuffer_->OwnerEffect() != effect_.get()))
+		{
+			instance_cbuffer_ = picb.CBuffer()->Clone(*effect_);
+			// Rewritten for each batch, so it goes to the upload ring if possible
+			instance_cbuffer_->UploadRing(true);
+		}
+
+		// Cameras get the identity model matrix, the vertex shader applies the matrices of each instance
+		curr_node_ = nullptr;
+		this->ModelMatrix(float4x4::Identity());
+		this->InverseModelMatrix(float4x4::Identity());
+		this->PrevModelMatrix(float4x4::Identity());
+
+		uint32_t const prev_num_instances = layout.NumInstances();
+		uint32_t const num_instances = static_cast<uint32_t>(instances_.size());
+		for (uint32_t first = 0; first < num_instances; first += RenderEngine::PredefinedInstanceCBuffer::max_num_instances)
+		{
+			num_batched_instances_ = std::min(num_instances - first, RenderEngine::PredefinedInstanceCBuffer::max_num_instances);
+			for (uint32_t i = 0; i < num_batched_instances_; ++ i)
+			{
+				SceneNode const * node = instances_[first + i];
+				picb.Model(*instance_cbuffer_, i) = MathLib::transpose(node->TransformToWorld());
+				picb.PrevModel(*instance_cbuffer_, i) = MathLib::transpose(node->PrevTransformToWorld());
+			}
+			picb.NumInstances(*instance_cbuffer_) = num_batched_instances_;
+			instance_cbuffer_->Dirty(true);
+
+			layout.NumInstances(num_batched_instances_);
+
+			this->OnRenderBegin();
+
+			bool const auto_set_camera_instances = (re.NumCameraInstances() == 0);
+			if (auto_set_camera_instances)
+			{
+				re.NumCameraInstances(visible_in_cameras_);
+			}
+			re.Render(effect, tech, layout);
+			if (auto_set_camera_instances)
+			{
+				re.NumCameraInstances(0);
+			}
+
+			this->OnRenderEnd();
+		}
+		num_batched_instances_ = 0;
+		layout.NumInstances(prev_num_instances);
+
+		// Leaves the same state as drawing the nodes one by one
+		this->BindSceneNode(instances_.back());
+	}
+
 	void Renderable::AddInstance(SceneNode const * node)
 	{
 		instances_.push_back(node);
@@ -428,14 +531,30 @@ namespace KlayGE
 		mesh_cbuffer_->Dirty(true);
 	}
 
-	float Renderable::CalcLod(float3 const & eye_pos, float fov_scale) const
+	int32_t Renderable::SelectLod(float3 const & eye_pos, float proj_scale_y) const
 	{
+		int32_t const num_lods = static_cast<int32_t>(this->NumLods());
+		if (num_lods <= 1)
+		{
+			return 0;
+		}
+
 		auto const aabb_ws = MathLib::transform_aabb(this->PosBound(), model_mat_);
-		float3 view_dir = aabb_ws.Center() - eye_pos;
-		float const dist_sq = MathLib::length_sq(view_dir);
-		view_dir *= MathLib::recip_sqrt(dist_sq);
-		float const area = MathLib::ortho_area(view_dir, aabb_ws);
-		return dist_sq / area / fov_scale;
+		float const radius = MathLib::length(aabb_ws.HalfSize());
+		float const dist = MathLib::length(aabb_ws.Center() - eye_pos);
+		if (dist <= radius)
+		{
+			return 0;
+		}
+
+		// Projected diameter over the viewport height of 2 in NDC
+		float const screen_size = radius * proj_scale_y / dist;
+		int32_t lod = 0;
+		while ((lod + 1 < num_lods) && (screen_size < this->LodScreenSize(lod + 1)))
+		{
+			++ lod;
+		}
+		return lod;
 	}
 
 	bool Renderable::AllHWResourceReady() const
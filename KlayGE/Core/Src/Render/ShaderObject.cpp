@@ -31,6 +31,7 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/CustomizedStreamBuf.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KFL/Hash.hpp>
 #include <KFL/com_ptr.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/RenderEffect.hpp>
@@ -39,8 +40,14 @@
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/CustomizedStreamBuf.hpp>
+#include <KFL/CXX17/filesystem.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <map>
 #include <sstream>
@@ -111,6 +118,12 @@ namespace
 			return initer;
 		}
 
+		// Identifies the compiler binary by its name, size and time stamp. Part of the shader code cache key.
+		std::string const & CompilerVersion() const
+		{
+			return compiler_version_;
+		}
+
 		HRESULT D3DCompile(std::string const & src_data,
 			D3D_SHADER_MACRO const * defines, char const * entry_point,
 			char const * target, uint32_t flags1, uint32_t flags2,
@@ -142,7 +155,10 @@ namespace
 			}
 			return hr;
 #else
-			std::string mark = std::to_string(reinterpret_cast<uint64_t>(src_data.c_str()));
+			// Shaders are compiled on several threads, the temporary files need unique names
+			static std::atomic<uint32_t> compile_counter(0);
+			std::string mark = std::to_string(reinterpret_cast<uint64_t>(src_data.c_str())) + '_'
+				+ std::to_string(compile_counter.fetch_add(1));
 			std::string compile_input_file = entry_point + mark + "Input.tmp";
 			std::string compile_output_file = entry_point + mark + "Output.tmp";
 
@@ -180,16 +196,14 @@ namespace
 #ifdef KLAYGE_PLATFORM_WINDOWS
 			ss << d3dcompiler_wrapper_name << ".exe";
 #else
-			static bool first = true;
-			if (first)
-			{
-				ss << KFL_STRINGIZE(WINE_PATH) << "wineserver -p";
-				int err = system(ss.str().c_str());
-				KFL_UNUSED(err);
-				// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
-				first = false;
-				ss.str(std::string());
-			}
+			static std::once_flag wineserver_flag;
+			std::call_once(wineserver_flag, []
+				{
+					std::string const cmd = std::string(KFL_STRINGIZE(WINE_PATH)) + "wineserver -p";
+					int err = system(cmd.c_str());
+					KFL_UNUSED(err);
+					// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
+				});
 			d3dcompiler_wrapper_name += ".exe.so";
 			std::string wrapper_path = ResLoader::Instance().Locate(d3dcompiler_wrapper_name);
 			ss << KFL_STRINGIZE(WINE_PATH) << "wine " << wrapper_path;
@@ -240,6 +254,28 @@ namespace
 #endif
 		}
 
+		// Expands the includes and macros. Not available through the compiler wrapper, returns false there.
+		bool D3DPreprocess(std::string const & src_data, D3D_SHADER_MACRO const * defines, std::string& output) const
+		{
+#ifdef CALL_D3DCOMPILER_DIRECTLY
+			com_ptr<ID3DBlob> code_blob;
+			com_ptr<ID3DBlob> error_msgs_blob;
+			HRESULT hr = DynamicD3DPreprocess_(src_data.c_str(), static_cast<UINT>(src_data.size()),
+				nullptr, defines, nullptr, code_blob.put(), error_msgs_blob.put());
+			if (SUCCEEDED(hr) && code_blob)
+			{
+				char const * p = static_cast<char const *>(code_blob->GetBufferPointer());
+				output.assign(p, p + code_blob->GetBufferSize());
+				return true;
+			}
+#else
+			KFL_UNUSED(src_data);
+			KFL_UNUSED(defines);
+#endif
+			output.clear();
+			return false;
+		}
+
 		HRESULT D3DReflect(std::vector<uint8_t> const & shader_code, void** reflector)
 		{
 #ifdef CALL_D3DCOMPILER_DIRECTLY
@@ -286,12 +322,34 @@ namespace
 #pragma GCC diagnostic ignored "-Wcast-function-type"
 #endif
 			DynamicD3DCompile_ = reinterpret_cast<D3DCompileFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DCompile"));
+			DynamicD3DPreprocess_ = reinterpret_cast<D3DPreprocessFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DPreprocess"));
 			DynamicD3DReflect_ = reinterpret_cast<D3DReflectFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DReflect"));
 			DynamicD3DStripShader_ = reinterpret_cast<D3DStripShaderFunc>(::GetProcAddress(mod_d3dcompiler_, "D3DStripShader"));
 #if defined(KLAYGE_COMPILER_GCC) && (KLAYGE_COMPILER_VERSION >= 80)
 #pragma GCC diagnostic pop
 #endif
+
+			char compiler_path[MAX_PATH];
+			::GetModuleFileNameA(mod_d3dcompiler_, compiler_path, MAX_PATH);
+			std::filesystem::path const compiler_file(compiler_path);
+#else
+			std::string d3dcompiler_wrapper_name = "D3DCompilerWrapper";
+#ifdef KLAYGE_DEBUG
+			d3dcompiler_wrapper_name += "_d";
 #endif
+#ifdef KLAYGE_PLATFORM_WINDOWS
+			d3dcompiler_wrapper_name += ".exe";
+#else
+			d3dcompiler_wrapper_name += ".exe.so";
+#endif
+			std::filesystem::path const compiler_file(ResLoader::Instance().Locate(d3dcompiler_wrapper_name));
+#endif
+
+			std::error_code ec;
+			uint64_t const size = std::filesystem::file_size(compiler_file, ec);
+			uint64_t const timestamp = std::filesystem::last_write_time(compiler_file, ec).time_since_epoch().count();
+			compiler_version_ = compiler_file.filename().string() + ':' + std::to_string(ec ? 0 : size) + ':'
+				+ std::to_string(ec ? 0 : timestamp);
 		}
 
 	private:
@@ -299,15 +357,206 @@ namespace
 		typedef HRESULT (WINAPI *D3DCompileFunc)(LPCVOID pSrcData, SIZE_T SrcDataSize, LPCSTR pSourceName,
 			D3D_SHADER_MACRO const * pDefines, ID3DInclude* pInclude, LPCSTR pEntrypoint,
 			LPCSTR pTarget, UINT Flags1, UINT Flags2, ID3DBlob** ppCode, ID3DBlob** ppErrorMsgs);
+		typedef HRESULT (WINAPI *D3DPreprocessFunc)(LPCVOID pSrcData, SIZE_T SrcDataSize, LPCSTR pSourceName,
+			D3D_SHADER_MACRO const * pDefines, ID3DInclude* pInclude, ID3DBlob** ppCodeText, ID3DBlob** ppErrorMsgs);
 		typedef HRESULT (WINAPI *D3DReflectFunc)(LPCVOID pSrcData, SIZE_T SrcDataSize, REFIID pInterface, void** ppReflector);
 		typedef HRESULT (WINAPI *D3DStripShaderFunc)(LPCVOID pShaderBytecode, SIZE_T BytecodeLength, UINT uStripFlags,
 			ID3DBlob** ppStrippedBlob);
 
 		HMODULE mod_d3dcompiler_;
 		D3DCompileFunc DynamicD3DCompile_;
+		D3DPreprocessFunc DynamicD3DPreprocess_;
 		D3DReflectFunc DynamicD3DReflect_;
 		D3DStripShaderFunc DynamicD3DStripShader_;
 #endif
+
+		std::string compiler_version_;
+	};
+
+	// Compiled shader code keyed by the hash of the compiler and its inputs. It's kept in memory and in the ShaderCache
+	//  folder, so a shader that appears in several techniques or effects is compiled once, and not again in the next run.
+	//  Both are bounded. The least recently used files are deleted when the folder grows over its cap.
+	class ShaderCodeCache
+	{
+		static uint32_t constexpr CACHE_VERSION = 1;
+		static uint64_t constexpr MAX_MEMORY_SIZE = 64ULL << 20;
+		static uint64_t constexpr MAX_DISK_SIZE = 256ULL << 20;
+
+	public:
+		static ShaderCodeCache& Instance()
+		{
+			static ShaderCodeCache cache;
+			return cache;
+		}
+
+		bool Find(std::string const & key, std::vector<uint8_t>& code)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				auto iter = codes_.find(key);
+				if (iter != codes_.end())
+				{
+					code = iter->second;
+					return true;
+				}
+			}
+
+			std::filesystem::path const file_path = cache_dir_ / (key + ".dxbc");
+			std::ifstream ifs(file_path.string().c_str(), std::ios_base::binary);
+			if (ifs)
+			{
+				uint32_t fourcc;
+				uint32_t ver;
+				uint32_t size;
+				ifs.read(reinterpret_cast<char*>(&fourcc), sizeof(fourcc));
+				ifs.read(reinterpret_cast<char*>(&ver), sizeof(ver));
+				ifs.read(reinterpret_cast<char*>(&size), sizeof(size));
+				if (ifs && (LE2Native(fourcc) == MakeFourCC<'K', 'S', 'C', ' '>::value) && (LE2Native(ver) == CACHE_VERSION)
+					&& (size > 0))
+				{
+					code.resize(LE2Native(size));
+					ifs.read(reinterpret_cast<char*>(code.data()), code.size());
+					if (ifs)
+					{
+						ifs.close();
+
+						// Marks it as recently used for TrimDiskCache
+						std::error_code ec;
+						std::filesystem::last_write_time(file_path, std::filesystem::file_time_type::clock::now(), ec);
+
+						std::lock_guard<std::mutex> lock(mutex_);
+						this->AddToMemoryNoLock(key, code);
+						return true;
+					}
+				}
+			}
+
+			code.clear();
+			return false;
+		}
+
+		void Add(std::string const & key, std::vector<uint8_t> const & code)
+		{
+			BOOST_ASSERT(!code.empty());
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				this->AddToMemoryNoLock(key, code);
+			}
+
+			std::error_code ec;
+			std::filesystem::create_directories(cache_dir_, ec);
+
+			// Writes to a temporary file first, other processes could be reading the same key
+			static std::atomic<uint32_t> tmp_counter(0);
+			std::filesystem::path const tmp_path = cache_dir_ / (key + '.' + std::to_string(tmp_counter.fetch_add(1)) + ".tmp");
+			{
+				std::ofstream ofs(tmp_path.string().c_str(), std::ios_base::binary);
+				if (!ofs)
+				{
+					return;
+				}
+
+				uint32_t const fourcc = Native2LE(MakeFourCC<'K', 'S', 'C', ' '>::value);
+				uint32_t const ver = Native2LE(CACHE_VERSION);
+				uint32_t const size = Native2LE(static_cast<uint32_t>(code.size()));
+				ofs.write(reinterpret_cast<char const *>(&fourcc), sizeof(fourcc));
+				ofs.write(reinterpret_cast<char const *>(&ver), sizeof(ver));
+				ofs.write(reinterpret_cast<char const *>(&size), sizeof(size));
+				ofs.write(reinterpret_cast<char const *>(code.data()), code.size());
+			}
+			std::filesystem::rename(tmp_path, cache_dir_ / (key + ".dxbc"), ec);
+			if (ec)
+			{
+				std::filesystem::remove(tmp_path, ec);
+			}
+		}
+
+	private:
+		ShaderCodeCache()
+			: cache_dir_(std::filesystem::path(ResLoader::Instance().LocalFolder()) / "ShaderCache"),
+				memory_size_(0)
+		{
+			this->TrimDiskCache();
+		}
+
+		// Codes are still on the disk, so any of them can be dropped
+		void AddToMemoryNoLock(std::string const & key, std::vector<uint8_t> const & code)
+		{
+			if (codes_.emplace(key, code).second)
+			{
+				memory_size_ += code.size();
+				while ((memory_size_ > MAX_MEMORY_SIZE) && (codes_.size() > 1))
+				{
+					auto iter = codes_.begin();
+					if (iter->first == key)
+					{
+						++ iter;
+					}
+					memory_size_ -= iter->second.size();
+					codes_.erase(iter);
+				}
+			}
+		}
+
+		// Deletes the least recently used files, down to 3/4 of the cap, once the folder is over it
+		void TrimDiskCache()
+		{
+			struct CacheFile
+			{
+				std::filesystem::path path;
+				std::filesystem::file_time_type timestamp;
+				uint64_t size;
+			};
+
+			std::vector<CacheFile> files;
+			uint64_t total_size = 0;
+			std::error_code ec;
+			for (std::filesystem::directory_iterator iter(cache_dir_, ec), end; !ec && (iter != end); iter.increment(ec))
+			{
+				std::filesystem::path const & path = iter->path();
+				if (path.extension() == ".dxbc")
+				{
+					CacheFile file;
+					file.path = path;
+					file.timestamp = std::filesystem::last_write_time(path, ec);
+					file.size = std::filesystem::file_size(path, ec);
+					if (!ec)
+					{
+						total_size += file.size;
+						files.push_back(std::move(file));
+					}
+					ec.clear();
+				}
+			}
+
+			if (total_size > MAX_DISK_SIZE)
+			{
+				std::sort(files.begin(), files.end(), [](CacheFile const & lhs, CacheFile const & rhs)
+					{
+						return lhs.timestamp < rhs.timestamp;
+					});
+				for (auto const & file : files)
+				{
+					if (total_size <= MAX_DISK_SIZE / 4 * 3)
+					{
+						break;
+					}
+
+					if (std::filesystem::remove(file.path, ec))
+					{
+						total_size -= file.size;
+					}
+				}
+			}
+		}
+
+	private:
+		std::filesystem::path const cache_dir_;
+
+		std::mutex mutex_;
+		std::unordered_map<std::string, std::vector<uint8_t>> codes_;
+		uint64_t memory_size_;
 	};
 }
 
@@ -457,6 +706,38 @@ namespace KlayGE
 			macros.push_back(macro_end);
 		}
 
+		std::string cache_key;
+		{
+			ContentHasher hasher;
+			std::string preprocessed;
+			if (D3DCompilerLoader::Instance().D3DPreprocess(hlsl_shader_text, &macros[0], preprocessed))
+			{
+				// Macros are expanded, techniques that differ only in unused macros share the code
+				hasher.Update(preprocessed.data(), preprocessed.size());
+			}
+			else
+			{
+				hasher.Update(hlsl_shader_text.data(), hlsl_shader_text.size());
+				for (auto const & macro : macros)
+				{
+					if (macro.Name != nullptr)
+					{
+						hasher.Update(macro.Name);
+						hasher.Update(macro.Definition);
+					}
+				}
+			}
+			hasher.Update(func_name);
+			hasher.Update(shader_profile);
+			hasher.Update(flags);
+			hasher.Update(D3DCompilerLoader::Instance().CompilerVersion().c_str());
+			cache_key = hasher.HexDigest();
+		}
+		if (ShaderCodeCache::Instance().Find(cache_key, code))
+		{
+			return code;
+		}
+
 		D3DCompilerLoader::Instance().D3DCompile(hlsl_shader_text, &macros[0],
 			func_name, shader_profile,
 			flags, 0, code, err_msg);
@@ -552,6 +833,11 @@ namespace KlayGE
 			}
 		}
 
+		if (!code.empty())
+		{
+			ShaderCodeCache::Instance().Add(cache_key, code);
+		}
+
 		return code;
 	}
 
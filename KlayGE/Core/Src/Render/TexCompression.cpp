@@ -29,12 +29,15 @@
 */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/TaskScheduler.hpp>
 #include <KlayGE/Context.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/Texture.hpp>
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <vector>
 
 #include <KlayGE/TexCompression.hpp>
 
@@ -278,6 +281,27 @@ namespace KlayGE
 
 	TexCompression::~TexCompression() noexcept = default;
 
+	void TexCompression::EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method)
+	{
+		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
+		uint32_t const uncompressed_block_bytes = BlockWidth(compression_format_) * BlockHeight(compression_format_) * elem_size;
+		uint32_t const block_bytes = BlockBytes(compression_format_);
+
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		for (uint32_t i = 0; i < num_blocks; ++ i)
+		{
+			this->EncodeBlock(dst, src, method);
+			dst += block_bytes;
+			src += uncompressed_block_bytes;
+		}
+	}
+
+	std::unique_ptr<TexCompression> TexCompression::Clone() const
+	{
+		return std::unique_ptr<TexCompression>();
+	}
+
 	void TexCompression::EncodeMem(uint32_t width, uint32_t height,
 		void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
 		void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
@@ -289,39 +313,85 @@ namespace KlayGE
 		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
 		uint32_t const block_width = BlockWidth(compression_format_);
 		uint32_t const block_height = BlockHeight(compression_format_);
-		uint32_t const block_bytes = BlockBytes(compression_format_);
+		uint32_t const uncompressed_block_bytes = block_width * block_height * elem_size;
 
-		uint8_t const * src = static_cast<uint8_t const *>(input);
+		uint32_t const num_blocks_x = (width + block_width - 1) / block_width;
+		uint32_t const num_blocks_y = (height + block_height - 1) / block_height;
 
-		std::vector<uint8_t> uncompressed(block_width * block_height * elem_size);
-		for (uint32_t y_base = 0; y_base < height; y_base += block_height)
+		// Every block is encoded independently, so a block row can be encoded on any thread and the output is
+		// identical to a serial encoding. Rows are handed out by an atomic counter, since the cost of a block
+		// varies a lot in some codecs.
+		std::atomic<uint32_t> next_row(0);
+		auto encode_rows = [&](TexCompression& codec)
 		{
-			uint8_t* dst = static_cast<uint8_t*>(output) + (y_base / block_height) * out_row_pitch;
-
-			for (uint32_t x_base = 0; x_base < width; x_base += block_width)
+			std::vector<uint8_t> uncompressed(num_blocks_x * uncompressed_block_bytes);
+			for (;;)
 			{
-				for (uint32_t y = 0; y < block_height; ++ y)
+				uint32_t const block_y = next_row.fetch_add(1);
+				if (block_y >= num_blocks_y)
+				{
+					break;
+				}
+
+				uint32_t const y_base = block_y * block_height;
+				uint8_t const * src = static_cast<uint8_t const *>(input);
+				uint8_t* dst = static_cast<uint8_t*>(output) + block_y * out_row_pitch;
+
+				for (uint32_t block_x = 0; block_x < num_blocks_x; ++ block_x)
 				{
-					for (uint32_t x = 0; x < block_width; ++ x)
+					uint32_t const x_base = block_x * block_width;
+					uint8_t* block = &uncompressed[block_x * uncompressed_block_bytes];
+					for (uint32_t y = 0; y < block_height; ++ y)
 					{
-						if ((x_base + x < width) && (y_base + y < height))
-						{
-							memcpy(&uncompressed[(y * block_width + x) * elem_size],
-								&src[(y_base + y) * in_row_pitch + (x_base + x) * elem_size],
-								elem_size);
-						}
-						else
+						for (uint32_t x = 0; x < block_width; ++ x)
 						{
-							memset(&uncompressed[(y * block_width + x) * elem_size],
-								0, elem_size);
+							if ((x_base + x < width) && (y_base + y < height))
+							{
+								memcpy(&block[(y * block_width + x) * elem_size],
+									&src[(y_base + y) * in_row_pitch + (x_base + x) * elem_size],
+									elem_size);
+							}
+							else
+							{
+								memset(&block[(y * block_width + x) * elem_size],
+									0, elem_size);
+							}
 						}
 					}
 				}
 
-				this->EncodeBlock(dst, &uncompressed[0], method);
-				dst += block_bytes;
+				codec.EncodeBlocks(dst, &uncompressed[0], num_blocks_x, method);
 			}
+		};
+
+		auto& scheduler = Context::Instance().TaskScheduler();
+
+		uint32_t const MIN_BLOCKS_PER_TASK = 64;
+		uint32_t const num_tasks = std::min({scheduler.concurrency(),
+			num_blocks_y, std::max(num_blocks_x * num_blocks_y / MIN_BLOCKS_PER_TASK, 1U)});
+
+		std::vector<std::unique_ptr<TexCompression>> codecs;
+		for (uint32_t i = 1; i < num_tasks; ++ i)
+		{
+			auto codec = this->Clone();
+			if (!codec)
+			{
+				break;
+			}
+			codecs.push_back(std::move(codec));
 		}
+
+		// Codecs carry state, so each task owns a clone for its whole life instead of splitting the rows up front
+		task_group group(scheduler);
+		for (auto& codec : codecs)
+		{
+			TexCompression* codec_ptr = codec.get();
+			group.run([&encode_rows, codec_ptr] { encode_rows(*codec_ptr); });
+		}
+
+		encode_rows(*this);
+
+		group.wait();
 	}
 
 	void TexCompression::DecodeMem(uint32_t width, uint32_t height,
@@ -880,9 +880,8 @@ namespace
 		}
 	}
 
-	int IntRand()
+	int IntRand(std::mt19937& gen)
 	{
-		static thread_local std::mt19937 gen;
 		std::uniform_int_distribution<int> random_dis(0, RAND_MAX);
 		return random_dis(gen);
 	}
@@ -897,6 +896,11 @@ namespace KlayGE
 		compression_format_ = EF_BC1;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC1::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC1>();
+	}
+
 	void TexCompressionBC1::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1384,6 +1388,11 @@ namespace KlayGE
 		compression_format_ = EF_BC2;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC2::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC2>();
+	}
+
 	void TexCompressionBC2::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1435,6 +1444,11 @@ namespace KlayGE
 		compression_format_ = EF_BC3;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC3::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC3>();
+	}
+
 	void TexCompressionBC3::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1481,6 +1495,11 @@ namespace KlayGE
 		compression_format_ = EF_BC4;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC4::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC4>();
+	}
+
 	// Alpha block compression (this is easy for a change)
 	void TexCompressionBC4::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
@@ -1587,6 +1606,11 @@ namespace KlayGE
 		compression_format_ = EF_BC5;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC5::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC5>();
+	}
+
 	void TexCompressionBC5::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1887,6 +1911,11 @@ namespace KlayGE
 		compression_format_ = EF_BC6;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC6U::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC6U>();
+	}
+
 	void TexCompressionBC6U::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		KFL_UNUSED(output);
@@ -2138,6 +2167,11 @@ namespace KlayGE
 		compression_format_ = EF_SIGNED_BC6;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC6S::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC6S>();
+	}
+
 	void TexCompressionBC6S::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		KFL_UNUSED(output);
@@ -2180,6 +2214,11 @@ namespace KlayGE
 		compression_format_ = EF_BC7;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC7::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC7>();
+	}
+
 	void TexCompressionBC7::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -2189,6 +2228,18 @@ namespace KlayGE
 
 		ARGBColor32 const * argb = static_cast<ARGBColor32 const *>(input);
 
+		{
+			// FNV-1a of the texels. Each block gets its own random sequence, as with the old per-thread generator, but
+			// the sequence doesn't depend on which blocks were encoded before.
+			uint8_t const * bytes = static_cast<uint8_t const *>(input);
+			uint32_t seed = 0x811C9DC5U;
+			for (uint32_t i = 0; i < 16 * sizeof(ARGBColor32); ++ i)
+			{
+				seed = (seed ^ bytes[i]) * 0x01000193U;
+			}
+			rng_.seed(seed);
+		}
+
 		bool uniform_block = true;
 		for (int i = 1; i < 16; ++ i)
 		{
@@ -2888,7 +2939,7 @@ namespace KlayGE
 		{
 			float4 const & p = pt ? p1 : p2;
 			float4& np = pt ? np1 : np2;
-			uint32_t const rdir = IntRand() & 0xF;
+			uint32_t const rdir = IntRand(rng_) & 0xF;
 
 			np = p;
 			if (has_pbits)
@@ -2921,7 +2972,7 @@ namespace KlayGE
 		}
 
 		size_t const p = static_cast<size_t>(exp(0.1f * static_cast<int64_t>(old_err - new_err) / temp) * static_cast<float>(RAND_MAX));
-		size_t const r = IntRand();
+		size_t const r = IntRand(rng_);
 
 		return r < p;
 	}
@@ -41,12 +41,21 @@
 #include <KlayGE/DevHelper.hpp>
 #include <KFL/Half.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/TaskScheduler.hpp>
 
+#include <array>
+#include <cmath>
 #include <cstring>
 #include <fstream>
 #include <iterator>
 #include <system_error>
 
+#if defined(KLAYGE_SSE_SUPPORT)
+#include <xmmintrin.h>
+#elif defined(KLAYGE_NEON_SUPPORT)
+#include <arm_neon.h>
+#endif
+
 #include <KlayGE/Texture.hpp>
 
 namespace
@@ -1312,6 +1321,15 @@ namespace
 			return true;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashRange(seed, tex_desc_.res_name.begin(), tex_desc_.res_name.end());
+			HashCombine(seed, tex_desc_.access_hint);
+			return seed;
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -1344,6 +1362,40 @@ namespace
 			return *tex_desc_.tex;
 		}
 
+		uint64_t ResourceSize() const override
+		{
+			TexturePtr const & tex = *tex_desc_.tex;
+			if (!tex)
+			{
+				return 0;
+			}
+
+			ElementFormat const format = tex->Format();
+			uint32_t const elem_size = NumFormatBytes(format);
+			uint64_t size = 0;
+			for (uint32_t level = 0; level < tex->NumMipMaps(); ++ level)
+			{
+				uint64_t const width = tex->Width(level);
+				uint64_t const height = tex->Height(level);
+				uint64_t const depth = tex->Depth(level);
+				if (IsCompressedFormat(format))
+				{
+					size += ((width + 3) / 4) * ((height + 3) / 4) * depth * elem_size * 4;
+				}
+				else
+				{
+					size += width * height * depth * elem_size;
+				}
+			}
+
+			uint32_t array_size = tex->ArraySize();
+			if (Texture::TT_Cube == tex->Type())
+			{
+				array_size *= 6;
+			}
+			return size * array_size;
+		}
+
 	private:
 		void LoadDDS()
 		{
@@ -1635,6 +1687,518 @@ namespace
 		TexDesc tex_desc_;
 		std::mutex main_thread_stage_mutex_;
 	};
+
+	float ResampleFilterSupport(ResampleFilter filter)
+	{
+		switch (filter)
+		{
+		case ResampleFilter::Point:
+		case ResampleFilter::Box:
+			return 0.5f;
+
+		case ResampleFilter::Linear:
+			return 1;
+
+		case ResampleFilter::Kaiser:
+		case ResampleFilter::Lanczos3:
+			return 3;
+
+		default:
+			KFL_UNREACHABLE("Invalid resample filter");
+		}
+	}
+
+	float Sinc(float x)
+	{
+		if (std::abs(x) < 1e-4f)
+		{
+			return 1;
+		}
+		else
+		{
+			return std::sin(PI * x) / (PI * x);
+		}
+	}
+
+	// Zeroth order modified Bessel function of the first kind, by its power series
+	float BesselI0(float x)
+	{
+		float const x2 = x * x / 4;
+		float sum = 1;
+		float term = 1;
+		for (int k = 1; k < 32; ++ k)
+		{
+			term *= x2 / (k * k);
+			sum += term;
+			if (term < sum * 1e-8f)
+			{
+				break;
+			}
+		}
+		return sum;
+	}
+
+	float ResampleFilterWeight(ResampleFilter filter, float x)
+	{
+		x = std::abs(x);
+		switch (filter)
+		{
+		case ResampleFilter::Point:
+		case ResampleFilter::Box:
+			return (x < 0.5f) ? 1.0f : 0.0f;
+
+		case ResampleFilter::Linear:
+			return std::max(1 - x, 0.0f);
+
+		case ResampleFilter::Kaiser:
+			if (x < 3)
+			{
+				float constexpr ALPHA = 4;
+				float const t = x / 3;
+				return Sinc(x) * BesselI0(ALPHA * std::sqrt(1 - t * t)) / BesselI0(ALPHA);
+			}
+			else
+			{
+				return 0;
+			}
+
+		case ResampleFilter::Lanczos3:
+			return (x < 3) ? Sinc(x) * Sinc(x / 3) : 0.0f;
+
+		default:
+			KFL_UNREACHABLE("Invalid resample filter");
+		}
+	}
+
+	// Precomputed weights of one axis. Every destination texel reads a window of NumTaps() source texels starting at
+	//  First(). Taps out of the image are clamped to the edge texel, and their weights are folded into it.
+	class ResampleAxis final
+	{
+	public:
+		ResampleAxis(uint32_t src_size, uint32_t dst_size, ResampleFilter filter)
+			: firsts_(dst_size)
+		{
+			float const scale = static_cast<float>(src_size) / dst_size;
+
+			if ((src_size == dst_size) || (filter == ResampleFilter::Point))
+			{
+				num_taps_ = 1;
+				weights_.assign(dst_size, 1.0f);
+				for (uint32_t i = 0; i < dst_size; ++ i)
+				{
+					firsts_[i] = std::min(static_cast<uint32_t>((i + 0.5f) * scale), src_size - 1);
+				}
+				return;
+			}
+
+			// Linear stays bilinear when shrinking, the others widen to cover all the source texels under a destination one
+			float const filter_scale = (filter == ResampleFilter::Linear) ? 1.0f : std::max(scale, 1.0f);
+			float const support = ResampleFilterSupport(filter) * filter_scale;
+			// All filters are 0 at the support boundary, so an open interval of 2 * support holds no more texels than this
+			uint32_t const window = std::max(static_cast<uint32_t>(std::ceil(support * 2)), 1U);
+			num_taps_ = std::min(window, src_size);
+			weights_.assign(dst_size * num_taps_, 0.0f);
+
+			for (uint32_t i = 0; i < dst_size; ++ i)
+			{
+				float const center = (i + 0.5f) * scale;
+				int32_t const start = static_cast<int32_t>(std::floor(center - support - 0.5f)) + 1;
+				uint32_t const first = static_cast<uint32_t>(
+					MathLib::clamp(start, 0, static_cast<int32_t>(src_size - num_taps_)));
+				firsts_[i] = first;
+
+				float* weights = &weights_[i * num_taps_];
+				float sum = 0;
+				for (uint32_t t = 0; t < window; ++ t)
+				{
+					int32_t const j = start + static_cast<int32_t>(t);
+					float const w = ResampleFilterWeight(filter, (j + 0.5f - center) / filter_scale);
+					uint32_t const clamped_j = static_cast<uint32_t>(MathLib::clamp(j, 0, static_cast<int32_t>(src_size - 1)));
+					weights[clamped_j - first] += w;
+					sum += w;
+				}
+
+				if (std::abs(sum) > 1e-6f)
+				{
+					for (uint32_t t = 0; t < num_taps_; ++ t)
+					{
+						weights[t] /= sum;
+					}
+				}
+				else
+				{
+					std::fill(weights, weights + num_taps_, 0.0f);
+					uint32_t const nearest = std::min(static_cast<uint32_t>(center), src_size - 1);
+					weights[nearest - first] = 1;
+				}
+			}
+		}
+
+		uint32_t NumTaps() const
+		{
+			return num_taps_;
+		}
+		uint32_t First(uint32_t dst) const
+		{
+			return firsts_[dst];
+		}
+		float const * Weights(uint32_t dst) const
+		{
+			return &weights_[dst * num_taps_];
+		}
+
+	private:
+		uint32_t num_taps_;
+		std::vector<uint32_t> firsts_;
+		std::vector<float> weights_;
+	};
+
+	// How texels are stored while being filtered. When both sides are the same plain format, the stored channels are
+	//  filtered in memory order, otherwise everything goes through ABGR32F.
+	enum class ResampleChannelType
+	{
+		UNorm8,
+		UNorm16,
+		Half,
+		Float,
+		ABGR32F
+	};
+
+	struct ResampleLayout
+	{
+		ResampleChannelType type;
+		uint32_t num_channels;
+	};
+
+	ResampleLayout GetResampleLayout(ElementFormat src_format, ElementFormat dst_format)
+	{
+		if (src_format == dst_format)
+		{
+			switch (src_format)
+			{
+			case EF_A8:
+			case EF_R8:
+				return {ResampleChannelType::UNorm8, 1};
+			case EF_GR8:
+				return {ResampleChannelType::UNorm8, 2};
+			case EF_BGR8:
+				return {ResampleChannelType::UNorm8, 3};
+			case EF_ARGB8:
+			case EF_ABGR8:
+				return {ResampleChannelType::UNorm8, 4};
+
+			case EF_R16:
+				return {ResampleChannelType::UNorm16, 1};
+			case EF_GR16:
+				return {ResampleChannelType::UNorm16, 2};
+			case EF_BGR16:
+				return {ResampleChannelType::UNorm16, 3};
+			case EF_ABGR16:
+				return {ResampleChannelType::UNorm16, 4};
+
+			case EF_R16F:
+				return {ResampleChannelType::Half, 1};
+			case EF_GR16F:
+				return {ResampleChannelType::Half, 2};
+			case EF_BGR16F:
+				return {ResampleChannelType::Half, 3};
+			case EF_ABGR16F:
+				return {ResampleChannelType::Half, 4};
+
+			case EF_R32F:
+				return {ResampleChannelType::Float, 1};
+			case EF_GR32F:
+				return {ResampleChannelType::Float, 2};
+			case EF_BGR32F:
+				return {ResampleChannelType::Float, 3};
+			case EF_ABGR32F:
+				return {ResampleChannelType::Float, 4};
+
+			default:
+				break;
+			}
+		}
+
+		return {ResampleChannelType::ABGR32F, 4};
+	}
+
+	void DecodeResampleRow(ResampleLayout const & layout, ElementFormat format, void const * src, uint32_t num_texels, float* dst)
+	{
+		uint32_t const num_values = num_texels * layout.num_channels;
+		switch (layout.type)
+		{
+		case ResampleChannelType::UNorm8:
+			{
+				static std::array<float, 256> const unorm8_table = []
+				{
+					std::array<float, 256> table;
+					for (uint32_t i = 0; i < table.size(); ++ i)
+					{
+						table[i] = i / 255.0f;
+					}
+					return table;
+				}();
+
+				uint8_t const * p = static_cast<uint8_t const *>(src);
+				for (uint32_t i = 0; i < num_values; ++ i)
+				{
+					dst[i] = unorm8_table[p[i]];
+				}
+			}
+			break;
+
+		case ResampleChannelType::UNorm16:
+			{
+				uint16_t const * p = static_cast<uint16_t const *>(src);
+				for (uint32_t i = 0; i < num_values; ++ i)
+				{
+					dst[i] = p[i] / 65535.0f;
+				}
+			}
+			break;
+
+		case ResampleChannelType::Half:
+			{
+				half const * p = static_cast<half const *>(src);
+				for (uint32_t i = 0; i < num_values; ++ i)
+				{
+					dst[i] = p[i];
+				}
+			}
+			break;
+
+		case ResampleChannelType::Float:
+			std::memcpy(dst, src, num_values * sizeof(float));
+			break;
+
+		case ResampleChannelType::ABGR32F:
+			KLAYGE_STATIC_ASSERT(sizeof(Color) == sizeof(float) * 4);
+			ConvertToABGR32F(format, src, num_texels, reinterpret_cast<Color*>(dst));
+			break;
+
+		default:
+			KFL_UNREACHABLE("Invalid channel type");
+		}
+	}
+
+	void EncodeResampleRow(ResampleLayout const & layout, ElementFormat format, float const * src, uint32_t num_texels, void* dst)
+	{
+		uint32_t const num_values = num_texels * layout.num_channels;
+		switch (layout.type)
+		{
+		case ResampleChannelType::UNorm8:
+			{
+				uint8_t* p = static_cast<uint8_t*>(dst);
+				for (uint32_t i = 0; i < num_values; ++ i)
+				{
+					p[i] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(src[i] * 255.0f + 0.5f), 0, 255));
+				}
+			}
+			break;
+
+		case ResampleChannelType::UNorm16:
+			{
+				uint16_t* p = static_cast<uint16_t*>(dst);
+				for (uint32_t i = 0; i < num_values; ++ i)
+				{
+					p[i] = static_cast<uint16_t>(MathLib::clamp(static_cast<int>(src[i] * 65535.0f + 0.5f), 0, 65535));
+				}
+			}
+			break;
+
+		case ResampleChannelType::Half:
+			{
+				half* p = static_cast<half*>(dst);
+				for (uint32_t i = 0; i < num_values; ++ i)
+				{
+					p[i] = half(src[i]);
+				}
+			}
+			break;
+
+		case ResampleChannelType::Float:
+			std::memcpy(dst, src, num_values * sizeof(float));
+			break;
+
+		case ResampleChannelType::ABGR32F:
+			ConvertFromABGR32F(format, reinterpret_cast<Color const *>(src), num_texels, dst);
+			break;
+
+		default:
+			KFL_UNREACHABLE("Invalid channel type");
+		}
+	}
+
+	template <uint32_t NUM_CHANNELS>
+	void ResampleRowHorizontal(float const * src, float* dst, ResampleAxis const & axis, uint32_t dst_width)
+	{
+		uint32_t const num_taps = axis.NumTaps();
+		for (uint32_t x = 0; x < dst_width; ++ x, dst += NUM_CHANNELS)
+		{
+			float const * weights = axis.Weights(x);
+			float const * s = src + axis.First(x) * NUM_CHANNELS;
+
+			float sum[NUM_CHANNELS] = {};
+			for (uint32_t t = 0; t < num_taps; ++ t, s += NUM_CHANNELS)
+			{
+				for (uint32_t c = 0; c < NUM_CHANNELS; ++ c)
+				{
+					sum[c] += weights[t] * s[c];
+				}
+			}
+			for (uint32_t c = 0; c < NUM_CHANNELS; ++ c)
+			{
+				dst[c] = sum[c];
+			}
+		}
+	}
+
+#if defined(KLAYGE_SSE_SUPPORT) || defined(KLAYGE_NEON_SUPPORT)
+	// 4 channels fit in one register, a texel is filtered with one multiply-add per tap
+	template <>
+	void ResampleRowHorizontal<4>(float const * src, float* dst, ResampleAxis const & axis, uint32_t dst_width)
+	{
+		uint32_t const num_taps = axis.NumTaps();
+		for (uint32_t x = 0; x < dst_width; ++ x, dst += 4)
+		{
+			float const * weights = axis.Weights(x);
+			float const * s = src + axis.First(x) * 4;
+
+#if defined(KLAYGE_SSE_SUPPORT)
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t t = 0; t < num_taps; ++ t, s += 4)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(s)));
+			}
+			_mm_storeu_ps(dst, sum);
+#else
+			float32x4_t sum = vdupq_n_f32(0);
+			for (uint32_t t = 0; t < num_taps; ++ t, s += 4)
+			{
+				sum = vmlaq_n_f32(sum, vld1q_f32(s), weights[t]);
+			}
+			vst1q_f32(dst, sum);
+#endif
+		}
+	}
+#endif
+
+	void ResampleRowHorizontal(uint32_t num_channels, float const * src, float* dst, ResampleAxis const & axis, uint32_t dst_width)
+	{
+		switch (num_channels)
+		{
+		case 1:
+			ResampleRowHorizontal<1>(src, dst, axis, dst_width);
+			break;
+
+		case 2:
+			ResampleRowHorizontal<2>(src, dst, axis, dst_width);
+			break;
+
+		case 3:
+			ResampleRowHorizontal<3>(src, dst, axis, dst_width);
+			break;
+
+		case 4:
+			ResampleRowHorizontal<4>(src, dst, axis, dst_width);
+			break;
+
+		default:
+			KFL_UNREACHABLE("Invalid number of channels");
+		}
+	}
+
+	// dst += src * weight, the vertical and depth passes are weighted sums of whole rows
+	void AccumulateResampleRow(float* dst, float const * src, float weight, uint32_t num_values)
+	{
+		uint32_t i = 0;
+#if defined(KLAYGE_SSE_SUPPORT)
+		__m128 const w = _mm_set1_ps(weight);
+		for (; i + 4 <= num_values; i += 4)
+		{
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(w, _mm_loadu_ps(src + i))));
+		}
+#elif defined(KLAYGE_NEON_SUPPORT)
+		for (; i + 4 <= num_values; i += 4)
+		{
+			vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), weight));
+		}
+#endif
+		for (; i < num_values; ++ i)
+		{
+			dst[i] += weight * src[i];
+		}
+	}
+
+	void ResampleImage(uint8_t* dst, uint32_t dst_row_pitch, uint32_t dst_slice_pitch, ElementFormat dst_format,
+		uint32_t dst_width, uint32_t dst_height, uint32_t dst_depth,
+		uint8_t const * src, uint32_t src_row_pitch, uint32_t src_slice_pitch, ElementFormat src_format,
+		uint32_t src_width, uint32_t src_height, uint32_t src_depth, ResampleFilter filter)
+	{
+		ResampleLayout const layout = GetResampleLayout(src_format, dst_format);
+		ResampleAxis const x_axis(src_width, dst_width, filter);
+		ResampleAxis const y_axis(src_height, dst_height, filter);
+		ResampleAxis const z_axis(src_depth, dst_depth, filter);
+
+		uint32_t const src_row_values = src_width * layout.num_channels;
+		uint32_t const dst_row_values = dst_width * layout.num_channels;
+
+		// A band of destination rows is one task. Source rows shared by 2 bands are filtered horizontally twice, that's
+		//  cheaper than synchronizing.
+		uint32_t const ROWS_PER_BAND = std::max(16U, 64 * 1024 / std::max(dst_width, 1U));
+		uint32_t const num_bands = (dst_height + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+
+		Context::Instance().TaskScheduler().parallel_for(0, dst_depth * num_bands, 1,
+			[&](uint32_t first_band, uint32_t last_band)
+			{
+				std::vector<float> src_row(src_row_values);
+				std::vector<float> dst_row(dst_row_values);
+				std::vector<float> horizontal_rows;
+
+				for (uint32_t band = first_band; band < last_band; ++ band)
+				{
+					uint32_t const z = band / num_bands;
+					uint32_t const y_begin = band % num_bands * ROWS_PER_BAND;
+					uint32_t const y_end = std::min(y_begin + ROWS_PER_BAND, dst_height);
+					uint32_t const sy_begin = y_axis.First(y_begin);
+					uint32_t const num_src_rows = y_axis.First(y_end - 1) + y_axis.NumTaps() - sy_begin;
+
+					horizontal_rows.resize(z_axis.NumTaps() * num_src_rows * dst_row_values);
+					for (uint32_t zt = 0; zt < z_axis.NumTaps(); ++ zt)
+					{
+						uint32_t const sz = z_axis.First(z) + zt;
+						for (uint32_t sy = 0; sy < num_src_rows; ++ sy)
+						{
+							DecodeResampleRow(layout, src_format, src + sz * src_slice_pitch + (sy_begin + sy) * src_row_pitch,
+								src_width, src_row.data());
+							ResampleRowHorizontal(layout.num_channels, src_row.data(),
+								&horizontal_rows[(zt * num_src_rows + sy) * dst_row_values], x_axis, dst_width);
+						}
+					}
+
+					float const * z_weights = z_axis.Weights(z);
+					for (uint32_t y = y_begin; y < y_end; ++ y)
+					{
+						float const * y_weights = y_axis.Weights(y);
+						uint32_t const sy_first = y_axis.First(y) - sy_begin;
+
+						std::fill(dst_row.begin(), dst_row.end(), 0.0f);
+						for (uint32_t zt = 0; zt < z_axis.NumTaps(); ++ zt)
+						{
+							for (uint32_t yt = 0; yt < y_axis.NumTaps(); ++ yt)
+							{
+								AccumulateResampleRow(dst_row.data(),
+									&horizontal_rows[(zt * num_src_rows + sy_first + yt) * dst_row_values],
+									z_weights[zt] * y_weights[yt], dst_row_values);
+							}
+						}
+
+						EncodeResampleRow(layout, dst_format, dst_row.data(), dst_width,
+							dst + z * dst_slice_pitch + y * dst_row_pitch);
+					}
+				}
+			});
+	}
 }
 
 namespace KlayGE
@@ -3557,6 +4121,15 @@ namespace KlayGE
 	void ResizeTexture(void* dst_data, uint32_t dst_row_pitch, uint32_t dst_slice_pitch, ElementFormat dst_format, uint32_t dst_width,
 		uint32_t dst_height, uint32_t dst_depth, void const* src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch,
 		ElementFormat src_format, uint32_t src_width, uint32_t src_height, uint32_t src_depth, TextureFilter filter)
+	{
+		ResizeTexture(dst_data, dst_row_pitch, dst_slice_pitch, dst_format, dst_width, dst_height, dst_depth,
+			src_data, src_row_pitch, src_slice_pitch, src_format, src_width, src_height, src_depth,
+			(filter == TextureFilter::Linear) ? ResampleFilter::Linear : ResampleFilter::Point);
+	}
+
+	void ResizeTexture(void* dst_data, uint32_t dst_row_pitch, uint32_t dst_slice_pitch, ElementFormat dst_format, uint32_t dst_width,
+		uint32_t dst_height, uint32_t dst_depth, void const* src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch,
+		ElementFormat src_format, uint32_t src_width, uint32_t src_height, uint32_t src_depth, ResampleFilter filter)
 	{
 		std::vector<uint8_t> src_cpu_data_block;
 		void* src_cpu_data;
@@ -3643,7 +4216,7 @@ namespace KlayGE
 				KFL_UNREACHABLE("Invalid destination format");
 			}
 
-			dst_cpu_row_pitch = dst_width * NumFormatBytes(src_cpu_format);
+			dst_cpu_row_pitch = dst_width * NumFormatBytes(dst_cpu_format);
 			dst_cpu_slice_pitch = dst_cpu_row_pitch * dst_height;
 			dst_cpu_data_block.resize(dst_depth * dst_cpu_slice_pitch);
 			dst_cpu_data = &dst_cpu_data_block[0];
@@ -3661,7 +4234,7 @@ namespace KlayGE
 		uint32_t const src_elem_size = NumFormatBytes(src_cpu_format);
 		uint32_t const dst_elem_size = NumFormatBytes(dst_cpu_format);
 
-		if (((filter == TextureFilter::Point) || ((src_width == dst_width) && (src_height == dst_height) && (src_depth == dst_depth))) &&
+		if (((filter == ResampleFilter::Point) || ((src_width == dst_width) && (src_height == dst_height) && (src_depth == dst_depth))) &&
 			(src_cpu_format == dst_cpu_format))
 		{
 			for (uint32_t z = 0; z < dst_depth; ++ z)
@@ -3695,87 +4268,8 @@ namespace KlayGE
 		}
 		else
 		{
-			std::vector<Color> src_32f(src_width * src_height * src_depth);
-			{
-				for (uint32_t z = 0; z < src_depth; ++ z)
-				{
-					for (uint32_t y = 0; y < src_height; ++ y)
-					{
-						ConvertToABGR32F(src_cpu_format, src_ptr + z * src_cpu_slice_pitch + y * src_cpu_row_pitch,
-							src_width, &src_32f[(z * src_height + y) * src_width]);
-					}
-				}
-			}
-
-			std::vector<Color> dst_32f(dst_width * dst_height * dst_depth);
-			if (filter == TextureFilter::Linear)
-			{
-				for (uint32_t z = 0; z < dst_depth; ++ z)
-				{
-					float fz = static_cast<float>(z + 0.5f) / dst_depth * src_depth;
-					uint32_t sz0 = static_cast<uint32_t>(fz - 0.5f);
-					uint32_t sz1 = MathLib::clamp<uint32_t>(sz0 + 1, 0, src_depth - 1);
-					float weight_z = fz - sz0 - 0.5f;
-							
-					for (uint32_t y = 0; y < dst_height; ++ y)
-					{
-						float fy = static_cast<float>(y + 0.5f) / dst_height * src_height;
-						uint32_t sy0 = static_cast<uint32_t>(fy - 0.5f);
-						uint32_t sy1 = MathLib::clamp<uint32_t>(sy0 + 1, 0, src_height - 1);
-						float weight_y = fy - sy0 - 0.5f;
-							
-						for (uint32_t x = 0; x < dst_width; ++ x)
-						{
-							float fx = static_cast<float>(x + 0.5f) / dst_width * src_width;
-							uint32_t sx0 = static_cast<uint32_t>(fx - 0.5f);
-							uint32_t sx1 = MathLib::clamp<uint32_t>(sx0 + 1, 0, src_width - 1);
-							float weight_x = fx - sx0 - 0.5f;
-							Color clr_x00 = MathLib::lerp(src_32f[(sz0 * src_height + sy0) * src_width + sx0],
-								src_32f[(sz0 * src_height + sy0) * src_width + sx1], weight_x);
-							Color clr_x01 = MathLib::lerp(src_32f[(sz0 * src_height + sy1) * src_width + sx0],
-								src_32f[(sz0 * src_height + sy1) * src_width + sx1], weight_x);
-							Color clr_y0 = MathLib::lerp(clr_x00, clr_x01, weight_y);
-							Color clr_x10 = MathLib::lerp(src_32f[(sz1 * src_height + sy0) * src_width + sx0],
-								src_32f[(sz1 * src_height + sy0) * src_width + sx1], weight_x);
-							Color clr_x11 = MathLib::lerp(src_32f[(sz1 * src_height + sy1) * src_width + sx0],
-								src_32f[(sz1 * src_height + sy1) * src_width + sx1], weight_x);
-							Color clr_y1 = MathLib::lerp(clr_x10, clr_x11, weight_y);
-							dst_32f[(z * dst_height + y) * dst_width + x] = MathLib::lerp(clr_y0, clr_y1, weight_z);
-						}
-					}
-				}
-			}
-			else
-			{
-				for (uint32_t z = 0; z < dst_depth; ++ z)
-				{
-					float fz = static_cast<float>(z + 0.5f) / dst_depth * src_depth;
-					uint32_t sz = std::min(static_cast<uint32_t>(fz), src_depth - 1);
-
-					for (uint32_t y = 0; y < dst_height; ++ y)
-					{
-						float fy = static_cast<float>(y + 0.5f) / dst_height * src_height;
-						uint32_t sy = std::min(static_cast<uint32_t>(fy), src_height - 1);
-
-						for (uint32_t x = 0; x < dst_width; ++ x)
-						{
-							float fx = static_cast<float>(x + 0.5f) / dst_width * src_width;
-							uint32_t sx = std::min(static_cast<uint32_t>(fx), src_width - 1);
-							dst_32f[(z * dst_height + y) * dst_width + x] = src_32f[(sz * src_height + sy) * src_width + sx];
-						}
-					}
-				}
-			}
-
-			{
-				for (uint32_t z = 0; z < dst_depth; ++ z)
-				{
-					for (uint32_t y = 0; y < dst_height; ++ y)
-					{
-						ConvertFromABGR32F(dst_cpu_format, &dst_32f[(z * dst_height + y) * dst_width], dst_width, dst_ptr + z * dst_cpu_slice_pitch + y * dst_cpu_row_pitch);
-					}
-				}
-			}
+			ResampleImage(dst_ptr, dst_cpu_row_pitch, dst_cpu_slice_pitch, dst_cpu_format, dst_width, dst_height, dst_depth,
+				src_ptr, src_cpu_row_pitch, src_cpu_slice_pitch, src_cpu_format, src_width, src_height, src_depth, filter);
 		}
 
 		if (IsCompressedFormat(dst_format))
@@ -34,14 +34,388 @@
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/App3D.hpp>
 
+#include <algorithm>
 #include <cstring>
 
+#ifdef KLAYGE_COMPILER_MSVC
+	#include <intrin.h>		// For _BitScanForward and _BitScanReverse
+#endif
+
 #include <KlayGE/TransientBuffer.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	// v must not be 0
+	uint32_t LowestBit(uint32_t v)
+	{
+		BOOST_ASSERT(v != 0);
+#ifdef KLAYGE_COMPILER_MSVC
+		unsigned long index;
+		_BitScanForward(&index, v);
+		return index;
+#else
+		return __builtin_ctz(v);
+#endif
+	}
+
+	// v must not be 0
+	uint32_t HighestBit(uint32_t v)
+	{
+		BOOST_ASSERT(v != 0);
+#ifdef KLAYGE_COMPILER_MSVC
+		unsigned long index;
+		_BitScanReverse(&index, v);
+		return index;
+#else
+		return 31 - __builtin_clz(v);
+#endif
+	}
+}
+
 namespace KlayGE
 {
-	TransientBuffer::TransientBuffer(uint32_t size_in_byte, TransientBuffer::BindFlag bind_flag)
-		: bind_flag_(bind_flag)
+	FrameRingSubAllocator::FrameRingSubAllocator(uint32_t capacity)
+		: capacity_(capacity), head_(0), tail_(0)
+	{
+	}
+
+	bool FrameRingSubAllocator::Alloc(uint32_t size_in_byte, SubAlloc& alloc)
+	{
+		if (0 == size_in_byte)
+		{
+			alloc = SubAlloc(0, 0);
+			return true;
+		}
+		if (size_in_byte > capacity_)
+		{
+			return false;
+		}
+
+		uint64_t pos = head_;
+		uint32_t offset = static_cast<uint32_t>(pos % capacity_);
+		if (offset + size_in_byte > capacity_)
+		{
+			// Skips the rest of the ring, it comes back with the frame. If nothing is in flight, it's free right away.
+			pos += capacity_ - offset;
+			offset = 0;
+			if (head_ == tail_)
+			{
+				tail_ = pos;
+			}
+		}
+		if (pos + size_in_byte - tail_ > capacity_)
+		{
+			return false;
+		}
+
+		head_ = pos + size_in_byte;
+		alloc = SubAlloc(offset, size_in_byte);
+		return true;
+	}
+
+	void FrameRingSubAllocator::EndFrame(uint32_t frame_id)
+	{
+		if (!frames_.empty() && (frames_.back().frame_id == frame_id))
+		{
+			frames_.back().end = head_;
+		}
+		else if (head_ != (frames_.empty() ? tail_ : frames_.back().end))
+		{
+			frames_.push_back({ frame_id, head_ });
+		}
+	}
+
+	void FrameRingSubAllocator::RetireFrames(uint32_t last_frame_id)
+	{
+		while (!frames_.empty() && (frames_.front().frame_id <= last_frame_id))
+		{
+			tail_ = std::max(tail_, frames_.front().end);
+			frames_.pop_front();
+		}
+	}
+
+	void FrameRingSubAllocator::Grow(uint32_t capacity)
+	{
+		BOOST_ASSERT(capacity > capacity_);
+
+		// Moves to a position that maps to offset 0 of the new ring. [0, old capacity) holds everything in flight, including
+		// the current frame, so it's treated as allocated until the current frame is retired.
+		uint64_t const base = (head_ + capacity - 1) / capacity * capacity;
+		tail_ = base;
+		head_ = base + capacity_;
+		for (auto& frame : frames_)
+		{
+			frame.end = tail_;
+		}
+
+		capacity_ = capacity;
+	}
+
+
+	TlsfSubAllocator::TlsfSubAllocator(uint32_t capacity)
+		: capacity_(0), last_phys_block_(INVALID_BLOCK), fl_bitmap_(0)
+	{
+		sl_bitmaps_.fill(0);
+		for (auto& heads : free_heads_)
+		{
+			heads.fill(INVALID_BLOCK);
+		}
+
+		this->Grow(capacity);
+	}
+
+	void TlsfSubAllocator::Mapping(uint32_t size, uint32_t& fl, uint32_t& sl)
+	{
+		uint32_t const units = size / GRANULARITY;
+		if (units < SL_COUNT)
+		{
+			fl = 0;
+			sl = units;
+		}
+		else
+		{
+			uint32_t const hb = HighestBit(units);
+			fl = hb - SL_BITS + 1;
+			sl = (units >> (hb - SL_BITS)) ^ SL_COUNT;
+		}
+	}
+
+	uint32_t TlsfSubAllocator::NewBlock()
+	{
+		uint32_t index;
+		if (unused_blocks_.empty())
+		{
+			index = static_cast<uint32_t>(blocks_.size());
+			blocks_.emplace_back();
+		}
+		else
+		{
+			index = unused_blocks_.back();
+			unused_blocks_.pop_back();
+		}
+		return index;
+	}
+
+	void TlsfSubAllocator::InsertFreeBlock(uint32_t index)
+	{
+		Block& block = blocks_[index];
+		uint32_t fl, sl;
+		Mapping(block.size, fl, sl);
+
+		uint32_t& head = free_heads_[fl][sl];
+		block.free = true;
+		block.prev_free = INVALID_BLOCK;
+		block.next_free = head;
+		if (head != INVALID_BLOCK)
+		{
+			blocks_[head].prev_free = index;
+		}
+		head = index;
+
+		fl_bitmap_ |= 1U << fl;
+		sl_bitmaps_[fl] |= 1U << sl;
+	}
+
+	void TlsfSubAllocator::RemoveFreeBlock(uint32_t index)
+	{
+		Block& block = blocks_[index];
+		uint32_t fl, sl;
+		Mapping(block.size, fl, sl);
+
+		if (block.prev_free != INVALID_BLOCK)
+		{
+			blocks_[block.prev_free].next_free = block.next_free;
+		}
+		else
+		{
+			free_heads_[fl][sl] = block.next_free;
+			if (block.next_free == INVALID_BLOCK)
+			{
+				sl_bitmaps_[fl] &= ~(1U << sl);
+				if (0 == sl_bitmaps_[fl])
+				{
+					fl_bitmap_ &= ~(1U << fl);
+				}
+			}
+		}
+		if (block.next_free != INVALID_BLOCK)
+		{
+			blocks_[block.next_free].prev_free = block.prev_free;
+		}
+		block.free = false;
+	}
+
+	bool TlsfSubAllocator::Alloc(uint32_t size_in_byte, SubAlloc& alloc)
+	{
+		if (0 == size_in_byte)
+		{
+			alloc = SubAlloc(0, 0);
+			return true;
+		}
+
+		uint32_t const size = (size_in_byte + GRANULARITY - 1) & ~(GRANULARITY - 1);
+		if (size < size_in_byte)
+		{
+			return false;
+		}
+
+		// Rounds up to the next size class, so any block in the list found is large enough
+		uint32_t search_size = size;
+		if (size / GRANULARITY >= SL_COUNT)
+		{
+			uint32_t const round = (1U << (HighestBit(size / GRANULARITY) - SL_BITS)) - 1;
+			search_size = size + round * GRANULARITY;
+			if (search_size < size)
+			{
+				return false;
+			}
+		}
+		uint32_t fl, sl;
+		Mapping(search_size, fl, sl);
+
+		uint32_t sl_map = sl_bitmaps_[fl] & (~0U << sl);
+		if (0 == sl_map)
+		{
+			uint32_t const fl_map = (fl + 1 < FL_COUNT) ? (fl_bitmap_ & (~0U << (fl + 1))) : 0;
+			if (0 == fl_map)
+			{
+				return false;
+			}
+			fl = LowestBit(fl_map);
+			sl_map = sl_bitmaps_[fl];
+		}
+		sl = LowestBit(sl_map);
+
+		uint32_t const index = free_heads_[fl][sl];
+		BOOST_ASSERT(blocks_[index].size >= size);
+		this->RemoveFreeBlock(index);
+
+		if (blocks_[index].size > size)
+		{
+			uint32_t const rest = this->NewBlock();
+			Block& block = blocks_[index];
+			Block& rest_block = blocks_[rest];
+			rest_block.offset = block.offset + size;
+			rest_block.size = block.size - size;
+			rest_block.prev_phys = index;
+			rest_block.next_phys = block.next_phys;
+			if (block.next_phys != INVALID_BLOCK)
+			{
+				blocks_[block.next_phys].prev_phys = rest;
+			}
+			else
+			{
+				last_phys_block_ = rest;
+			}
+			block.next_phys = rest;
+			block.size = size;
+			this->InsertFreeBlock(rest);
+		}
+
+		Block const & block = blocks_[index];
+		used_block_at_[block.offset / GRANULARITY] = index;
+		alloc = SubAlloc(block.offset, size_in_byte);
+		return true;
+	}
+
+	void TlsfSubAllocator::Free(SubAlloc const & alloc)
+	{
+		if (0 == alloc.length_)
+		{
+			return;
+		}
+
+		BOOST_ASSERT(alloc.offset_ % GRANULARITY == 0);
+		uint32_t index = used_block_at_[alloc.offset_ / GRANULARITY];
+		BOOST_ASSERT((index != INVALID_BLOCK) && !blocks_[index].free);
+		used_block_at_[alloc.offset_ / GRANULARITY] = INVALID_BLOCK;
+
+		uint32_t const prev = blocks_[index].prev_phys;
+		if ((prev != INVALID_BLOCK) && blocks_[prev].free)
+		{
+			this->RemoveFreeBlock(prev);
+			Block& prev_block = blocks_[prev];
+			Block const & block = blocks_[index];
+			prev_block.size += block.size;
+			prev_block.next_phys = block.next_phys;
+			if (block.next_phys != INVALID_BLOCK)
+			{
+				blocks_[block.next_phys].prev_phys = prev;
+			}
+			else
+			{
+				last_phys_block_ = prev;
+			}
+			unused_blocks_.push_back(index);
+			index = prev;
+		}
+
+		uint32_t const next = blocks_[index].next_phys;
+		if ((next != INVALID_BLOCK) && blocks_[next].free)
+		{
+			this->RemoveFreeBlock(next);
+			Block& block = blocks_[index];
+			Block const & next_block = blocks_[next];
+			block.size += next_block.size;
+			block.next_phys = next_block.next_phys;
+			if (next_block.next_phys != INVALID_BLOCK)
+			{
+				blocks_[next_block.next_phys].prev_phys = index;
+			}
+			else
+			{
+				last_phys_block_ = index;
+			}
+			unused_blocks_.push_back(next);
+		}
+
+		this->InsertFreeBlock(index);
+	}
+
+	void TlsfSubAllocator::Grow(uint32_t capacity)
+	{
+		BOOST_ASSERT(capacity >= capacity_);
+
+		// Space beyond the last GRANULARITY aligned offset can't be used
+		capacity &= ~(GRANULARITY - 1);
+		if (capacity <= capacity_)
+		{
+			return;
+		}
+
+		uint32_t const added = capacity - capacity_;
+		used_block_at_.resize(capacity / GRANULARITY, INVALID_BLOCK);
+
+		if ((last_phys_block_ != INVALID_BLOCK) && blocks_[last_phys_block_].free)
+		{
+			this->RemoveFreeBlock(last_phys_block_);
+			blocks_[last_phys_block_].size += added;
+			this->InsertFreeBlock(last_phys_block_);
+		}
+		else
+		{
+			uint32_t const index = this->NewBlock();
+			Block& block = blocks_[index];
+			block.offset = capacity_;
+			block.size = added;
+			block.prev_phys = last_phys_block_;
+			block.next_phys = INVALID_BLOCK;
+			if (last_phys_block_ != INVALID_BLOCK)
+			{
+				blocks_[last_phys_block_].next_phys = index;
+			}
+			last_phys_block_ = index;
+			this->InsertFreeBlock(index);
+		}
+
+		capacity_ = capacity;
+	}
+
+
+	TransientBuffer::TransientBuffer(uint32_t size_in_byte, TransientBuffer::BindFlag bind_flag, AllocPolicy policy)
+		: bind_flag_(bind_flag), policy_(policy)
 	{
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine const & re = rf.RenderEngineInstance();
@@ -61,11 +435,14 @@ namespace KlayGE
 			valid_max_ = 0;
 		}
 
-		SubAlloc alloc(0, size_in_byte);
-		free_list_.push_back(alloc);
-
-		App3DFramework const & app = Context::Instance().AppInstance();
-		retired_frames_.push_back(RetiredFrame(app.TotalNumFrames() + 1));
+		if (AP_FrameRing == policy_)
+		{
+			ring_allocator_ = MakeUniquePtr<FrameRingSubAllocator>(size_in_byte);
+		}
+		else
+		{
+			tlsf_allocator_ = MakeUniquePtr<TlsfSubAllocator>(size_in_byte);
+		}
 	}
 
 	GraphicsBufferPtr TransientBuffer::DoCreateBuffer(TransientBuffer::BindFlag bind_flag, uint32_t size_in_byte)
@@ -91,38 +468,26 @@ namespace KlayGE
 	SubAlloc TransientBuffer::Alloc(uint32_t size_in_byte, void const * data)
 	{
 		SubAlloc ret;
-
-		// Use first fit method to find a free sub alloc
-		bool found = false;
-		auto iter = free_list_.begin();
-		auto first_fit_iter = iter;
-		for (; iter != free_list_.end(); ++ iter)
+		for (;;)
 		{
-			if (iter->length_ >= size_in_byte)
+			bool const found = ring_allocator_ ? ring_allocator_->Alloc(size_in_byte, ret) : tlsf_allocator_->Alloc(size_in_byte, ret);
+			if (found)
 			{
-				first_fit_iter = iter;
-				found = true;
 				break;
 			}
-		}
 
-		// If there is not enough space, reallocate a larger buffer.
-		if (!found)
-		{
+			// If there is not enough space, reallocate a larger buffer.
 			uint32_t const old_buffer_size = buffer_->Size();
-			uint32_t larger_buffer_size = std::max(old_buffer_size * 2, old_buffer_size + size_in_byte);
+			uint32_t const larger_buffer_size = std::max(old_buffer_size * 2, old_buffer_size + size_in_byte);
 			GraphicsBufferPtr larger_buffer = this->DoCreateBuffer(bind_flag_, larger_buffer_size);
-			SubAlloc alloc(old_buffer_size, larger_buffer_size - old_buffer_size);
-			if (!free_list_.empty() && (free_list_.back().offset_ + free_list_.back().length_ == alloc.offset_))
+			if (ring_allocator_)
 			{
-				free_list_.back().length_ += alloc.length_;
+				ring_allocator_->Grow(larger_buffer_size);
 			}
 			else
 			{
-				free_list_.push_back(alloc);
+				tlsf_allocator_->Grow(larger_buffer_size);
 			}
-			first_fit_iter = free_list_.end();
-			-- first_fit_iter;
 			if (use_no_overwrite_)
 			{
 				buffer_->CopyToBuffer(*larger_buffer);
@@ -134,17 +499,9 @@ namespace KlayGE
 			buffer_ = larger_buffer;
 		}
 
-		uint32_t left_size = first_fit_iter->length_ - size_in_byte;
-		ret.length_ = size_in_byte;
-		ret.offset_ = first_fit_iter->offset_;
-		if (0 == left_size)
-		{
-			free_list_.erase(first_fit_iter);
-		}
-		else
+		if (0 == ret.length_)
 		{
-			first_fit_iter->length_ = left_size;
-			first_fit_iter->offset_ += size_in_byte;
+			return ret;
 		}
 
 		if (use_no_overwrite_)
@@ -165,10 +522,12 @@ namespace KlayGE
 
 	void TransientBuffer::Dealloc(SubAlloc const & alloc)
 	{
-		if ((alloc.length_ > 0) && !retired_frames_.empty())
+		if (alloc.length_ > 0)
 		{
-			RetiredFrame& frame = retired_frames_.back();
-			frame.pending_frees_.push_back(alloc);
+			if (tlsf_allocator_)
+			{
+				pending_frees_.push_back(alloc);
+			}
 
 			if (!use_no_overwrite_)
 			{
@@ -186,99 +545,49 @@ namespace KlayGE
 
 	void TransientBuffer::OnPresent()
 	{
-		if (!retired_frames_.empty())
-		{
-			App3DFramework const & app = Context::Instance().AppInstance();
-			uint32_t const frame_id = app.TotalNumFrames();
+		App3DFramework const & app = Context::Instance().AppInstance();
+		uint32_t const frame_id = app.TotalNumFrames();
 
-			// First, deal with deletes from this frame
-			RetiredFrame& ret_frame = retired_frames_.back();
-			if (!ret_frame.pending_frees_.empty()) 
-			{
-				// Append a new (empty) RetiredFrame to retired_frames_
-				retired_frames_.push_back(RetiredFrame(frame_id + 1));
-			}
-			// Second, return pending frees to free_list
-			auto frame_iter = retired_frames_.begin();
-			for (; frame_iter != retired_frames_.end();)
+		if (ring_allocator_)
+		{
+			ring_allocator_->EndFrame(frame_id);
+			if (frame_id >= num_pre_frames_)
 			{
-				if (frame_iter->frame_id + num_pre_frames_ <= frame_id)
-				{
-					auto iter = frame_iter->pending_frees_.begin();
-					for (; iter != frame_iter->pending_frees_.end(); ++ iter)
-					{
-						this->DoFree(*iter);
-					}
-					frame_iter = retired_frames_.erase(frame_iter);
-				}
-				else
-				{
-					++ frame_iter;
-				}
+				ring_allocator_->RetireFrames(frame_id - num_pre_frames_);
 			}
 		}
-	}
-
-	void TransientBuffer::DoFree(SubAlloc const & alloc)
-	{
-		if (free_list_.empty())
-		{
-			free_list_.push_back(alloc);
-		}
 		else
 		{
-			// Find where to insert the alloc
-			auto insert_position = free_list_.begin();
-			while (insert_position != free_list_.end())
+			// First, deal with deletes from this frame
+			uint32_t const num_pending_frees = static_cast<uint32_t>(pending_frees_.size());
+			if (!retired_frames_.empty() && (retired_frames_.back().frame_id == frame_id))
 			{
-				if (insert_position->offset_ > alloc.offset_)
-				{
-					break;
-				}
-				++ insert_position;
+				retired_frames_.back().pending_frees_end = num_pending_frees;
 			}
-
-			bool left_merged = false;
-			// If the alloc is adjacent to previous alloc, merge them.
-			auto previous = insert_position;
-			if (insert_position != free_list_.begin())
+			else if (num_pending_frees != (retired_frames_.empty() ? 0 : retired_frames_.back().pending_frees_end))
 			{
-				-- previous;
-				if (previous->offset_ + previous->length_ == alloc.offset_)
-				{
-					previous->length_ += alloc.length_;
-					left_merged = true;
-				}
+				retired_frames_.push_back({ frame_id, num_pending_frees });
 			}
 
-			bool right_merged = false;
-			// If the alloc is adjecent to next alloc, merge them.
-			auto next = insert_position;
-			if (insert_position != free_list_.end())
+			// Second, return pending frees of the frames the GPU is done with
+			uint32_t num_frees = 0;
+			while (!retired_frames_.empty() && (retired_frames_.front().frame_id + num_pre_frames_ <= frame_id))
 			{
-				if (left_merged)
+				num_frees = retired_frames_.front().pending_frees_end;
+				retired_frames_.pop_front();
+			}
+			if (num_frees > 0)
+			{
+				for (uint32_t i = 0; i < num_frees; ++ i)
 				{
-					if (previous->offset_ + previous->length_ == next->offset_)
-					{
-						previous->length_ += next->length_;
-						free_list_.erase(next);
-						right_merged = true;
-					}
+					tlsf_allocator_->Free(pending_frees_[i]);
 				}
-				else
+				pending_frees_.erase(pending_frees_.begin(), pending_frees_.begin() + num_frees);
+				for (auto& frame : retired_frames_)
 				{
-					if (alloc.offset_ + alloc.length_ == next->offset_)
-					{
-						next->offset_ -= alloc.length_;
-						next->length_ += alloc.length_;
-						right_merged = true;
-					}
+					frame.pending_frees_end -= num_frees;
 				}
 			}
-			if (!(left_merged || right_merged))
-			{
-				free_list_.emplace(insert_position, alloc);
-			}
 		}
 	}
 
@@ -291,4 +600,61 @@ namespace KlayGE
 				valid_max_ - valid_min_);
 		}
 	}
+
+
+	ConstantBufferRing::ConstantBufferRing(uint32_t size_in_byte)
+	{
+		RenderEngine const & re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		use_no_overwrite_ = re.DeviceCaps().no_overwrite_support;
+		num_pre_frames_ = use_no_overwrite_ ? 3 : 1;
+		frame_id_ = Context::Instance().AppInstance().TotalNumFrames();
+
+		this->CreateBuffer(AlignedSize(size_in_byte));
+	}
+
+	void ConstantBufferRing::CreateBuffer(uint32_t size_in_byte)
+	{
+		// The old buffer, if any, is released after the constant buffers using it upload again
+		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+		buffer_ = rf.MakeConstantBuffer(BU_Dynamic, EAH_CPU_Write | EAH_GPU_Read, size_in_byte, nullptr);
+		allocator_ = MakeUniquePtr<FrameRingSubAllocator>(size_in_byte);
+	}
+
+	GraphicsBufferPtr const & ConstantBufferRing::Upload(void const * data, uint32_t size_in_byte, uint32_t& offset)
+	{
+		uint32_t const frame_id = Context::Instance().AppInstance().TotalNumFrames();
+		if (frame_id != frame_id_)
+		{
+			allocator_->EndFrame(frame_id_);
+			if (frame_id >= num_pre_frames_)
+			{
+				allocator_->RetireFrames(frame_id - num_pre_frames_);
+			}
+			frame_id_ = frame_id;
+		}
+
+		// All sizes are aligned, so are all offsets in the ring
+		uint32_t const aligned_size = AlignedSize(size_in_byte);
+		SubAlloc alloc;
+		if (!allocator_->Alloc(aligned_size, alloc))
+		{
+			this->CreateBuffer(std::max(allocator_->Capacity() * 2, aligned_size));
+			bool const succeeded = allocator_->Alloc(aligned_size, alloc);
+			BOOST_ASSERT(succeeded);
+			KFL_UNUSED(succeeded);
+		}
+		offset = alloc.offset_;
+
+		if (use_no_overwrite_)
+		{
+			GraphicsBuffer::Mapper mapper(*buffer_, BA_Write_No_Overwrite);
+			memcpy(mapper.Pointer<uint8_t>() + offset, data, size_in_byte);
+		}
+		else
+		{
+			buffer_->UpdateSubresource(offset, size_in_byte, data);
+		}
+
+		return buffer_;
+	}
 }
@@ -52,13 +52,29 @@
 #include <KlayGE/InputFactory.hpp>
 #include <KlayGE/FrameBuffer.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/Mesh.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/SIMDMath.hpp>
+#include <KFL/RadixSort.hpp>
+#include <KFL/TaskScheduler.hpp>
 
 #include <map>
 #include <algorithm>
 
 #include <KlayGE/SceneManager.hpp>
 
+namespace
+{
+	uint32_t constexpr INVALID_HIERARCHY_INDEX = ~0U;
+
+	enum HierarchyDirtyFlag : uint8_t
+	{
+		HDF_Bound = 1U << 0,
+		HDF_Transform = 1U << 1
+	};
+}
+
 namespace KlayGE
 {
 	// 캯
@@ -114,48 +130,108 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::ClipScene()
 	{
+		KLAYGE_PERF_ZONE("SceneManager::ClipScene");
+
 		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 		auto const& viewport = *re.CurFrameBuffer()->Viewport();
 		uint32_t const num_cameras = viewport.NumCameras();
+		uint32_t const num_nodes = static_cast<uint32_t>(all_scene_nodes_.size());
 
-		for (auto* sn : all_scene_nodes_)
+		for (auto& bounds : node_bounds_ws_)
 		{
-			auto& node = *sn;
-			node.FillVisibleMark(BoundOverlap::No);
-			if (node.Visible())
+			bounds.resize(num_nodes);
+		}
+		node_area_visibles_.resize(num_nodes * num_cameras);
+		node_local_visibles_.resize(num_nodes * num_cameras);
+
+		// The tests of a node itself don't depend on its parent, so they are done in parallel over ranges of nodes.
+		// node_area_visibles_ is the small object test, node_local_visibles_ is the result if the parent is Partial.
+		uint32_t constexpr NODES_PER_TASK = 256;
+		Context::Instance().TaskScheduler().parallel_for(0, num_nodes, NODES_PER_TASK,
+			[this, &viewport, num_cameras](uint32_t begin, uint32_t end)
 			{
-				if (node.Updated())
+				std::array<BoundOverlap, NODES_PER_TASK> frustum_results;
+
+				for (uint32_t n = begin; n < end; ++ n)
 				{
-					uint32_t const attr = node.Attrib();
+					AABBox const & aabb = all_scene_nodes_[n]->PosBoundWS();
+					for (uint32_t j = 0; j < 3; ++ j)
+					{
+						node_bounds_ws_[j][n] = aabb.Min()[j];
+						node_bounds_ws_[j + 3][n] = aabb.Max()[j];
+					}
+				}
 
-					for (uint32_t i = 0; i < num_cameras; ++i)
+				for (uint32_t i = 0; i < num_cameras; ++ i)
+				{
+					auto const& camera = *viewport.Camera(i);
+					float4x4 const& view_proj = camera_view_projs_[i];
+
+					bool const frustum_test = !camera.OmniDirectionalMode();
+					if (frustum_test)
 					{
-						auto const& camera = *viewport.Camera(i);
-						float4x4 const& view_proj = camera_view_projs_[i];
+						SIMDMathLib::IntersectAABBFrustum(*camera_frustums_[i], &node_bounds_ws_[0][begin], &node_bounds_ws_[1][begin],
+							&node_bounds_ws_[2][begin], &node_bounds_ws_[3][begin], &node_bounds_ws_[4][begin], &node_bounds_ws_[5][begin],
+							end - begin, frustum_results.data());
+					}
+
+					for (uint32_t n = begin; n < end; ++ n)
+					{
+						auto const& node = *all_scene_nodes_[n];
 
-						auto visible = this->VisibleTestFromParent(node, i);
-						if (BoundOverlap::Partial == visible)
+						bool area_visible = true;
+						BoundOverlap local_visible = BoundOverlap::Yes;
+						if (node.Visible() && node.Updated() && (node.Attrib() & SceneNode::SOA_Cullable))
 						{
-							if (attr & SceneNode::SOA_Cullable)
+							if (small_obj_threshold_ > 0)
 							{
-								visible = (small_obj_threshold_ <= 0) ||
-												  ((MathLib::ortho_area(camera.ForwardVec(), node.PosBoundWS()) > small_obj_threshold_) &&
-													  (MathLib::perspective_area(camera.EyePos(), view_proj, node.PosBoundWS()) >
-														  small_obj_threshold_))
-											  ? BoundOverlap::Yes
-											  : BoundOverlap::No;
+								area_visible = (MathLib::ortho_area(camera.ForwardVec(), node.PosBoundWS()) > small_obj_threshold_)
+									&& (MathLib::perspective_area(camera.EyePos(), view_proj, node.PosBoundWS()) > small_obj_threshold_);
 							}
-							else
+
+							if (!area_visible)
 							{
-								visible = BoundOverlap::Yes;
+								local_visible = BoundOverlap::No;
 							}
-
-							if (!camera.OmniDirectionalMode() && (attr & SceneNode::SOA_Cullable) && (BoundOverlap::Yes == visible))
+							else if (frustum_test)
 							{
-								visible = camera_frustums_[i]->Intersect(node.PosBoundWS());
+								local_visible = frustum_results[n - begin];
 							}
 						}
 
+						node_area_visibles_[n * num_cameras + i] = area_visible;
+						node_local_visibles_[n * num_cameras + i] = local_visible;
+					}
+				}
+			});
+
+		// all_scene_nodes_ is in traversal order, parents come before their children. Same rules as VisibleTestFromParent.
+		for (uint32_t n = 0; n < num_nodes; ++ n)
+		{
+			auto& node = *all_scene_nodes_[n];
+			node.FillVisibleMark(BoundOverlap::No);
+			if (node.Visible())
+			{
+				if (node.Updated())
+				{
+					for (uint32_t i = 0; i < num_cameras; ++i)
+					{
+						BoundOverlap const parent_bo = node.Parent() ? node.Parent()->VisibleMark(i) : BoundOverlap::Partial;
+
+						BoundOverlap visible;
+						if ((BoundOverlap::No == parent_bo) || !node_area_visibles_[n * num_cameras + i])
+						{
+							visible = BoundOverlap::No;
+						}
+						else if (BoundOverlap::Partial == parent_bo)
+						{
+							visible = node_local_visibles_[n * num_cameras + i];
+						}
+						else
+						{
+							visible = parent_bo;
+						}
+
 						node.VisibleMark(i, visible);
 					}
 				}
@@ -254,20 +330,14 @@ namespace KlayGE
 			{
 				RenderTechnique const * obj_tech = obj->GetRenderTechnique();
 				BOOST_ASSERT(obj_tech);
-				bool found = false;
-				for (auto& items : render_queue_)
-				{
-					if (items.first == obj_tech)
-					{
-						items.second.push_back(obj);
-						found = true;
-						break;
-					}
-				}
-				if (!found)
+				auto const bucket = render_bucket_indices_.Emplace(obj_tech, static_cast<uint32_t>(render_buckets_.size()));
+				uint32_t const bucket_index = bucket.first;
+				if (bucket.second)
 				{
-					render_queue_.emplace_back(obj_tech, std::vector<Renderable*>(1, obj));
+					render_buckets_.push_back({ obj_tech, 0, 0 });
 				}
+				++ render_buckets_[bucket_index].num_items;
+				render_queue_.emplace_back(obj, bucket_index);
 			}
 		}
 	}
@@ -371,6 +441,8 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::Update()
 	{
+		KLAYGE_PERF_ZONE("SceneManager::Update");
+
 		deferred_mode_ = !!Context::Instance().DeferredRenderingLayerInstance();
 
 		App3DFramework& app = Context::Instance().AppInstance();
@@ -391,7 +463,6 @@ namespace KlayGE
 
 			scene_root_.Traverse([this, app_time, frame_time](SceneNode& node) {
 				node.MainThreadUpdate(app_time, frame_time);
-				node.UpdateTransforms();
 
 				if (node.Visible())
 				{
@@ -406,7 +477,7 @@ namespace KlayGE
 
 				return true;
 			});
-			scene_root_.UpdatePosBoundSubtree();
+			this->UpdateHierarchy();
 
 			overlay_root_.ClearChildren();
 		}
@@ -435,10 +506,14 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::Flush(uint32_t urt)
 	{
+		KLAYGE_PERF_ZONE("SceneManager::Flush");
+
 		std::lock_guard<std::mutex> lock(update_mutex_);
 
 		urt_ = urt;
 
+		SkinnedModel::UpdateQueuedFrames();
+
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 		auto const& viewport = *re.CurFrameBuffer()->Viewport();
 		uint32_t const num_cameras = viewport.NumCameras();
@@ -613,65 +688,75 @@ namespace KlayGE
 			}
 		}
 
-		std::sort(render_queue_.begin(), render_queue_.end(),
-			[](std::pair<RenderTechnique const *, std::vector<Renderable*>> const & lhs,
-				std::pair<RenderTechnique const *, std::vector<Renderable*>> const & rhs)
+		// Buckets are ranked by technique weight, which puts transparent techniques last. Techniques with the same weight keep
+		// the order they are added.
+		render_bucket_order_.resize(render_buckets_.size());
+		for (uint32_t i = 0; i < render_bucket_order_.size(); ++ i)
+		{
+			render_bucket_order_[i] = i;
+		}
+		std::stable_sort(render_bucket_order_.begin(), render_bucket_order_.end(),
+			[this](uint32_t lhs, uint32_t rhs)
 			{
-				BOOST_ASSERT(lhs.first);
-				BOOST_ASSERT(rhs.first);
-
-				return lhs.first->Weight() < rhs.first->Weight();
+				return render_buckets_[lhs].tech->Weight() < render_buckets_[rhs].tech->Weight();
 			});
+		for (uint32_t i = 0; i < render_bucket_order_.size(); ++ i)
+		{
+			render_buckets_[render_bucket_order_[i]].rank = i;
+		}
 
 		float4 view_mat_z;
 		if (viewport.NumCameras() == 1)
 		{
 			view_mat_z = viewport.Camera(0)->ViewMatrix().Col(2);
 		}
-		for (auto& items : render_queue_)
+
+		// Sort key: bucket rank in the high 32 bits, and for opaque buckets with a single camera, the ordered bits of the
+		// min view depth in the low 32 bits, to draw front to back. The radix sort is stable, so other buckets keep the
+		// order renderables are added.
+		render_sort_items_.resize(render_queue_.size());
+		for (size_t i = 0; i < render_queue_.size(); ++ i)
 		{
-			if ((viewport.NumCameras() == 1) && !items.first->Transparent() && !items.first->HasDiscard() && (items.second.size() > 1))
+			Renderable* renderable = render_queue_[i].first;
+			auto const & bucket = render_buckets_[render_queue_[i].second];
+
+			uint64_t key = static_cast<uint64_t>(bucket.rank) << 32;
+			if ((viewport.NumCameras() == 1) && !bucket.tech->Transparent() && !bucket.tech->HasDiscard() && (bucket.num_items > 1))
 			{
-				std::vector<std::pair<float, uint32_t>> min_depths(items.second.size());
-				for (size_t j = 0; j < min_depths.size(); ++ j)
+				AABBox const & box = renderable->PosBound();
+				uint32_t const num = renderable->NumInstances();
+				float md = 1e10f;
+				for (uint32_t j = 0; j < num; ++ j)
 				{
-					Renderable const * renderable = items.second[j];
-					AABBox const & box = renderable->PosBound();
-					uint32_t const num = renderable->NumInstances();
-					float md = 1e10f;
-					for (uint32_t i = 0; i < num; ++ i)
+					float4x4 const & mat = renderable->GetInstance(j)->TransformToWorld();
+					float4 const zvec(MathLib::dot(mat.Row(0), view_mat_z),
+						MathLib::dot(mat.Row(1), view_mat_z), MathLib::dot(mat.Row(2), view_mat_z),
+						MathLib::dot(mat.Row(3), view_mat_z));
+					for (int k = 0; k < 8; ++ k)
 					{
-						float4x4 const & mat = renderable->GetInstance(i)->TransformToWorld();
-						float4 const zvec(MathLib::dot(mat.Row(0), view_mat_z),
-							MathLib::dot(mat.Row(1), view_mat_z), MathLib::dot(mat.Row(2), view_mat_z),
-							MathLib::dot(mat.Row(3), view_mat_z));
-						for (int k = 0; k < 8; ++ k)
-						{
-							float3 const v = box.Corner(k);
-							md = std::min(md, v.x() * zvec.x() + v.y() * zvec.y() + v.z() * zvec.z() + zvec.w());
-						}
+						float3 const v = box.Corner(k);
+						md = std::min(md, v.x() * zvec.x() + v.y() * zvec.y() + v.z() * zvec.z() + zvec.w());
 					}
-
-					min_depths[j] = std::make_pair(md, static_cast<uint32_t>(j));
 				}
 
-				std::sort(min_depths.begin(), min_depths.end());
-
-				std::vector<Renderable*> sorted_items(min_depths.size());
-				for (size_t j = 0; j < min_depths.size(); ++ j)
-				{
-					sorted_items[j] = items.second[min_depths[j].second];
-				}
-				items.second.swap(sorted_items);
+				key |= OrderedFloatBits(md);
 			}
 
-			for (auto const & item : items.second)
-			{
-				item->Render();
-			}
-			num_renderables_rendered_ += static_cast<uint32_t>(items.second.size());
+			render_sort_items_[i] = std::make_pair(key, renderable);
 		}
-		render_queue_.resize(0);
+
+		RadixSort(render_sort_items_, render_sort_scratch_,
+			[](std::pair<uint64_t, Renderable*> const & item) { return item.first; });
+
+		for (auto const & item : render_sort_items_)
+		{
+			item.second->Render();
+		}
+		num_renderables_rendered_ += static_cast<uint32_t>(render_sort_items_.size());
+
+		render_queue_.clear();
+		render_buckets_.clear();
+		render_bucket_indices_.Clear();
 
 		num_primitives_rendered_ += re.NumPrimitivesJustRendered();
 		num_vertices_rendered_ += re.NumVerticesJustRendered();
@@ -720,6 +805,276 @@ namespace KlayGE
 		return num_dispatch_calls_;
 	}
 
+	void SceneManager::MarkNodeDirty(SceneNode const & node, bool transform_changed)
+	{
+		// Nodes removed since the last rebuild still carry their old index
+		uint32_t const index = node.hierarchy_index_;
+		if ((index < hierarchy_nodes_.size()) && (hierarchy_nodes_[index] == &node))
+		{
+			hierarchy_dirties_[index] |= transform_changed ? HDF_Transform : HDF_Bound;
+			hierarchy_any_dirty_ = true;
+		}
+	}
+
+	void SceneManager::MarkHierarchyDirty()
+	{
+		hierarchy_changed_ = true;
+	}
+
+	void SceneManager::RebuildHierarchy()
+	{
+		KLAYGE_PERF_ZONE("SceneManager::RebuildHierarchy");
+
+		hierarchy_changed_ = false;
+
+		std::vector<SceneNode*> nodes;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> depths;
+		std::vector<float4x4> xforms;
+		std::vector<uint8_t> dirties;
+		std::vector<uint32_t> old_to_new(hierarchy_nodes_.size(), INVALID_HIERARCHY_INDEX);
+		nodes.reserve(hierarchy_nodes_.size());
+		parents.reserve(hierarchy_nodes_.size());
+		depths.reserve(hierarchy_nodes_.size());
+		xforms.reserve(hierarchy_nodes_.size());
+		dirties.reserve(hierarchy_nodes_.size());
+
+		struct StackItem
+		{
+			SceneNode* node;
+			uint32_t parent;
+			uint32_t depth;
+		};
+		std::vector<StackItem> stack(1, {&scene_root_, INVALID_HIERARCHY_INDEX, 0});
+		while (!stack.empty())
+		{
+			auto const item = stack.back();
+			stack.pop_back();
+
+			SceneNode& node = *item.node;
+			uint32_t const index = static_cast<uint32_t>(nodes.size());
+
+			// Nodes already in the hierarchy under the same parent keep their state, the others are recomputed
+			uint32_t const old_index = node.hierarchy_index_;
+			if ((old_index < hierarchy_nodes_.size()) && (hierarchy_nodes_[old_index] == &node))
+			{
+				old_to_new[old_index] = index;
+
+				uint32_t const old_parent = hierarchy_parents_[old_index];
+				SceneNode const * old_parent_node = (old_parent == INVALID_HIERARCHY_INDEX) ? nullptr : hierarchy_nodes_[old_parent];
+				uint8_t dirty = hierarchy_dirties_[old_index];
+				if (old_parent_node != node.Parent())
+				{
+					dirty |= HDF_Transform;
+				}
+				dirties.push_back(dirty);
+				xforms.push_back(hierarchy_xforms_[old_index]);
+			}
+			else
+			{
+				dirties.push_back(HDF_Transform);
+				xforms.push_back(node.xform_to_world_);
+			}
+
+			node.hierarchy_index_ = index;
+			nodes.push_back(&node);
+			parents.push_back(item.parent);
+			depths.push_back(item.depth);
+
+			for (auto iter = node.Children().rbegin(); iter != node.Children().rend(); ++ iter)
+			{
+				stack.push_back({iter->get(), index, item.depth + 1});
+			}
+		}
+
+		uint32_t const num_nodes = static_cast<uint32_t>(nodes.size());
+
+		std::vector<uint32_t> subtree_ends(num_nodes);
+		for (uint32_t i = 0; i < num_nodes; ++ i)
+		{
+			subtree_ends[i] = i + 1;
+		}
+		for (uint32_t i = num_nodes; i-- > 1;)
+		{
+			subtree_ends[parents[i]] = std::max(subtree_ends[parents[i]], subtree_ends[i]);
+		}
+
+		uint32_t const num_levels = depths.empty() ? 0 : *std::max_element(depths.begin(), depths.end()) + 1;
+		hierarchy_level_offsets_.assign(num_levels + 1, 0);
+		for (uint32_t const depth : depths)
+		{
+			++ hierarchy_level_offsets_[depth + 1];
+		}
+		for (uint32_t level = 0; level < num_levels; ++ level)
+		{
+			hierarchy_level_offsets_[level + 1] += hierarchy_level_offsets_[level];
+		}
+		hierarchy_levels_.resize(num_nodes);
+		{
+			std::vector<uint32_t> level_fills(hierarchy_level_offsets_.begin(), hierarchy_level_offsets_.end() - 1);
+			for (uint32_t i = 0; i < num_nodes; ++ i)
+			{
+				hierarchy_levels_[level_fills[depths[i]] ++] = i;
+			}
+		}
+
+		hierarchy_moveables_.clear();
+		for (uint32_t i = 0; i < num_nodes; ++ i)
+		{
+			if (nodes[i]->pos_aabb_os_ && (nodes[i]->Attrib() & SceneNode::SOA_Moveable))
+			{
+				hierarchy_moveables_.push_back(i);
+			}
+		}
+
+		std::vector<uint32_t> moved;
+		moved.reserve(hierarchy_moved_.size());
+		for (uint32_t const old_index : hierarchy_moved_)
+		{
+			uint32_t const new_index = old_to_new[old_index];
+			if (new_index != INVALID_HIERARCHY_INDEX)
+			{
+				moved.push_back(new_index);
+			}
+		}
+
+		hierarchy_nodes_.swap(nodes);
+		hierarchy_parents_.swap(parents);
+		hierarchy_subtree_ends_.swap(subtree_ends);
+		hierarchy_xforms_.swap(xforms);
+		hierarchy_dirties_.swap(dirties);
+		hierarchy_moved_.swap(moved);
+		hierarchy_any_dirty_ = true;
+	}
+
+	void SceneManager::UpdateHierarchy()
+	{
+		KLAYGE_PERF_ZONE("SceneManager::UpdateHierarchy");
+
+		if (hierarchy_changed_)
+		{
+			this->RebuildHierarchy();
+		}
+
+		for (uint32_t const index : hierarchy_moved_)
+		{
+			auto& node = *hierarchy_nodes_[index];
+			node.prev_xform_to_world_ = node.xform_to_world_;
+		}
+		hierarchy_moved_.clear();
+
+		for (uint32_t const index : hierarchy_moveables_)
+		{
+			hierarchy_dirties_[index] |= HDF_Bound;
+			hierarchy_any_dirty_ = true;
+		}
+
+		// Nothing moved and nothing changed, a static scene stops here
+		if (!hierarchy_any_dirty_)
+		{
+			return;
+		}
+		hierarchy_any_dirty_ = false;
+
+		uint32_t const num_nodes = static_cast<uint32_t>(hierarchy_nodes_.size());
+
+		uint32_t num_dirty_xforms = 0;
+		for (uint32_t i = 0; i < num_nodes;)
+		{
+			if (hierarchy_dirties_[i] & HDF_Transform)
+			{
+				uint32_t const end = hierarchy_subtree_ends_[i];
+				for (uint32_t j = i; j < end; ++ j)
+				{
+					hierarchy_dirties_[j] |= HDF_Transform;
+					hierarchy_moved_.push_back(j);
+				}
+				num_dirty_xforms += end - i;
+				i = end;
+			}
+			else
+			{
+				++ i;
+			}
+		}
+
+		if (num_dirty_xforms > 0)
+		{
+			auto update_xform = [this](uint32_t index)
+			{
+				auto& node = *hierarchy_nodes_[index];
+				uint32_t const parent = hierarchy_parents_[index];
+				float4x4& xform = hierarchy_xforms_[index];
+				if (parent == INVALID_HIERARCHY_INDEX)
+				{
+					xform = node.xform_to_parent_;
+				}
+				else
+				{
+					xform = node.xform_to_parent_ * hierarchy_xforms_[parent];
+				}
+
+				node.prev_xform_to_world_ = node.xform_to_world_;
+				node.xform_to_world_ = xform;
+				node.inv_xform_to_world_ = MathLib::inverse_affine(xform);
+			};
+
+			uint32_t const MIN_NODES_PER_TASK = 256;
+			auto& scheduler = Context::Instance().TaskScheduler();
+			if (num_dirty_xforms < MIN_NODES_PER_TASK * scheduler.concurrency())
+			{
+				// hierarchy_moved_ is in traversal order, parents are updated before their children
+				for (uint32_t const index : hierarchy_moved_)
+				{
+					update_xform(index);
+				}
+			}
+			else
+			{
+				for (size_t level = 0; level + 1 < hierarchy_level_offsets_.size(); ++ level)
+				{
+					scheduler.parallel_for(hierarchy_level_offsets_[level], hierarchy_level_offsets_[level + 1], MIN_NODES_PER_TASK,
+						[this, &update_xform](uint32_t first, uint32_t last)
+						{
+							for (uint32_t i = first; i < last; ++ i)
+							{
+								uint32_t const index = hierarchy_levels_[i];
+								if (hierarchy_dirties_[index] & HDF_Transform)
+								{
+									update_xform(index);
+								}
+							}
+						});
+				}
+			}
+		}
+
+		// Bounds of parents include their children's, so every dirty node dirties its ancestors. The walk stops at the
+		//  first dirty ancestor, whose own ancestors are dirtied when it's visited.
+		for (uint32_t i = 0; i < num_nodes; ++ i)
+		{
+			if (hierarchy_dirties_[i])
+			{
+				uint32_t parent = hierarchy_parents_[i];
+				while ((parent != INVALID_HIERARCHY_INDEX) && !hierarchy_dirties_[parent])
+				{
+					hierarchy_dirties_[parent] |= HDF_Bound;
+					parent = hierarchy_parents_[parent];
+				}
+			}
+		}
+
+		// Children before parents
+		for (uint32_t i = num_nodes; i-- > 0;)
+		{
+			if (hierarchy_dirties_[i])
+			{
+				hierarchy_nodes_[i]->UpdatePosBound();
+				hierarchy_dirties_[i] = 0;
+			}
+		}
+	}
+
 	void SceneManager::FlushScene()
 	{
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
@@ -760,10 +1115,19 @@ namespace KlayGE
 
 		num_draw_calls_ = re.NumDrawsJustCalled();
 		num_dispatch_calls_ = re.NumDispatchesJustCalled();
+
+#ifndef KLAYGE_SHIP
+		PerfProfiler::Instance().Counter("Draw calls", num_draw_calls_);
+		PerfProfiler::Instance().Counter("Dispatch calls", num_dispatch_calls_);
+#endif
 	}
 
 	void SceneManager::UpdateThreadFunc()
 	{
+#ifndef KLAYGE_SHIP
+		PerfProfiler::Instance().ThreadName("Scene update");
+#endif
+
 		Timer timer;
 		float app_time = 0;
 		while (!quit_)
@@ -777,6 +1141,8 @@ namespace KlayGE
 				WindowPtr const & win = Context::Instance().AppInstance().MainWnd();
 				if (win && win->Active())
 				{
+					KLAYGE_PERF_ZONE("SceneManager::SubThreadUpdate");
+
 					std::lock_guard<std::mutex> lock(update_mutex_);
 
 					auto updater = [app_time, frame_time](SceneNode& node) {
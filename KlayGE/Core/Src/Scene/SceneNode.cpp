@@ -160,7 +160,7 @@ namespace KlayGE
 	{
 		parent_ = so;
 
-		pos_aabb_dirty_ = true;
+		this->MarkTransformDirty();
 		updated_ = false;
 	}
 
@@ -174,7 +174,7 @@ namespace KlayGE
 		auto iter = std::find(children_.begin(), children_.end(), node);
 		if (iter == children_.end())
 		{
-			pos_aabb_dirty_ = true;
+			this->MarkPosBoundDirty();
 			node->Parent(this);
 			children_.push_back(node);
 		}
@@ -190,7 +190,7 @@ namespace KlayGE
 		auto iter = std::find_if(children_.begin(), children_.end(), [node](SceneNodePtr const& child) { return child.get() == node; });
 		if (iter != children_.end())
 		{
-			pos_aabb_dirty_ = true;
+			this->MarkPosBoundDirty();
 			node->Parent(nullptr);
 			children_.erase(iter);
 
@@ -205,23 +205,12 @@ namespace KlayGE
 			child->Parent(nullptr);
 		}
 
-		pos_aabb_dirty_ = true;
+		this->MarkPosBoundDirty();
 		children_.clear();
 
 		this->EmitSceneChanged();
 	}
 
-	void SceneNode::Traverse(std::function<bool(SceneNode&)> const& callback)
-	{
-		if (callback(*this))
-		{
-			for (auto const& child : children_)
-			{
-				child->Traverse(callback);
-			}
-		}
-	}
-
 	uint32_t SceneNode::NumComponents() const
 	{
 		return static_cast<uint32_t>(components_.size());
@@ -259,7 +248,7 @@ namespace KlayGE
 
 		components_.push_back(component);
 		component->BindSceneNode(this);
-		pos_aabb_dirty_ = true;
+		this->MarkPosBoundDirty();
 	}
 
 	void SceneNode::RemoveComponent(SceneComponentPtr const& component)
@@ -275,14 +264,14 @@ namespace KlayGE
 		{
 			components_.erase(iter);
 			component->BindSceneNode(nullptr);
-			pos_aabb_dirty_ = true;
+			this->MarkPosBoundDirty();
 		}
 	}
 
 	void SceneNode::ClearComponents()
 	{
 		components_.clear();
-		pos_aabb_dirty_ = true;
+		this->MarkPosBoundDirty();
 	}
 
 	void SceneNode::ReplaceComponent(uint32_t index, SceneComponentPtr const& component)
@@ -302,7 +291,7 @@ namespace KlayGE
 
 		component->BindSceneNode(this);
 		components_[index] = component;
-		pos_aabb_dirty_ = true;
+		this->MarkPosBoundDirty();
 	}
 
 	void SceneNode::ForEachComponent(std::function<void(SceneComponent&)> const& callback) const
@@ -319,8 +308,8 @@ namespace KlayGE
 	void SceneNode::TransformToParent(float4x4 const& mat)
 	{
 		xform_to_parent_ = mat;
-		inv_xform_to_parent_ = MathLib::inverse(mat);
-		pos_aabb_dirty_ = true;
+		inv_xform_to_parent_ = MathLib::inverse_affine(mat);
+		this->MarkTransformDirty();
 	}
 
 	void SceneNode::TransformToWorld(float4x4 const& mat)
@@ -333,9 +322,9 @@ namespace KlayGE
 		{
 			xform_to_parent_ = mat;
 		}
-		inv_xform_to_parent_ = MathLib::inverse(mat);
+		inv_xform_to_parent_ = MathLib::inverse_affine(xform_to_parent_);
 
-		pos_aabb_dirty_ = true;
+		this->MarkTransformDirty();
 	}
 
 	float4x4 const& SceneNode::TransformToParent() const
@@ -387,7 +376,7 @@ namespace KlayGE
 			auto& scene_mgr = Context::Instance().SceneManagerInstance();
 			if (!scene_mgr.NodesUpdated())
 			{
-				inv_xform_to_world_ = MathLib::inverse(this->TransformToWorld());
+				inv_xform_to_world_ = MathLib::inverse_affine(this->TransformToWorld());
 			}
 			return inv_xform_to_world_;
 		}
@@ -414,7 +403,7 @@ namespace KlayGE
 		{
 			xform_to_world_ = xform_to_parent_;
 		}
-		inv_xform_to_world_ = MathLib::inverse(xform_to_world_);
+		inv_xform_to_world_ = MathLib::inverse_affine(xform_to_world_);
 
 		pos_aabb_dirty_ = true;
 	}
@@ -631,44 +620,81 @@ namespace KlayGE
 
 	void SceneNode::UpdatePosBoundSubtree()
 	{
-		for (auto const & child : children_)
+		std::vector<SceneNode*> nodes;
+		this->Traverse([&nodes](SceneNode& node)
+			{
+				nodes.push_back(&node);
+				return true;
+			});
+
+		// Children before parents
+		for (auto iter = nodes.rbegin(); iter != nodes.rend(); ++ iter)
 		{
-			child->UpdatePosBoundSubtree();
+			(*iter)->UpdatePosBound();
 		}
 
-		if (pos_aabb_dirty_)
+		// Bounds of the ancestors depend on this subtree
+		this->NotifySceneManager(false);
+	}
+
+	void SceneNode::UpdatePosBound()
+	{
+		if (pos_aabb_os_)
 		{
-			if (pos_aabb_os_)
-			{
-				pos_aabb_os_->Min() = float3(+1e10f, +1e10f, +1e10f);
-				pos_aabb_os_->Max() = float3(-1e10f, -1e10f, -1e10f);
+			pos_aabb_os_->Min() = float3(+1e10f, +1e10f, +1e10f);
+			pos_aabb_os_->Max() = float3(-1e10f, -1e10f, -1e10f);
 
-				for (auto const& component : components_)
+			for (auto const& component : components_)
+			{
+				auto const* renderable_comp = boost::typeindex::runtime_cast<RenderableComponent*>(component.get());
+				if (renderable_comp != nullptr)
 				{
-					auto const* renderable_comp = boost::typeindex::runtime_cast<RenderableComponent*>(component.get());
-					if (renderable_comp != nullptr)
-					{
-						*pos_aabb_os_ |= renderable_comp->BoundRenderable().PosBound();
-					}
+					*pos_aabb_os_ |= renderable_comp->BoundRenderable().PosBound();
 				}
+			}
 
-				for (auto const & child : children_)
+			for (auto const & child : children_)
+			{
+				if (child->pos_aabb_os_)
 				{
-					if (child->pos_aabb_os_)
+					if ((child->pos_aabb_os_->Min().x() < child->pos_aabb_os_->Max().x())
+						|| (child->pos_aabb_os_->Min().y() < child->pos_aabb_os_->Max().y())
+						|| (child->pos_aabb_os_->Min().z() < child->pos_aabb_os_->Max().z()))
 					{
-						if ((child->pos_aabb_os_->Min().x() < child->pos_aabb_os_->Max().x())
-							|| (child->pos_aabb_os_->Min().y() < child->pos_aabb_os_->Max().y())
-							|| (child->pos_aabb_os_->Min().z() < child->pos_aabb_os_->Max().z()))
-						{
-							*pos_aabb_os_ |= MathLib::transform_aabb(*child->pos_aabb_os_, child->TransformToParent());
-						}
+						*pos_aabb_os_ |= MathLib::transform_aabb(*child->pos_aabb_os_, child->TransformToParent());
 					}
 				}
-
-				*pos_aabb_ws_ = MathLib::transform_aabb(*pos_aabb_os_, xform_to_world_);
 			}
 
-			pos_aabb_dirty_ = false;
+			*pos_aabb_ws_ = MathLib::transform_aabb(*pos_aabb_os_, xform_to_world_);
+		}
+
+		pos_aabb_dirty_ = false;
+	}
+
+	void SceneNode::MarkTransformDirty()
+	{
+		pos_aabb_dirty_ = true;
+		this->NotifySceneManager(true);
+	}
+
+	void SceneNode::MarkPosBoundDirty()
+	{
+		pos_aabb_dirty_ = true;
+		this->NotifySceneManager(false);
+	}
+
+	void SceneNode::NotifySceneManager(bool transform_changed)
+	{
+		// Nodes that have never been under the scene root are skipped without touching the scene manager, they can be
+		//  built on loading threads
+		if (hierarchy_index_ != ~0U)
+		{
+			auto& context = Context::Instance();
+			if (context.SceneManagerValid())
+			{
+				context.SceneManagerInstance().MarkNodeDirty(*this, transform_changed);
+			}
 		}
 	}
 
@@ -686,6 +712,7 @@ namespace KlayGE
 			auto& scene_mgr = context.SceneManagerInstance();
 			if (node == &scene_mgr.SceneRootNode())
 			{
+				scene_mgr.MarkHierarchyDirty();
 				scene_mgr.OnSceneChanged();
 			}
 		}
@@ -112,11 +112,70 @@ namespace KlayGE
 			flip_winding_order_ = flip_winding_order;
 		}
 
+		bool OptimizeVertexCache() const
+		{
+			return optimize_vertex_cache_;
+		}
+		void OptimizeVertexCache(bool optimize)
+		{
+			optimize_vertex_cache_ = optimize;
+		}
+		// The ACMR a cluster can lose for less overdraw, 1 to 1.1 are typical. 0 disables the overdraw optimization.
+		float OverdrawThreshold() const
+		{
+			return overdraw_threshold_;
+		}
+		void OverdrawThreshold(float threshold)
+		{
+			overdraw_threshold_ = threshold;
+		}
+		bool OptimizeVertexFetch() const
+		{
+			return optimize_vertex_fetch_;
+		}
+		void OptimizeVertexFetch(bool optimize)
+		{
+			optimize_vertex_fetch_ = optimize;
+		}
+
 		uint32_t NumLods() const;
 		void NumLods(uint32_t lods);
 		std::string_view LodFileName(uint32_t lod) const;
 		void LodFileName(uint32_t lod, std::string_view lod_name);
 
+		// LODs simplified from LOD 0, used when there is no LOD file. Each one targets a ratio of the LOD 0 triangles, and
+		//  stops earlier if the error relative to the mesh extent would go over max error. The screen size is stored in the
+		//  model, a negative one keeps the default of Renderable::LodScreenSize.
+		uint32_t NumAutoLods() const
+		{
+			return static_cast<uint32_t>(auto_lods_.size());
+		}
+		void NumAutoLods(uint32_t lods);
+		float AutoLodRatio(uint32_t lod) const
+		{
+			return auto_lods_[lod].ratio;
+		}
+		void AutoLodRatio(uint32_t lod, float ratio)
+		{
+			auto_lods_[lod].ratio = ratio;
+		}
+		float AutoLodMaxError(uint32_t lod) const
+		{
+			return auto_lods_[lod].max_error;
+		}
+		void AutoLodMaxError(uint32_t lod, float max_error)
+		{
+			auto_lods_[lod].max_error = max_error;
+		}
+		float AutoLodScreenSize(uint32_t lod) const
+		{
+			return auto_lods_[lod].screen_size;
+		}
+		void AutoLodScreenSize(uint32_t lod, float screen_size)
+		{
+			auto_lods_[lod].screen_size = screen_size;
+		}
+
 		uint32_t NumMaterials() const;
 		void NumMaterials(uint32_t materials);
 		std::string_view MaterialFileName(uint32_t mtl_index) const;
@@ -142,7 +201,17 @@ namespace KlayGE
 		float3 scale_ = float3(1, 1, 1);
 		uint8_t axis_mapping_[3] = { 0, 1, 2 };
 		bool flip_winding_order_ = false;
+		bool optimize_vertex_cache_ = false;
+		float overdraw_threshold_ = 0;
+		bool optimize_vertex_fetch_ = false;
 		std::vector<std::string> lod_file_names_;
+		struct AutoLod
+		{
+			float ratio = 0.5f;
+			float max_error = 1;
+			float screen_size = -1;
+		};
+		std::vector<AutoLod> auto_lods_;
 		std::vector<std::string> material_file_names_;
 
 		float4x4 transform_ = float4x4::Identity();
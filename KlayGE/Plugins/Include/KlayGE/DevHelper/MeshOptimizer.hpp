@@ -0,0 +1,87 @@
+/**
+ * @file MeshOptimizer.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_TOOLS_TOOL_COMMON_MESH_OPTIMIZER_HPP
+#define KLAYGE_TOOLS_TOOL_COMMON_MESH_OPTIMIZER_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/CXX2a/span.hpp>
+#include <KFL/Vector.hpp>
+
+#include <vector>
+
+#include <KlayGE/DevHelper/DevHelper.hpp>
+
+namespace KlayGE
+{
+	struct VertexCacheStatistics
+	{
+		uint32_t vertices_transformed = 0;
+		// Average cache miss ratio, transformed vertices per triangle. 0.5 is the best for a regular grid.
+		float acmr = 0;
+		// Average transform to vertex ratio, transformed vertices per referenced vertex. 1 is the best.
+		float atvr = 0;
+	};
+
+	// Index buffer and vertex buffer optimizations on triangle lists
+	class KLAYGE_DEV_HELPER_API MeshOptimizer final
+	{
+	public:
+		// A FIFO cache of this size is what the statistics are measured with
+		static uint32_t constexpr ANALYZE_CACHE_SIZE = 16;
+
+		static VertexCacheStatistics AnalyzeVertexCache(std::span<uint32_t const> indices, uint32_t num_vertices,
+			uint32_t cache_size = ANALYZE_CACHE_SIZE);
+
+		// Reorders triangles for post-transform cache reuse, with Tom Forsyth's linear-speed algorithm
+		static void OptimizeVertexCache(std::span<uint32_t> indices, uint32_t num_vertices);
+
+		// Splits the triangles into clusters where the cache is cold, or where the ACMR so far is within threshold times of
+		//  the ACMR of the whole run, then draws the clusters that face outwards first. Run it after OptimizeVertexCache.
+		//  Front faces are clockwise.
+		static void OptimizeOverdraw(std::span<uint32_t> indices, std::span<float3 const> positions, float threshold);
+
+		// Renumbers vertices in the order of their first use. remap maps the old index to the new one, or to 0xFFFFFFFF
+		//  for unreferenced vertices. Returns the number of referenced vertices.
+		static uint32_t OptimizeVertexFetch(std::span<uint32_t> indices, uint32_t num_vertices, std::vector<uint32_t>& remap);
+
+		// Simplifies the triangles by quadric error edge collapses, until there are no more than target_index_count indices
+		//  or the next collapse costs more than target_error. Vertices collapse onto their neighbors, so the result still
+		//  indexes the same vertices. Vertices on borders and on attribute seams are locked. attributes has num_attributes
+		//  floats per vertex, already scaled by their weights, and can be empty. Errors are relative to the mesh extent.
+		//  Returns the error of the result.
+		static float Simplify(std::vector<uint32_t>& indices, std::span<float3 const> positions,
+			std::span<float const> attributes, uint32_t num_attributes, uint32_t target_index_count, float target_error);
+	};
+}
+
+#endif		// KLAYGE_TOOLS_TOOL_COMMON_MESH_OPTIMIZER_HPP
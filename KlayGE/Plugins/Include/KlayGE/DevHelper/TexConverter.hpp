@@ -35,8 +35,11 @@
 
 #include <KlayGE/PreDeclare.hpp>
 #include <KFL/CXX17/string_view.hpp>
+#include <KFL/CXX2a/span.hpp>
 #include <KlayGE/ElementFormat.hpp>
 
+#include <functional>
+#include <string>
 #include <vector>
 
 #include <KlayGE/DevHelper/DevHelper.hpp>
@@ -47,7 +50,12 @@ namespace KlayGE
 	class KLAYGE_DEV_HELPER_API TexConverter final
 	{
 	public:
+		// Slices and mips are processed in parallel. Results are cached in <local folder>/TexCache, keyed by the hash of
+		//  the input files and the metadata, so unchanged textures are loaded from there without converting.
 		TexturePtr Load(std::string_view input_name, TexMetadata const & metadata);
+		// Converts the textures on all cores. on_loaded is called on the worker threads, with the index of the input.
+		void LoadBatch(std::span<std::string const> input_names, std::span<TexMetadata const> metadata,
+			std::function<void(uint32_t index, TexturePtr const & texture)> const & on_loaded);
 
 		void GetImageInfo(std::string_view input_name, TexMetadata const & metadata,
 			Texture::TextureType& type,
@@ -89,11 +89,17 @@ namespace KlayGE
 		void DoReset() override;
 		void DoPlay(bool loop) override;
 		void DoStop() override;
+		bool DoUpdateStream(std::chrono::microseconds& next_update) override;
 
 	private:
 		float3 pos_;
 		float3 vel_;
 		float3 dir_;
+
+		// Consumes the stream in real time, as a device would
+		std::atomic<bool> playing_{false};
+		std::chrono::steady_clock::time_point play_start_time_;
+		uint64_t consumed_bytes_{0};
 	};
 
 	class NullAudioEngine final : public AudioEngine
@@ -104,24 +104,20 @@ namespace KlayGE
 		float3 Direction() const override;
 		void Direction(float3 const & v) override;
 
-		void LoopUpdateBuffer();
-
 	private:
 		void DoReset() override;
 		void DoPlay(bool loop) override;
 		void DoStop() override;
+		bool DoUpdateStream(std::chrono::microseconds& next_update) override;
+
+		void UnqueueAll();
+		void QueueFreeBuffers();
 
 	private:
 		ALuint source_;
 		std::vector<ALuint> buffer_queue_;
-
-		bool loop_;
-
-		bool played_;
-		bool stopped_;
-		std::condition_variable play_cond_;
-		std::mutex play_mutex_;
-		joiner<void> play_thread_;
+		std::vector<ALuint> free_buffers_;
+		std::vector<uint8_t> chunk_;
 	};
 
 	class OALAudioEngine final : public AudioEngine
@@ -81,6 +81,8 @@ namespace KlayGE
 		void BindSamplers(GLuint first, GLsizei count, GLuint const * samplers, bool force = false);
 		void BindBuffer(GLenum target, GLuint buffer, bool force = false);
 		void BindBuffersBase(GLenum target, GLuint first, GLsizei count, GLuint const * buffers, bool force = false);
+		void BindBuffersRange(GLenum target, GLuint first, GLsizei count, GLuint const * buffers,
+			GLintptr const * offsets, GLsizeiptr const * sizes, bool force = false);
 		void DeleteTextures(GLsizei n, GLuint const * textures);
 		void DeleteSamplers(GLsizei n, GLuint const * samplers);
 		void DeleteBuffers(GLsizei n, GLuint const * buffers);
@@ -201,6 +203,8 @@ namespace KlayGE
 		std::vector<GLuint> binded_samplers_;
 		std::map<GLenum, GLuint> binded_buffers_;
 		std::map<GLenum, std::vector<GLuint>> binded_buffers_with_binding_points_;
+		// (offset, size) of each binding point, size is 0 if the whole buffer is bound
+		std::map<GLenum, std::vector<std::pair<GLintptr, GLsizeiptr>>> binded_buffer_ranges_with_binding_points_;
 
 		GLuint restart_index_;
 
@@ -141,12 +141,12 @@ namespace KlayGE
 		void Direction(float3 const & v) override;
 
 	private:
-		void LoopUpdateBuffer();
-
 		void DoReset() override;
 		void DoPlay(bool loop) override;
 		void DoStop() override;
+		bool DoUpdateStream(std::chrono::microseconds& next_update) override;
 
+		void SubmitBuffers();
 		bool FillData(uint32_t size);
 
 	private:
@@ -163,14 +163,7 @@ namespace KlayGE
 		uint32_t buffer_size_;
 		uint32_t buffer_count_;
 		uint32_t curr_buffer_index_;
-
-		bool loop_;
-
-		bool played_;
-		bool stopped_;
-		std::condition_variable play_cond_;
-		std::mutex play_mutex_;
-		joiner<void> play_thread_;
+		bool end_submitted_;
 
 		X3DAUDIO_EMITTER emitter_;
 		X3DAUDIO_DSP_SETTINGS dsp_settings_;
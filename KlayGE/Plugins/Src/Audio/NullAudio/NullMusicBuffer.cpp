@@ -35,10 +35,8 @@
 namespace KlayGE
 {
 	NullMusicBuffer::NullMusicBuffer(AudioDataSourcePtr const & data_source, uint32_t buffer_seconds, float volume)
-					: MusicBuffer(data_source)
+					: MusicBuffer(data_source, buffer_seconds)
 	{
-		KFL_UNUSED(buffer_seconds);
-
 		this->Position(float3::Zero());
 		this->Velocity(float3::Zero());
 		this->Direction(float3::Zero());
@@ -60,16 +58,46 @@ namespace KlayGE
 
 	void NullMusicBuffer::DoPlay(bool loop)
 	{
-		KFL_UNUSED(loop);
+		this->PrepareStreaming(loop);
+
+		play_start_time_ = std::chrono::steady_clock::now();
+		consumed_bytes_ = 0;
+		playing_ = true;
+
+		this->StartStreaming();
 	}
 
 	void NullMusicBuffer::DoStop()
 	{
+		this->StopStreaming();
+
+		playing_ = false;
+	}
+
+	bool NullMusicBuffer::DoUpdateStream(std::chrono::microseconds& next_update)
+	{
+		auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - play_start_time_);
+		uint64_t const played_bytes = static_cast<uint64_t>(elapsed.count()) * this->BytesPerSecond() / 1000000;
+		if (played_bytes > consumed_bytes_)
+		{
+			consumed_bytes_ += this->SkipStream(static_cast<size_t>(played_bytes - consumed_bytes_));
+		}
+
+		if (this->StreamEnded())
+		{
+			playing_ = false;
+			return false;
+		}
+
+		// Pretends to have a buffer processed every 1 / BUFFERS_PER_SECOND second
+		next_update = std::chrono::microseconds(1000000 / BUFFERS_PER_SECOND);
+		return true;
 	}
 
 	bool NullMusicBuffer::IsPlaying() const
 	{
-		return false;
+		return playing_;
 	}
 
 	void NullMusicBuffer::Volume(float vol)
@@ -34,16 +34,15 @@
 
 #include <KlayGE/OpenAL/OALAudio.hpp>
 
-size_t constexpr READ_SIZE = 88200;
-
 namespace KlayGE
 {
 	OALMusicBuffer::OALMusicBuffer(AudioDataSourcePtr const & data_source, uint32_t buffer_seconds, float volume)
-							: MusicBuffer(data_source),
-								buffer_queue_(buffer_seconds * BUFFERS_PER_SECOND),
-								played_(false), stopped_(true)
+							: MusicBuffer(data_source, buffer_seconds),
+								buffer_queue_(buffer_seconds * BUFFERS_PER_SECOND)
 	{
 		alGenBuffers(static_cast<ALsizei>(buffer_queue_.size()), buffer_queue_.data());
+		free_buffers_.reserve(buffer_queue_.size());
+		chunk_.resize(this->StreamChunkSize());
 
 		alGenSources(1, &source_);
 		alSourcef(source_, AL_PITCH, 1);
@@ -65,119 +64,105 @@ namespace KlayGE
 		alDeleteSources(1, &source_);
 	}
 
-	void OALMusicBuffer::LoopUpdateBuffer()
+	void OALMusicBuffer::UnqueueAll()
 	{
-		std::unique_lock<std::mutex> lock(play_mutex_);
-		while (!played_)
+		alSourceStopv(1, &source_);
+
+		ALint queued;
+		alGetSourcei(source_, AL_BUFFERS_QUEUED, &queued);
+		if (queued > 0)
 		{
-			play_cond_.wait(lock);
+			auto cur_queue = MakeUniquePtr<ALuint[]>(queued);
+			alSourceUnqueueBuffers(source_, queued, &cur_queue[0]);
 		}
-		played_ = false;
 
-		while (!stopped_)
+		free_buffers_ = buffer_queue_;
+	}
+
+	void OALMusicBuffer::QueueFreeBuffers()
+	{
+		ALenum const format = Convert(format_);
+		while (!free_buffers_.empty())
 		{
-			ALint processed;
-			alGetSourcei(source_, AL_BUFFERS_PROCESSED, &processed);
-			if (processed > 0)
-			{
-				while (processed > 0)
-				{
-					-- processed;
-
-					ALuint buf;
-					alSourceUnqueueBuffers(source_, 1, &buf);
-
-					std::vector<uint8_t> data(READ_SIZE);
-					data.resize(data_source_->Read(data.data(), data.size()));
-					if (data.empty())
-					{
-						if (loop_)
-						{
-							stopped_ = false;
-							alSourceStopv(1, &source_);
-							this->DoReset();
-							alSourcePlay(source_);
-						}
-						else
-						{
-							stopped_ = true;
-						}
-					}
-					else
-					{
-						alBufferData(buf, Convert(format_), data.data(), static_cast<ALsizei>(data.size()), freq_);
-						alSourceQueueBuffers(source_, 1, &buf);
-					}
-				}
-			}
-			else
+			size_t const size = this->ReadStream(chunk_.data(), chunk_.size());
+			if (size == 0)
 			{
-				Sleep(1000 / BUFFERS_PER_SECOND);
+				break;
 			}
+
+			ALuint const buf = free_buffers_.back();
+			free_buffers_.pop_back();
+			alBufferData(buf, format, chunk_.data(), static_cast<ALsizei>(size), static_cast<ALsizei>(freq_));
+			alSourceQueueBuffers(source_, 1, &buf);
 		}
 	}
 
-	void OALMusicBuffer::DoReset()
+	bool OALMusicBuffer::DoUpdateStream(std::chrono::microseconds& next_update)
 	{
-		ALint queued_;
-		alGetSourcei(source_, AL_BUFFERS_QUEUED, &queued_);
-		if (queued_ > 0)
+		ALint processed;
+		alGetSourcei(source_, AL_BUFFERS_PROCESSED, &processed);
+		while (processed > 0)
 		{
-			auto cur_queue = MakeUniquePtr<ALuint[]>(queued_);
-			alSourceUnqueueBuffers(source_, queued_, &cur_queue[0]);
+			-- processed;
+
+			ALuint buf;
+			alSourceUnqueueBuffers(source_, 1, &buf);
+			free_buffers_.push_back(buf);
 		}
 
-		ALenum const format(Convert(format_));
-		std::vector<uint8_t> data(READ_SIZE);
+		this->QueueFreeBuffers();
 
-		data_source_->Reset();
+		ALint queued;
+		alGetSourcei(source_, AL_BUFFERS_QUEUED, &queued);
+		if (queued == 0)
+		{
+			// Finished, or starved. Decode tasks wake the service up when new data arrives.
+			return !this->StreamEnded();
+		}
 
-		ALsizei non_empty_buf = 0;
-		// Load 1 / BUFFERS_PER_SECOND second data to each buffer
-		for (auto const & buf : buffer_queue_)
+		ALint state;
+		alGetSourcei(source_, AL_SOURCE_STATE, &state);
+		if (state != AL_PLAYING)
 		{
-			data.resize(data_source_->Read(data.data(), data.size()));
-			if (data.empty())
-			{
-				break;
-			}
-			else
-			{
-				++ non_empty_buf;
-				alBufferData(buf, format, data.data(),
-					static_cast<ALuint>(data.size()), static_cast<ALuint>(freq_));
-			}
+			// The source stops by itself after an underrun
+			alSourcePlay(source_);
 		}
 
-		alSourceQueueBuffers(source_, non_empty_buf, buffer_queue_.data());
+		// OpenAL has no callback, wake up when the current buffer is processed
+		ALint sample_offset;
+		alGetSourcei(source_, AL_SAMPLE_OFFSET, &sample_offset);
+		uint32_t const buffer_samples = freq_ / BUFFERS_PER_SECOND;
+		uint32_t const remain_samples = buffer_samples - static_cast<uint32_t>(sample_offset) % buffer_samples;
+		next_update = std::chrono::microseconds(static_cast<uint64_t>(remain_samples) * 1000000 / freq_);
+
+		return true;
+	}
+
+	void OALMusicBuffer::DoReset()
+	{
+		this->UnqueueAll();
+
+		data_source_->Reset();
 
 		alSourceRewindv(1, &source_);
 	}
 
 	void OALMusicBuffer::DoPlay(bool loop)
 	{
-		play_thread_ = Context::Instance().ThreadPool()([this] { this->LoopUpdateBuffer(); });
+		this->PrepareStreaming(loop);
 
-		loop_ = loop;
-
-		stopped_ = false;
-		{
-			std::lock_guard<std::mutex> lock(play_mutex_);
-			played_ = true;
-		}
-		play_cond_.notify_one();
+		this->UnqueueAll();
+		this->QueueFreeBuffers();
 
 		alSourcei(source_, AL_LOOPING, false);
 		alSourcePlay(source_);
+
+		this->StartStreaming();
 	}
 
 	void OALMusicBuffer::DoStop()
 	{
-		if (!stopped_)
-		{
-			stopped_ = true;
-			play_thread_();
-		}
+		this->StopStreaming();
 
 		alSourceStopv(1, &source_);
 	}
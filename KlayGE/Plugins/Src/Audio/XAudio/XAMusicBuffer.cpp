@@ -47,18 +47,13 @@ namespace KlayGE
 	class MusicVoiceContext final : public IXAudio2VoiceCallback
 	{
 	public:
-		MusicVoiceContext()
-			: buffer_end_event_(::CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS))
+		explicit MusicVoiceContext(AudioStreamingService& streaming_service)
+			: streaming_service_(streaming_service)
 		{
 		}
 
 		virtual ~MusicVoiceContext() noexcept = default;
 
-		HANDLE GetBufferEndEvent() const
-		{
-			return buffer_end_event_.get();
-		}
-
 		STDMETHOD_(void, OnVoiceProcessingPassStart)(UINT32)
 		{
 		}
@@ -73,7 +68,7 @@ namespace KlayGE
 		}
 		STDMETHOD_(void, OnBufferEnd)(void*)
 		{
-			::SetEvent(buffer_end_event_.get());
+			streaming_service_.Notify();
 		}
 		STDMETHOD_(void, OnLoopEnd)(void*)
 		{
@@ -83,14 +78,14 @@ namespace KlayGE
 		}
 
 	private:
-		Win32UniqueHandle buffer_end_event_;
+		AudioStreamingService& streaming_service_;
 	};
 
 	XAMusicBuffer::XAMusicBuffer(AudioDataSourcePtr const & data_source, uint32_t buffer_seconds, float volume)
-					: MusicBuffer(data_source),
-						voice_call_back_(MakeUniquePtr<MusicVoiceContext>()),
-						buffer_count_(buffer_seconds * BUFFERS_PER_SECOND), curr_buffer_index_(0),
-						played_(false), stopped_(true),
+					: MusicBuffer(data_source, buffer_seconds),
+						voice_call_back_(MakeUniquePtr<MusicVoiceContext>(
+							Context::Instance().AudioFactoryInstance().AudioEngineInstance().StreamingService())),
+						buffer_count_(buffer_seconds * BUFFERS_PER_SECOND), curr_buffer_index_(0), end_submitted_(false),
 						emitter_{}, dsp_settings_{}
 	{
 		WAVEFORMATEX wfx = WaveFormatEx(data_source);
@@ -128,50 +123,31 @@ namespace KlayGE
 		this->Stop();
 	}
 
-	void XAMusicBuffer::LoopUpdateBuffer()
+	void XAMusicBuffer::SubmitBuffers()
 	{
-		std::unique_lock<std::mutex> lock(play_mutex_);
-		while (!played_)
+		XAUDIO2_VOICE_STATE state;
+		source_voice_->GetState(&state);
+		// Keeps one slot of audio_data_ free, XAudio2 still reads the buffer being played
+		uint32_t queued = state.BuffersQueued;
+		while (!end_submitted_ && (queued < buffer_count_ - 1))
 		{
-			play_cond_.wait(lock);
-		}
-		played_ = false;
-
-		while (!stopped_)
-		{
-			XAUDIO2_VOICE_STATE state;
-			for (;;)
+			if (!this->FillData(buffer_size_))
 			{
-				source_voice_->GetState(&state);
-				if (state.BuffersQueued < buffer_count_ - 1)
-				{
-					break;
-				}
-
-				::WaitForSingleObjectEx(checked_cast<MusicVoiceContext&>(*voice_call_back_).GetBufferEndEvent(), INFINITE, FALSE);
-			}
-
-			if (this->FillData(buffer_size_))
-			{
-				if (loop_)
-				{
-					stopped_ = false;
-					this->DoReset();
-				}
-				else
-				{
-					stopped_ = true;
-
-					HRESULT hr = source_voice_->Stop();
-					if (SUCCEEDED(hr))
-					{
-						source_voice_->FlushSourceBuffers();
-					}
-				}
+				break;
 			}
+			++ queued;
 		}
 	}
 
+	bool XAMusicBuffer::DoUpdateStream(std::chrono::microseconds& next_update)
+	{
+		KFL_UNUSED(next_update);
+
+		// OnBufferEnd wakes the service up, no need to poll
+		this->SubmitBuffers();
+		return !end_submitted_;
+	}
+
 	void XAMusicBuffer::DoReset()
 	{
 		data_source_->Reset();
@@ -187,28 +163,19 @@ namespace KlayGE
 		source_voice_->SetFrequencyRatio(dsp_settings_.DopplerFactor);
 
 		curr_buffer_index_ = 0;
-		loop_ = loop;
-
-		play_thread_ = Context::Instance().ThreadPool()([this] { this->LoopUpdateBuffer(); });
+		end_submitted_ = false;
 
-		stopped_ = false;
-		{
-			std::lock_guard<std::mutex> lock(play_mutex_);
-			played_ = true;
-		}
-		play_cond_.notify_one();
+		this->PrepareStreaming(loop);
+		this->SubmitBuffers();
 
 		source_voice_->Start(0, 0);
+
+		this->StartStreaming();
 	}
 
 	void XAMusicBuffer::DoStop()
 	{
-		if (!stopped_)
-		{
-			stopped_ = true;
-			::SetEvent(checked_cast<MusicVoiceContext&>(*voice_call_back_).GetBufferEndEvent());
-			play_thread_();
-		}
+		this->StopStreaming();
 
 		HRESULT hr = source_voice_->Stop();
 		if (SUCCEEDED(hr))
@@ -219,22 +186,33 @@ namespace KlayGE
 
 	bool XAMusicBuffer::FillData(uint32_t size)
 	{
-		bool ret = false;
+		uint8_t* data = &audio_data_[curr_buffer_index_ * buffer_size_];
+		size_t const read_size = this->ReadStream(data, size);
+		bool const ended = this->StreamEnded();
+		if (read_size == 0)
+		{
+			if (ended)
+			{
+				// The last submitted buffer ends the stream
+				source_voice_->Discontinuity();
+				end_submitted_ = true;
+			}
+			return false;
+		}
 
-		size_t read_size = data_source_->Read(&audio_data_[curr_buffer_index_ * buffer_size_], size);
 		XAUDIO2_BUFFER buf{};
 		buf.AudioBytes = static_cast<uint32_t>(read_size);
-		buf.pAudioData = &audio_data_[curr_buffer_index_ * buffer_size_];
-		if (curr_buffer_index_ * buffer_size_ + read_size >= data_source_->Size())
+		buf.pAudioData = data;
+		if (ended)
 		{
 			buf.Flags = XAUDIO2_END_OF_STREAM;
-			ret = true;
+			end_submitted_ = true;
 		}
 
 		source_voice_->SubmitSourceBuffer(&buf);
 		curr_buffer_index_ = (curr_buffer_index_ + 1) % buffer_count_;
 
-		return ret;
+		return true;
 	}
 
 	bool XAMusicBuffer::IsPlaying() const
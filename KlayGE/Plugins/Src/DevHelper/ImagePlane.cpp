@@ -32,8 +32,9 @@
 
 #include <KFL/CXX17/filesystem.hpp>
 #include <KFL/CXX2a/span.hpp>
-#include <KFL/CpuInfo.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KFL/TaskScheduler.hpp>
+#include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/TexCompression.hpp>
 #include <KlayGE/TexCompressionBC.hpp>
@@ -477,7 +478,7 @@ namespace KlayGE
 
 			if ((width != aligned_width) || (height != aligned_height))
 			{
-				*this = this->ResizeTo(aligned_width, aligned_height, true);
+				*this = this->ResizeTo(aligned_width, aligned_height, ResampleFilter::Linear);
 			}
 		}
 
@@ -776,38 +777,37 @@ namespace KlayGE
 
 		std::vector<uint8_t> new_tex_data(slice_pitch);
 
-		CPUInfo cpu;
-		uint32_t const num_threads = cpu.NumHWThreads();
-		thread_pool tp(1, num_threads);
-		std::vector<joiner<void>> joiners(num_threads);
-
-		uint32_t const tex_region_height = ((tex_height + num_threads - 1) / num_threads + block_height - 1) & ~(block_height - 1);
-		std::vector<TexturePtr> new_tex_regions(num_threads);
-		for (uint32_t i = 0; i < num_threads; ++ i)
-		{
-			joiners[i] = tp(
-				[block_height, tex_width, tex_height, tex_region_height, i, format, row_pitch,
-					&new_tex_data, &new_tex_regions, this]
+		// Regions of block rows, converted on the task scheduler. There are more regions than threads, so the planes
+		//  converted at the same time share the workers.
+		auto& scheduler = Context::Instance().TaskScheduler();
+		uint32_t const num_block_rows = (tex_height + block_height - 1) / block_height;
+		uint32_t const num_regions = std::min(num_block_rows, scheduler.concurrency() * 4);
+		uint32_t const tex_region_height = (num_block_rows + num_regions - 1) / num_regions * block_height;
+		scheduler.parallel_for(0, num_regions, 1,
+			[block_height, tex_width, tex_height, tex_region_height, format, row_pitch, &new_tex_data, this](
+				uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; ++ i)
 				{
 					uint32_t const this_tex_region_height = MathLib::clamp(static_cast<int>(tex_height - i * tex_region_height),
 						0, static_cast<int>(tex_region_height));
 					if (this_tex_region_height > 0)
 					{
-						new_tex_regions[i] = MakeSharedPtr<SoftwareTexture>(Texture::TT_2D, tex_width, this_tex_region_height,
-							1, 1, 1, format, true);
+						TexturePtr new_tex_region = MakeSharedPtr<SoftwareTexture>(Texture::TT_2D, tex_width,
+							this_tex_region_height, 1, 1, 1, format, true);
 
 						ElementInitData init_data;
 						init_data.data = new_tex_data.data() + i * tex_region_height / block_height * row_pitch;
 						init_data.row_pitch = row_pitch;
 						init_data.slice_pitch = (this_tex_region_height + block_height - 1) / block_height * row_pitch;
 
-						new_tex_regions[i]->CreateHWResource(MakeSpan<1>(init_data), nullptr);
+						new_tex_region->CreateHWResource(MakeSpan<1>(init_data), nullptr);
 
-						uncompressed_tex_->CopyToSubTexture2D(*new_tex_regions[i], 0, 0, 0, 0, tex_width, this_tex_region_height,
+						uncompressed_tex_->CopyToSubTexture2D(*new_tex_region, 0, 0, 0, 0, tex_width, this_tex_region_height,
 							0, 0, 0, i * tex_region_height, tex_width, this_tex_region_height, TextureFilter::Point);
 					}
-				});
-		}
+				}
+			});
 
 		TexturePtr new_tex = MakeSharedPtr<SoftwareTexture>(Texture::TT_2D, uncompressed_tex_->Width(0), uncompressed_tex_->Height(0),
 			1, 1, 1, format, false);
@@ -816,11 +816,6 @@ namespace KlayGE
 		init_data.row_pitch = row_pitch;
 		init_data.slice_pitch = slice_pitch;
 
-		for (uint32_t i = 0; i < num_threads; ++ i)
-		{
-			joiners[i]();
-		}
-
 		new_tex->CreateHWResource(MakeSpan<1>(init_data), nullptr);
 
 		if (IsCompressedFormat(format))
@@ -834,7 +829,7 @@ namespace KlayGE
 		}
 	}
 
-	ImagePlane ImagePlane::ResizeTo(uint32_t width, uint32_t height, bool linear)
+	ImagePlane ImagePlane::ResizeTo(uint32_t width, uint32_t height, ResampleFilter filter)
 	{
 		BOOST_ASSERT(uncompressed_tex_);
 
@@ -858,8 +853,7 @@ namespace KlayGE
 			ResizeTexture(target_data.data(), target_init_data.row_pitch, target_init_data.slice_pitch,
 				format, width, height, 1,
 				mapper.Pointer<void>(), mapper.RowPitch(), mapper.SlicePitch(), format,
-				uncompressed_tex_->Width(0), uncompressed_tex_->Height(0), 1,
-				linear ? TextureFilter::Linear : TextureFilter::Point);
+				uncompressed_tex_->Width(0), uncompressed_tex_->Height(0), 1, filter);
 		}
 
 		target.uncompressed_tex_->CreateHWResource(MakeSpan<1>(target_init_data), nullptr);
@@ -36,6 +36,7 @@
 #include <KlayGE/PreDeclare.hpp>
 #include <KFL/CXX17/string_view.hpp>
 #include <KlayGE/ElementFormat.hpp>
+#include <KlayGE/Texture.hpp>
 
 #include <vector>
 
@@ -55,7 +56,7 @@ namespace KlayGE
 		void NormalToHeight(float min_z);
 		void PrepareNormalCompression(ElementFormat normal_compression_format);
 		void FormatConversion(ElementFormat format);
-		ImagePlane ResizeTo(uint32_t width, uint32_t height, bool linear);
+		ImagePlane ResizeTo(uint32_t width, uint32_t height, ResampleFilter filter);
 
 		uint32_t Width() const
 		{
@@ -36,7 +36,9 @@
 #include <KFL/Hash.hpp>
 #include <KFL/Math.hpp>
 #include <KFL/StringUtil.hpp>
+#include <KFL/TaskScheduler.hpp>
 #include <KFL/XMLDom.hpp>
+#include <KlayGE/Context.hpp>
 #include <KlayGE/Mesh.hpp>
 #include <KlayGE/RenderMaterial.hpp>
 #include <KlayGE/ResLoader.hpp>
@@ -62,6 +64,7 @@
 #include <assimp/pbrmaterial.h>
 
 #include <KlayGE/DevHelper/MeshConverter.hpp>
+#include <KlayGE/DevHelper/MeshOptimizer.hpp>
 
 using namespace std;
 using namespace KlayGE;
@@ -211,6 +214,42 @@ namespace
 		}
 	}
 
+	// Keeps the vertices referenced by the indices, in the order of their first use
+	template <typename MeshLod>
+	void CompactVertices(MeshLod& mesh_lod)
+	{
+		std::vector<uint32_t> remap;
+		uint32_t const num_referenced = MeshOptimizer::OptimizeVertexFetch(mesh_lod.indices,
+			static_cast<uint32_t>(mesh_lod.positions.size()), remap);
+
+		auto remap_attrib = [&remap, num_referenced](auto& attrib)
+		{
+			if (!attrib.empty())
+			{
+				std::remove_reference_t<decltype(attrib)> new_attrib(num_referenced);
+				for (size_t v = 0; v < remap.size(); ++ v)
+				{
+					if (remap[v] != 0xFFFFFFFFU)
+					{
+						new_attrib[remap[v]] = std::move(attrib[v]);
+					}
+				}
+				attrib.swap(new_attrib);
+			}
+		};
+		remap_attrib(mesh_lod.positions);
+		remap_attrib(mesh_lod.tangents);
+		remap_attrib(mesh_lod.binormals);
+		remap_attrib(mesh_lod.normals);
+		remap_attrib(mesh_lod.diffuses);
+		remap_attrib(mesh_lod.speculars);
+		for (auto& texcoords : mesh_lod.texcoords)
+		{
+			remap_attrib(texcoords);
+		}
+		remap_attrib(mesh_lod.joint_bindings);
+	}
+
 	class MeshLoader
 	{
 	public:
@@ -220,6 +259,8 @@ namespace
 		void RemoveUnusedJoints();
 		void RemoveUnusedMaterials();
 		void CompressKeyFrameSet(KeyFrameSet& kf);
+		void GenerateLods(MeshMetadata const & metadata);
+		void OptimizeMeshes(MeshMetadata const & metadata);
 
 		// From assimp
 		void BuildNodeData(uint32_t num_lods, uint32_t lod, int16_t parent_id, aiNode const * node);
@@ -3527,6 +3568,155 @@ namespace
 	}
 
 
+	void MeshLoader::GenerateLods(MeshMetadata const & metadata)
+	{
+		uint32_t const num_auto_lods = metadata.NumAutoLods();
+		if (num_auto_lods == 0)
+		{
+			return;
+		}
+		if (meshes_[0].lods.size() > 1)
+		{
+			LogWarn() << "LODs are loaded from files, auto LODs are ignored." << std::endl;
+			return;
+		}
+
+		for (auto& mesh : meshes_)
+		{
+			mesh.lods.resize(num_auto_lods + 1);
+		}
+
+		// Normals and texcoords are in the error, so the collapses prefer smooth and uniformly mapped regions
+		float constexpr NORMAL_WEIGHT = 0.25f;
+		float constexpr TEXCOORD_WEIGHT = 0.5f;
+
+		std::vector<float> errors(meshes_.size() * num_auto_lods);
+		Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(errors.size()), 1,
+			[this, &metadata, &errors, num_auto_lods](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; ++ i)
+				{
+					auto& mesh = meshes_[i / num_auto_lods];
+					uint32_t const auto_lod = i % num_auto_lods;
+					auto const & base_lod = mesh.lods[0];
+					auto& mesh_lod = mesh.lods[auto_lod + 1];
+					mesh_lod = base_lod;
+
+					uint32_t const num_vertices = static_cast<uint32_t>(base_lod.positions.size());
+					uint32_t num_attributes = 0;
+					if (!base_lod.normals.empty())
+					{
+						num_attributes += 3;
+					}
+					if (!base_lod.texcoords[0].empty())
+					{
+						num_attributes += 2;
+					}
+					std::vector<float> attributes(num_vertices * num_attributes);
+					for (uint32_t v = 0; v < num_vertices; ++ v)
+					{
+						float* attrib = &attributes[v * num_attributes];
+						if (!base_lod.normals.empty())
+						{
+							float3 const normal = base_lod.normals[v] * NORMAL_WEIGHT;
+							*attrib ++ = normal.x();
+							*attrib ++ = normal.y();
+							*attrib ++ = normal.z();
+						}
+						if (!base_lod.texcoords[0].empty())
+						{
+							*attrib ++ = base_lod.texcoords[0][v].x() * TEXCOORD_WEIGHT;
+							*attrib ++ = base_lod.texcoords[0][v].y() * TEXCOORD_WEIGHT;
+						}
+					}
+
+					uint32_t const num_triangles = static_cast<uint32_t>(base_lod.indices.size() / 3);
+					uint32_t const target_triangles = std::max(static_cast<uint32_t>(num_triangles * metadata.AutoLodRatio(auto_lod) + 0.5f), 1U);
+					errors[i] = MeshOptimizer::Simplify(mesh_lod.indices, base_lod.positions, attributes, num_attributes,
+						target_triangles * 3, metadata.AutoLodMaxError(auto_lod));
+
+					CompactVertices(mesh_lod);
+				}
+			});
+
+		for (uint32_t i = 0; i < errors.size(); ++ i)
+		{
+			auto const & mesh = meshes_[i / num_auto_lods];
+			uint32_t const lod = i % num_auto_lods + 1;
+			LogInfo() << "Mesh " << mesh.name << " LOD " << lod << ": " << mesh.lods[0].indices.size() / 3 << " -> "
+				<< mesh.lods[lod].indices.size() / 3 << " triangles, error " << errors[i] << std::endl;
+		}
+	}
+
+	void MeshLoader::OptimizeMeshes(MeshMetadata const & metadata)
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> mesh_lods;
+		for (uint32_t mesh_index = 0; mesh_index < meshes_.size(); ++ mesh_index)
+		{
+			for (uint32_t lod = 0; lod < meshes_[mesh_index].lods.size(); ++ lod)
+			{
+				mesh_lods.emplace_back(mesh_index, lod);
+			}
+		}
+
+		bool const optimize = metadata.OptimizeVertexCache() || (metadata.OverdrawThreshold() > 0) || metadata.OptimizeVertexFetch();
+		std::vector<std::pair<VertexCacheStatistics, VertexCacheStatistics>> statistics(mesh_lods.size());
+
+		Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(mesh_lods.size()), 1,
+			[this, &metadata, &mesh_lods, &statistics, optimize](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; ++ i)
+				{
+					auto& mesh_lod = meshes_[mesh_lods[i].first].lods[mesh_lods[i].second];
+					auto& indices = mesh_lod.indices;
+					uint32_t const num_vertices = static_cast<uint32_t>(mesh_lod.positions.size());
+
+					// Winding is flipped first, so the overdraw optimization sees the final front faces
+					if (metadata.FlipWindingOrder())
+					{
+						for (size_t j = 0; j < indices.size(); j += 3)
+						{
+							std::swap(indices[j + 1], indices[j + 2]);
+						}
+					}
+
+					if (!optimize)
+					{
+						continue;
+					}
+
+					statistics[i].first = MeshOptimizer::AnalyzeVertexCache(indices, num_vertices);
+
+					if (metadata.OptimizeVertexCache())
+					{
+						MeshOptimizer::OptimizeVertexCache(indices, num_vertices);
+					}
+					if (metadata.OverdrawThreshold() > 0)
+					{
+						MeshOptimizer::OptimizeOverdraw(indices, mesh_lod.positions, metadata.OverdrawThreshold());
+					}
+					if (metadata.OptimizeVertexFetch())
+					{
+						CompactVertices(mesh_lod);
+					}
+
+					statistics[i].second = MeshOptimizer::AnalyzeVertexCache(indices, static_cast<uint32_t>(mesh_lod.positions.size()));
+				}
+			});
+
+		if (optimize)
+		{
+			for (size_t i = 0; i < mesh_lods.size(); ++ i)
+			{
+				auto const & before = statistics[i].first;
+				auto const & after = statistics[i].second;
+				LogInfo() << "Mesh " << meshes_[mesh_lods[i].first].name << " LOD " << mesh_lods[i].second
+					<< ": ACMR " << before.acmr << " -> " << after.acmr
+					<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+			}
+		}
+	}
+
 	RenderModelPtr MeshLoader::Load(std::string_view input_name, MeshMetadata const & metadata)
 	{
 		std::string const input_name_str = ResLoader::Instance().Locate(input_name);
@@ -3582,6 +3772,9 @@ namespace
 			}
 		}
 
+		bool const has_auto_lods = (metadata.NumAutoLods() > 0) && (meshes_[0].lods.size() == 1);
+		this->GenerateLods(metadata);
+
 		uint32_t const num_lods = static_cast<uint32_t>(meshes_[0].lods.size());
 		bool const skinned = !joints_.empty();
 
@@ -3590,6 +3783,7 @@ namespace
 			this->RemoveUnusedJoints();
 		}
 		this->RemoveUnusedMaterials();
+		this->OptimizeMeshes(metadata);
 
 		auto global_transform = metadata.Transform();
 		if (metadata.AutoCenter())
@@ -3686,12 +3880,9 @@ namespace
 						float3 const pos = (position - pos_center) / pos_extent * 0.5f + 0.5f;
 						int16_t const s_pos[] =
 						{
-							static_cast<int16_t>(
-								MathLib::clamp<int32_t>(static_cast<int32_t>(pos.x() * 65535 - 32768), -32768, 32767)),
-							static_cast<int16_t>(
-								MathLib::clamp<int32_t>(static_cast<int32_t>(pos.y() * 65535 - 32768), -32768, 32767)),
-							static_cast<int16_t>(
-								MathLib::clamp<int32_t>(static_cast<int32_t>(pos.z() * 65535 - 32768), -32768, 32767)),
+							QuantizeToSNorm16(pos.x()),
+							QuantizeToSNorm16(pos.y()),
+							QuantizeToSNorm16(pos.z()),
 							32767
 						};
 
@@ -3743,8 +3934,7 @@ namespace
 							uint32_t const clr = diffuse.ABGR();
 
 							uint8_t const * p = reinterpret_cast<uint8_t const *>(&clr);
-							merged_vertices[tangent_quat_stream].insert(merged_vertices[tangent_quat_stream].end(),
-								p, p + sizeof(clr));
+							merged_vertices[diffuse_stream].insert(merged_vertices[diffuse_stream].end(), p, p + sizeof(clr));
 						}
 					}
 					if (specular_stream != -1)
@@ -3754,8 +3944,7 @@ namespace
 							uint32_t const clr = specular.ABGR();
 
 							uint8_t const * p = reinterpret_cast<uint8_t const *>(&clr);
-							merged_vertices[tangent_quat_stream].insert(merged_vertices[tangent_quat_stream].end(),
-								p, p + sizeof(clr));
+							merged_vertices[specular_stream].insert(merged_vertices[specular_stream].end(), p, p + sizeof(clr));
 						}
 					}
 					if (texcoord_stream != -1)
@@ -3766,10 +3955,8 @@ namespace
 							tex_coord = (tex_coord - tc_center) / tc_extent * 0.5f + 0.5f;
 							int16_t const s_tc[2] =
 							{
-								static_cast<int16_t>(MathLib::clamp<int32_t>(static_cast<int32_t>(tex_coord.x() * 65535 - 32768),
-									-32768, 32767)),
-								static_cast<int16_t>(MathLib::clamp<int32_t>(static_cast<int32_t>(tex_coord.y() * 65535 - 32768),
-									-32768, 32767)),
+								QuantizeToSNorm16(tex_coord.x()),
+								QuantizeToSNorm16(tex_coord.y())
 							};
 
 							uint8_t const * p = reinterpret_cast<uint8_t const *>(s_tc);
@@ -3841,18 +4028,13 @@ namespace
 				{
 					for (size_t i = 0; i < mesh_lod.indices.size(); i += 3)
 					{
-						uint32_t triangle[] = 
+						uint32_t const triangle[] =
 						{
 							mesh_lod.indices[i + 0],
 							mesh_lod.indices[i + 1],
 							mesh_lod.indices[i + 2]
 						};
 
-						if (metadata.FlipWindingOrder())
-						{
-							std::swap(triangle[1], triangle[2]);
-						}
-
 						if (is_index_16_bit)
 						{
 							uint16_t const triangle_16[]
@@ -3961,6 +4143,18 @@ namespace
 
 		render_model_->AssignMeshes(render_meshes.begin(), render_meshes.end());
 
+		if (has_auto_lods)
+		{
+			for (uint32_t auto_lod = 0; auto_lod < metadata.NumAutoLods(); ++ auto_lod)
+			{
+				float const screen_size = metadata.AutoLodScreenSize(auto_lod);
+				if (screen_size >= 0)
+				{
+					render_model_->LodScreenSize(auto_lod + 1, screen_size);
+				}
+			}
+		}
+
 		for (auto const & node : nodes_)
 		{
 			for (auto const mesh_index : node.mesh_indices)
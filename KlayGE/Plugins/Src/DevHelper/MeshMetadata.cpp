@@ -211,6 +211,27 @@ namespace KlayGE
 				new_metadata.flip_winding_order_ = flip_winding_order_val.GetBool();
 			}
 
+			if (document.HasMember("optimize_vertex_cache"))
+			{
+				auto const & optimize_vertex_cache_val = document["optimize_vertex_cache"];
+				BOOST_ASSERT(optimize_vertex_cache_val.IsBool());
+				new_metadata.optimize_vertex_cache_ = optimize_vertex_cache_val.GetBool();
+			}
+
+			if (document.HasMember("overdraw_threshold"))
+			{
+				auto const & overdraw_threshold_val = document["overdraw_threshold"];
+				BOOST_ASSERT(overdraw_threshold_val.IsNumber());
+				new_metadata.overdraw_threshold_ = GetFloat(overdraw_threshold_val);
+			}
+
+			if (document.HasMember("optimize_vertex_fetch"))
+			{
+				auto const & optimize_vertex_fetch_val = document["optimize_vertex_fetch"];
+				BOOST_ASSERT(optimize_vertex_fetch_val.IsBool());
+				new_metadata.optimize_vertex_fetch_ = optimize_vertex_fetch_val.GetBool();
+			}
+
 			if (document.HasMember("lod"))
 			{
 				auto const & lod_val = document["lod"];
@@ -224,6 +245,37 @@ namespace KlayGE
 				}
 			}
 
+			if (document.HasMember("auto_lods"))
+			{
+				auto const & auto_lods_val = document["auto_lods"];
+				BOOST_ASSERT(auto_lods_val.IsArray());
+				new_metadata.auto_lods_.resize(auto_lods_val.Size());
+				uint32_t index = 0;
+				for (auto iter = auto_lods_val.Begin(); iter != auto_lods_val.End(); ++ iter, ++ index)
+				{
+					BOOST_ASSERT(iter->IsObject());
+					auto& auto_lod = new_metadata.auto_lods_[index];
+					if (iter->HasMember("ratio"))
+					{
+						auto const & ratio_val = (*iter)["ratio"];
+						BOOST_ASSERT(ratio_val.IsNumber());
+						auto_lod.ratio = GetFloat(ratio_val);
+					}
+					if (iter->HasMember("max_error"))
+					{
+						auto const & max_error_val = (*iter)["max_error"];
+						BOOST_ASSERT(max_error_val.IsNumber());
+						auto_lod.max_error = GetFloat(max_error_val);
+					}
+					if (iter->HasMember("screen_size"))
+					{
+						auto const & screen_size_val = (*iter)["screen_size"];
+						BOOST_ASSERT(screen_size_val.IsNumber());
+						auto_lod.screen_size = GetFloat(screen_size_val);
+					}
+				}
+			}
+
 			if (document.HasMember("materials"))
 			{
 				auto const & materials_val = document["materials"];
@@ -331,6 +383,21 @@ namespace KlayGE
 			document.AddMember("flip_winding_order", flip_winding_order_, allocator);
 		}
 
+		if (optimize_vertex_cache_)
+		{
+			document.AddMember("optimize_vertex_cache", optimize_vertex_cache_, allocator);
+		}
+
+		if (overdraw_threshold_ > 0)
+		{
+			document.AddMember("overdraw_threshold", overdraw_threshold_, allocator);
+		}
+
+		if (optimize_vertex_fetch_)
+		{
+			document.AddMember("optimize_vertex_fetch", optimize_vertex_fetch_, allocator);
+		}
+
 		if ((lod_file_names_.size() > 1) || ((lod_file_names_.size() == 1) && (lod_file_names_[0].size() > 1)))
 		{
 			rapidjson::Value array_names_val;
@@ -345,6 +412,27 @@ namespace KlayGE
 			document.AddMember("lod", array_names_val, allocator);
 		}
 
+		if (!auto_lods_.empty())
+		{
+			rapidjson::Value auto_lods_val;
+			auto_lods_val.SetArray();
+
+			for (auto const & auto_lod : auto_lods_)
+			{
+				rapidjson::Value auto_lod_val;
+				auto_lod_val.SetObject();
+				auto_lod_val.AddMember("ratio", auto_lod.ratio, allocator);
+				auto_lod_val.AddMember("max_error", auto_lod.max_error, allocator);
+				if (auto_lod.screen_size >= 0)
+				{
+					auto_lod_val.AddMember("screen_size", auto_lod.screen_size, allocator);
+				}
+				auto_lods_val.PushBack(auto_lod_val, allocator);
+			}
+
+			document.AddMember("auto_lods", auto_lods_val, allocator);
+		}
+
 		if (!material_file_names_.empty())
 		{
 			rapidjson::Value mtl_names_val;
@@ -386,6 +474,11 @@ namespace KlayGE
 		lod_file_names_[lod] = std::string(lod_name);
 	}
 
+	void MeshMetadata::NumAutoLods(uint32_t lods)
+	{
+		auto_lods_.resize(lods);
+	}
+
 	uint32_t MeshMetadata::NumMaterials() const
 	{
 		return static_cast<uint32_t>(material_file_names_.size());
@@ -0,0 +1,800 @@
+/**
+ * @file MeshOptimizer.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/RadixSort.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <KlayGE/DevHelper/MeshOptimizer.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t constexpr INVALID_INDEX = 0xFFFFFFFFU;
+
+	// FIFO cache simulation. A vertex is in the cache if it's added less than cache_size misses ago.
+	class FifoCache
+	{
+	public:
+		FifoCache(uint32_t num_vertices, uint32_t cache_size)
+			: cache_size_(cache_size), timestamps_(num_vertices, 0)
+		{
+		}
+
+		// Returns true if it's a miss
+		bool Touch(uint32_t vertex)
+		{
+			if (time_ - timestamps_[vertex] >= cache_size_)
+			{
+				timestamps_[vertex] = time_;
+				++ time_;
+				return true;
+			}
+			return false;
+		}
+
+		void Flush()
+		{
+			time_ += cache_size_;
+		}
+
+	private:
+		uint32_t cache_size_;
+		// Starts at cache_size_ so that the initial timestamps of 0 are misses
+		uint32_t time_{cache_size_};
+		std::vector<uint32_t> timestamps_;
+	};
+
+	// Scoring of "Linear-Speed Vertex Cache Optimisation" by Tom Forsyth
+	uint32_t constexpr FORSYTH_CACHE_SIZE = 32;
+
+	float ForsythVertexScore(int32_t cache_pos, uint32_t remaining_valence)
+	{
+		if (remaining_valence == 0)
+		{
+			return -1;
+		}
+
+		float score = 0;
+		if (cache_pos >= 0)
+		{
+			if (cache_pos < 3)
+			{
+				// The last triangle, fixed score to avoid using it again right away
+				score = 0.75f;
+			}
+			else
+			{
+				float const scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+				score = std::pow(1 - (cache_pos - 3) * scaler, 1.5f);
+			}
+		}
+
+		// Boosts vertices with few triangles left, so the lone ones don't get stranded
+		score += 2.0f / std::sqrt(static_cast<float>(remaining_valence));
+		return score;
+	}
+
+	// Sum of squared distances to a set of planes, weighted by the triangle areas. Stored as the upper half of the
+	//  symmetric 4x4 matrix.
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+		double weight = 0;
+
+		static Quadric FromTriangle(float3 const & p0, float3 const & p1, float3 const & p2)
+		{
+			Quadric q;
+
+			float3 n = MathLib::cross(p1 - p0, p2 - p0);
+			float const area = MathLib::length(n);
+			if (area > 0)
+			{
+				n /= area;
+				double const nx = n.x();
+				double const ny = n.y();
+				double const nz = n.z();
+				double const d = -MathLib::dot(n, p0);
+				double const w = area;
+
+				q.a00 = w * nx * nx;
+				q.a01 = w * nx * ny;
+				q.a02 = w * nx * nz;
+				q.a11 = w * ny * ny;
+				q.a12 = w * ny * nz;
+				q.a22 = w * nz * nz;
+				q.b0 = w * nx * d;
+				q.b1 = w * ny * d;
+				q.b2 = w * nz * d;
+				q.c = w * d * d;
+				q.weight = w;
+			}
+
+			return q;
+		}
+
+		Quadric& operator+=(Quadric const & rhs)
+		{
+			a00 += rhs.a00;
+			a01 += rhs.a01;
+			a02 += rhs.a02;
+			a11 += rhs.a11;
+			a12 += rhs.a12;
+			a22 += rhs.a22;
+			b0 += rhs.b0;
+			b1 += rhs.b1;
+			b2 += rhs.b2;
+			c += rhs.c;
+			weight += rhs.weight;
+			return *this;
+		}
+
+		// Average squared distance from p to the planes
+		double Error(float3 const & p) const
+		{
+			if (weight <= 0)
+			{
+				return 0;
+			}
+
+			double const x = p.x();
+			double const y = p.y();
+			double const z = p.z();
+			double const e = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2 * (b0 * x + b1 * y + b2 * z) + c;
+			return std::abs(e) / weight;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		float cost;
+	};
+}
+
+namespace KlayGE
+{
+	VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(std::span<uint32_t const> indices, uint32_t num_vertices,
+		uint32_t cache_size)
+	{
+		VertexCacheStatistics ret;
+
+		uint32_t const num_indices = static_cast<uint32_t>(indices.size());
+		if (num_indices < 3)
+		{
+			return ret;
+		}
+
+		FifoCache cache(num_vertices, cache_size);
+		std::vector<bool> referenced(num_vertices, false);
+		uint32_t num_referenced = 0;
+		for (uint32_t i = 0; i < num_indices; ++ i)
+		{
+			uint32_t const vertex = indices[i];
+			if (cache.Touch(vertex))
+			{
+				++ ret.vertices_transformed;
+			}
+			if (!referenced[vertex])
+			{
+				referenced[vertex] = true;
+				++ num_referenced;
+			}
+		}
+
+		ret.acmr = static_cast<float>(ret.vertices_transformed) / (num_indices / 3);
+		ret.atvr = static_cast<float>(ret.vertices_transformed) / num_referenced;
+		return ret;
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, uint32_t num_vertices)
+	{
+		uint32_t const num_triangles = static_cast<uint32_t>(indices.size() / 3);
+		if (num_triangles == 0)
+		{
+			return;
+		}
+
+		// Triangles of each vertex, in CSR layout. Emitted triangles are swapped out of the live part.
+		std::vector<uint32_t> valences(num_vertices, 0);
+		for (uint32_t i = 0; i < num_triangles * 3; ++ i)
+		{
+			++ valences[indices[i]];
+		}
+		std::vector<uint32_t> adjacency_offsets(num_vertices + 1, 0);
+		for (uint32_t v = 0; v < num_vertices; ++ v)
+		{
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + valences[v];
+		}
+		std::vector<uint32_t> adjacency(num_triangles * 3);
+		{
+			std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (uint32_t t = 0; t < num_triangles; ++ t)
+			{
+				for (uint32_t j = 0; j < 3; ++ j)
+				{
+					adjacency[fill[indices[t * 3 + j]] ++] = t;
+				}
+			}
+		}
+
+		std::vector<int32_t> cache_pos(num_vertices, -1);
+		std::vector<float> vertex_scores(num_vertices);
+		for (uint32_t v = 0; v < num_vertices; ++ v)
+		{
+			vertex_scores[v] = ForsythVertexScore(-1, valences[v]);
+		}
+
+		std::vector<float> triangle_scores(num_triangles);
+		uint32_t best_triangle = 0;
+		for (uint32_t t = 0; t < num_triangles; ++ t)
+		{
+			triangle_scores[t] = vertex_scores[indices[t * 3 + 0]] + vertex_scores[indices[t * 3 + 1]]
+				+ vertex_scores[indices[t * 3 + 2]];
+			if (triangle_scores[t] > triangle_scores[best_triangle])
+			{
+				best_triangle = t;
+			}
+		}
+
+		std::vector<bool> emitted(num_triangles, false);
+		std::vector<uint32_t> output;
+		output.reserve(num_triangles * 3);
+
+		uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t cache_count = 0;
+		uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t scan_cursor = 0;
+
+		for (uint32_t emitted_count = 0; emitted_count < num_triangles; ++ emitted_count)
+		{
+			if (best_triangle == INVALID_INDEX)
+			{
+				// Nothing adjacent to the cache. Takes the next triangle left, all their vertices are out of the cache and
+				//  the scores only differ by valences.
+				while (emitted[scan_cursor])
+				{
+					++ scan_cursor;
+				}
+				best_triangle = scan_cursor;
+			}
+
+			uint32_t const* tri = &indices[best_triangle * 3];
+			output.insert(output.end(), tri, tri + 3);
+			emitted[best_triangle] = true;
+
+			uint32_t new_cache_count = 0;
+			for (uint32_t j = 0; j < 3; ++ j)
+			{
+				uint32_t const v = tri[j];
+
+				// Removes the triangle from the live adjacency of v
+				uint32_t const begin = adjacency_offsets[v];
+				uint32_t const end = begin + valences[v];
+				for (uint32_t k = begin; k < end; ++ k)
+				{
+					if (adjacency[k] == best_triangle)
+					{
+						std::swap(adjacency[k], adjacency[end - 1]);
+						break;
+					}
+				}
+				-- valences[v];
+
+				if (std::find(new_cache, new_cache + new_cache_count, v) == new_cache + new_cache_count)
+				{
+					new_cache[new_cache_count] = v;
+					++ new_cache_count;
+				}
+			}
+			for (uint32_t j = 0; j < cache_count; ++ j)
+			{
+				uint32_t const v = cache[j];
+				if ((v != tri[0]) && (v != tri[1]) && (v != tri[2]))
+				{
+					new_cache[new_cache_count] = v;
+					++ new_cache_count;
+				}
+			}
+
+			for (uint32_t j = 0; j < new_cache_count; ++ j)
+			{
+				cache_pos[new_cache[j]] = (j < FORSYTH_CACHE_SIZE) ? static_cast<int32_t>(j) : -1;
+			}
+
+			// Rescores the vertices in the old and new caches, and the triangles around them
+			best_triangle = INVALID_INDEX;
+			float best_score = -1;
+			for (uint32_t j = 0; j < new_cache_count; ++ j)
+			{
+				uint32_t const v = new_cache[j];
+				vertex_scores[v] = ForsythVertexScore(cache_pos[v], valences[v]);
+			}
+			for (uint32_t j = 0; j < std::min(new_cache_count, FORSYTH_CACHE_SIZE); ++ j)
+			{
+				uint32_t const v = new_cache[j];
+				uint32_t const begin = adjacency_offsets[v];
+				uint32_t const end = begin + valences[v];
+				for (uint32_t k = begin; k < end; ++ k)
+				{
+					uint32_t const t = adjacency[k];
+					float const score = vertex_scores[indices[t * 3 + 0]] + vertex_scores[indices[t * 3 + 1]]
+						+ vertex_scores[indices[t * 3 + 2]];
+					triangle_scores[t] = score;
+					if (score > best_score)
+					{
+						best_score = score;
+						best_triangle = t;
+					}
+				}
+			}
+
+			cache_count = std::min(new_cache_count, FORSYTH_CACHE_SIZE);
+			std::copy(new_cache, new_cache + cache_count, cache);
+		}
+
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<float3 const> positions, float threshold)
+	{
+		uint32_t const num_triangles = static_cast<uint32_t>(indices.size() / 3);
+		uint32_t const num_vertices = static_cast<uint32_t>(positions.size());
+		if (num_triangles < 2)
+		{
+			return;
+		}
+
+		// Hard boundaries, where a triangle shares no vertex with the cache
+		std::vector<uint32_t> hard_clusters;
+		{
+			FifoCache cache(num_vertices, ANALYZE_CACHE_SIZE);
+			for (uint32_t t = 0; t < num_triangles; ++ t)
+			{
+				uint32_t misses = 0;
+				for (uint32_t j = 0; j < 3; ++ j)
+				{
+					misses += cache.Touch(indices[t * 3 + j]);
+				}
+				if ((t == 0) || (misses == 3))
+				{
+					hard_clusters.push_back(t);
+				}
+			}
+			hard_clusters.push_back(num_triangles);
+		}
+
+		// Soft boundaries, where a cluster has been as cache friendly as the whole run
+		std::vector<uint32_t> clusters;
+		{
+			FifoCache cache(num_vertices, ANALYZE_CACHE_SIZE);
+			for (size_t c = 0; c + 1 < hard_clusters.size(); ++ c)
+			{
+				uint32_t const begin = hard_clusters[c];
+				uint32_t const end = hard_clusters[c + 1];
+
+				cache.Flush();
+				uint32_t run_misses = 0;
+				for (uint32_t t = begin; t < end; ++ t)
+				{
+					for (uint32_t j = 0; j < 3; ++ j)
+					{
+						run_misses += cache.Touch(indices[t * 3 + j]);
+					}
+				}
+				float const run_acmr = static_cast<float>(run_misses) / (end - begin);
+
+				cache.Flush();
+				clusters.push_back(begin);
+				uint32_t cluster_begin = begin;
+				uint32_t cluster_misses = 0;
+				for (uint32_t t = begin; t < end; ++ t)
+				{
+					for (uint32_t j = 0; j < 3; ++ j)
+					{
+						cluster_misses += cache.Touch(indices[t * 3 + j]);
+					}
+
+					float const cluster_acmr = static_cast<float>(cluster_misses) / (t + 1 - cluster_begin);
+					if ((t + 1 < end) && (cluster_acmr <= run_acmr * threshold))
+					{
+						cluster_begin = t + 1;
+						cluster_misses = 0;
+						clusters.push_back(cluster_begin);
+						cache.Flush();
+					}
+				}
+			}
+			clusters.push_back(num_triangles);
+		}
+
+		uint32_t const num_clusters = static_cast<uint32_t>(clusters.size() - 1);
+		if (num_clusters < 2)
+		{
+			return;
+		}
+
+		// Area weighted centroids and normals
+		std::vector<float3> cluster_centroids(num_clusters, float3::Zero());
+		std::vector<float3> cluster_normals(num_clusters, float3::Zero());
+		float3 mesh_centroid = float3::Zero();
+		float mesh_area = 0;
+		for (uint32_t c = 0; c < num_clusters; ++ c)
+		{
+			float cluster_area = 0;
+			for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++ t)
+			{
+				float3 const& p0 = positions[indices[t * 3 + 0]];
+				float3 const& p1 = positions[indices[t * 3 + 1]];
+				float3 const& p2 = positions[indices[t * 3 + 2]];
+
+				float3 const normal = MathLib::cross(p1 - p0, p2 - p0);
+				float const area = MathLib::length(normal);
+
+				cluster_centroids[c] += (p0 + p1 + p2) * (area / 3);
+				cluster_normals[c] += normal;
+				cluster_area += area;
+			}
+
+			mesh_centroid += cluster_centroids[c];
+			mesh_area += cluster_area;
+
+			if (cluster_area > 0)
+			{
+				cluster_centroids[c] /= cluster_area;
+			}
+		}
+		if (mesh_area > 0)
+		{
+			mesh_centroid /= mesh_area;
+		}
+
+		// Clusters facing outwards and far from the center are likely to occlude others
+		std::vector<float> cluster_keys(num_clusters);
+		for (uint32_t c = 0; c < num_clusters; ++ c)
+		{
+			float const normal_length = MathLib::length(cluster_normals[c]);
+			cluster_keys[c] = (normal_length > 0)
+				? MathLib::dot(cluster_centroids[c] - mesh_centroid, cluster_normals[c] / normal_length) : 0;
+		}
+
+		std::vector<uint32_t> order(num_clusters);
+		std::iota(order.begin(), order.end(), 0U);
+		std::stable_sort(order.begin(), order.end(), [&cluster_keys](uint32_t lhs, uint32_t rhs)
+			{
+				return cluster_keys[lhs] > cluster_keys[rhs];
+			});
+
+		std::vector<uint32_t> output;
+		output.reserve(num_triangles * 3);
+		for (uint32_t c : order)
+		{
+			output.insert(output.end(), &indices[clusters[c] * 3], &indices[clusters[c] * 3] + (clusters[c + 1] - clusters[c]) * 3);
+		}
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	uint32_t MeshOptimizer::OptimizeVertexFetch(std::span<uint32_t> indices, uint32_t num_vertices, std::vector<uint32_t>& remap)
+	{
+		remap.assign(num_vertices, INVALID_INDEX);
+
+		uint32_t num_referenced = 0;
+		for (auto& index : indices)
+		{
+			if (remap[index] == INVALID_INDEX)
+			{
+				remap[index] = num_referenced;
+				++ num_referenced;
+			}
+			index = remap[index];
+		}
+
+		return num_referenced;
+	}
+
+	float MeshOptimizer::Simplify(std::vector<uint32_t>& indices, std::span<float3 const> positions,
+		std::span<float const> attributes, uint32_t num_attributes, uint32_t target_index_count, float target_error)
+	{
+		uint32_t const num_vertices = static_cast<uint32_t>(positions.size());
+		if ((indices.size() <= target_index_count) || (num_vertices == 0))
+		{
+			return 0;
+		}
+		if (attributes.empty())
+		{
+			num_attributes = 0;
+		}
+
+		// Works in a unit box, so the errors don't depend on the size of the mesh
+		std::vector<float3> unit_positions(positions.begin(), positions.end());
+		{
+			float3 min_pos = positions[0];
+			float3 max_pos = positions[0];
+			for (auto const & pos : positions)
+			{
+				min_pos = MathLib::minimize(min_pos, pos);
+				max_pos = MathLib::maximize(max_pos, pos);
+			}
+			float3 const size = max_pos - min_pos;
+			float const extent = std::max(std::max(size.x(), size.y()), size.z());
+			float const scale = extent > 0 ? 1 / extent : 1.0f;
+			for (auto& pos : unit_positions)
+			{
+				pos = (pos - min_pos) * scale;
+			}
+		}
+
+		std::vector<uint8_t> locked(num_vertices, 0);
+		std::vector<uint32_t> wedge_heads(num_vertices);
+		{
+			// Vertices at the same position are wedges of one point, split by an attribute seam
+			std::vector<uint32_t> order(num_vertices);
+			std::iota(order.begin(), order.end(), 0U);
+			std::sort(order.begin(), order.end(), [&positions](uint32_t lhs, uint32_t rhs)
+				{
+					float3 const & lp = positions[lhs];
+					float3 const & rp = positions[rhs];
+					if (lp.x() != rp.x())
+					{
+						return lp.x() < rp.x();
+					}
+					if (lp.y() != rp.y())
+					{
+						return lp.y() < rp.y();
+					}
+					if (lp.z() != rp.z())
+					{
+						return lp.z() < rp.z();
+					}
+					return lhs < rhs;
+				});
+			for (uint32_t begin = 0; begin < num_vertices;)
+			{
+				uint32_t end = begin + 1;
+				while ((end < num_vertices) && (positions[order[end]] == positions[order[begin]]))
+				{
+					++ end;
+				}
+				for (uint32_t i = begin; i < end; ++ i)
+				{
+					wedge_heads[order[i]] = order[begin];
+					if (end - begin > 1)
+					{
+						locked[order[i]] = 1;
+					}
+				}
+				begin = end;
+			}
+
+			// Edges not shared by exactly 2 triangles are borders or non-manifold
+			std::vector<uint64_t> edges;
+			edges.reserve(indices.size());
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (uint32_t j = 0; j < 3; ++ j)
+				{
+					uint32_t const a = wedge_heads[indices[i + j]];
+					uint32_t const b = wedge_heads[indices[i + (j + 1) % 3]];
+					edges.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			for (size_t begin = 0; begin < edges.size();)
+			{
+				size_t end = begin + 1;
+				while ((end < edges.size()) && (edges[end] == edges[begin]))
+				{
+					++ end;
+				}
+				if (end - begin != 2)
+				{
+					locked[static_cast<uint32_t>(edges[begin] >> 32)] = 1;
+					locked[static_cast<uint32_t>(edges[begin] & 0xFFFFFFFFU)] = 1;
+				}
+				begin = end;
+			}
+		}
+
+		std::vector<Quadric> quadrics(num_vertices);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			Quadric const q = Quadric::FromTriangle(unit_positions[indices[i + 0]], unit_positions[indices[i + 1]],
+				unit_positions[indices[i + 2]]);
+			for (uint32_t j = 0; j < 3; ++ j)
+			{
+				quadrics[indices[i + j]] += q;
+			}
+		}
+
+		auto collapse_cost = [&](uint32_t from, uint32_t to)
+		{
+			Quadric q = quadrics[from];
+			q += quadrics[to];
+			double cost = q.Error(unit_positions[to]);
+			for (uint32_t a = 0; a < num_attributes; ++ a)
+			{
+				float const diff = attributes[from * num_attributes + a] - attributes[to * num_attributes + a];
+				cost += diff * diff;
+			}
+			return static_cast<float>(cost);
+		};
+
+		std::vector<uint32_t> adj_offsets;
+		std::vector<uint32_t> adj_triangles;
+		// A collapse is rejected if it turns any of the remaining triangles around
+		auto flips = [&](uint32_t from, uint32_t to)
+		{
+			for (uint32_t i = adj_offsets[from]; i < adj_offsets[from + 1]; ++ i)
+			{
+				uint32_t const* tri = &indices[adj_triangles[i] * 3];
+				if ((tri[0] == to) || (tri[1] == to) || (tri[2] == to))
+				{
+					continue;
+				}
+
+				float3 p[3];
+				float3 q[3];
+				for (uint32_t j = 0; j < 3; ++ j)
+				{
+					p[j] = unit_positions[tri[j]];
+					q[j] = unit_positions[tri[j] == from ? to : tri[j]];
+				}
+				float3 const n0 = MathLib::cross(p[1] - p[0], p[2] - p[0]);
+				float3 const n1 = MathLib::cross(q[1] - q[0], q[2] - q[0]);
+				if (MathLib::dot(n0, n1) <= 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+
+		float const max_cost = target_error * target_error;
+		float result_cost = 0;
+
+		std::vector<Collapse> collapses;
+		std::vector<Collapse> collapses_scratch;
+		std::vector<uint32_t> remap(num_vertices);
+		std::vector<uint8_t> touched(num_vertices);
+		bool error_reached = false;
+		while ((indices.size() > target_index_count) && !error_reached)
+		{
+			uint32_t const num_triangles = static_cast<uint32_t>(indices.size() / 3);
+
+			adj_offsets.assign(num_vertices + 1, 0);
+			for (uint32_t index : indices)
+			{
+				++ adj_offsets[index + 1];
+			}
+			for (uint32_t i = 0; i < num_vertices; ++ i)
+			{
+				adj_offsets[i + 1] += adj_offsets[i];
+			}
+			adj_triangles.resize(indices.size());
+			{
+				std::vector<uint32_t> cursors(adj_offsets.begin(), adj_offsets.end() - 1);
+				for (uint32_t i = 0; i < indices.size(); ++ i)
+				{
+					adj_triangles[cursors[indices[i]] ++] = i / 3;
+				}
+			}
+
+			collapses.clear();
+			for (uint32_t t = 0; t < num_triangles; ++ t)
+			{
+				for (uint32_t j = 0; j < 3; ++ j)
+				{
+					uint32_t const a = indices[t * 3 + j];
+					uint32_t const b = indices[t * 3 + (j + 1) % 3];
+					if (!locked[a])
+					{
+						collapses.push_back({ a, b, collapse_cost(a, b) });
+					}
+					if (!locked[b])
+					{
+						collapses.push_back({ b, a, collapse_cost(b, a) });
+					}
+				}
+			}
+			RadixSort(collapses, collapses_scratch, [](Collapse const & c) { return OrderedFloatBits(c.cost); });
+
+			// Every collapse removes about 2 triangles. Collapses in one pass don't share triangles, so they can be tested
+			//  against the triangles of the pass.
+			uint32_t const triangles_to_remove = (static_cast<uint32_t>(indices.size()) - target_index_count + 2) / 3;
+			uint32_t triangles_removed = 0;
+			uint32_t num_collapsed = 0;
+			std::iota(remap.begin(), remap.end(), 0U);
+			std::fill(touched.begin(), touched.end(), static_cast<uint8_t>(0));
+			for (auto const & collapse : collapses)
+			{
+				if (triangles_removed >= triangles_to_remove)
+				{
+					break;
+				}
+				if (collapse.cost > max_cost)
+				{
+					error_reached = true;
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to))
+				{
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				for (uint32_t i = adj_offsets[collapse.from]; i < adj_offsets[collapse.from + 1]; ++ i)
+				{
+					uint32_t const* tri = &indices[adj_triangles[i] * 3];
+					bool has_to = false;
+					for (uint32_t j = 0; j < 3; ++ j)
+					{
+						touched[tri[j]] = 1;
+						has_to |= (tri[j] == collapse.to);
+					}
+					triangles_removed += has_to;
+				}
+				quadrics[collapse.to] += quadrics[collapse.from];
+				result_cost = std::max(result_cost, collapse.cost);
+				++ num_collapsed;
+			}
+			if (num_collapsed == 0)
+			{
+				break;
+			}
+
+			size_t num_indices = 0;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				uint32_t const a = remap[indices[i + 0]];
+				uint32_t const b = remap[indices[i + 1]];
+				uint32_t const c = remap[indices[i + 2]];
+				if ((a != b) && (b != c) && (c != a))
+				{
+					indices[num_indices + 0] = a;
+					indices[num_indices + 1] = b;
+					indices[num_indices + 2] = c;
+					num_indices += 3;
+				}
+			}
+			indices.resize(num_indices);
+		}
+
+		return std::sqrt(result_cost);
+	}
+}
@@ -30,10 +30,15 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/CXX17/filesystem.hpp>
+#include <KFL/Hash.hpp>
+#include <KFL/TaskScheduler.hpp>
+#include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/TexCompression.hpp>
 
+#include <atomic>
 #include <cstring>
+#include <fstream>
 
 #include <KlayGE/DevHelper/TexConverter.hpp>
 #include "ImagePlane.hpp"
@@ -56,6 +61,10 @@ namespace
 		bool Load();
 		TexturePtr StoreToTexture();
 
+		// Calls func(arr, m) on the first num_mips mip levels of every array slice, in parallel
+		template <typename Func>
+		void ForEachPlane(uint32_t num_mips, Func const & func);
+
 	private:
 		std::string input_name_;
 
@@ -183,6 +192,19 @@ namespace
 		}
 	}
 
+	template <typename Func>
+	void TexLoader::ForEachPlane(uint32_t num_mips, Func const & func)
+	{
+		Context::Instance().TaskScheduler().parallel_for(0, array_size_ * num_mips, 1,
+			[num_mips, &func](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; ++ i)
+				{
+					func(i / num_mips, i % num_mips);
+				}
+			});
+	}
+
 	bool TexLoader::Load()
 	{
 		array_size_ = metadata_.ArraySize();
@@ -267,6 +289,9 @@ namespace
 		}
 		else
 		{
+			// Files are loaded and slices are copied from the first one here. The mips are resized from their slices in
+			//  parallel, ResizeTo touches its source so one slice can't be resized by 2 threads.
+			std::vector<uint8_t> need_resize(array_size_ * num_mipmaps_, 0);
 			for (uint32_t arr = 0; arr < array_size_; ++ arr)
 			{
 				planes_[arr].resize(num_mipmaps_);
@@ -281,12 +306,11 @@ namespace
 						{
 							if (m == 0)
 							{
-								*planes_[arr][m] = planes_[0][0]->ResizeTo(width_, height_, false);
+								*planes_[arr][m] = planes_[0][0]->ResizeTo(width_, height_, ResampleFilter::Point);
 							}
 							else
 							{
-								*planes_[arr][m] = planes_[arr][0]->ResizeTo(
-									std::max(1U, width_ >> m), std::max(1U, height_ >> m), metadata_.LinearMipmap());
+								need_resize[arr * num_mipmaps_ + m] = 1;
 							}
 						}
 						else
@@ -300,27 +324,39 @@ namespace
 					}
 				}
 			}
+
+			Context::Instance().TaskScheduler().parallel_for(0, array_size_, 1,
+				[this, &need_resize](uint32_t first, uint32_t last)
+				{
+					for (uint32_t arr = first; arr < last; ++ arr)
+					{
+						for (uint32_t m = 1; m < num_mipmaps_; ++ m)
+						{
+							if (need_resize[arr * num_mipmaps_ + m])
+							{
+								*planes_[arr][m] = planes_[arr][0]->ResizeTo(
+									std::max(1U, width_ >> m), std::max(1U, height_ >> m),
+									metadata_.LinearMipmap() ? ResampleFilter::Linear : ResampleFilter::Point);
+							}
+						}
+					}
+				});
 		}
 
+		uint32_t const num_source_mips = need_gen_mipmaps ? 1 : num_mipmaps_;
+
 		if (metadata_.RgbToLum())
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				uint32_t const num = need_gen_mipmaps ? 1 : num_mipmaps_;
-				for (uint32_t m = 0; m < num; ++ m)
+			this->ForEachPlane(num_source_mips, [this](uint32_t arr, uint32_t m)
 				{
 					planes_[arr][m]->RgbToLum();
-				}
-			}
+				});
 		}
 
 		if (((metadata_.Slot() == RenderMaterial::TS_Normal) || (metadata_.Slot() == RenderMaterial::TS_Occlusion)) &&
 			(metadata_.BumpToNormal() || metadata_.BumpToOcclusion()))
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				uint32_t const num = need_gen_mipmaps ? 1 : num_mipmaps_;
-				for (uint32_t m = 0; m < num; ++ m)
+			this->ForEachPlane(num_source_mips, [this](uint32_t arr, uint32_t m)
 				{
 					planes_[arr][m]->BumpToNormal(metadata_.BumpScale(), metadata_.BumpToOcclusion() ? metadata_.OcclusionAmplitude() : 0);
 
@@ -328,36 +364,35 @@ namespace
 					{
 						planes_[arr][m]->AlphaToLum();
 					}
-				}
-			}
+				});
 		}
 
 		if ((metadata_.Slot() == RenderMaterial::TS_Height) && metadata_.NormalToHeight())
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				uint32_t const num = need_gen_mipmaps ? 1 : num_mipmaps_;
-				for (uint32_t m = 0; m < num; ++ m)
+			this->ForEachPlane(num_source_mips, [this](uint32_t arr, uint32_t m)
 				{
 					planes_[arr][m]->NormalToHeight(metadata_.HeightMinZ());
-				}
-			}
+				});
 		}
 
 		if (need_gen_mipmaps)
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				uint32_t w = width_;
-				uint32_t h = height_;
-				for (uint32_t m = 0; m < num_mipmaps_ - 1; ++ m)
+			// Each mip is resized from the previous one, only the slices are independent
+			this->ForEachPlane(1, [this](uint32_t arr, uint32_t m)
 				{
-					w = std::max<uint32_t>(1U, w / 2);
-					h = std::max<uint32_t>(1U, h / 2);
+					KFL_UNUSED(m);
 
-					*planes_[arr][m + 1] = planes_[arr][m]->ResizeTo(w, h, metadata_.LinearMipmap());
-				}
-			}
+					uint32_t w = width_;
+					uint32_t h = height_;
+					for (uint32_t mip = 0; mip < num_mipmaps_ - 1; ++ mip)
+					{
+						w = std::max<uint32_t>(1U, w / 2);
+						h = std::max<uint32_t>(1U, h / 2);
+
+						*planes_[arr][mip + 1] = planes_[arr][mip]->ResizeTo(w, h,
+							metadata_.LinearMipmap() ? ResampleFilter::Linear : ResampleFilter::Point);
+					}
+				});
 
 			format_ = planes_[0][0]->UncompressedTex()->Format();
 		}
@@ -379,24 +414,18 @@ namespace
 		}
 		if (need_normal_compression)
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				for (uint32_t m = 0; m < num_mipmaps_; ++ m)
+			this->ForEachPlane(num_mipmaps_, [this](uint32_t arr, uint32_t m)
 				{
 					planes_[arr][m]->PrepareNormalCompression(metadata_.PreferedFormat());
-				}
-			}
+				});
 		}
 
 		if (format_ != metadata_.PreferedFormat())
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				for (uint32_t m = 0; m < num_mipmaps_; ++ m)
+			this->ForEachPlane(num_mipmaps_, [this](uint32_t arr, uint32_t m)
 				{
 					planes_[arr][m]->FormatConversion(metadata_.PreferedFormat());
-				}
-			}
+				});
 
 			format_ = metadata_.PreferedFormat();
 		}
@@ -473,14 +502,173 @@ namespace
 		ret->CreateHWResource(output_init_data, nullptr);
 		return ret;
 	}
+
+	// Bump it when the conversion changes, so the old results are not used
+	uint32_t constexpr TEX_CACHE_VERSION = 1;
+
+	bool HashFile(ContentHasher& hasher, std::string_view name)
+	{
+		std::string const path = ResLoader::Instance().Locate(name);
+		if (path.empty())
+		{
+			return false;
+		}
+
+		std::ifstream ifs(path.c_str(), std::ios_base::binary);
+		if (!ifs)
+		{
+			return false;
+		}
+
+		char buff[64 * 1024];
+		do
+		{
+			ifs.read(buff, sizeof(buff));
+			hasher.Update(buff, static_cast<size_t>(ifs.gcount()));
+		} while (ifs);
+
+		hasher.Update(static_cast<uint32_t>(0));
+		return true;
+	}
+
+	// The key of a conversion is the hash of all input files and all metadata. Returns an empty string if an input can't
+	//  be read, the conversion is not cached then.
+	std::string TexCacheKey(std::string_view input_name, TexMetadata const & metadata)
+	{
+		ContentHasher hasher;
+		hasher.Update(TEX_CACHE_VERSION);
+
+		if (!HashFile(hasher, input_name))
+		{
+			return std::string();
+		}
+		for (uint32_t arr = 0; arr < metadata.ArraySize(); ++ arr)
+		{
+			for (uint32_t m = 0;; ++ m)
+			{
+				std::string_view const plane_file_name = metadata.PlaneFileName(arr, m);
+				if (plane_file_name.empty())
+				{
+					if ((arr == 0) && (m == 0))
+					{
+						continue;
+					}
+					break;
+				}
+				hasher.Update(plane_file_name.data(), plane_file_name.size());
+				if (!HashFile(hasher, plane_file_name))
+				{
+					return std::string();
+				}
+			}
+		}
+
+		hasher.Update(static_cast<uint32_t>(metadata.Type()));
+		hasher.Update(static_cast<uint32_t>(metadata.Slot()));
+		hasher.Update(static_cast<uint32_t>(metadata.PreferedFormat()));
+		hasher.Update(static_cast<uint32_t>(metadata.ForceSRGB()));
+		for (uint32_t ch = 0; ch < 4; ++ ch)
+		{
+			hasher.Update(static_cast<uint32_t>(metadata.ChannelMapping(ch)));
+		}
+		hasher.Update(static_cast<uint32_t>(metadata.RgbToLum()));
+		hasher.Update(static_cast<uint32_t>(metadata.MipmapEnabled()));
+		hasher.Update(static_cast<uint32_t>(metadata.AutoGenMipmap()));
+		hasher.Update(metadata.NumMipmaps());
+		hasher.Update(static_cast<uint32_t>(metadata.LinearMipmap()));
+		hasher.Update(static_cast<uint32_t>(metadata.BumpToNormal()));
+		float const bump_scale = metadata.BumpScale();
+		hasher.Update(&bump_scale, sizeof(bump_scale));
+		hasher.Update(static_cast<uint32_t>(metadata.BumpToOcclusion()));
+		float const occlusion_amplitude = metadata.OcclusionAmplitude();
+		hasher.Update(&occlusion_amplitude, sizeof(occlusion_amplitude));
+		hasher.Update(static_cast<uint32_t>(metadata.NormalToHeight()));
+		float const height_min_z = metadata.HeightMinZ();
+		hasher.Update(&height_min_z, sizeof(height_min_z));
+		hasher.Update(metadata.ArraySize());
+
+		return hasher.HexDigest();
+	}
+
+	std::filesystem::path TexCacheFolder()
+	{
+		return std::filesystem::path(ResLoader::Instance().LocalFolder()) / "TexCache";
+	}
 }
 
 namespace KlayGE
 {
 	TexturePtr TexConverter::Load(std::string_view input_name, TexMetadata const & metadata)
 	{
+		std::string const cache_key = TexCacheKey(input_name, metadata);
+		std::filesystem::path const cache_path = TexCacheFolder() / (cache_key + ".dds");
+		if (!cache_key.empty())
+		{
+			std::error_code ec;
+			if (std::filesystem::exists(cache_path, ec))
+			{
+				TexturePtr texture = LoadSoftwareTexture(cache_path.string());
+				if (texture)
+				{
+					return texture;
+				}
+			}
+		}
+
 		TexLoader tl;
-		return tl.Load(input_name, metadata);
+		TexturePtr texture = tl.Load(input_name, metadata);
+
+		if (texture && !cache_key.empty())
+		{
+			std::error_code ec;
+			std::filesystem::create_directories(cache_path.parent_path(), ec);
+
+			// Writes to a temporary file first, other processes could be reading the same key
+			static std::atomic<uint32_t> tmp_counter(0);
+			std::filesystem::path const tmp_path = TexCacheFolder()
+				/ (cache_key + '.' + std::to_string(tmp_counter.fetch_add(1)) + ".tmp");
+			SaveTexture(texture, tmp_path.string());
+			std::filesystem::rename(tmp_path, cache_path, ec);
+			if (ec)
+			{
+				std::filesystem::remove(tmp_path, ec);
+			}
+		}
+
+		return texture;
+	}
+
+	void TexConverter::LoadBatch(std::span<std::string const> input_names, std::span<TexMetadata const> metadata,
+		std::function<void(uint32_t index, TexturePtr const & texture)> const & on_loaded)
+	{
+		BOOST_ASSERT(input_names.size() == metadata.size());
+
+		// The folders are added up front. Otherwise the conversions of 2 files in one folder could remove it from the
+		//  paths while the other one is still loading.
+		std::vector<std::string> added_folders;
+		for (auto const & input_name : input_names)
+		{
+			auto const in_folder = std::filesystem::path(ResLoader::Instance().Locate(input_name)).parent_path().string();
+			if (!ResLoader::Instance().IsInPath(in_folder))
+			{
+				ResLoader::Instance().AddPath(in_folder);
+				added_folders.push_back(in_folder);
+			}
+		}
+
+		Context::Instance().TaskScheduler().parallel_for(0, static_cast<uint32_t>(input_names.size()), 1,
+			[this, input_names, metadata, &on_loaded](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; ++ i)
+				{
+					on_loaded(i, this->Load(input_names[i], metadata[i]));
+				}
+			});
+
+		for (auto const & folder : added_folders)
+		{
+			ResLoader::Instance().DelPath(folder);
+		}
 	}
 
 	void TexConverter::GetImageInfo(std::string_view input_name, TexMetadata const & metadata,
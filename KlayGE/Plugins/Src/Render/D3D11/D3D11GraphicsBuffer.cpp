@@ -344,7 +344,14 @@ namespace KlayGE
 	{
 		D3D11_BOX* p = nullptr;
 		D3D11_BOX box;
-		if (!(bind_flags_ & D3D11_BIND_CONSTANT_BUFFER))
+		bool partial = !(bind_flags_ & D3D11_BIND_CONSTANT_BUFFER);
+		if (!partial && ((offset != 0) || (size < size_in_byte_)))
+		{
+			// Constant buffers can be updated partially only with D3D11.1's ConstantBufferPartialUpdate
+			auto const& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+			partial = re.DeviceCaps().partial_cbuffer_update_support;
+		}
+		if (partial)
 		{
 			p = &box;
 			box.left = offset;
@@ -354,6 +361,6 @@ namespace KlayGE
 			box.bottom = 1;
 			box.back = 1;
 		}
-		d3d_imm_ctx_->UpdateSubresource(d3d_buffer_.get(), 0, p, data, size, size);
+		d3d_imm_ctx_->UpdateSubresource1(d3d_buffer_.get(), 0, p, data, size, size, 0);
 	}
 }
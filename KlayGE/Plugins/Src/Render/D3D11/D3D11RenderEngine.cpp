@@ -86,6 +86,18 @@ namespace
 		std::mem_fn(&ID3D11DeviceContext1::DSSetConstantBuffers)
 	};
 	KLAYGE_STATIC_ASSERT(std::size(ShaderSetConstantBuffers) == NumShaderStages);
+
+	static std::function<void(ID3D11DeviceContext1*, UINT, UINT, ID3D11Buffer * const *, UINT const *, UINT const *)> const
+		ShaderSetConstantBuffers1[] =
+	{
+		std::mem_fn(&ID3D11DeviceContext1::VSSetConstantBuffers1),
+		std::mem_fn(&ID3D11DeviceContext1::PSSetConstantBuffers1),
+		std::mem_fn(&ID3D11DeviceContext1::GSSetConstantBuffers1),
+		std::mem_fn(&ID3D11DeviceContext1::CSSetConstantBuffers1),
+		std::mem_fn(&ID3D11DeviceContext1::HSSetConstantBuffers1),
+		std::mem_fn(&ID3D11DeviceContext1::DSSetConstantBuffers1)
+	};
+	KLAYGE_STATIC_ASSERT(std::size(ShaderSetConstantBuffers1) == NumShaderStages);
 }
 
 namespace KlayGE
@@ -438,6 +450,8 @@ namespace KlayGE
 				std::fill(shader_cb_ptr_cache_[i].begin(), shader_cb_ptr_cache_[i].end(), static_cast<ID3D11Buffer*>(nullptr));
 				ShaderSetConstantBuffers[i](d3d_imm_ctx_1_.get(), 0, static_cast<UINT>(shader_cb_ptr_cache_[i].size()), &shader_cb_ptr_cache_[i][0]);
 				shader_cb_ptr_cache_[i].clear();
+				shader_cb_first_constant_cache_[i].clear();
+				shader_cb_num_constants_cache_[i].clear();
 			}
 		}
 	}
@@ -800,6 +814,8 @@ namespace KlayGE
 			shader_srv_ptr_cache_[i].clear();
 			shader_sampler_ptr_cache_[i].clear();
 			shader_cb_ptr_cache_[i].clear();
+			shader_cb_first_constant_cache_[i].clear();
+			shader_cb_num_constants_cache_[i].clear();
 		}
 		render_uav_ptr_cache_.clear();
 		render_uav_init_count_cache_.clear();
@@ -932,10 +948,15 @@ namespace KlayGE
 			if (SUCCEEDED(d3d_device_1_->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &d3d11_feature, sizeof(d3d11_feature))))
 			{
 				caps_.logic_op_support = d3d11_feature.OutputMergerLogicOp ? true : false;
+				caps_.partial_cbuffer_update_support = d3d11_feature.ConstantBufferPartialUpdate ? true : false;
+				caps_.cbuffer_offset_binding_support =
+					d3d11_feature.ConstantBufferOffsetting && d3d11_feature.MapNoOverwriteOnDynamicConstantBuffer;
 			}
 			else
 			{
 				caps_.logic_op_support = false;
+				caps_.partial_cbuffer_update_support = false;
+				caps_.cbuffer_offset_binding_support = false;
 			}
 		}
 		caps_.independent_blend_support = true;
@@ -1434,11 +1455,30 @@ namespace KlayGE
 	void D3D11RenderEngine::SetConstantBuffers(ShaderStage stage, std::span<ID3D11Buffer* const> cbs)
 	{
 		uint32_t const stage_index = static_cast<uint32_t>(stage);
-		if (MakeSpan(shader_cb_ptr_cache_[stage_index]) != cbs)
+		if ((MakeSpan(shader_cb_ptr_cache_[stage_index]) != cbs) || !shader_cb_first_constant_cache_[stage_index].empty())
 		{
 			ShaderSetConstantBuffers[stage_index](d3d_imm_ctx_1_.get(), 0, static_cast<UINT>(cbs.size()), &cbs[0]);
 
 			shader_cb_ptr_cache_[stage_index].assign(cbs.begin(), cbs.end());
+			shader_cb_first_constant_cache_[stage_index].clear();
+			shader_cb_num_constants_cache_[stage_index].clear();
+		}
+	}
+
+	void D3D11RenderEngine::SetConstantBuffers1(ShaderStage stage, std::span<ID3D11Buffer* const> cbs,
+		std::span<UINT const> first_constants, std::span<UINT const> num_constants)
+	{
+		uint32_t const stage_index = static_cast<uint32_t>(stage);
+		if ((MakeSpan(shader_cb_ptr_cache_[stage_index]) != cbs)
+			|| (MakeSpan(shader_cb_first_constant_cache_[stage_index]) != first_constants)
+			|| (MakeSpan(shader_cb_num_constants_cache_[stage_index]) != num_constants))
+		{
+			ShaderSetConstantBuffers1[stage_index](d3d_imm_ctx_1_.get(), 0, static_cast<UINT>(cbs.size()), &cbs[0],
+				&first_constants[0], &num_constants[0]);
+
+			shader_cb_ptr_cache_[stage_index].assign(cbs.begin(), cbs.end());
+			shader_cb_first_constant_cache_[stage_index].assign(first_constants.begin(), first_constants.end());
+			shader_cb_num_constants_cache_[stage_index].assign(num_constants.begin(), num_constants.end());
 		}
 	}
 
@@ -38,6 +38,7 @@
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/TransientBuffer.hpp>
 #include <KFL/CustomizedStreamBuf.hpp>
 #include <KFL/Hash.hpp>
 
@@ -1258,14 +1259,37 @@ namespace KlayGE
 				if (!cbuff_indices.empty())
 				{
 					ID3D11Buffer* d3d11_cbuffs[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+					UINT first_constants[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+					UINT num_constants[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+					bool bind_by_offset = false;
 					for (uint32_t i = 0; i < cbuff_indices.size(); ++i)
 					{
 						auto* cb = effect.CBufferByIndex(cbuff_indices[i]);
 						cb->Update();
-						d3d11_cbuffs[i] = checked_cast<D3D11GraphicsBuffer*>(cb->HWBuff().get())->D3DBuffer();
+						auto const& hw_buff = cb->HWBuff();
+						d3d11_cbuffs[i] = checked_cast<D3D11GraphicsBuffer*>(hw_buff.get())->D3DBuffer();
+						first_constants[i] = cb->HWBuffOffset() / 16;
+						if (cb->UploadRing())
+						{
+							num_constants[i] = ConstantBufferRing::AlignedSize(cb->Size()) / 16;
+							bind_by_offset = true;
+						}
+						else
+						{
+							num_constants[i] = ConstantBufferRing::AlignedSize(hw_buff->Size()) / 16;
+						}
 					}
 
-					re.SetConstantBuffers(stage, MakeSpan(d3d11_cbuffs, cbuff_indices.size()));
+					uint32_t const num_cbuffs = static_cast<uint32_t>(cbuff_indices.size());
+					if (bind_by_offset)
+					{
+						re.SetConstantBuffers1(stage, MakeSpan(d3d11_cbuffs, num_cbuffs), MakeSpan(first_constants, num_cbuffs),
+							MakeSpan(num_constants, num_cbuffs));
+					}
+					else
+					{
+						re.SetConstantBuffers(stage, MakeSpan(d3d11_cbuffs, num_cbuffs));
+					}
 				}
 			}
 		}
@@ -1149,6 +1149,9 @@ namespace KlayGE
 		caps_.independent_blend_support = true;
 		caps_.draw_indirect_support = true;
 		caps_.no_overwrite_support = true;
+		// UpdateSubresource renews the whole memory block, so constant buffers are always uploaded entirely
+		caps_.partial_cbuffer_update_support = false;
+		caps_.cbuffer_offset_binding_support = true;
 		caps_.full_npot_texture_support = true;
 		caps_.render_to_texture_array_support = true;
 		caps_.explicit_multi_sample_support = true;
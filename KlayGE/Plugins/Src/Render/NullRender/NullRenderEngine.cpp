@@ -31,6 +31,8 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Hash.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/RenderLayout.hpp>
 
 #include <KlayGE/NullRender/NullRenderEngine.hpp>
 
@@ -159,8 +161,12 @@ namespace KlayGE
 	void NullRenderEngine::DoRender(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl)
 	{
 		KFL_UNUSED(effect);
-		KFL_UNUSED(tech);
-		KFL_UNUSED(rl);
+
+		// Nothing is drawn, but the counters are kept as in the other render engines, so draw calls can be measured
+		uint32_t const vertex_count = static_cast<uint32_t>(rl.UseIndices() ? rl.NumIndices() : rl.NumVertices());
+		uint32_t const num_instances = rl.NumInstances() * (this->CurFrameBuffer() ? this->NumRealizedCameraInstances() : 1);
+		num_vertices_just_rendered_ += num_instances * vertex_count;
+		num_draws_just_called_ += tech.NumPasses();
 	}
 
 	void NullRenderEngine::DoDispatch(RenderEffect const & effect, RenderTechnique const & tech, uint32_t tgx, uint32_t tgy, uint32_t tgz)
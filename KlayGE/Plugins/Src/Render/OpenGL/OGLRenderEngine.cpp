@@ -50,6 +50,7 @@
 #include <KFL/Util.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/PostProcess.hpp>
+#include <KlayGE/TransientBuffer.hpp>
 #include <KFL/Hash.hpp>
 
 #include <glloader/glloader.h>
@@ -477,11 +478,29 @@ namespace KlayGE
 			binded.resize(first + count, 0xFFFFFFFF);
 		}
 
+		auto& binded_ranges = binded_buffer_ranges_with_binding_points_[target];
+		if (first + count > binded_ranges.size())
+		{
+			binded_ranges.resize(first + count, std::make_pair(0, 0));
+		}
+
 		bool dirty = force;
 		if (!dirty)
 		{
 			dirty = (memcmp(&binded[first], buffers, count * sizeof(buffers[0])) != 0);
 		}
+		if (!dirty)
+		{
+			// A binding point bound by BindBuffersRange needs to be rebound to the whole buffer
+			for (GLsizei i = 0; i < count; ++ i)
+			{
+				if (binded_ranges[first + i].second != 0)
+				{
+					dirty = true;
+					break;
+				}
+			}
+		}
 
 		if (dirty)
 		{
@@ -503,6 +522,65 @@ namespace KlayGE
 			}
 
 			memcpy(&binded[first], buffers, count * sizeof(buffers[0]));
+			std::fill(binded_ranges.begin() + first, binded_ranges.begin() + first + count, std::make_pair(0, 0));
+		}
+	}
+
+	void OGLRenderEngine::BindBuffersRange(GLenum target, GLuint first, GLsizei count, GLuint const * buffers,
+		GLintptr const * offsets, GLsizeiptr const * sizes, bool force)
+	{
+		auto& binded = binded_buffers_with_binding_points_[target];
+		if (first + count > binded.size())
+		{
+			binded.resize(first + count, 0xFFFFFFFF);
+		}
+		auto& binded_ranges = binded_buffer_ranges_with_binding_points_[target];
+		if (first + count > binded_ranges.size())
+		{
+			binded_ranges.resize(first + count, std::make_pair(0, 0));
+		}
+
+		bool dirty = force;
+		if (!dirty)
+		{
+			dirty = (memcmp(&binded[first], buffers, count * sizeof(buffers[0])) != 0);
+		}
+		if (!dirty)
+		{
+			for (GLsizei i = 0; i < count; ++ i)
+			{
+				if ((binded_ranges[first + i].first != offsets[i]) || (binded_ranges[first + i].second != sizes[i]))
+				{
+					dirty = true;
+					break;
+				}
+			}
+		}
+
+		if (dirty)
+		{
+			if (glloader_GL_VERSION_4_4() || glloader_GL_ARB_multi_bind())
+			{
+				glBindBuffersRange(target, first, count, buffers, offsets, sizes);
+			}
+			else
+			{
+				for (uint32_t i = first; i < first + count; ++ i)
+				{
+					glBindBufferRange(target, i, buffers[i - first], offsets[i - first], sizes[i - first]);
+				}
+				auto iter = binded_buffers_.find(target);
+				if (iter != binded_buffers_.end())
+				{
+					glBindBuffer(target, iter->second);
+				}
+			}
+
+			memcpy(&binded[first], buffers, count * sizeof(buffers[0]));
+			for (GLsizei i = 0; i < count; ++ i)
+			{
+				binded_ranges[first + i] = std::make_pair(offsets[i], sizes[i]);
+			}
 		}
 	}
 
@@ -564,15 +642,12 @@ namespace KlayGE
 				iter_target != binded_buffers_with_binding_points_.end();
 				++ iter_target)
 			{
-				for (auto iter_buff = iter_target->second.begin(); iter_buff != iter_target->second.end();)
+				// Invalidate instead of erasing, so the binding points and their ranges stay in place
+				for (auto& buff : iter_target->second)
 				{
-					if (*iter_buff == buffers[i])
-					{
-						iter_buff = iter_target->second.erase(iter_buff);
-					}
-					else
+					if (buff == buffers[i])
 					{
-						++ iter_buff;
+						buff = 0xFFFFFFFF;
 					}
 				}
 			}
@@ -1527,6 +1602,9 @@ namespace KlayGE
 		caps_.independent_blend_support = true;
 		caps_.draw_indirect_support = true;
 		caps_.no_overwrite_support = false;
+		caps_.partial_cbuffer_update_support = true;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &temp);
+		caps_.cbuffer_offset_binding_support = (temp <= static_cast<GLint>(ConstantBufferRing::ALIGNMENT));
 		caps_.full_npot_texture_support = true;
 		if (caps_.max_texture_array_length > 1)
 		{
@@ -41,6 +41,7 @@
 #include <KlayGE/RenderEffect.hpp>
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/TransientBuffer.hpp>
 #include <KFL/CustomizedStreamBuf.hpp>
 #include <KFL/Hash.hpp>
 
@@ -1559,15 +1560,39 @@ namespace KlayGE
 		if (!all_cbuff_indices_.empty())
 		{
 			std::vector<GLuint> gl_bind_cbuffs;
+			std::vector<GLintptr> gl_bind_cbuff_offsets;
+			std::vector<GLsizeiptr> gl_bind_cbuff_sizes;
 			gl_bind_cbuffs.reserve(all_cbuff_indices_.size());
+			gl_bind_cbuff_offsets.reserve(all_cbuff_indices_.size());
+			gl_bind_cbuff_sizes.reserve(all_cbuff_indices_.size());
+			bool bind_by_offset = false;
 			for (auto cb_index : all_cbuff_indices_)
 			{
 				auto* cbuff = effect.CBufferByIndex(cb_index);
 				cbuff->Update();
-				gl_bind_cbuffs.push_back(checked_cast<OGLGraphicsBuffer&>(*cbuff->HWBuff()).GLvbo());	
+				auto const& hw_buff = cbuff->HWBuff();
+				gl_bind_cbuffs.push_back(checked_cast<OGLGraphicsBuffer&>(*hw_buff).GLvbo());
+				gl_bind_cbuff_offsets.push_back(cbuff->HWBuffOffset());
+				if (cbuff->UploadRing())
+				{
+					gl_bind_cbuff_sizes.push_back(ConstantBufferRing::AlignedSize(cbuff->Size()));
+					bind_by_offset = true;
+				}
+				else
+				{
+					gl_bind_cbuff_sizes.push_back(hw_buff->Size());
+				}
 			}
 
-			re.BindBuffersBase(GL_UNIFORM_BUFFER, 0, static_cast<GLsizei>(gl_bind_cbuffs.size()), gl_bind_cbuffs.data());
+			if (bind_by_offset)
+			{
+				re.BindBuffersRange(GL_UNIFORM_BUFFER, 0, static_cast<GLsizei>(gl_bind_cbuffs.size()), gl_bind_cbuffs.data(),
+					gl_bind_cbuff_offsets.data(), gl_bind_cbuff_sizes.data());
+			}
+			else
+			{
+				re.BindBuffersBase(GL_UNIFORM_BUFFER, 0, static_cast<GLsizei>(gl_bind_cbuffs.size()), gl_bind_cbuffs.data());
+			}
 		}
 
 		if (!gl_bind_textures_.empty())
@@ -1487,6 +1487,8 @@ namespace KlayGE
 			caps_.draw_indirect_support = false;
 		}
 		caps_.no_overwrite_support = false;
+		caps_.partial_cbuffer_update_support = true;
+		caps_.cbuffer_offset_binding_support = false;
 		if (this->HackForAndroidEmulator())
 		{
 			caps_.full_npot_texture_support = false;
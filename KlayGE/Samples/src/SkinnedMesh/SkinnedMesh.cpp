@@ -178,7 +178,7 @@ uint32_t SkinnedMeshApp::DoUpdate(uint32_t pass)
 	if ((pass == 0) && skinning_ && playing_)
 	{
 		frame_ += skinned_model_->FrameRate() * frame_time_;
-		skinned_model_->SetFrame(frame_);
+		skinned_model_->QueueFrame(frame_);
 	}
 
 	return deferred_rendering_->Update(pass);
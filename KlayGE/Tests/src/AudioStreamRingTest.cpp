@@ -0,0 +1,123 @@
+/**
+ * @file AudioStreamRingTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <KlayGE/Audio.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+TEST(AudioStreamRingTest, WrapAround)
+{
+	AudioStreamRing ring(100);
+	EXPECT_EQ(ring.Capacity(), 128U);
+	EXPECT_EQ(ring.WriteAvailable(), 128U);
+
+	std::vector<uint8_t> src(200);
+	for (size_t i = 0; i < src.size(); ++ i)
+	{
+		src[i] = static_cast<uint8_t>(i);
+	}
+
+	EXPECT_EQ(ring.Write(src.data(), 100), 100U);
+	EXPECT_EQ(ring.Skip(90), 90U);
+	EXPECT_EQ(ring.Write(src.data() + 100, 100), 100U);
+	EXPECT_EQ(ring.Write(src.data(), 100), 18U);
+	EXPECT_EQ(ring.WriteAvailable(), 0U);
+
+	std::vector<uint8_t> dst(200);
+	EXPECT_EQ(ring.Read(dst.data(), dst.size()), 128U);
+	for (size_t i = 0; i < 110; ++ i)
+	{
+		EXPECT_EQ(dst[i], static_cast<uint8_t>(90 + i));
+	}
+	for (size_t i = 0; i < 18; ++ i)
+	{
+		EXPECT_EQ(dst[110 + i], static_cast<uint8_t>(i));
+	}
+	EXPECT_EQ(ring.ReadAvailable(), 0U);
+
+	ring.Write(src.data(), 10);
+	ring.Clear();
+	EXPECT_EQ(ring.ReadAvailable(), 0U);
+}
+
+TEST(AudioStreamRingTest, SingleProducerSingleConsumer)
+{
+	uint32_t const total = 4 * 1024 * 1024;
+	AudioStreamRing ring(4096);
+
+	std::thread producer([&ring, total]
+		{
+			uint8_t chunk[1000];
+			uint32_t written = 0;
+			while (written < total)
+			{
+				uint32_t const size = std::min(static_cast<uint32_t>(sizeof(chunk)), total - written);
+				for (uint32_t i = 0; i < size; ++ i)
+				{
+					chunk[i] = static_cast<uint8_t>((written + i) * 7);
+				}
+
+				uint32_t offset = 0;
+				while (offset < size)
+				{
+					offset += static_cast<uint32_t>(ring.Write(chunk + offset, size - offset));
+				}
+				written += size;
+			}
+		});
+
+	uint32_t num_errors = 0;
+	uint32_t read = 0;
+	uint8_t chunk[777];
+	while (read < total)
+	{
+		uint32_t const size = static_cast<uint32_t>(ring.Read(chunk, sizeof(chunk)));
+		for (uint32_t i = 0; i < size; ++ i)
+		{
+			if (chunk[i] != static_cast<uint8_t>((read + i) * 7))
+			{
+				++ num_errors;
+			}
+		}
+		read += size;
+	}
+	producer.join();
+
+	EXPECT_EQ(num_errors, 0U);
+	EXPECT_EQ(ring.ReadAvailable(), 0U);
+}
@@ -30,3 +30,23 @@ TEST(MathTest, NormalizeFloat4)
 	v = MathLib::normalize(v);
 	EXPECT_LT(MathLib::abs(MathLib::length(v) - 1.0f), 1e-5f);
 }
+
+TEST(MathTest, InverseAffine)
+{
+	float4x4 const mat = MathLib::scaling(1.5f, 2.0f, 0.5f) * MathLib::rotation_x(0.3f) * MathLib::rotation_y(-1.1f)
+		* MathLib::translation(3.0f, -4.0f, 7.0f);
+	float4x4 const inv_affine = MathLib::inverse_affine(mat);
+	float4x4 const inv = MathLib::inverse(mat);
+	for (size_t i = 0; i < float4x4::elem_num; ++ i)
+	{
+		EXPECT_NEAR(inv_affine[i], inv[i], 1e-5f);
+	}
+
+	float4x4 const proj = MathLib::perspective_fov_lh(1.0f, 1.5f, 0.1f, 100.0f);
+	float4x4 const inv_proj = MathLib::inverse(proj);
+	float4x4 const inv_affine_proj = MathLib::inverse_affine(proj);
+	for (size_t i = 0; i < float4x4::elem_num; ++ i)
+	{
+		EXPECT_FLOAT_EQ(inv_affine_proj[i], inv_proj[i]);
+	}
+}
@@ -38,6 +38,10 @@
 #include <KlayGE/DevHelper/MeshConverter.hpp>
 #include <KlayGE/DevHelper/MeshMetadata.hpp>
 
+#include <cstring>
+#include <fstream>
+#include <vector>
+
 #include "KlayGETests.hpp"
 
 using namespace std;
@@ -796,3 +800,101 @@ TEST_F(MeshConverterTest, AnimationMeshML)
 {
 	RunTest("anim.meshml", "", "anim.meshml");
 }
+
+TEST_F(MeshConverterTest, ModelBinRoundTrip)
+{
+	auto model = LoadSoftwareModel("tree2a.lod.meshml");
+	ASSERT_TRUE(model);
+	ASSERT_GT(model->NumLods(), 1U);
+	model->LodScreenSize(1, 0.3f);
+
+	auto const temp_dir = std::filesystem::temp_directory_path();
+	std::string const saved_name = (temp_dir / "MeshConverterTestRoundTrip.model_bin").generic_string();
+	SaveModel(*model, saved_name);
+
+	auto loaded = LoadSoftwareModel(saved_name);
+	ASSERT_TRUE(loaded);
+
+	EXPECT_EQ(loaded->NumMaterials(), model->NumMaterials());
+	ASSERT_EQ(loaded->NumMeshes(), model->NumMeshes());
+	for (uint32_t i = 0; i < model->NumMeshes(); ++ i)
+	{
+		auto const & mesh = checked_cast<StaticMesh&>(*model->Mesh(i));
+		auto const & loaded_mesh = checked_cast<StaticMesh&>(*loaded->Mesh(i));
+
+		EXPECT_EQ(loaded_mesh.Name(), mesh.Name());
+		EXPECT_EQ(loaded_mesh.MaterialID(), mesh.MaterialID());
+		ASSERT_EQ(loaded_mesh.NumLods(), mesh.NumLods());
+		for (uint32_t lod = 0; lod < mesh.NumLods(); ++ lod)
+		{
+			EXPECT_EQ(loaded_mesh.NumVertices(lod), mesh.NumVertices(lod));
+			EXPECT_EQ(loaded_mesh.NumIndices(lod), mesh.NumIndices(lod));
+			EXPECT_EQ(loaded_mesh.LodScreenSize(lod), mesh.LodScreenSize(lod));
+		}
+	}
+
+	auto const & rl = checked_cast<StaticMesh&>(*model->Mesh(0)).GetRenderLayout();
+	auto const & loaded_rl = checked_cast<StaticMesh&>(*loaded->Mesh(0)).GetRenderLayout();
+	ASSERT_EQ(loaded_rl.NumVertexStreams(), rl.NumVertexStreams());
+	for (uint32_t i = 0; i < rl.NumVertexStreams(); ++ i)
+	{
+		EXPECT_TRUE(loaded_rl.VertexStreamFormat(i)[0] == rl.VertexStreamFormat(i)[0]);
+
+		auto& vb = *rl.GetVertexStream(i);
+		auto& loaded_vb = *loaded_rl.GetVertexStream(i);
+		ASSERT_EQ(loaded_vb.Size(), vb.Size());
+
+		GraphicsBuffer::Mapper mapper(vb, BA_Read_Only);
+		GraphicsBuffer::Mapper loaded_mapper(loaded_vb, BA_Read_Only);
+		EXPECT_EQ(std::memcmp(loaded_mapper.Pointer<uint8_t>(), mapper.Pointer<uint8_t>(), vb.Size()), 0);
+	}
+	EXPECT_EQ(loaded_rl.IndexStreamFormat(), rl.IndexStreamFormat());
+	{
+		auto& ib = *rl.GetIndexStream();
+		auto& loaded_ib = *loaded_rl.GetIndexStream();
+		ASSERT_EQ(loaded_ib.Size(), ib.Size());
+
+		GraphicsBuffer::Mapper mapper(ib, BA_Read_Only);
+		GraphicsBuffer::Mapper loaded_mapper(loaded_ib, BA_Read_Only);
+		EXPECT_EQ(std::memcmp(loaded_mapper.Pointer<uint8_t>(), mapper.Pointer<uint8_t>(), ib.Size()), 0);
+	}
+
+	// A truncated file has chunks pointing past its end, which must be rejected instead of read
+	std::vector<char> content;
+	{
+		std::ifstream ifs(saved_name.c_str(), std::ios_base::binary);
+		content.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	}
+	ASSERT_GT(content.size(), 16U);
+	std::string const truncated_name = (temp_dir / "MeshConverterTestTruncated.model_bin").generic_string();
+	{
+		std::ofstream ofs(truncated_name.c_str(), std::ios_base::binary);
+		ofs.write(content.data(), static_cast<std::streamsize>(content.size() / 2));
+	}
+	EXPECT_ANY_THROW(LoadSoftwareModel(truncated_name));
+
+	std::error_code ec;
+	std::filesystem::remove(saved_name, ec);
+	std::filesystem::remove(truncated_name, ec);
+}
+
+TEST(MeshQuantizationTest, SNorm16RoundTrip)
+{
+	EXPECT_EQ(QuantizeToSNorm16(0), -32768);
+	EXPECT_EQ(QuantizeToSNorm16(1), 32767);
+	EXPECT_EQ(QuantizeToSNorm16(-0.5f), -32768);
+	EXPECT_EQ(QuantizeToSNorm16(1.5f), 32767);
+	EXPECT_EQ(DequantizeFromSNorm16(-32768), 0.0f);
+	EXPECT_EQ(DequantizeFromSNorm16(32767), 1.0f);
+
+	for (uint32_t i = 0; i <= 100000; ++ i)
+	{
+		float const v = i / 100000.0f;
+		EXPECT_NEAR(DequantizeFromSNorm16(QuantizeToSNorm16(v)), v, 0.5f / 65535 + 1e-6f);
+	}
+	for (int32_t i = -32768; i <= 32767; ++ i)
+	{
+		int16_t const q = static_cast<int16_t>(i);
+		EXPECT_EQ(QuantizeToSNorm16(DequantizeFromSNorm16(q)), q);
+	}
+}
@@ -0,0 +1,213 @@
+/**
+ * @file MeshOptimizerTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/DevHelper/MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	void MakeGrid(uint32_t size, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+	{
+		positions.clear();
+		for (uint32_t y = 0; y <= size; ++ y)
+		{
+			for (uint32_t x = 0; x <= size; ++ x)
+			{
+				positions.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.0f);
+			}
+		}
+
+		indices.clear();
+		for (uint32_t y = 0; y < size; ++ y)
+		{
+			for (uint32_t x = 0; x < size; ++ x)
+			{
+				uint32_t const v0 = y * (size + 1) + x;
+				uint32_t const v1 = v0 + 1;
+				uint32_t const v2 = v0 + size + 1;
+				uint32_t const v3 = v2 + 1;
+				indices.insert(indices.end(), { v0, v2, v1, v1, v2, v3 });
+			}
+		}
+	}
+
+	void ShuffleTriangles(std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+		std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(indices[0]));
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+		std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(indices[0]));
+	}
+
+	std::vector<std::array<uint32_t, 3>> SortedTriangles(std::vector<uint32_t> const & indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+		std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(indices[0]));
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+TEST(MeshOptimizerTest, VertexCache)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeGrid(64, positions, indices);
+	ShuffleTriangles(indices);
+
+	auto const before = MeshOptimizer::AnalyzeVertexCache(indices, static_cast<uint32_t>(positions.size()));
+	auto const expected_triangles = SortedTriangles(indices);
+
+	MeshOptimizer::OptimizeVertexCache(indices, static_cast<uint32_t>(positions.size()));
+	auto const after = MeshOptimizer::AnalyzeVertexCache(indices, static_cast<uint32_t>(positions.size()));
+
+	EXPECT_EQ(SortedTriangles(indices), expected_triangles);
+	EXPECT_GT(before.acmr, 2.0f);
+	EXPECT_LT(after.acmr, 0.8f);
+	EXPECT_LT(after.atvr, 1.6f);
+	EXPECT_GE(after.atvr, 1.0f);
+}
+
+TEST(MeshOptimizerTest, Overdraw)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeGrid(64, positions, indices);
+	ShuffleTriangles(indices);
+
+	MeshOptimizer::OptimizeVertexCache(indices, static_cast<uint32_t>(positions.size()));
+	auto const cache_optimized = MeshOptimizer::AnalyzeVertexCache(indices, static_cast<uint32_t>(positions.size()));
+	auto const expected_triangles = SortedTriangles(indices);
+
+	MeshOptimizer::OptimizeOverdraw(indices, positions, 1.05f);
+	auto const after = MeshOptimizer::AnalyzeVertexCache(indices, static_cast<uint32_t>(positions.size()));
+
+	EXPECT_EQ(SortedTriangles(indices), expected_triangles);
+	EXPECT_LT(after.acmr, cache_optimized.acmr * 1.2f);
+}
+
+TEST(MeshOptimizerTest, VertexFetch)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeGrid(16, positions, indices);
+	ShuffleTriangles(indices);
+	// The last vertex is not referenced
+	uint32_t const num_vertices = static_cast<uint32_t>(positions.size() + 1);
+
+	std::vector<uint32_t> const old_indices = indices;
+	std::vector<uint32_t> remap;
+	uint32_t const num_referenced = MeshOptimizer::OptimizeVertexFetch(indices, num_vertices, remap);
+
+	EXPECT_EQ(num_referenced, positions.size());
+	EXPECT_EQ(remap.back(), 0xFFFFFFFFU);
+
+	uint32_t next_new_vertex = 0;
+	for (size_t i = 0; i < indices.size(); ++ i)
+	{
+		EXPECT_EQ(indices[i], remap[old_indices[i]]);
+		EXPECT_LE(indices[i], next_new_vertex);
+		if (indices[i] == next_new_vertex)
+		{
+			++ next_new_vertex;
+		}
+	}
+	EXPECT_EQ(next_new_vertex, num_referenced);
+}
+
+TEST(MeshOptimizerTest, SimplifyPlane)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeGrid(32, positions, indices);
+	uint32_t const target_index_count = static_cast<uint32_t>(indices.size() / 4);
+
+	float const error = MeshOptimizer::Simplify(indices, positions, {}, 0, target_index_count, 0.01f);
+
+	EXPECT_LE(indices.size(), target_index_count);
+	EXPECT_GT(indices.size(), 0U);
+	EXPECT_EQ(indices.size() % 3, 0U);
+	EXPECT_LT(error, 1e-4f);
+
+	// The border is kept
+	std::vector<bool> referenced(positions.size(), false);
+	for (uint32_t index : indices)
+	{
+		referenced[index] = true;
+	}
+	for (size_t i = 0; i < positions.size(); ++ i)
+	{
+		float const x = positions[i].x();
+		float const y = positions[i].y();
+		if ((x == 0) || (y == 0) || (x == 32) || (y == 32))
+		{
+			EXPECT_TRUE(referenced[i]);
+		}
+	}
+
+	// No triangle is turned around
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		float3 const n = MathLib::cross(positions[indices[i + 1]] - positions[indices[i + 0]],
+			positions[indices[i + 2]] - positions[indices[i + 0]]);
+		EXPECT_LT(n.z(), 0);
+	}
+}
+
+TEST(MeshOptimizerTest, SimplifyErrorLimit)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	MakeGrid(32, positions, indices);
+	for (auto& pos : positions)
+	{
+		float const x = pos.x() / 16 - 1;
+		float const y = pos.y() / 16 - 1;
+		pos.z() = 8 * (x * x + y * y);
+	}
+	size_t const original_index_count = indices.size();
+
+	float const error = MeshOptimizer::Simplify(indices, positions, {}, 0, 0, 0.01f);
+
+	EXPECT_LT(indices.size(), original_index_count);
+	EXPECT_GT(indices.size(), 0U);
+	EXPECT_LE(error, 0.01f);
+}
@@ -0,0 +1,318 @@
+/**
+ * @file ParticleSystemTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <KFL/Math.hpp>
+#include <KlayGE/ParticleSystem.hpp>
+
+#include <array>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// Records the particles and threads it's called on. Only has the per-particle update.
+	class RecordingParticleUpdater final : public ParticleUpdater
+	{
+	public:
+		explicit RecordingParticleUpdater(ParticleSystemPtr const & ps)
+			: ParticleUpdater(ps)
+		{
+		}
+
+		std::string const & Type() const override
+		{
+			static std::string const type("recording");
+			return type;
+		}
+
+		ParticleUpdaterPtr Clone() override
+		{
+			auto ret = MakeSharedPtr<RecordingParticleUpdater>(ps_.lock());
+			this->DoClone(ret);
+			return ret;
+		}
+
+		using ParticleUpdater::Update;
+		void Update(Particle& par, float elapse_time) override
+		{
+			// Not thread safe on purpose
+			updated_ids.push_back(par.spin);
+			threads.push_back(std::this_thread::get_id());
+
+			par.pos += par.vel * elapse_time;
+			par.life -= elapse_time;
+		}
+
+		void SnapParams() override
+		{
+		}
+
+		std::vector<float> updated_ids;
+		std::vector<std::thread::id> threads;
+	};
+
+	// Particles in structure-of-arrays layout, backing a ParticleBatch
+	struct ParticleStreams
+	{
+		explicit ParticleStreams(uint32_t num)
+		{
+			for (auto& stream : streams)
+			{
+				stream.resize(num);
+			}
+		}
+
+		ParticleBatch Batch()
+		{
+			ParticleBatch batch;
+			batch.pos_x = streams[0].data();
+			batch.pos_y = streams[1].data();
+			batch.pos_z = streams[2].data();
+			batch.vel_x = streams[3].data();
+			batch.vel_y = streams[4].data();
+			batch.vel_z = streams[5].data();
+			batch.life = streams[6].data();
+			batch.spin = streams[7].data();
+			batch.size = streams[8].data();
+			batch.alpha = streams[9].data();
+			batch.init_life = streams[10].data();
+			batch.num = static_cast<uint32_t>(streams[0].size());
+			return batch;
+		}
+
+		std::array<std::vector<float>, 11> streams;
+	};
+
+	std::vector<Particle> RandomParticles(uint32_t num, std::mt19937& gen)
+	{
+		std::uniform_real_distribution<float> dis(-1, 1);
+
+		std::vector<Particle> particles(num);
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			auto& par = particles[i];
+			par.pos = float3(dis(gen), dis(gen), dis(gen));
+			par.vel = float3(dis(gen), dis(gen), dis(gen));
+			par.init_life = 2 + dis(gen);
+			par.life = par.init_life * (0.5f + dis(gen) * 0.4f);
+			par.spin = static_cast<float>(i);
+			par.size = 1;
+			par.alpha = 1;
+		}
+		return particles;
+	}
+
+	void ExpectParticleNear(Particle const & expected, Particle const & actual, float tolerance)
+	{
+		for (uint32_t i = 0; i < 3; ++ i)
+		{
+			EXPECT_NEAR(expected.pos[i], actual.pos[i], tolerance);
+			EXPECT_NEAR(expected.vel[i], actual.vel[i], tolerance);
+		}
+		EXPECT_NEAR(expected.life, actual.life, tolerance);
+		EXPECT_NEAR(expected.spin, actual.spin, tolerance);
+		EXPECT_NEAR(expected.size, actual.size, tolerance);
+		EXPECT_NEAR(expected.alpha, actual.alpha, tolerance);
+		EXPECT_NEAR(expected.init_life, actual.init_life, tolerance);
+	}
+}
+
+TEST(ParticleSystemTest, DefaultBatchUpdate)
+{
+	auto ps = MakeSharedPtr<ParticleSystem>(16);
+	RecordingParticleUpdater updater(ps);
+	EXPECT_FALSE(updater.ConcurrentBatches());
+
+	std::mt19937 gen(0);
+	auto const particles = RandomParticles(100, gen);
+
+	ParticleStreams streams(static_cast<uint32_t>(particles.size()));
+	ParticleBatch const batch = streams.Batch();
+	for (uint32_t i = 0; i < batch.num; ++ i)
+	{
+		batch.Set(i, particles[i]);
+	}
+
+	float const elapsed_time = 0.1f;
+	updater.Update(batch, elapsed_time);
+
+	ASSERT_EQ(updater.updated_ids.size(), particles.size());
+	for (uint32_t i = 0; i < batch.num; ++ i)
+	{
+		EXPECT_EQ(updater.updated_ids[i], static_cast<float>(i));
+
+		Particle expected = particles[i];
+		expected.pos += expected.vel * elapsed_time;
+		expected.life -= elapsed_time;
+		ExpectParticleNear(expected, batch.Get(i), 0);
+	}
+}
+
+TEST(ParticleSystemTest, PolylineBatchUpdate)
+{
+	auto ps = MakeSharedPtr<ParticleSystem>(16);
+	ps->Force(float3(0.3f, 0.1f, -0.2f));
+	ps->MediaDensity(0.5f);
+
+	PolylineParticleUpdater updater(ps);
+	EXPECT_TRUE(updater.ConcurrentBatches());
+	updater.SizeOverLife({ float2(0, 1), float2(0.3f, 2.5f), float2(1, 0.5f) });
+	updater.MassOverLife({ float2(0, 1), float2(1, 3) });
+	updater.OpacityOverLife({ float2(0, 0), float2(0.1f, 1), float2(0.7f, 0.8f), float2(1, 0) });
+	updater.SnapParams();
+
+	std::mt19937 gen(1);
+	auto const particles = RandomParticles(1000, gen);
+
+	ParticleStreams streams(static_cast<uint32_t>(particles.size()));
+	ParticleBatch const batch = streams.Batch();
+	for (uint32_t i = 0; i < batch.num; ++ i)
+	{
+		batch.Set(i, particles[i]);
+	}
+
+	float const elapsed_time = 0.05f;
+	updater.Update(batch, elapsed_time);
+
+	// The batch update reads the curves from lookup tables, so it's close to, but not the same as, the per-particle one
+	for (uint32_t i = 0; i < batch.num; ++ i)
+	{
+		Particle expected = particles[i];
+		updater.Update(expected, elapsed_time);
+		ExpectParticleNear(expected, batch.Get(i), 1e-2f);
+	}
+}
+
+TEST(ParticleSystemTest, SerialUpdaterAndGetParticle)
+{
+	uint32_t const NUM_PARTICLES = 5000;
+
+	auto ps = MakeSharedPtr<ParticleSystem>(NUM_PARTICLES);
+	auto updater = MakeSharedPtr<RecordingParticleUpdater>(ps);
+	ps->AddUpdater(updater);
+
+	std::mt19937 gen(2);
+	auto const particles = RandomParticles(NUM_PARTICLES, gen);
+
+	// Particles written through GetParticle are picked up by the next update. Every third one stays dead.
+	for (uint32_t i = 0; i < NUM_PARTICLES; ++ i)
+	{
+		EXPECT_EQ(ps->GetParticle(i).life, 0);
+		if (i % 3 != 0)
+		{
+			ps->GetParticle(i) = particles[i];
+		}
+	}
+
+	float const elapsed_time = 0.05f;
+	ps->RootNode()->SubThreadUpdate(0, elapsed_time);
+
+	// RecordingParticleUpdater isn't thread safe, so all batches are updated on one thread, in order
+	ASSERT_FALSE(updater->threads.empty());
+	for (auto const & thread : updater->threads)
+	{
+		EXPECT_EQ(thread, updater->threads[0]);
+	}
+
+	std::vector<Particle> expected;
+	for (uint32_t i = 0; i < NUM_PARTICLES; ++ i)
+	{
+		if (i % 3 != 0)
+		{
+			expected.push_back(particles[i]);
+			expected.back().pos += expected.back().vel * elapsed_time;
+			expected.back().life -= elapsed_time;
+		}
+	}
+	ASSERT_EQ(updater->updated_ids.size(), expected.size());
+	ASSERT_EQ(ps->NumActiveParticles(), expected.size());
+
+	auto const & const_ps = *ps;
+	for (uint32_t i = 0; i < expected.size(); ++ i)
+	{
+		EXPECT_EQ(updater->updated_ids[i], expected[i].spin);
+		ExpectParticleNear(expected[i], const_ps.GetParticle(i), 0);
+	}
+	for (uint32_t i = static_cast<uint32_t>(expected.size()); i < NUM_PARTICLES; ++ i)
+	{
+		EXPECT_EQ(const_ps.GetParticle(i).life, 0);
+	}
+}
+
+TEST(ParticleSystemTest, ConcurrentGetParticle)
+{
+	uint32_t const NUM_PARTICLES = 5000;
+
+	auto ps = MakeSharedPtr<ParticleSystem>(NUM_PARTICLES);
+	ps->AddUpdater(MakeSharedPtr<PolylineParticleUpdater>(ps));
+
+	std::mt19937 gen(3);
+	auto const particles = RandomParticles(NUM_PARTICLES, gen);
+	for (uint32_t i = 0; i < NUM_PARTICLES; ++ i)
+	{
+		ps->GetParticle(i) = particles[i];
+	}
+	ps->RootNode()->SubThreadUpdate(0, 0.05f);
+
+	// The first readers after the update gather the particles together
+	auto const & const_ps = *ps;
+	std::array<std::vector<Particle>, 4> read_particles;
+	std::vector<std::thread> readers;
+	for (auto& read : read_particles)
+	{
+		readers.emplace_back([&const_ps, &read]
+			{
+				for (uint32_t i = 0; i < NUM_PARTICLES; ++ i)
+				{
+					read.push_back(const_ps.GetParticle(i));
+				}
+			});
+	}
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+
+	for (uint32_t i = 0; i < NUM_PARTICLES; ++ i)
+	{
+		for (auto const & read : read_particles)
+		{
+			ExpectParticleNear(const_ps.GetParticle(i), read[i], 0);
+		}
+	}
+}
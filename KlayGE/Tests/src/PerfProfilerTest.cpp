@@ -0,0 +1,211 @@
+/**
+ * @file PerfProfilerTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <KFL/CXX17/filesystem.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/PerfProfiler.hpp>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	struct TraceEvent
+	{
+		std::string name;
+		std::string phase;
+	};
+
+	// Reads the events of the exported trace, one per line
+	std::vector<TraceEvent> ExportTrace(PerfProfiler& profiler)
+	{
+		std::string const file_name = (std::filesystem::temp_directory_path() / "PerfProfilerTest.json").generic_string();
+		profiler.ExportToChromeTrace(file_name);
+
+		std::vector<TraceEvent> events;
+		{
+			std::ifstream ifs(file_name.c_str());
+			std::string line;
+			while (std::getline(ifs, line))
+			{
+				std::string const name_tag = "{\"name\":\"";
+				std::string const phase_tag = "\"ph\":\"";
+				if (line.compare(0, name_tag.size(), name_tag) == 0)
+				{
+					size_t const name_end = line.find('"', name_tag.size());
+					size_t const phase_begin = line.find(phase_tag) + phase_tag.size();
+
+					TraceEvent event;
+					event.name = line.substr(name_tag.size(), name_end - name_tag.size());
+					event.phase = line.substr(phase_begin, line.find('"', phase_begin) - phase_begin);
+					events.push_back(event);
+				}
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::remove(file_name, ec);
+
+		return events;
+	}
+
+	void ExpectBalancedZones(std::vector<TraceEvent> const & events)
+	{
+		int32_t depth = 0;
+		for (auto const & event : events)
+		{
+			if (event.phase == "B")
+			{
+				++ depth;
+			}
+			else if (event.phase == "E")
+			{
+				-- depth;
+				EXPECT_GE(depth, 0);
+			}
+		}
+		EXPECT_EQ(depth, 0);
+	}
+
+	class PerfProfilerTest : public testing::Test
+	{
+	public:
+		void SetUp() override
+		{
+			old_cfg_ = Context::Instance().Config();
+			ContextCfg cfg = old_cfg_;
+			cfg.perf_profiler = true;
+			cfg.perf_profiler_events_per_thread = 1UL << 16;
+			Context::Instance().Config(cfg);
+		}
+
+		void TearDown() override
+		{
+			Context::Instance().Config(old_cfg_);
+		}
+
+	private:
+		ContextCfg old_cfg_;
+	};
+}
+
+TEST_F(PerfProfilerTest, ChromeTrace)
+{
+	PerfProfiler profiler;
+	profiler.ThreadName("PerfProfilerTest");
+	profiler.BeginZone("Outer");
+	profiler.BeginZone("Inner");
+	profiler.Counter("Count", 42);
+	profiler.EndZone();
+	profiler.EndZone();
+
+	auto const events = ExportTrace(profiler);
+	ASSERT_EQ(events.size(), 6U);
+	EXPECT_EQ(events[0].name, "thread_name");
+	EXPECT_EQ(events[0].phase, "M");
+	EXPECT_EQ(events[1].name, "Outer");
+	EXPECT_EQ(events[1].phase, "B");
+	EXPECT_EQ(events[2].name, "Inner");
+	EXPECT_EQ(events[2].phase, "B");
+	EXPECT_EQ(events[3].name, "Count");
+	EXPECT_EQ(events[3].phase, "C");
+	EXPECT_EQ(events[4].phase, "E");
+	EXPECT_EQ(events[5].phase, "E");
+}
+
+TEST_F(PerfProfilerTest, ChromeTraceWrapped)
+{
+	PerfProfiler profiler;
+
+	// The begin of Outer is overwritten once the ring buffer wraps, and Open isn't ended at export time
+	profiler.BeginZone("Outer");
+	for (uint32_t i = 0; i < 40000; ++ i)
+	{
+		profiler.BeginZone("Inner");
+		profiler.EndZone();
+	}
+	profiler.EndZone();
+	profiler.BeginZone("Open");
+
+	auto const events = ExportTrace(profiler);
+	ExpectBalancedZones(events);
+
+	uint32_t num_outers = 0;
+	uint32_t num_opens = 0;
+	for (auto const & event : events)
+	{
+		num_outers += (event.name == "Outer");
+		num_opens += (event.name == "Open");
+	}
+	EXPECT_EQ(num_outers, 0U);
+	EXPECT_EQ(num_opens, 1U);
+	ASSERT_FALSE(events.empty());
+	EXPECT_EQ(events.back().phase, "E");
+}
+
+TEST_F(PerfProfilerTest, ChromeTraceExitedThread)
+{
+	PerfProfiler profiler;
+	profiler.BeginZone("Main");
+	profiler.EndZone();
+
+	std::thread worker([&profiler]
+		{
+			profiler.BeginZone("Worker");
+			profiler.EndZone();
+		});
+	worker.join();
+
+	// The ring of the exited thread is exported once, then freed
+	for (uint32_t pass = 0; pass < 2; ++ pass)
+	{
+		auto const events = ExportTrace(profiler);
+		ExpectBalancedZones(events);
+
+		uint32_t num_mains = 0;
+		uint32_t num_workers = 0;
+		for (auto const & event : events)
+		{
+			num_mains += (event.name == "Main");
+			num_workers += (event.name == "Worker");
+		}
+		EXPECT_EQ(num_mains, 1U);
+		EXPECT_EQ(num_workers, (pass == 0) ? 1U : 0U);
+	}
+}
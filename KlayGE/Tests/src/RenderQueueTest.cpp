@@ -0,0 +1,136 @@
+/**
+ * @file RenderQueueTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <KFL/PtrIndexMap.hpp>
+#include <KFL/RadixSort.hpp>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+TEST(RenderQueueTest, PtrIndexMap)
+{
+	std::vector<int> keys(100);
+
+	PtrIndexMap<int> map;
+	EXPECT_EQ(map.Find(&keys[0]), nullptr);
+
+	for (uint32_t i = 0; i < keys.size(); ++ i)
+	{
+		auto const ret = map.Emplace(&keys[i], i);
+		EXPECT_EQ(ret.first, i);
+		EXPECT_TRUE(ret.second);
+	}
+	EXPECT_EQ(map.Size(), keys.size());
+
+	for (uint32_t i = 0; i < keys.size(); ++ i)
+	{
+		auto const ret = map.Emplace(&keys[i], 1000 + i);
+		EXPECT_EQ(ret.first, i);
+		EXPECT_FALSE(ret.second);
+
+		uint32_t const * index = map.Find(&keys[i]);
+		ASSERT_NE(index, nullptr);
+		EXPECT_EQ(*index, i);
+	}
+	EXPECT_EQ(map.Size(), keys.size());
+
+	// Clearing keeps the slots, refilling to the same size doesn't allocate
+	size_t const capacity = map.Capacity();
+	for (uint32_t frame = 0; frame < 3; ++ frame)
+	{
+		map.Clear();
+		EXPECT_EQ(map.Size(), 0U);
+		EXPECT_EQ(map.Find(&keys[0]), nullptr);
+
+		for (uint32_t i = 0; i < keys.size(); ++ i)
+		{
+			uint32_t const index = static_cast<uint32_t>(keys.size()) - 1 - i;
+			auto const ret = map.Emplace(&keys[index], i);
+			EXPECT_EQ(ret.first, i);
+			EXPECT_TRUE(ret.second);
+		}
+		EXPECT_EQ(map.Capacity(), capacity);
+	}
+}
+
+TEST(RenderQueueTest, OrderedFloatBits)
+{
+	std::vector<float> const values = { -1e10f, -3.5f, -1, -1e-20f, -0.0f, 0.0f, 1e-20f, 0.5f, 1, 2, 1e10f };
+	for (size_t i = 1; i < values.size(); ++ i)
+	{
+		if (values[i - 1] == values[i])
+		{
+			EXPECT_EQ(OrderedFloatBits(values[i - 1]), OrderedFloatBits(values[i]));
+		}
+		else
+		{
+			EXPECT_LT(OrderedFloatBits(values[i - 1]), OrderedFloatBits(values[i]));
+		}
+	}
+}
+
+TEST(RenderQueueTest, RadixSortStable)
+{
+	std::mt19937 gen(0);
+
+	// Sort keys as the render queue builds them, a bucket rank in the high 32 bits and a depth in the low 32 bits
+	std::vector<std::pair<uint64_t, uint32_t>> items(5000);
+	std::uniform_int_distribution<uint32_t> rank_dis(0, 7);
+	std::uniform_real_distribution<float> depth_dis(-10, 10);
+	for (uint32_t i = 0; i < items.size(); ++ i)
+	{
+		uint64_t key = static_cast<uint64_t>(rank_dis(gen)) << 32;
+		if (i % 2 == 0)
+		{
+			key |= OrderedFloatBits(std::floor(depth_dis(gen)));
+		}
+		items[i] = std::make_pair(key, i);
+	}
+
+	auto expected = items;
+	std::stable_sort(expected.begin(), expected.end(),
+		[](std::pair<uint64_t, uint32_t> const & lhs, std::pair<uint64_t, uint32_t> const & rhs)
+		{
+			return lhs.first < rhs.first;
+		});
+
+	std::vector<std::pair<uint64_t, uint32_t>> scratch;
+	RadixSort(items, scratch, [](std::pair<uint64_t, uint32_t> const & item) { return item.first; });
+	EXPECT_EQ(items, expected);
+}
@@ -0,0 +1,125 @@
+/**
+ * @file RenderableInstancingTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/ElementFormat.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/RenderEngine.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/RenderLayout.hpp>
+#include <KlayGE/Renderable.hpp>
+#include <KlayGE/SceneNode.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	class RenderableGBufferQuad : public Renderable
+	{
+	public:
+		RenderableGBufferQuad()
+			: Renderable(L"GBufferQuad")
+		{
+			auto& rf = Context::Instance().RenderFactoryInstance();
+
+			this->BindDeferredEffect(SyncLoadRenderEffect("GBuffer.fxml"));
+			this->Pass(PT_OpaqueGBuffer);
+
+			float3 const positions[] = { float3(-1, +1, 0), float3(+1, +1, 0), float3(-1, -1, 0), float3(+1, -1, 0) };
+			float2 const texcoords[] = { float2(0, 0), float2(1, 0), float2(0, 1), float2(1, 1) };
+			uint32_t const tangent_quats[] = { 0x80808080U, 0x80808080U, 0x80808080U, 0x80808080U };
+
+			rls_[0] = rf.MakeRenderLayout();
+			rls_[0]->TopologyType(RenderLayout::TT_TriangleStrip);
+			rls_[0]->BindVertexStream(rf.MakeVertexBuffer(BU_Static, EAH_GPU_Read | EAH_Immutable, sizeof(positions), positions),
+				VertexElement(VEU_Position, 0, EF_BGR32F));
+			rls_[0]->BindVertexStream(rf.MakeVertexBuffer(BU_Static, EAH_GPU_Read | EAH_Immutable, sizeof(texcoords), texcoords),
+				VertexElement(VEU_TextureCoord, 0, EF_GR32F));
+			rls_[0]->BindVertexStream(rf.MakeVertexBuffer(BU_Static, EAH_GPU_Read | EAH_Immutable, sizeof(tangent_quats), tangent_quats),
+				VertexElement(VEU_Tangent, 0, EF_ABGR8));
+
+			pos_aabb_ = AABBox(float3(-1, -1, 0), float3(+1, +1, 0));
+			tc_aabb_ = AABBox(float3(0, 0, 0), float3(1, 1, 0));
+			this->UpdateBoundBox();
+		}
+	};
+
+	uint32_t NumDrawsForNodes(Renderable& renderable, uint32_t num_nodes)
+	{
+		std::vector<std::unique_ptr<SceneNode>> nodes;
+		renderable.ClearInstances();
+		for (uint32_t i = 0; i < num_nodes; ++ i)
+		{
+			auto node = MakeUniquePtr<SceneNode>(0);
+			node->TransformToParent(MathLib::translation(static_cast<float>(i), 0.0f, 0.0f));
+			node->FillVisibleMark(BoundOverlap::Yes);
+			renderable.AddInstance(node.get());
+			nodes.push_back(std::move(node));
+		}
+
+		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		re.NumDrawsJustCalled();
+		renderable.Render();
+		uint32_t const num_draws = re.NumDrawsJustCalled();
+
+		renderable.ClearInstances();
+		return num_draws;
+	}
+}
+
+TEST(RenderableInstancingTest, SharedRenderableBatchesDraws)
+{
+	RenderableGBufferQuad renderable;
+	RenderTechnique const& tech = *renderable.GetRenderTechnique();
+	ASSERT_TRUE(tech.AutoInstancing());
+
+	uint32_t const draws_per_node = NumDrawsForNodes(renderable, 1);
+	EXPECT_EQ(draws_per_node, tech.NumPasses());
+
+	// 100 nodes fit in 2 batches of RenderEngine::PredefinedInstanceCBuffer::max_num_instances
+	uint32_t const num_nodes = 100;
+	uint32_t const num_batches =
+		(num_nodes + RenderEngine::PredefinedInstanceCBuffer::max_num_instances - 1) / RenderEngine::PredefinedInstanceCBuffer::max_num_instances;
+	uint32_t const num_draws = NumDrawsForNodes(renderable, num_nodes);
+	EXPECT_EQ(num_draws, num_batches * draws_per_node);
+	EXPECT_LT(num_draws, num_nodes * draws_per_node);
+
+	// The batches leave the layout as it was
+	EXPECT_EQ(renderable.GetRenderLayout().NumInstances(), 1U);
+}
@@ -1,10 +1,135 @@
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KFL/Hash.hpp>
+#include <KlayGE/Package.hpp>
 #include <KlayGE/ResLoader.hpp>
 
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 #include "KlayGETests.hpp"
 
 using namespace KlayGE;
 
+namespace
+{
+	struct LoadingCounters
+	{
+		std::atomic<uint32_t> num_sub_thread_stages{0};
+		uint32_t num_main_thread_stages = 0;
+	};
+
+	class CountingLoadingDesc : public ResLoadingDesc
+	{
+	public:
+		CountingLoadingDesc(uint32_t id, LoadingCounters& counters)
+			: id_(id), counters_(&counters), res_(MakeSharedPtr<std::shared_ptr<uint32_t>>())
+		{
+		}
+
+		uint64_t Type() const override
+		{
+			static uint64_t const type = CT_HASH("CountingLoadingDesc");
+			return type;
+		}
+
+		bool StateLess() const override
+		{
+			return true;
+		}
+
+		std::shared_ptr<void> CreateResource() override
+		{
+			*res_ = MakeSharedPtr<uint32_t>(0U);
+			return *res_;
+		}
+
+		void SubThreadStage() override
+		{
+			++ counters_->num_sub_thread_stages;
+		}
+
+		void MainThreadStage() override
+		{
+			if (!*res_)
+			{
+				this->CreateResource();
+			}
+			**res_ = id_;
+			++ counters_->num_main_thread_stages;
+		}
+
+		bool HasSubThreadStage() const override
+		{
+			return true;
+		}
+
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashCombine(seed, id_);
+			HashCombine(seed, counters_);
+			return seed;
+		}
+
+		bool Match(ResLoadingDesc const & rhs) const override
+		{
+			if (this->Type() == rhs.Type())
+			{
+				CountingLoadingDesc const & cld = static_cast<CountingLoadingDesc const &>(rhs);
+				return (id_ == cld.id_) && (counters_ == cld.counters_);
+			}
+			return false;
+		}
+
+		void CopyDataFrom(ResLoadingDesc const & rhs) override
+		{
+			BOOST_ASSERT(this->Type() == rhs.Type());
+
+			CountingLoadingDesc const & cld = static_cast<CountingLoadingDesc const &>(rhs);
+			id_ = cld.id_;
+			counters_ = cld.counters_;
+			res_ = cld.res_;
+		}
+
+		std::shared_ptr<void> CloneResourceFrom(std::shared_ptr<void> const & resource) override
+		{
+			return resource;
+		}
+
+		std::shared_ptr<void> Resource() const override
+		{
+			return *res_;
+		}
+
+		// Drops the reference held by the desc, so that the resource expires once the caller releases it too
+		void ReleaseResource()
+		{
+			res_->reset();
+		}
+
+		uint64_t ResourceSize() const override
+		{
+			return *res_ ? RES_SIZE : 0;
+		}
+
+	public:
+		static uint64_t constexpr RES_SIZE = 1024;
+
+	private:
+		uint32_t id_;
+		LoadingCounters* counters_;
+		std::shared_ptr<std::shared_ptr<uint32_t>> res_;
+	};
+}
+
 std::string const sanity_string = "This is a test for ResLoader.";
 
 std::string ReadWholeFile(ResIdentifierPtr const & res)
@@ -95,3 +220,263 @@ TEST(ResLoaderTest, MountUnmountInsideEncrypt7zPath)
 	ResLoader::Instance().Unmount("ResLoaderTestData", "../../Tests/media/ResLoader/TestPassword.7z|1234/ResLoader");
 	EXPECT_TRUE(ResLoader::Instance().Locate("ResLoaderTestData/Test.txt").empty());
 }
+
+namespace
+{
+	std::string ReadBinaryFile(std::string const & file_name)
+	{
+		std::ifstream ifs(file_name.c_str(), std::ios_base::binary);
+		std::ostringstream oss;
+		oss << ifs.rdbuf();
+		return oss.str();
+	}
+
+	// Byte offset of the table of contents item of file_path in a native package, 0 if there isn't one
+	size_t KPakEntryOffset(std::string const & package, std::string_view file_path)
+	{
+		uint32_t num_entries;
+		std::memcpy(&num_entries, &package[8], sizeof(num_entries));
+		uint64_t names_offset;
+		std::memcpy(&names_offset, &package[16], sizeof(names_offset));
+		for (uint32_t i = 0; i < LE2Native(num_entries); ++ i)
+		{
+			size_t const entry_offset = 32 + i * sizeof(KPakEntry);
+			KPakEntry entry;
+			std::memcpy(&entry, &package[entry_offset], sizeof(entry));
+			std::string_view const name(&package[static_cast<size_t>(LE2Native(names_offset)) + LE2Native(entry.name_offset)],
+				LE2Native(entry.name_length));
+			if (name == file_path)
+			{
+				return entry_offset;
+			}
+		}
+		return 0;
+	}
+
+	template <typename T>
+	void PatchKPak(std::string& package, size_t offset, T value)
+	{
+		value = Native2LE(value);
+		std::memcpy(&package[offset], &value, sizeof(value));
+	}
+
+	// Not a file on the file system, so entries are read through the stream
+	std::unique_ptr<Package> OpenKPakInMemory(std::string const & package)
+	{
+		return MakeUniquePtr<Package>(MakeSharedPtr<ResIdentifier>("InMemory.kpk", 0, MakeSharedPtr<std::istringstream>(package)));
+	}
+}
+
+TEST(ResLoaderTest, MountUnmountKPakPath)
+{
+	std::string const src_dir = ResLoader::Instance().AbsPath("../../Tests/media/ResLoader");
+	std::string const package_name = (std::filesystem::temp_directory_path() / "ResLoaderTest.kpk").generic_string();
+	std::string const compressible_string = ReadBinaryFile(src_dir + "/Compressible.txt");
+	ASSERT_FALSE(compressible_string.empty());
+
+	for (bool const compress : { true, false })
+	{
+		SavePackage(package_name, src_dir, compress);
+
+		std::string const package = ReadBinaryFile(package_name);
+		size_t const compressible_entry_offset = KPakEntryOffset(package, "Compressible.txt");
+		ASSERT_NE(compressible_entry_offset, 0U);
+		uint32_t compression;
+		std::memcpy(&compression, &package[compressible_entry_offset + offsetof(KPakEntry, compression)], sizeof(compression));
+		EXPECT_EQ(LE2Native(compression), compress ? 1U : 0U);
+
+		ResLoader::Instance().Mount("ResLoaderTestData", package_name);
+		EXPECT_FALSE(ResLoader::Instance().Locate("ResLoaderTestData/Test.txt").empty());
+		EXPECT_FALSE(ResLoader::Instance().Locate("ResLoaderTestData/test.TXT").empty());
+		EXPECT_TRUE(ResLoader::Instance().Locate("ResLoaderTestData/Test2.txt").empty());
+
+		auto res = ResLoader::Instance().Open("ResLoaderTestData/Test.txt");
+		EXPECT_TRUE(res);
+		EXPECT_EQ(ReadWholeFile(res), sanity_string);
+		res = ResLoader::Instance().Open("ResLoaderTestData/Compressible.txt");
+		EXPECT_TRUE(res);
+		EXPECT_EQ(ReadWholeFile(res), compressible_string);
+		res.reset();
+
+		ResLoader::Instance().Unmount("ResLoaderTestData", package_name);
+		EXPECT_TRUE(ResLoader::Instance().Locate("ResLoaderTestData/Test.txt").empty());
+
+		auto in_memory = OpenKPakInMemory(package);
+		res = in_memory->Extract("Compressible.txt", "Compressible.txt");
+		EXPECT_TRUE(res);
+		EXPECT_EQ(ReadWholeFile(res), compressible_string);
+	}
+
+	std::error_code ec;
+	std::filesystem::remove(package_name, ec);
+}
+
+TEST(ResLoaderTest, CorruptedKPak)
+{
+	std::string const src_dir = ResLoader::Instance().AbsPath("../../Tests/media/ResLoader");
+	std::string const package_name = (std::filesystem::temp_directory_path() / "ResLoaderTestCorrupted.kpk").generic_string();
+	SavePackage(package_name, src_dir, true);
+	std::string const package = ReadBinaryFile(package_name);
+	std::error_code ec;
+	std::filesystem::remove(package_name, ec);
+
+	size_t const entry_offset = KPakEntryOffset(package, "Compressible.txt");
+	ASSERT_NE(entry_offset, 0U);
+	EXPECT_NO_THROW(OpenKPakInMemory(package));
+
+	EXPECT_THROW(OpenKPakInMemory(package.substr(0, 16)), std::runtime_error);
+
+	{
+		std::string corrupted = package;
+		PatchKPak(corrupted, 8, 0xFFFFFFFFU);
+		EXPECT_THROW(OpenKPakInMemory(corrupted), std::runtime_error);
+	}
+	{
+		std::string corrupted = package;
+		PatchKPak(corrupted, entry_offset + offsetof(KPakEntry, name_offset), 0xFFFFFFF0U);
+		EXPECT_THROW(OpenKPakInMemory(corrupted), std::runtime_error);
+	}
+	{
+		std::string corrupted = package;
+		PatchKPak(corrupted, entry_offset + offsetof(KPakEntry, offset), static_cast<uint64_t>(package.size()));
+		EXPECT_THROW(OpenKPakInMemory(corrupted), std::runtime_error);
+	}
+	{
+		std::string corrupted = package;
+		PatchKPak(corrupted, entry_offset + offsetof(KPakEntry, original_size), static_cast<uint64_t>(1) << 62);
+		EXPECT_THROW(OpenKPakInMemory(corrupted), std::runtime_error);
+	}
+	{
+		std::string corrupted = package;
+		PatchKPak(corrupted, entry_offset + offsetof(KPakEntry, compression), 7U);
+		EXPECT_THROW(OpenKPakInMemory(corrupted), std::runtime_error);
+	}
+}
+
+TEST(ResLoaderTest, ASyncQueryMultiThreads)
+{
+	uint32_t const old_num_threads = ResLoader::Instance().NumLoadingThreads();
+	ResLoader::Instance().NumLoadingThreads(4);
+	EXPECT_EQ(ResLoader::Instance().NumLoadingThreads(), 4U);
+
+	uint32_t const num_resources = 64;
+
+	LoadingCounters counters;
+	std::vector<std::shared_ptr<uint32_t>> resources(num_resources);
+	for (uint32_t i = 0; i < num_resources; ++ i)
+	{
+		resources[i] = ResLoader::Instance().ASyncQueryT<uint32_t>(MakeSharedPtr<CountingLoadingDesc>(i, counters),
+			static_cast<float>(i % 4));
+	}
+	ResLoader::Instance().Prioritize(resources.back(), 100.0f);
+
+	while (ResLoader::Instance().NumLoadingResources() > 0)
+	{
+		ResLoader::Instance().Update();
+		std::this_thread::yield();
+	}
+
+	EXPECT_EQ(counters.num_sub_thread_stages, num_resources);
+	EXPECT_EQ(counters.num_main_thread_stages, num_resources);
+	for (uint32_t i = 0; i < num_resources; ++ i)
+	{
+		EXPECT_EQ(*resources[i], i);
+	}
+
+	ResLoader::Instance().NumLoadingThreads(old_num_threads);
+	EXPECT_EQ(ResLoader::Instance().NumLoadingThreads(), old_num_threads);
+}
+
+TEST(ResLoaderTest, CacheBudget)
+{
+	uint64_t const old_budget = ResLoader::Instance().CacheBudget();
+
+	// Releases everything left unreferenced by other tests
+	ResLoader::Instance().CacheBudget(0);
+	ResLoader::Instance().Update();
+	ResLoader::Instance().CacheBudget(old_budget);
+
+	uint32_t const num_resources = 8;
+
+	LoadingCounters counters;
+	std::vector<std::weak_ptr<uint32_t>> weak_resources(num_resources);
+	for (uint32_t i = 0; i < num_resources; ++ i)
+	{
+		auto res = ResLoader::Instance().SyncQueryT<uint32_t>(MakeSharedPtr<CountingLoadingDesc>(i, counters));
+		EXPECT_EQ(*res, i);
+		weak_resources[i] = res;
+	}
+	EXPECT_EQ(counters.num_main_thread_stages, num_resources);
+
+	ResLoader::Instance().Update();
+	for (uint32_t i = 0; i < num_resources; ++ i)
+	{
+		EXPECT_FALSE(weak_resources[i].expired());
+	}
+
+	// Touches the first one, so that 1 and 2 are the least recently used
+	auto res0 = ResLoader::Instance().SyncQueryT<uint32_t>(MakeSharedPtr<CountingLoadingDesc>(0, counters));
+	EXPECT_EQ(counters.num_main_thread_stages, num_resources);
+	res0.reset();
+
+	ResLoader::Instance().CacheBudget(ResLoader::Instance().CacheSize() - 2 * CountingLoadingDesc::RES_SIZE);
+	ResLoader::Instance().Update();
+	EXPECT_FALSE(weak_resources[0].expired());
+	EXPECT_TRUE(weak_resources[1].expired());
+	EXPECT_TRUE(weak_resources[2].expired());
+	for (uint32_t i = 3; i < num_resources; ++ i)
+	{
+		EXPECT_FALSE(weak_resources[i].expired());
+	}
+
+	auto res1 = ResLoader::Instance().SyncQueryT<uint32_t>(MakeSharedPtr<CountingLoadingDesc>(1, counters));
+	EXPECT_EQ(*res1, 1U);
+	EXPECT_EQ(counters.num_main_thread_stages, num_resources + 1);
+
+	ResLoader::Instance().CacheBudget(old_budget);
+}
+
+TEST(ResLoaderTest, SweepExpiredResources)
+{
+	uint64_t const old_budget = ResLoader::Instance().CacheBudget();
+	ResLoader::Instance().CacheBudget(std::numeric_limits<uint64_t>::max());
+
+	LoadingCounters counters;
+	auto live_desc = MakeSharedPtr<CountingLoadingDesc>(0, counters);
+	auto live_res = ResLoader::Instance().SyncQueryT<uint32_t>(live_desc);
+	auto expired_desc = MakeSharedPtr<CountingLoadingDesc>(1, counters);
+	auto expired_res = ResLoader::Instance().SyncQueryT<uint32_t>(expired_desc);
+	uint64_t const size_with_both = ResLoader::Instance().CacheSize();
+
+	// The expired one is more recently used than a live one. It has to be removed even if the cache is within budget.
+	expired_res.reset();
+	expired_desc->ReleaseResource();
+	ResLoader::Instance().Update();
+	EXPECT_EQ(ResLoader::Instance().CacheSize(), size_with_both - CountingLoadingDesc::RES_SIZE);
+	EXPECT_EQ(*live_res, 0U);
+
+	ResLoader::Instance().CacheBudget(old_budget);
+}
+
+TEST(ResLoaderTest, CacheBudgetWithoutUpdate)
+{
+	uint64_t const old_budget = ResLoader::Instance().CacheBudget();
+
+	// Releases everything left unreferenced by other tests
+	ResLoader::Instance().CacheBudget(0);
+	ResLoader::Instance().Update();
+
+	// Unreferenced resources are evicted as new ones are added, not only in Update()
+	uint64_t const budget = ResLoader::Instance().CacheSize() + 2 * CountingLoadingDesc::RES_SIZE;
+	ResLoader::Instance().CacheBudget(budget);
+
+	LoadingCounters counters;
+	for (uint32_t i = 0; i < 8; ++ i)
+	{
+		auto res = ResLoader::Instance().SyncQueryT<uint32_t>(MakeSharedPtr<CountingLoadingDesc>(i, counters));
+		EXPECT_EQ(*res, i);
+		EXPECT_LE(ResLoader::Instance().CacheSize(), budget);
+	}
+
+	ResLoader::Instance().CacheBudget(old_budget);
+}
@@ -1,12 +1,15 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Math.hpp>
 #include <KFL/SIMDMath.hpp>
+#include <KFL/AABBox.hpp>
+#include <KFL/Frustum.hpp>
 
 #include "KlayGETests.hpp"
 
 #include <vector>
 #include <string>
 #include <iostream>
+#include <random>
 
 using namespace std;
 using namespace KlayGE;
@@ -31,3 +34,43 @@ TEST(SIMDMathTest, NormalizeVector4)
 	v = SIMDMathLib::NormalizeVector4(v);
 	EXPECT_LT(MathLib::abs(SIMDMathLib::GetX(SIMDMathLib::LengthVector4(v)) - 1.0f), 1e-3f);
 }
+
+TEST(SIMDMathTest, IntersectAABBFrustum)
+{
+	float4x4 const view_proj = MathLib::look_at_lh(float3(0, 0, -10), float3(0, 0, 0), float3(0, 1, 0))
+		* MathLib::perspective_fov_lh(PI / 4, 1.0f, 1.0f, 100.0f);
+	Frustum frustum;
+	frustum.ClipMatrix(view_proj, MathLib::inverse(view_proj));
+
+	std::ranlux24_base gen;
+	std::uniform_real_distribution<float> pos_dis(-60, 60);
+	std::uniform_real_distribution<float> size_dis(0, 20);
+
+	// Not a multiple of 4, to cover the tail
+	uint32_t const num = 1027;
+	std::vector<float> bounds[6];
+	std::vector<AABBox> aabbs;
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		float3 const min_pt(pos_dis(gen), pos_dis(gen), pos_dis(gen));
+		float3 const max_pt = min_pt + float3(size_dis(gen), size_dis(gen), size_dis(gen));
+		aabbs.emplace_back(min_pt, max_pt);
+		for (uint32_t j = 0; j < 3; ++ j)
+		{
+			bounds[j].push_back(min_pt[j]);
+			bounds[j + 3].push_back(max_pt[j]);
+		}
+	}
+
+	std::vector<BoundOverlap> results(num);
+	SIMDMathLib::IntersectAABBFrustum(frustum, bounds[0].data(), bounds[1].data(), bounds[2].data(),
+		bounds[3].data(), bounds[4].data(), bounds[5].data(), num, results.data());
+
+	uint32_t num_partial = 0;
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		EXPECT_EQ(frustum.Intersect(aabbs[i]), results[i]);
+		num_partial += (BoundOverlap::Partial == results[i]);
+	}
+	EXPECT_GT(num_partial, 0U);
+}
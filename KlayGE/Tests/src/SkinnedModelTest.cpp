@@ -0,0 +1,221 @@
+/**
+ * @file SkinnedModelTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <KFL/Math.hpp>
+#include <KlayGE/Mesh.hpp>
+#include <KlayGE/SceneNode.hpp>
+
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t const NUM_JOINTS = 6;
+	uint32_t const NUM_FRAMES = 40;
+
+	KeyFrameSet CreateKeyFrameSet(std::mt19937& gen)
+	{
+		std::uniform_real_distribution<float> dis(-1, 1);
+
+		KeyFrameSet kf;
+		for (uint32_t frame = 0; frame <= NUM_FRAMES; frame += 1 + gen() % 7)
+		{
+			Quaternion const real = MathLib::normalize(Quaternion(dis(gen), dis(gen), dis(gen), dis(gen) + 2));
+			float3 const trans(dis(gen), dis(gen), dis(gen));
+
+			kf.frame_id.push_back(frame);
+			kf.bind_real.push_back(real);
+			kf.bind_dual.push_back(MathLib::quat_trans_to_udq(real, trans));
+			kf.bind_scale.push_back(1 + dis(gen) * 0.5f);
+		}
+		return kf;
+	}
+
+	// A chain of joints, each bound to a child node of the previous one, sharing one set of key frames
+	std::shared_ptr<SkinnedModel> CreateSkinnedModel(std::shared_ptr<std::vector<KeyFrameSet>> const & kfs)
+	{
+		auto model = MakeSharedPtr<SkinnedModel>(L"SkinnedModel", SceneNode::SOA_Cullable);
+
+		std::vector<JointComponentPtr> joints(NUM_JOINTS);
+		SceneNode* parent_node = model->RootNode().get();
+		for (uint32_t i = 0; i < NUM_JOINTS; ++ i)
+		{
+			auto node = MakeSharedPtr<SceneNode>(L"Joint", SceneNode::SOA_Cullable);
+			parent_node->AddChild(node);
+
+			joints[i] = MakeSharedPtr<JointComponent>();
+			joints[i]->BindParams((*kfs)[i].bind_real[0], (*kfs)[i].bind_dual[0], (*kfs)[i].bind_scale[0]);
+			joints[i]->InitInverseOriginParams();
+			node->AddComponent(joints[i]);
+
+			parent_node = node.get();
+		}
+
+		model->AssignJoints(joints.begin(), joints.end());
+		model->AttachKeyFrameSets(kfs);
+		model->NumFrames(NUM_FRAMES);
+		model->FrameRate(30);
+
+		return model;
+	}
+
+	void ExpectQuaternionEq(Quaternion const & expected, Quaternion const & actual)
+	{
+		EXPECT_EQ(expected.x(), actual.x());
+		EXPECT_EQ(expected.y(), actual.y());
+		EXPECT_EQ(expected.z(), actual.z());
+		EXPECT_EQ(expected.w(), actual.w());
+	}
+
+	void ExpectSameJoints(SkinnedModel const & expected, SkinnedModel const & actual)
+	{
+		EXPECT_EQ(expected.GetFrame(), actual.GetFrame());
+		ASSERT_EQ(expected.NumJoints(), actual.NumJoints());
+		for (uint32_t i = 0; i < expected.NumJoints(); ++ i)
+		{
+			ExpectQuaternionEq(expected.GetJoint(i)->BindReal(), actual.GetJoint(i)->BindReal());
+			ExpectQuaternionEq(expected.GetJoint(i)->BindDual(), actual.GetJoint(i)->BindDual());
+			EXPECT_EQ(expected.GetJoint(i)->BindScale(), actual.GetJoint(i)->BindScale());
+		}
+	}
+}
+
+TEST(SkinnedModelTest, KeyFrameWithHint)
+{
+	std::mt19937 gen(0);
+	KeyFrameSet const kf = CreateKeyFrameSet(gen);
+
+	std::vector<float> frames;
+	for (float frame = 0; frame < NUM_FRAMES + 2; frame += 0.25f)
+	{
+		frames.push_back(frame);
+	}
+	for (float frame = NUM_FRAMES + 2.0f; frame >= 0; frame -= 0.75f)
+	{
+		frames.push_back(frame);
+	}
+	std::uniform_real_distribution<float> dis(0, static_cast<float>(NUM_FRAMES));
+	for (uint32_t i = 0; i < 200; ++ i)
+	{
+		frames.push_back(dis(gen));
+	}
+
+	uint32_t hint = 0;
+	for (float const frame : frames)
+	{
+		auto const expected = kf.Frame(frame);
+		auto const actual = kf.Frame(frame, hint);
+		ASSERT_LT(hint, kf.frame_id.size());
+
+		ExpectQuaternionEq(std::get<0>(expected), std::get<0>(actual));
+		ExpectQuaternionEq(std::get<1>(expected), std::get<1>(actual));
+		EXPECT_EQ(std::get<2>(expected), std::get<2>(actual));
+	}
+}
+
+TEST(SkinnedModelTest, SetFramesMatchesSetFrame)
+{
+	std::mt19937 gen(1);
+	auto kfs = MakeSharedPtr<std::vector<KeyFrameSet>>();
+	for (uint32_t i = 0; i < NUM_JOINTS; ++ i)
+	{
+		kfs->push_back(CreateKeyFrameSet(gen));
+	}
+
+	uint32_t const NUM_MODELS = 37;
+	std::vector<std::shared_ptr<SkinnedModel>> ref_models;
+	std::vector<std::shared_ptr<SkinnedModel>> batch_models;
+	std::vector<SkinnedModel*> batch_model_ptrs;
+	for (uint32_t i = 0; i < NUM_MODELS; ++ i)
+	{
+		ref_models.push_back(CreateSkinnedModel(kfs));
+		batch_models.push_back(CreateSkinnedModel(kfs));
+		batch_model_ptrs.push_back(batch_models.back().get());
+	}
+
+	std::uniform_real_distribution<float> dis(0, static_cast<float>(NUM_FRAMES));
+	std::vector<float> frames(NUM_MODELS);
+	for (uint32_t round = 0; round < 4; ++ round)
+	{
+		for (uint32_t i = 0; i < NUM_MODELS; ++ i)
+		{
+			// Some models keep their frame, to cover the ones SetFrames skips
+			if ((round == 0) || (i % 3 != 0))
+			{
+				frames[i] = dis(gen);
+			}
+			ref_models[i]->SetFrame(frames[i]);
+		}
+
+		SkinnedModel::SetFrames(batch_model_ptrs, frames);
+
+		for (uint32_t i = 0; i < NUM_MODELS; ++ i)
+		{
+			ExpectSameJoints(*ref_models[i], *batch_models[i]);
+		}
+	}
+}
+
+TEST(SkinnedModelTest, QueueFrame)
+{
+	std::mt19937 gen(2);
+	auto kfs = MakeSharedPtr<std::vector<KeyFrameSet>>();
+	for (uint32_t i = 0; i < NUM_JOINTS; ++ i)
+	{
+		kfs->push_back(CreateKeyFrameSet(gen));
+	}
+
+	auto ref_model = CreateSkinnedModel(kfs);
+	auto queued_model = CreateSkinnedModel(kfs);
+
+	queued_model->QueueFrame(3.5f);
+	queued_model->QueueFrame(7.25f);
+	{
+		// A destroyed model leaves the queue
+		auto destroyed_model = CreateSkinnedModel(kfs);
+		destroyed_model->QueueFrame(1.0f);
+	}
+	EXPECT_EQ(queued_model->GetFrame(), 0.0f);
+
+	SkinnedModel::UpdateQueuedFrames();
+	ref_model->SetFrame(7.25f);
+	ExpectSameJoints(*ref_model, *queued_model);
+
+	SkinnedModel::UpdateQueuedFrames();
+	EXPECT_EQ(queued_model->GetFrame(), 7.25f);
+}
@@ -0,0 +1,217 @@
+/**
+ * @file TaskSchedulerTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <KFL/TaskScheduler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+TEST(TaskSchedulerTest, Submit)
+{
+	task_scheduler scheduler(3);
+
+	std::atomic<uint32_t> counter(0);
+	std::atomic<uint32_t> sum(0);
+	for (uint32_t i = 0; i < 1000; ++ i)
+	{
+		scheduler.submit([&sum, i] { sum += i; }, &counter);
+	}
+	scheduler.wait(counter);
+
+	EXPECT_EQ(counter.load(), 0U);
+	EXPECT_EQ(sum.load(), 999U * 1000 / 2);
+}
+
+TEST(TaskSchedulerTest, ParallelFor)
+{
+	for (uint32_t num_workers : { 1U, 3U, 7U })
+	{
+		task_scheduler scheduler(num_workers);
+
+		std::vector<uint32_t> values(100003, 0);
+		std::atomic<uint32_t> max_range(0);
+		scheduler.parallel_for(0, static_cast<uint32_t>(values.size()), 97, [&values, &max_range](uint32_t first, uint32_t last)
+			{
+				uint32_t range = last - first;
+				uint32_t prev = max_range.load();
+				while ((range > prev) && !max_range.compare_exchange_weak(prev, range))
+				{
+				}
+
+				for (uint32_t i = first; i < last; ++ i)
+				{
+					values[i] += i;
+				}
+			});
+
+		EXPECT_LE(max_range.load(), 97U);
+		for (uint32_t i = 0; i < values.size(); ++ i)
+		{
+			EXPECT_EQ(values[i], i);
+		}
+	}
+}
+
+TEST(TaskSchedulerTest, NestedParallelFor)
+{
+	task_scheduler scheduler(3);
+
+	std::atomic<uint32_t> count(0);
+	scheduler.parallel_for(0, 64, 1, [&scheduler, &count](uint32_t first, uint32_t last)
+		{
+			for (uint32_t i = first; i < last; ++ i)
+			{
+				scheduler.parallel_for(0, 100, 10, [&count](uint32_t inner_first, uint32_t inner_last)
+					{
+						count += inner_last - inner_first;
+					});
+			}
+		});
+
+	EXPECT_EQ(count.load(), 6400U);
+}
+
+TEST(TaskSchedulerTest, TaskGroupException)
+{
+	task_scheduler scheduler(3);
+
+	std::atomic<uint32_t> count(0);
+	task_group group(scheduler);
+	for (uint32_t i = 0; i < 16; ++ i)
+	{
+		group.run([&count, i]
+			{
+				++ count;
+				if (i == 5)
+				{
+					throw std::runtime_error("task failed");
+				}
+			});
+	}
+
+	EXPECT_THROW(group.wait(), std::runtime_error);
+	EXPECT_EQ(count.load(), 16U);
+}
+
+TEST(TaskSchedulerTest, SubmitWithoutWait)
+{
+	task_scheduler scheduler;
+
+	// Nobody waits, so only a worker can run it
+	std::atomic<bool> done{false};
+	scheduler.submit([&done] { done = true; });
+	for (uint32_t i = 0; (i < 5000) && !done; ++ i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_TRUE(done);
+}
+
+TEST(TaskSchedulerTest, DefaultWorkers)
+{
+	task_scheduler scheduler;
+	EXPECT_EQ(scheduler.concurrency(), std::max(std::thread::hardware_concurrency(), 2U));
+	EXPECT_GE(scheduler.num_workers(), 1U);
+
+	std::mutex sum_mutex;
+	uint32_t sum = 0;
+	scheduler.parallel_for(0, 1000, 10, [&sum_mutex, &sum](uint32_t first, uint32_t last)
+		{
+			std::lock_guard<std::mutex> lock(sum_mutex);
+			for (uint32_t i = first; i < last; ++ i)
+			{
+				sum += i;
+			}
+		});
+
+	EXPECT_EQ(sum, 999U * 1000 / 2);
+}
+
+TEST(TaskSchedulerTest, SubmitException)
+{
+	task_scheduler scheduler(3);
+
+	// Exceptions from raw tasks are dropped, the workers keep running and the counter still reaches 0
+	std::atomic<uint32_t> counter(0);
+	std::atomic<uint32_t> count(0);
+	for (uint32_t i = 0; i < 100; ++ i)
+	{
+		scheduler.submit([&count, i]
+			{
+				++ count;
+				if (i % 10 == 0)
+				{
+					throw std::runtime_error("task failed");
+				}
+			}, &counter);
+	}
+	EXPECT_NO_THROW(scheduler.wait(counter));
+	EXPECT_EQ(counter.load(), 0U);
+	EXPECT_EQ(count.load(), 100U);
+
+	std::atomic<uint32_t> sum(0);
+	scheduler.parallel_for(0, 1000, 10, [&sum](uint32_t first, uint32_t last)
+		{
+			for (uint32_t i = first; i < last; ++ i)
+			{
+				sum += i;
+			}
+		});
+	EXPECT_EQ(sum.load(), 999U * 1000 / 2);
+}
+
+TEST(TaskSchedulerTest, ParallelForException)
+{
+	task_scheduler scheduler(3);
+
+	// The first range, run on the calling thread, throws while the other ranges are still queued
+	std::atomic<uint32_t> count(0);
+	EXPECT_THROW(scheduler.parallel_for(0, 1024, 1, [&count](uint32_t first, uint32_t last)
+		{
+			count += last - first;
+			if (first == 0)
+			{
+				throw std::runtime_error("range failed");
+			}
+		}), std::runtime_error);
+	EXPECT_EQ(count.load(), 1024U);
+}
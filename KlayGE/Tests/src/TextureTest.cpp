@@ -220,3 +220,45 @@ TEST_F(TextureTest, UpdateCompressedCPUSubTexture)
 #endif
 	TestUpdateSubTexture("Lenna_bc1.dds", "Lenna_SubTexture_bc1.dds", false, tolerance);
 }
+
+TEST_F(TextureTest, ResampleConstant)
+{
+	// Normalized weights keep a constant image constant, both when shrinking and when enlarging
+	std::vector<uint8_t> const src(37 * 23 * 4, 77);
+	for (auto filter : {ResampleFilter::Point, ResampleFilter::Box, ResampleFilter::Linear, ResampleFilter::Kaiser,
+			 ResampleFilter::Lanczos3})
+	{
+		std::vector<uint8_t> shrunk(9 * 5 * 4);
+		ResizeTexture(shrunk.data(), 9 * 4, 9 * 5 * 4, EF_ABGR8, 9, 5, 1,
+			src.data(), 37 * 4, 37 * 23 * 4, EF_ABGR8, 37, 23, 1, filter);
+		for (auto value : shrunk)
+		{
+			EXPECT_EQ(value, 77);
+		}
+
+		std::vector<uint8_t> enlarged(80 * 50 * 4);
+		ResizeTexture(enlarged.data(), 80 * 4, 80 * 50 * 4, EF_ABGR8, 80, 50, 1,
+			src.data(), 37 * 4, 37 * 23 * 4, EF_ABGR8, 37, 23, 1, filter);
+		for (auto value : enlarged)
+		{
+			EXPECT_EQ(value, 77);
+		}
+	}
+}
+
+TEST_F(TextureTest, ResampleBoxAverage)
+{
+	float src[4 * 4];
+	for (uint32_t i = 0; i < 16; ++ i)
+	{
+		src[i] = static_cast<float>(i);
+	}
+
+	float dst[2 * 2];
+	ResizeTexture(dst, 2 * sizeof(float), sizeof(dst), EF_R32F, 2, 2, 1,
+		src, 4 * sizeof(float), sizeof(src), EF_R32F, 4, 4, 1, ResampleFilter::Box);
+	EXPECT_FLOAT_EQ(dst[0], 2.5f);
+	EXPECT_FLOAT_EQ(dst[1], 4.5f);
+	EXPECT_FLOAT_EQ(dst[2], 10.5f);
+	EXPECT_FLOAT_EQ(dst[3], 12.5f);
+}
@@ -0,0 +1,359 @@
+/**
+ * @file TransientBufferTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <KFL/Timer.hpp>
+#include <KlayGE/TransientBuffer.hpp>
+
+#include <iostream>
+#include <list>
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// The first fit free list TransientBuffer used before, kept as the baseline of the benchmark
+	class FirstFitListSubAllocator
+	{
+	public:
+		explicit FirstFitListSubAllocator(uint32_t capacity)
+		{
+			free_list_.push_back(SubAlloc(0, capacity));
+		}
+
+		bool Alloc(uint32_t size_in_byte, SubAlloc& alloc)
+		{
+			for (auto iter = free_list_.begin(); iter != free_list_.end(); ++ iter)
+			{
+				if (iter->length_ >= size_in_byte)
+				{
+					alloc = SubAlloc(iter->offset_, size_in_byte);
+					if (iter->length_ == size_in_byte)
+					{
+						free_list_.erase(iter);
+					}
+					else
+					{
+						iter->offset_ += size_in_byte;
+						iter->length_ -= size_in_byte;
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void Free(SubAlloc const & alloc)
+		{
+			auto next = free_list_.begin();
+			while ((next != free_list_.end()) && (next->offset_ < alloc.offset_))
+			{
+				++ next;
+			}
+			auto iter = free_list_.insert(next, alloc);
+			if ((next != free_list_.end()) && (iter->offset_ + iter->length_ == next->offset_))
+			{
+				iter->length_ += next->length_;
+				free_list_.erase(next);
+			}
+			if (iter != free_list_.begin())
+			{
+				auto prev = std::prev(iter);
+				if (prev->offset_ + prev->length_ == iter->offset_)
+				{
+					prev->length_ += iter->length_;
+					free_list_.erase(iter);
+				}
+			}
+		}
+
+	private:
+		std::list<SubAlloc> free_list_;
+	};
+
+	bool Overlapped(SubAlloc const & lhs, SubAlloc const & rhs)
+	{
+		return (lhs.offset_ < rhs.offset_ + rhs.length_) && (rhs.offset_ < lhs.offset_ + lhs.length_);
+	}
+}
+
+TEST(TransientBufferTest, FrameRing)
+{
+	FrameRingSubAllocator ring(1000);
+
+	SubAlloc allocs[4];
+	for (uint32_t i = 0; i < 3; ++ i)
+	{
+		EXPECT_TRUE(ring.Alloc(300, allocs[i]));
+		EXPECT_EQ(allocs[i].offset_, i * 300);
+		EXPECT_EQ(allocs[i].length_, 300U);
+	}
+	EXPECT_FALSE(ring.Alloc(300, allocs[3]));
+	ring.EndFrame(1);
+
+	// The space comes back only after the frame is retired
+	ring.RetireFrames(0);
+	EXPECT_FALSE(ring.Alloc(300, allocs[3]));
+	ring.RetireFrames(1);
+
+	// Never wraps around the end
+	EXPECT_TRUE(ring.Alloc(300, allocs[3]));
+	EXPECT_EQ(allocs[3].offset_, 0U);
+	EXPECT_TRUE(ring.Alloc(600, allocs[3]));
+	EXPECT_EQ(allocs[3].offset_, 300U);
+	EXPECT_FALSE(ring.Alloc(200, allocs[3]));
+	ring.EndFrame(2);
+
+	ring.Grow(2000);
+	EXPECT_EQ(ring.Capacity(), 2000U);
+	EXPECT_TRUE(ring.Alloc(1000, allocs[0]));
+	EXPECT_EQ(allocs[0].offset_, 1000U);
+	EXPECT_FALSE(ring.Alloc(4, allocs[1]));
+	ring.EndFrame(3);
+
+	// The old range is in use until the frame that grows the ring is retired
+	ring.RetireFrames(2);
+	EXPECT_FALSE(ring.Alloc(4, allocs[1]));
+	ring.RetireFrames(3);
+	EXPECT_TRUE(ring.Alloc(2000, allocs[1]));
+	EXPECT_EQ(allocs[1].offset_, 0U);
+}
+
+TEST(TransientBufferTest, Tlsf)
+{
+	uint32_t const capacity = 1U << 20;
+	TlsfSubAllocator tlsf(capacity);
+
+	std::ranlux24_base gen;
+	std::uniform_int_distribution<uint32_t> size_dis(1, 4096);
+	std::vector<SubAlloc> allocs;
+	for (uint32_t iter = 0; iter < 20000; ++ iter)
+	{
+		if (!allocs.empty() && ((gen() & 3) == 0))
+		{
+			size_t const index = gen() % allocs.size();
+			tlsf.Free(allocs[index]);
+			allocs[index] = allocs.back();
+			allocs.pop_back();
+		}
+		else
+		{
+			SubAlloc alloc;
+			if (tlsf.Alloc(size_dis(gen), alloc))
+			{
+				EXPECT_LE(alloc.offset_ + alloc.length_, capacity);
+				for (auto const & other : allocs)
+				{
+					EXPECT_FALSE(Overlapped(alloc, other));
+				}
+				allocs.push_back(alloc);
+			}
+		}
+	}
+
+	for (auto const & alloc : allocs)
+	{
+		tlsf.Free(alloc);
+	}
+
+	// Everything is merged back into one block
+	SubAlloc alloc;
+	EXPECT_TRUE(tlsf.Alloc(capacity, alloc));
+	EXPECT_EQ(alloc.offset_, 0U);
+	EXPECT_FALSE(tlsf.Alloc(4, alloc));
+
+	tlsf.Grow(capacity * 2);
+	EXPECT_TRUE(tlsf.Alloc(capacity, alloc));
+	EXPECT_EQ(alloc.offset_, capacity);
+}
+
+// Text and UI style traffic: many small batches per frame, all released a few frames later
+TEST(TransientBufferTest, FrameTraffic)
+{
+	uint32_t const num_pre_frames = 3;
+	uint32_t const allocs_per_frame = 200;
+	uint32_t const max_size = 16 * 4 * 24;
+	// Twice the worst case of the frames in flight, the ring skips the space at the end that is too small
+	uint32_t const capacity = 2 * (num_pre_frames + 1) * allocs_per_frame * max_size;
+
+	std::ranlux24_base gen;
+	std::uniform_int_distribution<uint32_t> dis(1, 16);
+
+	FrameRingSubAllocator ring(capacity);
+	TlsfSubAllocator tlsf(capacity);
+	std::vector<std::vector<SubAlloc>> tlsf_frames(num_pre_frames + 1);
+	for (uint32_t frame = 0; frame < 50; ++ frame)
+	{
+		auto& tlsf_allocs = tlsf_frames[frame % tlsf_frames.size()];
+		for (uint32_t i = 0; i < allocs_per_frame; ++ i)
+		{
+			uint32_t const size = dis(gen) * 4 * 24;
+
+			// Both have room for all frames in flight
+			SubAlloc alloc;
+			EXPECT_TRUE(ring.Alloc(size, alloc));
+			EXPECT_LE(alloc.offset_ + alloc.length_, capacity);
+			EXPECT_TRUE(tlsf.Alloc(size, alloc));
+			tlsf_allocs.push_back(alloc);
+		}
+
+		ring.EndFrame(frame);
+		if (frame >= num_pre_frames)
+		{
+			ring.RetireFrames(frame - num_pre_frames);
+		}
+
+		auto& oldest = tlsf_frames[(frame + 1) % tlsf_frames.size()];
+		for (auto const & alloc : oldest)
+		{
+			tlsf.Free(alloc);
+		}
+		oldest.clear();
+	}
+}
+
+// Benchmarks against the first fit free list, disabled by default. Run with --gtest_also_run_disabled_tests.
+
+// Text and UI style traffic: many small batches per frame, all released a few frames later
+TEST(TransientBufferTest, DISABLED_SubAllocatorBenchmark)
+{
+	uint32_t const capacity = 16U << 20;
+	uint32_t const num_frames = 100;
+	uint32_t const allocs_per_frame = 2000;
+	uint32_t const num_pre_frames = 3;
+
+	std::vector<uint32_t> sizes(allocs_per_frame);
+	{
+		std::ranlux24_base gen;
+		std::uniform_int_distribution<uint32_t> dis(1, 16);
+		for (auto& size : sizes)
+		{
+			size = dis(gen) * 4 * 24;
+		}
+	}
+
+	auto run = [&](auto& allocator, auto&& end_frame)
+	{
+		std::vector<std::vector<SubAlloc>> frames(num_pre_frames + 1);
+		Timer timer;
+		for (uint32_t frame = 0; frame < num_frames; ++ frame)
+		{
+			auto& allocs = frames[frame % frames.size()];
+			for (auto size : sizes)
+			{
+				SubAlloc alloc;
+				EXPECT_TRUE(allocator.Alloc(size, alloc));
+				allocs.push_back(alloc);
+			}
+			end_frame(frame, frames[(frame + 1) % frames.size()]);
+		}
+		return timer.elapsed() * 1000 / num_frames;
+	};
+
+	// Pending frees used to go through std::list, like RetiredFrame::pending_frees_ did
+	FirstFitListSubAllocator first_fit(capacity);
+	double const first_fit_time = run(first_fit, [&first_fit](uint32_t frame, std::vector<SubAlloc>& oldest)
+		{
+			KFL_UNUSED(frame);
+			std::list<SubAlloc> pending_frees(oldest.begin(), oldest.end());
+			for (auto const & alloc : pending_frees)
+			{
+				first_fit.Free(alloc);
+			}
+			oldest.clear();
+		});
+
+	FrameRingSubAllocator ring(capacity);
+	double const ring_time = run(ring, [&ring, num_pre_frames](uint32_t frame, std::vector<SubAlloc>& oldest)
+		{
+			ring.EndFrame(frame);
+			if (frame >= num_pre_frames)
+			{
+				ring.RetireFrames(frame - num_pre_frames);
+			}
+			oldest.clear();
+		});
+
+	TlsfSubAllocator tlsf(capacity);
+	double const tlsf_time = run(tlsf, [&tlsf](uint32_t frame, std::vector<SubAlloc>& oldest)
+		{
+			KFL_UNUSED(frame);
+			for (auto const & alloc : oldest)
+			{
+				tlsf.Free(alloc);
+			}
+			oldest.clear();
+		});
+
+	std::cout << "Per frame of " << allocs_per_frame << " sub allocs: first fit list " << first_fit_time << " ms, frame ring "
+		<< ring_time << " ms, TLSF " << tlsf_time << " ms" << std::endl;
+}
+
+// Sub allocs with random life times, the free list gets fragmented
+TEST(TransientBufferTest, DISABLED_FragmentedSubAllocatorBenchmark)
+{
+	uint32_t const capacity = 64U << 20;
+	uint32_t const num_live = 4000;
+	uint32_t const num_steps = 100000;
+
+	auto run = [&](auto& allocator)
+	{
+		std::ranlux24_base gen;
+		std::uniform_int_distribution<uint32_t> size_dis(1, 64);
+		std::vector<SubAlloc> allocs(num_live);
+		for (auto& alloc : allocs)
+		{
+			EXPECT_TRUE(allocator.Alloc(size_dis(gen) * 4 * 24, alloc));
+		}
+
+		Timer timer;
+		for (uint32_t step = 0; step < num_steps; ++ step)
+		{
+			auto& alloc = allocs[gen() % num_live];
+			allocator.Free(alloc);
+			EXPECT_TRUE(allocator.Alloc(size_dis(gen) * 4 * 24, alloc));
+		}
+		return timer.elapsed() * 1e9 / num_steps;
+	};
+
+	FirstFitListSubAllocator first_fit(capacity);
+	double const first_fit_time = run(first_fit);
+	TlsfSubAllocator tlsf(capacity);
+	double const tlsf_time = run(tlsf);
+
+	std::cout << "Per free and alloc with " << num_live << " live sub allocs: first fit list " << first_fit_time << " ns, TLSF "
+		<< tlsf_time << " ns" << std::endl;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file KPakPacker.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Package.hpp>
+
+#include <iostream>
+#include <string>
+
+#ifndef KLAYGE_DEBUG
+#define CXXOPTS_NO_RTTI
+#endif
+#include <cxxopts.hpp>
+
+using namespace std;
+using namespace KlayGE;
+
+int main(int argc, char* argv[])
+{
+	std::string input_name;
+	std::string output_name;
+
+	cxxopts::Options options("KPakPacker", "KlayGE Package Packer");
+	options.add_options()
+		("H,help", "Produce help message.")
+		("I,input-name", "Input directory name.", cxxopts::value<std::string>())
+		("O,output-name", "Output package name. Default is the input directory name with .kpk.", cxxopts::value<std::string>())
+		("S,store", "Store all files without compression.")
+		("v,version", "Version.");
+
+	int const argc_backup = argc;
+	auto vm = options.parse(argc, argv);
+
+	if ((argc_backup <= 1) || (vm.count("help") > 0))
+	{
+		cout << options.help() << endl;
+		return 1;
+	}
+	if (vm.count("version") > 0)
+	{
+		cout << "KlayGE Package Packer, Version 1.0.0" << endl;
+		return 1;
+	}
+	if (vm.count("input-name") > 0)
+	{
+		input_name = vm["input-name"].as<std::string>();
+	}
+	else
+	{
+		cout << "Need input directory name." << endl;
+		cout << options.help() << endl;
+		return 1;
+	}
+	if (!filesystem::is_directory(input_name))
+	{
+		cout << "Couldn't find " << input_name << "." << endl;
+		return 1;
+	}
+	if (vm.count("output-name") > 0)
+	{
+		output_name = vm["output-name"].as<std::string>();
+	}
+	else
+	{
+		filesystem::path input_path(input_name);
+		if (!input_path.has_filename())
+		{
+			input_path = input_path.parent_path();
+		}
+		output_name = input_path.string() + ".kpk";
+	}
+	bool const compress = (vm.count("store") == 0);
+
+	Timer timer;
+	SavePackage(output_name, input_name, compress);
+	cout << "Saved " << output_name << ", takes " << timer.elapsed() << "s" << endl;
+
+	Context::Destroy();
+
+	return 0;
+}
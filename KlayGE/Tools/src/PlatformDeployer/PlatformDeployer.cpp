@@ -40,6 +40,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <vector>
 #include <regex>
 
@@ -140,19 +141,26 @@ void Deploy(std::vector<std::string> const & res_names, std::string_view res_typ
 	{
 		TexMetadata const default_metadata = DefaultTextureMetadata(res_type_hash, caps);
 
-		TexConverter tc;
+		std::vector<TexMetadata> metadata(res_names.size());
 		for (size_t i = 0; i < res_names.size(); ++ i)
 		{
-			std::cout << "Converting " << res_names[i] << " to " << res_type << std::endl;
+			metadata[i] = LoadTextureMetadata(res_names[i], default_metadata);
+		}
 
-			auto metadata = LoadTextureMetadata(res_names[i], default_metadata);
-			auto output_tex = tc.Load(res_names[i], metadata);
-			if (output_tex)
+		std::mutex output_mutex;
+		TexConverter tc;
+		tc.LoadBatch(res_names, metadata, [&res_names, res_type, &output_mutex](uint32_t index, TexturePtr const & output_tex)
 			{
-				filesystem::path res_path(res_names[i]);
-				SaveTexture(output_tex, res_path.string() + ".dds");
-			}
-		}
+				if (output_tex)
+				{
+					filesystem::path res_path(res_names[index]);
+					SaveTexture(output_tex, res_path.string() + ".dds");
+				}
+
+				std::lock_guard<std::mutex> lock(output_mutex);
+				std::cout << (output_tex ? "Converted " : "Failed to convert ") << res_names[index] << " to " << res_type
+					<< std::endl;
+			});
 	}
 	else if (CT_HASH("model") == res_type_hash)
 	{
@@ -168,7 +176,7 @@ void Deploy(std::vector<std::string> const & res_names, std::string_view res_typ
 			if (output_model)
 			{
 				filesystem::path res_path(res_names[i]);
-				SaveModel(*output_model, res_path.string() + ".model_bin");
+				SaveModel(*output_model, res_path.string() + ".model_bin", true);
 			}
 		}
 	}
@@ -276,13 +284,34 @@ int main(int argc, char* argv[])
 		for (auto& arg : tokens)
 		{
 			arg = StringUtil::Trim(arg);
-			if ((std::string::npos == arg.find('*')) && (std::string::npos == arg.find('?')))
+			filesystem::path const arg_path(arg.begin(), arg.end());
+			if (filesystem::is_directory(arg_path))
+			{
+				// A whole directory, without the metadata and the outputs of earlier runs
+				for (filesystem::recursive_directory_iterator i(arg_path), end_itr; i != end_itr; ++ i)
+				{
+					if (filesystem::is_regular_file(i->status()))
+					{
+						auto const & path = i->path();
+						if (path.extension() == ".kmeta")
+						{
+							continue;
+						}
+						auto const source_path = path.parent_path() / path.stem();
+						if (source_path.has_extension() && filesystem::exists(source_path))
+						{
+							continue;
+						}
+						res_names.push_back(path.string());
+					}
+				}
+			}
+			else if ((std::string::npos == arg.find('*')) && (std::string::npos == arg.find('?')))
 			{
 				res_names.push_back(std::string(arg));
 			}
 			else
 			{
-				filesystem::path arg_path(arg.begin(), arg.end());
 				auto const parent = arg_path.parent_path();
 				auto const file_name = arg_path.filename();
 